@@ -459,6 +459,8 @@ class PaddingCmd : public Cmd {
  private:
   void DoInitial() override;
   std::string ToRedisProtocol() override;
+  // The padding item is not a command, it is written as is in any format
+  std::string ToBinlogBinary(const std::string& compression) override { return ToRedisProtocol(); }
 };
 
 class PKPatternMatchDelCmd : public Cmd {
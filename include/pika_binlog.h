@@ -7,6 +7,10 @@
 #define PIKA_BINLOG_H_
 
 #include <atomic>
+#include <deque>
+#include <map>
+#include <thread>
+#include <vector>
 
 #include "pstd/include/env.h"
 #include "pstd/include/pstd_mutex.h"
@@ -25,11 +29,15 @@ class Version final : public pstd::noncopyable {
 
   // RWLock should be held when access members.
   pstd::Status StableSave();
+  // Save the producer status of an earlier sync point instead of the current one
+  pstd::Status StableSave(uint32_t pro_num, uint64_t pro_offset, uint64_t logic_id);
 
   uint32_t pro_num_ = 0;
   uint64_t pro_offset_ = 0;
   uint64_t logic_id_ = 0;
   uint32_t term_ = 0;
+  // Bumped whenever the producer rolls, or is set or truncated, not saved
+  uint64_t epoch_ = 0;
 
   std::shared_mutex rwlock_;
 
@@ -43,6 +51,36 @@ class Version final : public pstd::noncopyable {
   std::shared_ptr<pstd::RWFile> save_;
 };
 
+/*
+ * Read-only mapping of a binlog file which is no longer written,
+ * shared by all the binlog readers of the same file
+ */
+class BinlogMapping final : public pstd::noncopyable {
+ public:
+  ~BinlogMapping();
+
+  // Return nullptr if the file can not be mapped
+  static std::shared_ptr<BinlogMapping> Open(const std::string& filename);
+
+  const char* data() const { return base_; }
+  size_t size() const { return size_; }
+
+ private:
+  BinlogMapping(char* base, size_t size) : base_(base), size_(size) {}
+
+  char* base_ = nullptr;
+  size_t size_ = 0;
+};
+
+enum class BinlogSyncPolicy {
+  // Save the manifest after every group of records, the file is not synced
+  kRecord,
+  // The syncer syncs the file and saves the manifest every sync interval
+  kInterval,
+  // The syncer syncs the file and saves the manifest every sync bytes appended
+  kBytes,
+};
+
 class Binlog : public pstd::noncopyable {
  public:
   Binlog(std::string  Binlog_path, int file_size = 100 * 1024 * 1024);
@@ -51,7 +89,15 @@ class Binlog : public pstd::noncopyable {
   void Lock() { mutex_.lock(); }
   void Unlock() { mutex_.unlock(); }
 
+  // Concurrent callers are committed in groups: the first one in the queue
+  // appends the records of all the waiting callers under one lock, with a
+  // single flush and manifest save, then wakes them up with their status.
   pstd::Status Put(const std::string& item);
+  // The callers queued in Put, the leader of the group being appended included
+  size_t PendingWriters() {
+    std::lock_guard l(writers_mu_);
+    return writers_.size();
+  }
 
   pstd::Status GetProducerStatus(uint32_t* filenum, uint64_t* pro_offset, uint32_t* term = nullptr, uint64_t* logic_id = nullptr);
   /*
@@ -77,11 +123,39 @@ class Binlog : public pstd::noncopyable {
 
   void Close();
 
+  // Start the background syncer unless the policy is kRecord,
+  // invoked once after the binlog is opened
+  void StartSyncer(BinlogSyncPolicy policy, uint64_t interval_ms, uint64_t bytes);
+  // Sync the file and then save the manifest, need not hold Lock(), the
+  // appends are only held while the producer status is taken
+  pstd::Status Sync();
+
+  // The shared mapping of a binlog file, nullptr if the file is still written
+  std::shared_ptr<BinlogMapping> MapFile(uint32_t filenum);
+
  private:
+  struct Writer {
+    explicit Writer(const std::string* i) : item(i) {}
+    const std::string* item = nullptr;
+    pstd::Status status;
+    bool done = false;
+    pstd::CondVar cv;
+  };
+
+  // Need to hold writers_mu_ and be the front of writers_
+  void BuildGroup(std::vector<Writer*>* group);
+  pstd::Status PutGroup(const std::vector<Writer*>& group, size_t* appended);
+  // Need to hold mutex_, open the next file once the current one is full
+  pstd::Status MaybeRoll();
+  // Need to hold mutex_, the record is flushed and saved by the caller
   pstd::Status Put(const char* item, int len);
   pstd::Status EmitPhysicalRecord(RecordType t, const char* ptr, size_t n, int* temp_pro_offset);
   static pstd::Status AppendPadding(pstd::WritableFile* file, uint64_t* len);
   void InitLogFile();
+  // Rebuild the producer offset from the records behind the saved one
+  void RecoverTail();
+  void StopSyncer();
+  void RunSyncer();
 
   /*
    * Produce
@@ -97,6 +171,24 @@ class Binlog : public pstd::noncopyable {
 
   pstd::Mutex mutex_;
 
+  // callers waiting to be committed, the front one is the group leader
+  pstd::Mutex writers_mu_;
+  std::deque<Writer*> writers_;
+
+  BinlogSyncPolicy sync_policy_ = BinlogSyncPolicy::kRecord;
+  uint64_t sync_interval_ms_ = 0;
+  uint64_t sync_bytes_ = 0;
+  // bytes appended since the last sync
+  std::atomic<uint64_t> unsynced_bytes_{0};
+  pstd::Mutex sync_mu_;
+  pstd::CondVar sync_cv_;
+  bool sync_exit_ = false;
+  std::thread syncer_;
+
+  // Mappings alive as long as some reader holds them
+  pstd::Mutex mappings_mu_;
+  std::map<uint32_t, std::weak_ptr<BinlogMapping>> mappings_;
+
   uint32_t pro_num_ = 0;
 
   int block_offset_ = 0;
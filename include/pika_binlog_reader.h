@@ -28,6 +28,10 @@ class PikaBinlogReader {
   void GetReaderStatus(uint32_t* cur_filenum, uint64_t* cur_offset);
 
  private:
+  // Open filenum on the shared mapping if enabled and the file is no
+  // longer written, on a sequential file otherwise
+  pstd::Status OpenFile(const std::shared_ptr<Binlog>& logger, uint32_t filenum,
+                        std::unique_ptr<pstd::SequentialFile>* file);
   bool GetNext(uint64_t* size);
   unsigned int ReadPhysicalRecord(pstd::Slice* result, uint32_t* filenum, uint64_t* offset);
   // Returns scratch binflog and corresponding offset
@@ -9,6 +9,7 @@
 #include <glog/logging.h>
 #include <cstdint>
 #include <iostream>
+#include <string>
 #include <vector>
 
 /******************* Type First Binlog Item Format ******************
@@ -26,6 +27,26 @@ enum BinlogType {
   TypeFirst = 1,
 };
 
+/******************* Binlog Item Content Format *********************
+ * The RESP text of the command, which always begins with '*', or
+ * +-----------------------------------------------------------------+
+ * | Format (1 byte) | Arg Num (varint32) | Arg Len (varint32) | Arg |
+ * |-----------------------------------------------------------------|
+ * | Arg Len (varint32) | Arg | ...                                  |
+ * +-----------------------------------------------------------------+
+ * with Format kBinlogContentBinary. With kBinlogContentLZ4 and
+ * kBinlogContentZSTD the Format is followed by the length of the args
+ * (varint32) and then by the args compressed.
+ */
+enum BinlogContentFormat : uint8_t {
+  kBinlogContentBinary = 1,
+  kBinlogContentLZ4 = 2,
+  kBinlogContentZSTD = 3,
+};
+
+// Binary contents shorter than this are not compressed
+const size_t kBinlogCompressMinSize = 256;
+
 const int BINLOG_ITEM_HEADER_SIZE = 34;
 const int PADDING_BINLOG_PROTOCOL_SIZE = 22;
 const int SPACE_STROE_PARAMETER_LENGTH = 5;
@@ -72,6 +93,16 @@ class PikaBinlogTransverter {
   static std::string ConstructPaddingBinlog(BinlogType type, uint32_t size);
 
   static bool BinlogItemWithoutContentDecode(BinlogType type, const std::string& binlog, BinlogItem* binlog_item);
+
+  /*
+   * Encode the args of a command in the binary format, compressed with
+   * compression ("none", "lz4" or "zstd") when that makes it smaller
+   */
+  static void ContentEncode(const std::vector<std::string>& argv, const std::string& compression,
+                            std::string* content);
+
+  // Decode the args of a content of any format
+  static bool ContentDecode(const char* content, size_t size, std::vector<std::string>* argv);
 };
 
 #endif
@@ -176,6 +176,7 @@ const std::string kCmdNameZInterstore = "zinterstore";
 const std::string kCmdNameZRank = "zrank";
 const std::string kCmdNameZRevrank = "zrevrank";
 const std::string kCmdNameZScore = "zscore";
+const std::string kCmdNameZMScore = "zmscore";
 const std::string kCmdNameZRevrange = "zrevrange";
 const std::string kCmdNameZRevrangebyscore = "zrevrangebyscore";
 const std::string kCmdNameZRangebylex = "zrangebylex";
@@ -199,6 +200,7 @@ const std::string kCmdNameSUnionstore = "sunionstore";
 const std::string kCmdNameSInter = "sinter";
 const std::string kCmdNameSInterstore = "sinterstore";
 const std::string kCmdNameSIsmember = "sismember";
+const std::string kCmdNameSMIsmember = "smismember";
 const std::string kCmdNameSDiff = "sdiff";
 const std::string kCmdNameSDiffstore = "sdiffstore";
 const std::string kCmdNameSMove = "smove";
@@ -345,6 +347,15 @@ class CmdRes {
   }
   bool CacheMiss() const { return ret_ == kCacheMiss; }
   std::string raw_message() const { return message_; }
+  // message() of a finished command, the reply built in message_ is moved out
+  std::string TakeMessage() {
+    if (ret_ != kNone) {
+      return message();
+    }
+    std::string result = std::move(message_);
+    message_.clear();
+    return result;
+  }
   std::string message() const {
     std::string result;
     switch (ret_) {
@@ -532,6 +543,7 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
   int8_t SubCmdIndex(const std::string& cmdName);  // if the command no subCommand，return -1；
 
   void Initial(const PikaCmdArgsType& argv, const std::string& db_name);
+  void Initial(PikaCmdArgsType&& argv, const std::string& db_name);
   uint32_t flag() const;
   bool hasFlag(uint32_t flag) const;
   bool is_read() const;
@@ -558,6 +570,8 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
   std::string db_name() const;
   PikaCmdArgsType& argv();
   virtual std::string ToRedisProtocol();
+  // The binlog content in the binary format, see binlog-content-format
+  virtual std::string ToBinlogBinary(const std::string& compression);
 
   void SetConn(const std::shared_ptr<net::NetConn>& conn);
   std::shared_ptr<net::NetConn> GetConn();
@@ -604,6 +618,9 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
  private:
   virtual void DoInitial() = 0;
   virtual void Clear(){};
+  // Fill args and return true if the binlog carries other args than argv_,
+  // e.g. a relative expire is written as an absolute one
+  virtual bool RewriteBinlogArgs(PikaCmdArgsType* args) { return false; }
 
   Cmd& operator=(const Cmd&);
 };
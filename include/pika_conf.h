@@ -57,6 +57,10 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return thread_pool_size_;
   }
+  bool reuse_port() {
+    std::shared_lock l(rwlock_);
+    return reuse_port_;
+  }
   int slow_cmd_thread_pool_size() {
     std::shared_lock l(rwlock_);
     return slow_cmd_thread_pool_size_;
@@ -277,6 +281,42 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return small_compaction_duration_threshold_;
   }
+  std::string storage_key_format() {
+    std::shared_lock l(rwlock_);
+    return storage_key_format_;
+  }
+  int hash_max_inline_entries() {
+    std::shared_lock l(rwlock_);
+    return hash_max_inline_entries_;
+  }
+  int hash_max_inline_value() {
+    std::shared_lock l(rwlock_);
+    return hash_max_inline_value_;
+  }
+  int set_max_inline_entries() {
+    std::shared_lock l(rwlock_);
+    return set_max_inline_entries_;
+  }
+  int set_max_inline_value() {
+    std::shared_lock l(rwlock_);
+    return set_max_inline_value_;
+  }
+  int reclaim_min_count() {
+    std::shared_lock l(rwlock_);
+    return reclaim_min_count_;
+  }
+  int reclaim_ranges_per_sec() {
+    std::shared_lock l(rwlock_);
+    return reclaim_ranges_per_sec_;
+  }
+  bool enable_ttl_index() {
+    std::shared_lock l(rwlock_);
+    return enable_ttl_index_;
+  }
+  int active_expire_batch_size() {
+    std::shared_lock l(rwlock_);
+    return active_expire_batch_size_;
+  }
   int max_background_flushes() {
     std::shared_lock l(rwlock_);
     return max_background_flushes_;
@@ -435,6 +475,8 @@ class PikaConf : public pstd::BaseConf {
   int64_t rsync_timeout_ms() {
       return rsync_timeout_ms_.load(std::memory_order::memory_order_relaxed);
   }
+  int rsync_window_size() { return rsync_window_size_.load(std::memory_order_relaxed); }
+  int64_t rsync_chunk_size() { return rsync_chunk_size_.load(std::memory_order_relaxed); }
   // Slow Commands configuration
   const std::string GetSlowCmd() {
     std::shared_lock l(rwlock_);
@@ -455,6 +497,12 @@ class PikaConf : public pstd::BaseConf {
   bool daemonize() { return daemonize_; }
   std::string pidfile() { return pidfile_; }
   int binlog_file_size() { return binlog_file_size_; }
+  std::string binlog_sync_policy() { return binlog_sync_policy_; }
+  int binlog_sync_interval_ms() { return binlog_sync_interval_ms_; }
+  int64_t binlog_sync_bytes() { return binlog_sync_bytes_; }
+  std::string binlog_content_format() { return binlog_content_format_; }
+  std::string binlog_compression() { return binlog_compression_; }
+  bool binlog_reader_mmap() { return binlog_reader_mmap_; }
   std::vector<rocksdb::CompressionType> compression_per_level();
   std::string compression_all_levels() const { return compression_per_level_; };
   static rocksdb::CompressionType GetCompression(const std::string& value);
@@ -528,6 +576,26 @@ class PikaConf : public pstd::BaseConf {
     TryPushDiffCommands("small-compaction-threshold", std::to_string(value));
     small_compaction_threshold_ = value;
   }
+  void SetHashMaxInlineEntries(const int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("hash-max-inline-entries", std::to_string(value));
+    hash_max_inline_entries_ = value;
+  }
+  void SetHashMaxInlineValue(const int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("hash-max-inline-value", std::to_string(value));
+    hash_max_inline_value_ = value;
+  }
+  void SetSetMaxInlineEntries(const int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("set-max-inline-entries", std::to_string(value));
+    set_max_inline_entries_ = value;
+  }
+  void SetSetMaxInlineValue(const int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("set-max-inline-value", std::to_string(value));
+    set_max_inline_value_ = value;
+  }
   void SetSmallCompactionDurationThreshold(const int value) {
     std::lock_guard l(rwlock_);
     TryPushDiffCommands("small-compaction-duration-threshold", std::to_string(value));
@@ -785,6 +853,18 @@ class PikaConf : public pstd::BaseConf {
     rsync_timeout_ms_.store(value);
   }
 
+  void SetRsyncWindowSize(int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("rsync-window-size", std::to_string(value));
+    rsync_window_size_.store(value);
+  }
+
+  void SetRsyncChunkSize(int64_t value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("rsync-chunk-size", std::to_string(value));
+    rsync_chunk_size_.store(value);
+  }
+
   void SetAclPubsubDefault(const std::string& value) {
     std::lock_guard l(rwlock_);
     TryPushDiffCommands("acl-pubsub-default", value);
@@ -831,6 +911,7 @@ class PikaConf : public pstd::BaseConf {
   int slave_priority_ = 0;
   int thread_num_ = 0;
   int thread_pool_size_ = 0;
+  bool reuse_port_ = false;
   int slow_cmd_thread_pool_size_ = 0;
   std::unordered_set<std::string> slow_cmd_set_;
   int sync_thread_num_ = 0;
@@ -900,6 +981,15 @@ class PikaConf : public pstd::BaseConf {
   int max_cache_statistic_keys_ = 0;
   int small_compaction_threshold_ = 0;
   int small_compaction_duration_threshold_ = 0;
+  std::string storage_key_format_ = "legacy";
+  int hash_max_inline_entries_ = 16;
+  int hash_max_inline_value_ = 64;
+  int set_max_inline_entries_ = 16;
+  int set_max_inline_value_ = 64;
+  int reclaim_min_count_ = 10000;
+  int reclaim_ranges_per_sec_ = 100;
+  bool enable_ttl_index_ = false;
+  int active_expire_batch_size_ = 1000;
   int max_background_flushes_ = -1;
   int max_background_compactions_ = -1;
   int max_background_jobs_ = 0;
@@ -949,6 +1039,12 @@ class PikaConf : public pstd::BaseConf {
   int target_file_size_base_ = 0;
   int64_t max_compaction_bytes_ = 0;
   int binlog_file_size_ = 0;
+  std::string binlog_sync_policy_ = "record";
+  int binlog_sync_interval_ms_ = 100;
+  int64_t binlog_sync_bytes_ = 1024 * 1024;
+  std::string binlog_content_format_ = "resp";
+  std::string binlog_compression_ = "none";
+  bool binlog_reader_mmap_ = false;
 
   // cache
   std::vector<std::string> cache_type_;
@@ -985,6 +1081,9 @@ class PikaConf : public pstd::BaseConf {
   int throttle_bytes_per_second_ = 200 << 20; // 200MB/s
   int max_rsync_parallel_num_ = kMaxRsyncParallelNum;
   std::atomic_int64_t rsync_timeout_ms_ = 1000;
+  // file requests in flight per rsync worker, and the bytes each one asks for
+  std::atomic_int rsync_window_size_ = 4;
+  std::atomic_int64_t rsync_chunk_size_ = 4 << 20;
 };
 
 #endif
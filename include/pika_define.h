@@ -20,6 +20,7 @@
 #define PIKA_TTL_STALE (-2)
 
 #define PIKA_SYNC_BUFFER_SIZE 1000
+#define PIKA_REPL_WRITE_DB_BATCH_SIZE 128
 #define PIKA_MAX_WORKER_THREAD_NUM 24
 #define PIKA_REPL_SERVER_TP_SIZE 3
 #define PIKA_META_SYNC_MAX_WAIT_TIME 10
@@ -43,6 +44,9 @@ const std::string kDefaultRsyncAuth = "default";
 
 /* Rsync */
 const int kMaxRsyncParallelNum = 4;
+const int kMaxRsyncWindowSize = 16;
+const int64_t kMinRsyncChunkSize = 64 << 10;
+const int64_t kMaxRsyncChunkSize = 16 << 20;
 constexpr int kMaxRsyncInitReTryTimes = 64;
 
 struct DBStruct {
@@ -341,6 +345,11 @@ static const size_t kBlockSize = 64 * 1024;
  */
 static const size_t kHeaderSize = 1 + 3 + 4;
 
+/*
+ * The max bytes of the records one binlog group commit appends
+ */
+static const size_t kBinlogGroupMaxSize = 1024 * 1024;
+
 /*
  * the size of memory when we use memory mode
  * the default memory size is 2GB
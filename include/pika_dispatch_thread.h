@@ -15,7 +15,8 @@ class PikaDispatchThread {
   ~PikaDispatchThread();
   int StartThread();
 
-  uint64_t ThreadClientList(std::vector<ClientInfo>* clients);
+  // worker_conn_nums: the number of clients of each network thread
+  uint64_t ThreadClientList(std::vector<ClientInfo>* clients, std::vector<int>* worker_conn_nums = nullptr);
 
   bool ClientKill(const std::string& ip_port);
   void ClientKillAll();
@@ -45,7 +45,7 @@ class SetCmd : public Cmd {
     success_ = 0;
     condition_ = kNONE;
   }
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
   rocksdb::Status s_;
 };
 
@@ -321,7 +321,7 @@ class SetnxCmd : public Cmd {
   int32_t success_ = 0;
   void DoInitial() override;
   rocksdb::Status s_;
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
 };
 
 class SetexCmd : public Cmd {
@@ -346,7 +346,7 @@ class SetexCmd : public Cmd {
   std::string value_;
   void DoInitial() override;
   rocksdb::Status s_;
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
 };
 
 class PsetexCmd : public Cmd {
@@ -371,7 +371,7 @@ class PsetexCmd : public Cmd {
   std::string value_;
   void DoInitial() override;
   rocksdb::Status s_;
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
 };
 
 class DelvxCmd : public Cmd {
@@ -574,7 +574,7 @@ class ExpireCmd : public Cmd {
   std::string key_;
   int64_t sec_ = 0;
   void DoInitial() override;
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
   rocksdb::Status s_;
 };
 
@@ -598,7 +598,7 @@ class PexpireCmd : public Cmd {
   std::string key_;
   int64_t msec_ = 0;
   void DoInitial() override;
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
   rocksdb::Status s_;
 };
 
@@ -646,7 +646,7 @@ class PexpireatCmd : public Cmd {
   int64_t time_stamp_ms_ = 0;
   void DoInitial() override;
   rocksdb::Status s_;
-  std::string ToRedisProtocol() override;
+  bool RewriteBinlogArgs(PikaCmdArgsType* args) override;
 };
 
 class TtlCmd : public Cmd {
@@ -6,12 +6,15 @@
 #ifndef PIKA_REPL_BGWROKER_H_
 #define PIKA_REPL_BGWROKER_H_
 
+#include <deque>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "net/include/bg_thread.h"
 #include "net/include/pb_conn.h"
 #include "net/include/thread_pool.h"
+#include "pstd/include/pstd_mutex.h"
 
 #include "pika_inner_message.pb.h"
 
@@ -19,14 +22,26 @@
 #include "include/pika_define.h"
 #include "include/pika_command.h"
 
+struct ReplClientWriteDBTaskArg;
+class ReplWriteDBBarrier;
+
 class PikaReplBgWorker {
  public:
   explicit PikaReplBgWorker(int queue_size);
+  ~PikaReplBgWorker();
   int StartThread();
   int StopThread();
   void Schedule(net::TaskFunc func, void* arg);
   void QueueClear();
   static void HandleBGWorkerWriteBinlog(void* arg);
+  // Queue a command to apply, the queued commands are applied in batches,
+  // in the order they are queued. Waits for room in the queue unless
+  // wait_room is false, then the queue may go past its size
+  void ScheduleWriteDB(ReplClientWriteDBTaskArg* task_arg, bool wait_room = true);
+  void WaitWriteDBRoom();
+  // Cancel the barriers of the queued commands and of the ones queued from
+  // now on, so that no other worker waits for this one once it is stopped
+  void CancelWriteDB();
   static void HandleBGWorkerWriteDB(void* arg);
   void SetThreadName(const std::string& thread_name) {
     bg_thread_.set_thread_name(thread_name);
@@ -38,7 +53,28 @@ class PikaReplBgWorker {
   std::string db_name_;
 
  private:
+  // Apply one command under its record lock and the db shared lock
+  static void WriteDB(const std::shared_ptr<Cmd>& c_ptr);
+  // Apply commands of one db in one WriteBatch per storage instance, under
+  // the record locks of all their keys and the db shared lock. The commands
+  // do not see the writes of each other, no two of them share a key
+  static void WriteDB(const std::vector<std::shared_ptr<Cmd>>& cmds);
+  // Wait for the arrived barriers a task must be applied after, false if
+  // one of them is cancelled
+  bool WaitArrivedBarriers(const ReplClientWriteDBTaskArg& task);
+
   net::BGThread bg_thread_;
+  size_t queue_size_ = 0;
+
+  pstd::Mutex write_db_mu_;
+  pstd::CondVar write_db_cv_;
+  std::deque<ReplClientWriteDBTaskArg*> write_db_tasks_;
+  // whether a HandleBGWorkerWriteDB is scheduled to drain write_db_tasks_
+  bool write_db_scheduled_ = false;
+  bool write_db_cancelled_ = false;
+  // the barriers of the placeholders this worker went past, only touched by
+  // the worker thread
+  std::vector<std::shared_ptr<ReplWriteDBBarrier>> arrived_barriers_;
   static int HandleWriteBinlog(net::RedisParser* parser, const net::RedisCmdArgsType& argv);
   static void ParseBinlogOffset(const InnerMessage::BinlogOffset& pb_offset, LogOffset* offset);
 };
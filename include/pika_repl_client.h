@@ -7,8 +7,10 @@
 #define PIKA_REPL_CLIENT_H_
 
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "net/include/client_thread.h"
 #include "net/include/net_conn.h"
@@ -42,14 +44,111 @@ struct ReplClientWriteBinlogTaskArg {
       : res(_res), conn(_conn), res_private_data(_res_private_data), worker(_worker) {}
 };
 
+/*
+ * A command whose keys belong to more than one write db worker is queued on
+ * the worker of its first key, and a placeholder sharing the same barrier is
+ * queued on every other worker involved. Each placeholder arrives once its
+ * worker has applied everything queued before it, the command waits for all
+ * of them. A worker goes on past an arrived placeholder, and only stops
+ * before the first later task touching a key of the command, until the
+ * command is applied, so the command runs in the master order with respect
+ * to all its keys and the other keys keep flowing.
+ */
+class ReplWriteDBBarrier {
+ public:
+  // suspend: the command touches every key, such as flushdb
+  ReplWriteDBBarrier(size_t placeholders, std::vector<std::string> keys, bool suspend)
+      : placeholders_(placeholders), keys_(keys.begin(), keys.end()), suspend_(suspend) {}
+
+  // Invoked by the workers of the placeholders
+  void Arrive() {
+    std::lock_guard l(mu_);
+    arrived_++;
+    cv_.notify_all();
+  }
+
+  // Invoked by the worker of the command, false if the barrier is cancelled
+  bool WaitArrived() {
+    std::unique_lock l(mu_);
+    cv_.wait(l, [this] { return arrived_ == placeholders_ || cancelled_; });
+    return !cancelled_;
+  }
+
+  void Applied() {
+    std::lock_guard l(mu_);
+    applied_ = true;
+    cv_.notify_all();
+  }
+
+  // Invoked by a worker holding a task in conflict, false if the barrier is
+  // cancelled before the command is applied
+  bool WaitApplied() {
+    std::unique_lock l(mu_);
+    cv_.wait(l, [this] { return applied_ || cancelled_; });
+    return applied_;
+  }
+
+  bool IsDone() {
+    std::lock_guard l(mu_);
+    return applied_ || cancelled_;
+  }
+
+  // Wake up every waiter, the command will never be applied, invoked when
+  // the worker holding the command or a placeholder is stopped
+  void Cancel() {
+    std::lock_guard l(mu_);
+    cancelled_ = true;
+    cv_.notify_all();
+  }
+
+  // Whether a task touching keys must be applied after the command
+  bool Conflicts(const std::vector<std::string>& keys, bool suspend) const {
+    if (suspend_ || suspend) {
+      return true;
+    }
+    for (const auto& key : keys) {
+      if (keys_.count(key) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  bool Conflicts(const ReplWriteDBBarrier& other) const {
+    if (suspend_ || other.suspend_) {
+      return true;
+    }
+    for (const auto& key : other.keys_) {
+      if (keys_.count(key) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  pstd::Mutex mu_;
+  pstd::CondVar cv_;
+  size_t placeholders_ = 0;
+  size_t arrived_ = 0;
+  bool applied_ = false;
+  bool cancelled_ = false;
+  // immutable, read without mu_
+  const std::set<std::string> keys_;
+  const bool suspend_ = false;
+};
+
 struct ReplClientWriteDBTaskArg {
+  // nullptr for a placeholder
   const std::shared_ptr<Cmd> cmd_ptr;
   LogOffset offset;
   std::string db_name;
-  ReplClientWriteDBTaskArg(std::shared_ptr<Cmd> _cmd_ptr, const LogOffset& _offset, std::string _db_name)
+  std::shared_ptr<ReplWriteDBBarrier> barrier;
+  ReplClientWriteDBTaskArg(std::shared_ptr<Cmd> _cmd_ptr, const LogOffset& _offset, std::string _db_name,
+                           std::shared_ptr<ReplWriteDBBarrier> _barrier = nullptr)
       : cmd_ptr(std::move(_cmd_ptr)),
         offset(_offset),
-        db_name(std::move(_db_name)) {}
+        db_name(std::move(_db_name)),
+        barrier(std::move(_barrier)) {}
   ~ReplClientWriteDBTaskArg() = default;
 };
 
@@ -90,6 +189,10 @@ class PikaReplClient {
   std::hash<std::string> str_hash;
   std::vector<std::unique_ptr<PikaReplBgWorker>> write_binlog_workers_;
   std::vector<std::unique_ptr<PikaReplBgWorker>> write_db_workers_;
+  // Queue the parts of the commands spanning several write db workers in
+  // the same order on all the workers, or their barriers could deadlock,
+  // never held while waiting for room in a queue
+  pstd::Mutex write_db_schedule_mu_;
 };
 
 #endif
@@ -102,6 +102,10 @@ class SyncSlaveDB : public SyncDB {
   void SetLastRecvTime(uint64_t time);
   void SetReplState(const ReplState& repl_state);
   ReplState State();
+  // the last offset of the commands applied to the db by a write db worker,
+  // set once per batch of commands
+  void SetAppliedOffset(const LogOffset& offset);
+  LogOffset AppliedOffset();
   pstd::Status CheckSyncTimeout(uint64_t now);
 
   // For display
@@ -124,6 +128,7 @@ class SyncSlaveDB : public SyncDB {
   pstd::Mutex db_mu_;
   RmNode m_info_;
   ReplState repl_state_{kNoConnect};
+  LogOffset applied_offset_;
   std::string local_ip_;
 };
 
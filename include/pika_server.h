@@ -137,6 +137,8 @@ class PikaServer : public pstd::noncopyable {
   void PrepareDBTrySync();
   void DBSetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys);
   void DBSetSmallCompactionThreshold(uint32_t small_compaction_threshold);
+  void DBSetHashMaxInline(uint32_t hash_max_inline_entries, uint32_t hash_max_inline_value);
+  void DBSetSetMaxInline(uint32_t set_max_inline_entries, uint32_t set_max_inline_value);
   void DBSetSmallCompactionDurationThreshold(uint32_t small_compaction_duration_threshold);
   bool GetDBBinlogOffset(const std::string& db_name, BinlogOffset* boffset);
   pstd::Status DoSameThingEveryDB(const TaskType& type);
@@ -221,7 +223,7 @@ class PikaServer : public pstd::noncopyable {
    */
   void ClientKillAll();
   int ClientKill(const std::string& ip_port);
-  int64_t ClientList(std::vector<ClientInfo>* clients = nullptr);
+  int64_t ClientList(std::vector<ClientInfo>* clients = nullptr, std::vector<int>* worker_conn_nums = nullptr);
 
   /*
    * Monitor used
@@ -513,6 +515,7 @@ class PikaServer : public pstd::noncopyable {
    */
   void DoTimingTask();
   void AutoCompactRange();
+  void AutoActiveExpire();
   void AutoPurge();
   void AutoDeleteExpiredDump();
   void AutoUpdateNetworkMetric();
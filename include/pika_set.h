@@ -276,6 +276,30 @@ class SIsmemberCmd : public Cmd {
   void DoInitial() override;
 };
 
+class SMIsmemberCmd : public Cmd {
+ public:
+  SMIsmemberCmd(const std::string& name, int arity, uint32_t flag)
+      : Cmd(name, arity, flag, static_cast<uint32_t>(AclCategory::SET)) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    res.push_back(key_);
+    return res;
+  }
+  void Do() override;
+  void ReadCache() override;
+  void DoUpdateCache() override;
+  void DoThroughDB() override;
+  void Split(const HintKeys& hint_keys) override{};
+  void Merge() override{};
+  Cmd* Clone() override { return new SMIsmemberCmd(*this); }
+
+ private:
+  std::string key_;
+  std::vector<std::string> members_;
+  rocksdb::Status s_;
+  void DoInitial() override;
+};
+
 class SDiffCmd : public Cmd {
  public:
   SDiffCmd(const std::string& name, int arity, uint32_t flag)
@@ -431,6 +431,30 @@ class ZScoreCmd : public ZsetRankParentCmd {
   void DoInitial() override;
 };
 
+class ZMScoreCmd : public Cmd {
+ public:
+  ZMScoreCmd(const std::string& name, int arity, uint32_t flag)
+      : Cmd(name, arity, flag, static_cast<uint32_t>(AclCategory::SORTEDSET)) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    res.push_back(key_);
+    return res;
+  }
+  void Do() override;
+  void ReadCache() override;
+  void DoUpdateCache() override;
+  void DoThroughDB() override;
+  void Split(const HintKeys& hint_keys) override{};
+  void Merge() override{};
+  Cmd* Clone() override { return new ZMScoreCmd(*this); }
+
+ private:
+  std::string key_;
+  std::vector<std::string> members_;
+  rocksdb::Status s_;
+  void DoInitial() override;
+};
+
 class ZsetRangebylexParentCmd : public Cmd {
  public:
   ZsetRangebylexParentCmd(const std::string& name, int arity, uint32_t flag)
@@ -10,9 +10,12 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <list>
+#include <map>
+#include <set>
 #include <atomic>
 #include <memory>
 #include <thread>
+#include <vector>
 #include <condition_variable>
 
 #include <glog/logging.h>
@@ -32,11 +35,19 @@
 extern std::unique_ptr<PikaConf> g_pika_conf;
 
 const std::string kDumpMetaFileName = "DUMP_META_DATA";
+const std::string kDumpBlockMetaFileName = "DUMP_BLOCK_META";
 const std::string kUuidPrefix = "snapshot-uuid:";
 const size_t kInvalidOffset = 0xFFFFFFFF;
 
 namespace rsync {
 
+// A chunk of a file written to local disk, with the crc32 of its data
+struct RsyncBlock {
+  size_t count = 0;
+  uint32_t checksum = 0;
+};
+using RsyncBlockMap = std::map<size_t, RsyncBlock>;
+
 class RsyncWriter;
 class Session;
 class WaitObject;
@@ -73,6 +84,11 @@ private:
   Status PullRemoteMeta(std::string* snapshot_uuid, std::set<std::string>* file_set);
   Status LoadLocalMeta(std::string* snapshot_uuid, std::map<std::string, std::string>* file_map);
   std::string GetLocalMetaFilePath();
+  std::string GetBlockMetaFilePath();
+  Status LoadBlockMeta(const std::string& snapshot_uuid, std::map<std::string, RsyncBlockMap>* file_blocks);
+  Status ResetBlockMeta();
+  void VerifyLocalBlocks(const std::string& filepath, RsyncBlockMap* blocks);
+  void AddBlock(const std::string& filename, size_t offset, size_t count, const char* data);
   Status FlushMetaTable();
   Status CleanUpExpiredFiles(bool need_reset_path, const std::set<std::string>& files);
   Status UpdateLocalMeta(const std::string& snapshot_uuid, const std::set<std::string>& expired_files,
@@ -82,6 +98,12 @@ private:
 private:
   typedef std::unique_ptr<RsyncClientThread> NetThreadUPtr;
   std::map<std::string, std::string> meta_table_;
+  // Blocks of the files in file_set_ already on local disk. The entry of
+  // every file is created before the workers start, and then only touched
+  // by the worker copying that file.
+  std::map<std::string, RsyncBlockMap> file_blocks_;
+  // lines of DUMP_BLOCK_META not flushed yet, guarded by mu_
+  std::vector<std::string> block_table_;
   std::set<std::string> file_set_;
   std::string snapshot_uuid_;
   std::string dir_;
@@ -107,7 +129,7 @@ class RsyncWriter {
  public:
   RsyncWriter(const std::string& filepath) {
     filepath_ = filepath;
-    fd_ = open(filepath.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+    fd_ = open(filepath.c_str(), O_RDWR | O_CREAT, 0644);
   }
   ~RsyncWriter() {}
   Status Write(uint64_t offset, size_t n, const char* data) {
@@ -115,7 +137,8 @@ class RsyncWriter {
     size_t left = n;
     Status s;
     while (left != 0) {
-      ssize_t done = write(fd_, ptr, left);
+      // chunks of a file may arrive out of order
+      ssize_t done = pwrite(fd_, ptr, left, static_cast<off_t>(offset));
       if (done < 0) {
         if (errno == EINTR) {
           continue;
@@ -151,9 +174,42 @@ class WaitObject {
   void Reset(const std::string& filename, RsyncService::Type t, size_t offset) {
     std::lock_guard<std::mutex> guard(mu_);
     resp_.reset();
+    resps_.clear();
+    offsets_.clear();
     filename_ = filename;
     type_ = t;
-    offset_ = offset;
+    if (offset != kInvalidOffset) {
+      offsets_.insert(offset);
+    }
+  }
+
+  // Register a file request in flight, must be called before sending it
+  void AddOffset(size_t offset) {
+    std::lock_guard<std::mutex> guard(mu_);
+    offsets_.insert(offset);
+  }
+
+  // Wait for the response of the file request at offset, an error
+  // response of any request is returned as well
+  pstd::Status WaitOffset(size_t offset, ResponseSPtr& resp) {
+    auto timeout = g_pika_conf->rsync_timeout_ms();
+    std::unique_lock<std::mutex> lock(mu_);
+    auto cv_s = cond_.wait_for(lock, std::chrono::milliseconds(timeout), [this, offset] {
+      return resp_.get() != nullptr || resps_.find(offset) != resps_.end();
+    });
+    if (!cv_s) {
+      std::string timout_info("timeout during(in ms) is ");
+      timout_info.append(std::to_string(timeout));
+      return pstd::Status::Timeout("rsync timeout", timout_info);
+    }
+    auto iter = resps_.find(offset);
+    if (iter != resps_.end()) {
+      resp = iter->second;
+      resps_.erase(iter);
+    } else {
+      resp = resp_;
+    }
+    return pstd::Status::OK();
   }
 
   pstd::Status Wait(ResponseSPtr& resp) {
@@ -173,18 +229,29 @@ class WaitObject {
 
   void WakeUp(RsyncService::RsyncResponse* resp) {
     std::unique_lock<std::mutex> lock(mu_);
+    if (resp->code() == RsyncService::kOk && resp->type() == RsyncService::kRsyncFile) {
+      // drop responses of other files and of requests already given up
+      size_t offset = resp->file_resp().offset();
+      if (resp->file_resp().filename() != filename_ || offsets_.erase(offset) == 0) {
+        delete resp;
+        return;
+      }
+      resps_[offset].reset(resp);
+      cond_.notify_all();
+      return;
+    }
     resp_.reset(resp);
-    offset_ = kInvalidOffset;
+    offsets_.clear();
     cond_.notify_all();
   }
 
-  std::string Filename() {return filename_;}
   RsyncService::Type Type() {return type_;}
-  size_t Offset() {return offset_;}
  private:
   std::string filename_;
   RsyncService::Type type_;
-  size_t offset_ = kInvalidOffset;
+  // offsets of the file requests in flight, and the responses not taken yet
+  std::set<size_t> offsets_;
+  std::map<size_t, ResponseSPtr> resps_;
   ResponseSPtr resp_ = nullptr;
   std::condition_variable cond_;
   std::mutex mu_;
@@ -224,13 +291,6 @@ class WaitObjectManager {
       wo_vec_[index]->WakeUp(resp);
       return;
     }
-
-    if (resp->type() == RsyncService::kRsyncFile &&
-        ((resp->file_resp().filename() != wo_vec_[index]->Filename()) ||
-	 (resp->file_resp().offset() != wo_vec_[index]->Offset()))) {
-      delete resp;
-      return;
-    }
     wo_vec_[index]->WakeUp(resp);
   }
  private:
@@ -6,10 +6,14 @@
 #ifndef RSYNC_SERVER_H_
 #define RSYNC_SERVER_H_
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
+
+#include <algorithm>
 
 #include "net/include/net_conn.h"
 #include "net/include/net_thread.h"
@@ -19,7 +23,6 @@
 #include "net/src/holy_thread.h"
 #include "net/src/net_multiplexer.h"
 #include "pstd/include/env.h"
-#include "pstd_hash.h"
 #include "rsync_service.pb.h"
 
 namespace rsync {
@@ -91,95 +94,79 @@ class RsyncServerThread : public net::HolyThread {
   RsyncServerHandle handle_;
 };
 
+/*
+ * Locates the requested range of a dump file. The data is not read here,
+ * the connection sends it from a dup of the file descriptor with
+ * sendfile(2), so the bytes never go through user space on the master.
+ * The checksum of the response is left empty, the client does not check
+ * it, and the SST files carry block checksums of their own.
+ */
 class RsyncReader {
  public:
-  RsyncReader() {
-    block_data_ = new char[kBlockSize];
-  }
+  RsyncReader() {}
   ~RsyncReader() {
-    if (!filepath_.empty()) {
-      Reset();
-    }
-    delete []block_data_;
+    Reset();
   }
-  pstd::Status Read(const std::string filepath, const size_t offset,
-                    const size_t count, char* data, size_t* bytes_read,
-                    std::string* checksum, bool* is_eof) {
+  // *fd is a dup the caller owns, -1 if there is nothing to send
+  pstd::Status Read(const std::string filepath, const size_t offset, const size_t count,
+                    int* fd, size_t* bytes_read, bool* is_eof, size_t* file_size) {
     std::lock_guard<std::mutex> guard(mu_);
-    pstd::Status s = readAhead(filepath, offset);
-    if (!s.ok()) {
-      return s;
+    if (filepath != filepath_) {
+      pstd::Status s = Open(filepath);
+      if (!s.ok()) {
+        return s;
+      }
     }
-    size_t offset_in_block = offset % kBlockSize;
-    size_t copy_count = count > (end_offset_ - offset) ? end_offset_ - offset : count;
-    memcpy(data, block_data_ + offset_in_block, copy_count);
-    *bytes_read = copy_count;
-    *is_eof = (offset + copy_count == total_size_);
-    return pstd::Status::OK();
-  }
-
-private:
-  pstd::Status readAhead(const std::string filepath, const size_t offset) {
-    if (filepath == filepath_ && offset >= start_offset_ && offset < end_offset_) {
+    *file_size = total_size_;
+    *bytes_read = offset >= total_size_ ? 0 : std::min(count, total_size_ - offset);
+    *is_eof = (offset + *bytes_read >= total_size_);
+    *fd = -1;
+    if (*bytes_read == 0) {
       return pstd::Status::OK();
     }
-    if (filepath != filepath_) {
-      Reset();
-      fd_ = open(filepath.c_str(), O_RDONLY);
-      if (fd_ < 0) {
-        LOG(ERROR) << "open file [" << filepath <<  "] failed! error: " << strerror(errno);
-        return pstd::Status::IOError("open file [" + filepath +  "] failed! error: " + strerror(errno));
-      }
-      filepath_ = filepath;
-      struct stat buf;
-      stat(filepath.c_str(), &buf);
-      total_size_ = buf.st_size;
+    *fd = dup(fd_);
+    if (*fd < 0) {
+      LOG(ERROR) << "dup fd of [" << filepath << "] failed! error: " << strerror(errno);
+      return pstd::Status::IOError("dup fd of [" + filepath + "] failed! error: " + strerror(errno));
     }
-    start_offset_ = (offset / kBlockSize) * kBlockSize;
+    return pstd::Status::OK();
+  }
 
-    size_t read_offset = start_offset_;
-    size_t read_count = kBlockSize > (total_size_ - read_offset) ? (total_size_ - read_offset) : kBlockSize;
-    ssize_t bytesin = 0;
-    char* ptr = block_data_;
-    while ((bytesin = pread(fd_, ptr, read_count, read_offset)) > 0) {
-      read_count -= bytesin;
-      read_offset += bytesin;
-      ptr += bytesin;
-      if (read_count <= 0) {
-        break;
-      }
+private:
+  pstd::Status Open(const std::string& filepath) {
+    Reset();
+    fd_ = open(filepath.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      LOG(ERROR) << "open file [" << filepath <<  "] failed! error: " << strerror(errno);
+      return pstd::Status::IOError("open file [" + filepath +  "] failed! error: " + strerror(errno));
     }
-    if (bytesin < 0) {
-      LOG(ERROR) << "unable to read from " << filepath << ". error: " << strerror(errno);
+    struct stat buf;
+    if (fstat(fd_, &buf) != 0) {
+      LOG(ERROR) << "stat file [" << filepath << "] failed! error: " << strerror(errno);
       Reset();
-      return pstd::Status::IOError("unable to read from " + filepath + ". error: " + strerror(errno));
+      return pstd::Status::IOError("stat file [" + filepath + "] failed! error: " + strerror(errno));
     }
-    end_offset_ = start_offset_ + (ptr - block_data_);
+#if !defined(__APPLE__)
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    filepath_ = filepath;
+    total_size_ = buf.st_size;
     return pstd::Status::OK();
   }
   void Reset() {
-    total_size_ = -1;
-    start_offset_ = 0xFFFFFFFF;
-    end_offset_ = 0xFFFFFFFF;
-    memset(block_data_, 0, kBlockSize);
-    md5_.reset(new pstd::MD5());
-    filepath_ = "";
-    close(fd_);
+    if (fd_ >= 0) {
+      close(fd_);
+    }
     fd_ = -1;
+    total_size_ = 0;
+    filepath_ = "";
   }
 
  private:
   std::mutex mu_;
-  const size_t kBlockSize = 16 << 20;
-
-  char* block_data_;
-  size_t start_offset_ = -1;
-  size_t end_offset_ = -1;
-  size_t total_size_ = -1;
-
+  size_t total_size_ = 0;
   int fd_ = -1;
   std::string filepath_;
-  std::unique_ptr<pstd::MD5> md5_;
 };
 
 } //end namespace rsync
@@ -0,0 +1,84 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+#include "net/include/redis_parser.h"
+
+using namespace net;
+
+// Feed a buffer of pipelined GET/SET commands to RedisParser, the way
+// RedisConn does after one read, and report the time spent per command.
+
+static uint64_t g_parsed_cmds = 0;
+
+static int DealMessage(RedisParser* parser, const RedisCmdArgsType& argv) { return 0; }
+
+static int Complete(RedisParser* parser, std::vector<RedisCmdArgsType>& argvs) {
+  g_parsed_cmds += argvs.size();
+  return 0;
+}
+
+static void AppendBulk(const std::string& arg, std::string* buf) {
+  buf->append("$" + std::to_string(arg.size()) + "\r\n");
+  buf->append(arg);
+  buf->append("\r\n");
+}
+
+static std::string BuildPipeline(int cmds, int value_len) {
+  std::string buf;
+  std::string value(value_len, 'v');
+  for (int i = 0; i < cmds; i++) {
+    std::string key = "key:" + std::to_string(i);
+    if (i % 2 == 0) {
+      buf.append("*3\r\n");
+      AppendBulk("SET", &buf);
+      AppendBulk(key, &buf);
+      AppendBulk(value, &buf);
+    } else {
+      buf.append("*2\r\n");
+      AppendBulk("GET", &buf);
+      AppendBulk(key, &buf);
+    }
+  }
+  return buf;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    printf("Usage: ./redis_parser_bench cmds_per_read value_len rounds\n");
+    printf("Example: ./redis_parser_bench 128 16 100000\n");
+    exit(0);
+  }
+  int cmds = atoi(argv[1]);
+  int value_len = atoi(argv[2]);
+  int rounds = atoi(argv[3]);
+
+  std::string buf = BuildPipeline(cmds, value_len);
+  RedisParser parser;
+  RedisParserSettings settings;
+  settings.DealMessage = DealMessage;
+  settings.Complete = Complete;
+  if (parser.RedisParserInit(REDIS_PARSER_REQUEST, settings) != kRedisParserInitDone) {
+    printf("init parser failed\n");
+    exit(-1);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    int parsed_len = 0;
+    RedisParserStatus ret = parser.ProcessInputBuffer(buf.data(), static_cast<int>(buf.size()), &parsed_len);
+    if (ret != kRedisParserDone || parsed_len != static_cast<int>(buf.size())) {
+      printf("parse failed, status: %d, parsed_len: %d\n", ret, parsed_len);
+      exit(-1);
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+  double ns = static_cast<double>(elapsed.count());
+  printf("%d commands per read, %zu bytes, %d rounds\n", cmds, buf.size(), rounds);
+  printf("parsed %" PRIu64 " commands in %.3f ms, %.1f ns per command, %.1f MB/s\n", g_parsed_cmds, ns / 1e6,
+         ns / static_cast<double>(g_parsed_cmds), static_cast<double>(buf.size()) * rounds * 1e3 / ns);
+  return 0;
+}
@@ -6,7 +6,10 @@
 #ifndef NET_INCLUDE_PB_CONN_H_
 #define NET_INCLUDE_PB_CONN_H_
 
+#include <unistd.h>
+
 #include <map>
+#include <memory>
 #include <queue>
 #include <string>
 
@@ -21,9 +24,25 @@ using pstd::Status;
 
 class PbConn : public NetConn {
  public:
+  // count bytes of an open file from offset, the fd is closed with it
+  struct FileRegion {
+    FileRegion(int fd, off_t offset, size_t count) : fd_(fd), offset_(offset), count_(count) {}
+    ~FileRegion() { close(fd_); }
+    int fd_;
+    off_t offset_;
+    size_t count_;
+  };
+  // Either a buffer or a file region
+  struct WriteItem {
+    explicit WriteItem(std::string buf) : buf_(std::move(buf)) {}
+    explicit WriteItem(std::unique_ptr<FileRegion> file) : file_(std::move(file)) {}
+    size_t size() const { return file_ ? file_->count_ : buf_.size(); }
+    std::string buf_;
+    std::unique_ptr<FileRegion> file_;
+  };
   struct WriteBuf {
     WriteBuf(const size_t item_pos = 0) : item_pos_(item_pos) {}
-    std::queue<std::string> queue_;
+    std::queue<WriteItem> queue_;
     size_t item_pos_;
   };
   PbConn(int fd, const std::string& ip_port, Thread* thread, NetMultiplexer* net_mpx = nullptr);
@@ -33,6 +52,10 @@ class PbConn : public NetConn {
   WriteStatus SendReply() override;
   void TryResizeBuffer() override;
   int WriteResp(const std::string& resp) override;
+  // Send resp followed by count bytes of fd from offset as one message,
+  // the file bytes go to the socket with sendfile(2) and are never copied
+  // into user space. The connection owns fd from now on.
+  int WriteResp(const std::string& resp, int fd, off_t offset, size_t count);
   void NotifyWrite();
   void NotifyClose();
   void set_is_reply(bool reply) override;
@@ -84,6 +107,7 @@ class PbConn : public NetConn {
   pstd::Mutex is_reply_mu_;
   int64_t is_reply_{0};
   virtual void BuildInternalTag(const std::string& resp, std::string* tag);
+  ssize_t WriteFileRegion(FileRegion* file, size_t pos, size_t len);
 };
 
 }  // namespace net
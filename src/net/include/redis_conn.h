@@ -6,7 +6,9 @@
 #ifndef NET_INCLUDE_REDIS_CONN_H_
 #define NET_INCLUDE_REDIS_CONN_H_
 
+#include <deque>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -30,12 +32,17 @@ class RedisConn : public NetConn {
   ReadStatus GetRequest() override;
   WriteStatus SendReply() override;
   int WriteResp(const std::string& resp) override;
+  // A large buffer is queued as is and written out by SendReply with writev,
+  // it must not be modified afterwards. A small one is copied into response_
+  int WriteResp(std::shared_ptr<std::string> resp);
 
   void TryResizeBuffer() override;
   void SetHandleType(const HandleType& handle_type);
   HandleType GetHandleType();
 
-  virtual void ProcessRedisCmds(const std::vector<RedisCmdArgsType>& argvs, bool async, std::string* response);
+  // argvs are handed over, so that the args parsed out of the input buffer
+  // reach the command without another copy
+  virtual void ProcessRedisCmds(std::vector<RedisCmdArgsType>&& argvs, bool async, std::string* response);
   void NotifyEpoll(bool success);
 
   virtual int DealMessage(const RedisCmdArgsType& argv, std::string* response) = 0;
@@ -43,8 +50,9 @@ class RedisConn : public NetConn {
 
  private:
   static int ParserDealMessageCb(RedisParser* parser, const RedisCmdArgsType& argv);
-  static int ParserCompleteCb(RedisParser* parser, const std::vector<RedisCmdArgsType>& argvs);
+  static int ParserCompleteCb(RedisParser* parser, std::vector<RedisCmdArgsType>& argvs);
   ReadStatus ParseRedisParserStatus(RedisParserStatus status);
+  void QueueResponse();
 
   HandleType handle_type_ = kSynchronous;
 
@@ -54,8 +62,12 @@ class RedisConn : public NetConn {
   int msg_peak_ = 0;
   int command_len_ = 0;
 
-  uint32_t wbuf_pos_ = 0;
+  // Small responses appended by DealMessage and both WriteResp, moved into
+  // resp_queue_ as one buffer before a queued buffer or a write
   std::string response_;
+  // Responses not written yet, the first one written up to wbuf_pos_
+  std::deque<std::shared_ptr<std::string>> resp_queue_;
+  size_t wbuf_pos_ = 0;
 
   // For Redis Protocol parser
   int last_read_pos_ = -1;
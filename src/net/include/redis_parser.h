@@ -19,7 +19,8 @@ class RedisParser;
 
 using RedisCmdArgsType = std::vector<std::string>;
 using RedisParserDataCb = int (*)(RedisParser *, const RedisCmdArgsType &);
-using RedisParserMultiDataCb = int (*)(RedisParser *, const std::vector<RedisCmdArgsType> &);
+// The args are cleared after the callback returns, it may move them away
+using RedisParserMultiDataCb = int (*)(RedisParser *, std::vector<RedisCmdArgsType> &);
 using RedisParserCb = int (*)(RedisParser *);
 using RedisParserType = int;
 
@@ -196,6 +196,11 @@ class ServerThread : public Thread {
   std::set<int32_t> server_fds_;
 
   virtual int InitHandle();
+  /*
+   * Accept a connection of listen_fd which passes the AccessHandle,
+   * return the connfd, or -1 if none is accepted
+   */
+  int AcceptConn(int listen_fd, std::string* ip_port);
   void* ThreadMain() override;
   /*
    * The server event handle
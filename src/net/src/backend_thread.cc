@@ -217,12 +217,15 @@ std::shared_ptr<NetConn> BackendThread::GetConn(int fd) {
 }
 
 void BackendThread::CloseFd(const std::shared_ptr<NetConn>& conn) {
+  // deregister before close, the fd number may be reused at once
+  net_multiplexer_->NetDelEvent(conn->fd(), 0);
   close(conn->fd());
   CleanUpConnRemaining(conn->fd());
   handle_->FdClosedHandle(conn->fd(), conn->ip_port());
 }
 
 void BackendThread::CloseFd(const int fd) {
+  net_multiplexer_->NetDelEvent(fd, 0);
   close(fd);
   CleanUpConnRemaining(fd);
   // user don't use ip_port
@@ -344,7 +347,6 @@ void BackendThread::ProcessNotifyEvents(const NetFiredEvent* pfe) {
           }
         } else if (ti.notify_type() == kNotiClose) {
           LOG(INFO) << "received kNotiClose";
-          net_multiplexer_->NetDelEvent(fd, 0);
           CloseFd(fd);
           conns_.erase(fd);
           connecting_fds_.erase(fd);
@@ -452,7 +454,6 @@ void* BackendThread::ThreadMain() {
       if ((pfe->mask & kErrorEvent) || should_close) {
         {
           LOG(INFO) << "close connection " << pfe->fd << " reason " << pfe->mask << " " << should_close;
-          net_multiplexer_->NetDelEvent(pfe->fd, 0);
           CloseFd(conn);
           mu_.lock();
           conns_.erase(pfe->fd);
@@ -196,12 +196,15 @@ Status ClientThread::ScheduleConnect(const std::string& dst_ip, int dst_port) {
 }
 
 void ClientThread::CloseFd(const std::shared_ptr<NetConn>& conn) {
+  // deregister before close, the fd number may be reused at once
+  net_multiplexer_->NetDelEvent(conn->fd(), 0);
   close(conn->fd());
   CleanUpConnRemaining(conn->ip_port());
   handle_->FdClosedHandle(conn->fd(), conn->ip_port());
 }
 
 void ClientThread::CloseFd(int fd, const std::string& ip_port) {
+  net_multiplexer_->NetDelEvent(fd, 0);
   close(fd);
   CleanUpConnRemaining(ip_port);
   handle_->FdClosedHandle(fd, ip_port);
@@ -256,7 +259,6 @@ void ClientThread::DoCronTask() {
       continue;
     }
     std::shared_ptr<NetConn> conn = iter->second;
-    net_multiplexer_->NetDelEvent(conn->fd(), 0);
     CloseFd(conn);
     fd_conns_.erase(conn->fd());
     ipport_conns_.erase(conn->ip_port());
@@ -357,7 +359,6 @@ void ClientThread::ProcessNotifyEvents(const NetFiredEvent* pfe) {
           }
         } else if (ti.notify_type() == kNotiClose) {
           LOG(INFO) << "received kNotiClose";
-          net_multiplexer_->NetDelEvent(fd, 0);
           CloseFd(fd, ip_port);
           fd_conns_.erase(fd);
           ipport_conns_.erase(ip_port);
@@ -463,7 +464,6 @@ void* ClientThread::ThreadMain() {
       if ((pfe->mask & kErrorEvent) || should_close) {
         {
           LOG(INFO) << "close connection " << pfe->fd << " reason " << pfe->mask << " " << should_close;
-          net_multiplexer_->NetDelEvent(pfe->fd, 0);
           CloseFd(conn);
           fd_conns_.erase(pfe->fd);
           if (ipport_conns_.count(conn->ip_port())) {
@@ -8,6 +8,7 @@
 #include <glog/logging.h>
 
 #include "net/src/dispatch_thread.h"
+#include "net/src/server_socket.h"
 #include "net/src/worker_thread.h"
 
 namespace net {
@@ -48,6 +49,12 @@ DispatchThread::DispatchThread(const std::set<std::string>& ips, int port, int w
 DispatchThread::~DispatchThread() = default;
 
 int DispatchThread::StartThread() {
+  if (reuse_port_) {
+    int ret = InitWorkerListeners();
+    if (ret != kSuccess) {
+      return ret;
+    }
+  }
   for (int i = 0; i < work_num_; i++) {
     int ret = handle_->CreateWorkerSpecificData(&(worker_thread_[i]->private_data_));
     if (ret) {
@@ -92,6 +99,35 @@ int DispatchThread::StopThread() {
   return ServerThread::StopThread();
 }
 
+int DispatchThread::InitHandle() {
+  // the workers accept on their own sockets, this thread only runs the cron
+  if (reuse_port_) {
+    return kSuccess;
+  }
+  return ServerThread::InitHandle();
+}
+
+int DispatchThread::InitWorkerListeners() {
+  std::set<std::string> ips = ips_;
+  if (ips.find("0.0.0.0") != ips.end()) {
+    ips = {"0.0.0.0"};
+  }
+  for (int i = 0; i < work_num_; i++) {
+    for (const auto& ip : ips) {
+      auto socket_p = std::make_shared<ServerSocket>(port_);
+      socket_p->set_reuse_port(true);
+      int ret = socket_p->Listen(ip);
+      if (ret != kSuccess) {
+        LOG(ERROR) << "worker(" << i << ") listen on " << ip << ":" << port_ << " with SO_REUSEPORT failed";
+        return ret;
+      }
+      worker_thread_[i]->AddListener(socket_p);
+    }
+  }
+  LOG(INFO) << work_num_ << " workers accept on port " << port_ << " with SO_REUSEPORT";
+  return kSuccess;
+}
+
 void DispatchThread::set_keepalive_timeout(int timeout) {
   for (int i = 0; i < work_num_; ++i) {
     worker_thread_[i]->set_keepalive_timeout(timeout);
@@ -106,6 +142,14 @@ int DispatchThread::conn_num() const {
   return conn_num;
 }
 
+std::vector<int> DispatchThread::worker_conn_nums() const {
+  std::vector<int> conn_nums;
+  for (int i = 0; i < work_num_; ++i) {
+    conn_nums.push_back(worker_thread_[i]->conn_num());
+  }
+  return conn_nums;
+}
+
 std::vector<ServerThread::ConnInfo> DispatchThread::conns_info() const {
   std::vector<ServerThread::ConnInfo> result;
   for (int i = 0; i < work_num_; ++i) {
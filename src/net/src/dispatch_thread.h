@@ -89,6 +89,16 @@ class DispatchThread : public ServerThread {
 
   void SetQueueLimit(int queue_limit) override;
 
+  /*
+   * Every worker thread listens on the port with SO_REUSEPORT and accepts
+   * its own connections, instead of this thread accepting them all and
+   * handing them to the workers round-robin. Set before StartThread.
+   */
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+
+  // The number of connections each worker thread holds
+  std::vector<int> worker_conn_nums() const;
+
   void AllConn(const std::function<void(const std::shared_ptr<NetConn>&)>& func);
 
   /**
@@ -133,6 +143,7 @@ class DispatchThread : public ServerThread {
    */
   std::vector<std::unique_ptr<WorkerThread>> worker_thread_;
   int queue_limit_;
+  bool reuse_port_ = false;
   std::map<WorkerThread*, void*> localdata_;
 
   std::unordered_map<std::string, std::unordered_set<std::shared_ptr<NetConn>>> key_conns_map_;
@@ -141,6 +152,9 @@ class DispatchThread : public ServerThread {
 
   void HandleConnEvent(NetFiredEvent* pfe) override { UNUSED(pfe); }
 
+  int InitHandle() override;
+  int InitWorkerListeners();
+
   /*
    *  Blpop/BRpop used
    */
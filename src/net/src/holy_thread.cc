@@ -171,7 +171,6 @@ void HolyThread::HandleConnEvent(NetFiredEvent* pfe) {
     }
   }
   if ((pfe->mask & kErrorEvent) || should_close) {
-    net_multiplexer_->NetDelEvent(pfe->fd, 0);
     CloseFd(in_conn);
     in_conn = nullptr;
 
@@ -238,6 +237,8 @@ void HolyThread::DoCronTask() {
 }
 
 void HolyThread::CloseFd(const std::shared_ptr<NetConn>& conn) {
+  // deregister before close, the fd number may be reused at once
+  net_multiplexer_->NetDelEvent(conn->fd(), 0);
   close(conn->fd());
   handle_->FdClosedHandle(conn->fd(), conn->ip_port());
 }
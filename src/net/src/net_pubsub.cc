@@ -151,8 +151,9 @@ void PubSubThread::RemoveConn(const std::shared_ptr<NetConn>& conn) {
 }
 
 void PubSubThread::CloseConn(const std::shared_ptr<NetConn>& conn) {
-  CloseFd(conn);
+  // deregister before close, the fd number may be reused at once
   net_multiplexer_->NetDelEvent(conn->fd(), 0);
+  CloseFd(conn);
   {
     std::lock_guard l(rwlock_);
     conns_.erase(conn->fd());
@@ -581,6 +582,7 @@ void* PubSubThread::ThreadMain() {
 void PubSubThread::Cleanup() {
   std::lock_guard l(rwlock_);
   for (auto& iter : conns_) {
+    net_multiplexer_->NetDelEvent(iter.first, 0);
     CloseFd(iter.second->conn);
   }
   conns_.clear();
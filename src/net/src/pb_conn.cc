@@ -6,6 +6,10 @@
 #include "net/include/pb_conn.h"
 
 #include <arpa/inet.h>
+#if !defined(__APPLE__)
+#include <sys/sendfile.h>
+#endif
+#include <algorithm>
 #include <string>
 
 #include <glog/logging.h>
@@ -118,10 +122,14 @@ WriteStatus PbConn::SendReply() {
   size_t item_len;
   std::lock_guard l(resp_mu_);
   while (!write_buf_.queue_.empty()) {
-    std::string item = write_buf_.queue_.front();
+    WriteItem& item = write_buf_.queue_.front();
     item_len = item.size();
     while (item_len - write_buf_.item_pos_ > 0) {
-      nwritten = write(fd(), item.data() + write_buf_.item_pos_, item_len - write_buf_.item_pos_);
+      if (item.file_) {
+        nwritten = WriteFileRegion(item.file_.get(), write_buf_.item_pos_, item_len - write_buf_.item_pos_);
+      } else {
+        nwritten = write(fd(), item.buf_.data() + write_buf_.item_pos_, item_len - write_buf_.item_pos_);
+      }
       if (nwritten <= 0) {
         break;
       }
@@ -133,6 +141,10 @@ WriteStatus PbConn::SendReply() {
         item_len = 0;
       }
     }
+    if (nwritten == 0 && item_len != 0 && item.file_) {
+      // the file is shorter than the length already sent, nothing can follow
+      return kWriteError;
+    }
     if (nwritten == -1) {
       if (errno == EAGAIN) {
         return kWriteHalf;
@@ -169,12 +181,38 @@ int PbConn::WriteResp(const std::string& resp) {
   std::string tag;
   BuildInternalTag(resp, &tag);
   std::lock_guard l(resp_mu_);
-  write_buf_.queue_.push(tag);
-  write_buf_.queue_.push(resp);
+  write_buf_.queue_.emplace(std::move(tag));
+  write_buf_.queue_.emplace(resp);
   set_is_reply(true);
   return 0;
 }
 
+int PbConn::WriteResp(const std::string& resp, int fd, off_t offset, size_t count) {
+  auto file = std::make_unique<FileRegion>(fd, offset, count);
+  uint32_t resp_size = htonl(static_cast<uint32_t>(resp.size() + count));
+  std::string tag(reinterpret_cast<char*>(&resp_size), 4);
+  std::lock_guard l(resp_mu_);
+  write_buf_.queue_.emplace(std::move(tag));
+  write_buf_.queue_.emplace(resp);
+  write_buf_.queue_.emplace(std::move(file));
+  set_is_reply(true);
+  return 0;
+}
+
+ssize_t PbConn::WriteFileRegion(FileRegion* file, size_t pos, size_t len) {
+  off_t offset = file->offset_ + static_cast<off_t>(pos);
+#if defined(__APPLE__)
+  char buf[64 << 10];
+  ssize_t nread = pread(file->fd_, buf, std::min(len, sizeof(buf)), offset);
+  if (nread <= 0) {
+    return nread;
+  }
+  return write(fd(), buf, nread);
+#else
+  return sendfile(fd(), file->fd_, &offset, len);
+#endif
+}
+
 void PbConn::BuildInternalTag(const std::string& resp, std::string* tag) {
   uint32_t resp_size = resp.size();
   resp_size = htonl(resp_size);
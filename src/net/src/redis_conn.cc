@@ -5,6 +5,9 @@
 
 #include "net/include/redis_conn.h"
 
+#include <sys/uio.h>
+
+#include <climits>
 #include <cstdlib>
 #include <sstream>
 
@@ -18,6 +21,17 @@ extern std::unique_ptr<net::NetworkStatistic> g_network_statistic;
 
 namespace net {
 
+// The most responses one writev gathers
+#ifdef IOV_MAX
+static const int kMaxWriteIovs = IOV_MAX;
+#else
+static const int kMaxWriteIovs = 1024;
+#endif
+
+// Responses smaller than this are copied into response_ rather than queued
+// as a buffer of their own, a copy is cheaper than an iovec for them
+static const size_t kMinQueuedRespSize = 16 * 1024;
+
 RedisConn::RedisConn(const int fd, const std::string& ip_port, Thread* thread, NetMultiplexer* net_mpx,
                      const HandleType& handle_type, const int rbuf_max_len)
     : NetConn(fd, ip_port, thread, net_mpx),
@@ -125,26 +139,42 @@ ReadStatus RedisConn::GetRequest() {
   return read_status;  // OK || HALF || FULL_ERROR || PARSE_ERROR
 }
 
+void RedisConn::QueueResponse() {
+  if (!response_.empty()) {
+    resp_queue_.push_back(std::make_shared<std::string>(std::move(response_)));
+    response_.clear();
+  }
+}
+
 WriteStatus RedisConn::SendReply() {
+  QueueResponse();
+
   ssize_t nwritten = 0;
-  size_t wbuf_len = response_.size();
-  while (wbuf_len > 0) {
-    nwritten = write(fd(), response_.data() + wbuf_pos_, wbuf_len - wbuf_pos_);
+  struct iovec iov[kMaxWriteIovs];
+  while (!resp_queue_.empty()) {
+    int iovcnt = 0;
+    size_t pos = wbuf_pos_;
+    for (auto iter = resp_queue_.begin(); iter != resp_queue_.end() && iovcnt < kMaxWriteIovs; ++iter) {
+      iov[iovcnt].iov_base = const_cast<char*>((*iter)->data()) + pos;
+      iov[iovcnt].iov_len = (*iter)->size() - pos;
+      iovcnt++;
+      pos = 0;
+    }
+    nwritten = writev(fd(), iov, iovcnt);
     if (nwritten <= 0) {
       break;
     }
     g_network_statistic->IncrRedisOutputBytes(nwritten);
-    wbuf_pos_ += nwritten;
-    if (wbuf_pos_ == wbuf_len) {
-      // Have sended all response data
-      if (wbuf_len > DEFAULT_WBUF_SIZE) {
-        std::string buf;
-        buf.reserve(DEFAULT_WBUF_SIZE);
-        response_.swap(buf);
+    // drop the responses written out, keep the position in a partly written one
+    auto left = static_cast<size_t>(nwritten);
+    while (left > 0) {
+      size_t remain = resp_queue_.front()->size() - wbuf_pos_;
+      if (left < remain) {
+        wbuf_pos_ += left;
+        break;
       }
-      response_.clear();
-
-      wbuf_len = 0;
+      left -= remain;
+      resp_queue_.pop_front();
       wbuf_pos_ = 0;
     }
   }
@@ -156,7 +186,7 @@ WriteStatus RedisConn::SendReply() {
       return kWriteError;
     }
   }
-  if (wbuf_len == 0) {
+  if (resp_queue_.empty()) {
     return kWriteAll;
   } else {
     return kWriteHalf;
@@ -169,6 +199,20 @@ int RedisConn::WriteResp(const std::string& resp) {
   return 0;
 }
 
+int RedisConn::WriteResp(std::shared_ptr<std::string> resp) {
+  if (!resp || resp->empty()) {
+    return 0;
+  }
+  if (resp->size() < kMinQueuedRespSize) {
+    return WriteResp(*resp);
+  }
+  // keep the order of what is appended to response_ before
+  QueueResponse();
+  resp_queue_.push_back(std::move(resp));
+  set_is_reply(true);
+  return 0;
+}
+
 void RedisConn::TryResizeBuffer() {
   struct timeval now;
   gettimeofday(&now, nullptr);
@@ -188,7 +232,7 @@ void RedisConn::SetHandleType(const HandleType& handle_type) { handle_type_ = ha
 
 HandleType RedisConn::GetHandleType() { return handle_type_; }
 
-void RedisConn::ProcessRedisCmds(const std::vector<RedisCmdArgsType>& argvs, bool async, std::string* response) {}
+void RedisConn::ProcessRedisCmds(std::vector<RedisCmdArgsType>&& argvs, bool async, std::string* response) {}
 
 void RedisConn::NotifyEpoll(bool success) {
   NetItem ti(fd(), ip_port(), success ? kNotiEpolloutAndEpollin : kNotiClose);
@@ -204,10 +248,10 @@ int RedisConn::ParserDealMessageCb(RedisParser* parser, const RedisCmdArgsType&
   }
 }
 
-int RedisConn::ParserCompleteCb(RedisParser* parser, const std::vector<RedisCmdArgsType>& argvs) {
+int RedisConn::ParserCompleteCb(RedisParser* parser, std::vector<RedisCmdArgsType>& argvs) {
   auto conn = reinterpret_cast<RedisConn*>(parser->data);
   bool async = conn->GetHandleType() == HandleType::kAsynchronous;
-  conn->ProcessRedisCmds(argvs, async, &(conn->response_));
+  conn->ProcessRedisCmds(std::move(argvs), async, &(conn->response_));
   return 0;
 }
 
@@ -6,6 +6,8 @@
 #include "net/include/redis_parser.h"
 
 #include <cassert> /* assert */
+#include <cstring>
+#include <limits>
 
 #include <glog/logging.h>
 
@@ -14,6 +16,9 @@
 
 namespace net {
 
+// digits of a number which can not overflow long
+static const int kFastNumMaxLen = std::numeric_limits<long>::digits10;
+
 static bool IsHexDigit(char ch) {
   return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
 }
@@ -143,18 +148,16 @@ static int split2args(const std::string& req_buf, RedisCmdArgsType& argv) {
   }
 }
 
+// memchr of libc is vectorized, and picks SSE2/AVX2/AVX512 at runtime
 int RedisParser::FindNextSeparators() {
   if (cur_pos_ > length_ - 1) {
     return -1;
   }
-  int pos = cur_pos_;
-  while (pos <= length_ - 1) {
-    if (input_buf_[pos] == '\n') {
-      return pos;
-    }
-    pos++;
+  const void* sep = memchr(input_buf_ + cur_pos_, '\n', length_ - cur_pos_);
+  if (sep == nullptr) {
+    return -1;
   }
-  return -1;
+  return static_cast<int>(static_cast<const char*>(sep) - input_buf_);
 }
 
 int RedisParser::GetNextNum(int pos, long* value) {
@@ -164,7 +167,25 @@ int RedisParser::GetNextNum(int pos, long* value) {
   //      |    |
   //      *3\r\n
   // [cur_pos_ + 1, pos - cur_pos_ - 2]
-  if (pstd::string2int(input_buf_ + cur_pos_ + 1, pos - cur_pos_ - 2, value) != 0) {
+  const char* p = input_buf_ + cur_pos_ + 1;
+  int len = pos - cur_pos_ - 2;
+  // no leading zeros, as redis does; string2int would skip them
+  if (len > 1 && p[0] == '0') {
+    return -1;
+  }
+  // fast path of the lengths sent by clients, plain digits without overflow
+  if (len > 0 && len <= kFastNumMaxLen) {
+    long num = 0;
+    int i = 0;
+    for (; i < len && p[i] >= '0' && p[i] <= '9'; i++) {
+      num = num * 10 + (p[i] - '0');
+    }
+    if (i == len) {
+      *value = num;
+      return 0;
+    }
+  }
+  if (pstd::string2int(p, len, value) != 0) {
     return 0;  // Success
   }
   return -1;  // Failed
@@ -367,9 +388,9 @@ RedisParserStatus RedisParser::ProcessRequestBuffer() {
       return kRedisParserError;
     }
     if (!argv_.empty()) {
-      argvs_.push_back(argv_);
+      argvs_.push_back(std::move(argv_));
       if (parser_settings_.DealMessage) {
-        if (parser_settings_.DealMessage(this, argv_) != 0) {
+        if (parser_settings_.DealMessage(this, argvs_.back()) != 0) {
           SetParserStatus(kRedisParserError, kRedisParserDealError);
           return status_code_;
         }
@@ -39,6 +39,12 @@ int ServerSocket::Listen(const std::string& bind_ip) {
   if (ret < 0) {
     return kSetSockOptError;
   }
+  if (reuse_port_) {
+    ret = setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+    if (ret < 0) {
+      return kSetSockOptError;
+    }
+  }
 
   servaddr_.sin_family = AF_INET;
   if (bind_ip.empty()) {
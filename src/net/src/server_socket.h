@@ -45,6 +45,10 @@ class ServerSocket : public pstd::noncopyable {
 
   void set_recv_timeout(int recv_timeout) { recv_timeout_ = recv_timeout; }
 
+  // SO_REUSEPORT, several sockets listen on the same port and the kernel
+  // balances the connections among them, set before Listen
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+
   int recv_timeout() const { return recv_timeout_; }
 
   int sockfd() const { return sockfd_; }
@@ -65,6 +69,7 @@ class ServerSocket : public pstd::noncopyable {
   int tcp_send_buffer_{0};
   int tcp_recv_buffer_{0};
   bool keep_alive_{false};
+  bool reuse_port_{false};
   bool listening_{false};
   bool is_block_;
 
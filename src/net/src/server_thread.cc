@@ -153,12 +153,44 @@ void ServerThread::DoCronTask() {}
 
 void ServerThread::ProcessNotifyEvents(const NetFiredEvent* pfe) { UNUSED(pfe); }
 
+int ServerThread::AcceptConn(int listen_fd, std::string* ip_port) {
+  struct sockaddr_in cliaddr;
+  socklen_t clilen = sizeof(struct sockaddr);
+  char port_buf[32];
+  char ip_addr[INET_ADDRSTRLEN] = "";
+
+  int connfd = accept(listen_fd, reinterpret_cast<struct sockaddr*>(&cliaddr), &clilen);
+  if (connfd == -1) {
+    LOG(WARNING) << "accept error, errno numberis " << errno << ", error reason " << strerror(errno);
+    return -1;
+  }
+  fcntl(connfd, F_SETFD, fcntl(connfd, F_GETFD) | FD_CLOEXEC);
+
+  // not use nagel to avoid tcp 40ms delay
+  if (SetTcpNoDelay(connfd) == -1) {
+    LOG(WARNING) << "setsockopt error, errno numberis " << errno << ", error reason " << strerror(errno);
+    close(connfd);
+    return -1;
+  }
+
+  // Just ip
+  *ip_port = inet_ntop(AF_INET, &cliaddr.sin_addr, ip_addr, sizeof(ip_addr));
+
+  if (!handle_->AccessHandle(*ip_port) || !handle_->AccessHandle(connfd, *ip_port)) {
+    close(connfd);
+    return -1;
+  }
+
+  ip_port->append(":");
+  snprintf(port_buf, sizeof(port_buf), "%d", ntohs(cliaddr.sin_port));
+  ip_port->append(port_buf);
+  return connfd;
+}
+
 void* ServerThread::ThreadMain() {
   int nfds;
   NetFiredEvent* pfe;
   Status s;
-  struct sockaddr_in cliaddr;
-  socklen_t clilen = sizeof(struct sockaddr);
   int fd;
   int connfd;
 
@@ -174,8 +206,6 @@ void* ServerThread::ThreadMain() {
   }
 
   std::string ip_port;
-  char port_buf[32];
-  char ip_addr[INET_ADDRSTRLEN] = "";
 
   while (!should_stop()) {
     if (cron_interval_ > 0) {
@@ -209,32 +239,11 @@ void* ServerThread::ThreadMain() {
        */
       if (server_fds_.find(fd) != server_fds_.end()) {
         if ((pfe->mask & kReadable) != 0) {
-          connfd = accept(fd, reinterpret_cast<struct sockaddr*>(&cliaddr), &clilen);
+          connfd = AcceptConn(fd, &ip_port);
           if (connfd == -1) {
-            LOG(WARNING) << "accept error, errno numberis " << errno << ", error reason " << strerror(errno);
-            continue;
-          }
-          fcntl(connfd, F_SETFD, fcntl(connfd, F_GETFD) | FD_CLOEXEC);
-
-          // not use nagel to avoid tcp 40ms delay
-          if (SetTcpNoDelay(connfd) == -1) {
-            LOG(WARNING) << "setsockopt error, errno numberis " << errno << ", error reason " << strerror(errno);
-            close(connfd);
             continue;
           }
 
-          // Just ip
-          ip_port = inet_ntop(AF_INET, &cliaddr.sin_addr, ip_addr, sizeof(ip_addr));
-
-          if (!handle_->AccessHandle(ip_port) || !handle_->AccessHandle(connfd, ip_port)) {
-            close(connfd);
-            continue;
-          }
-
-          ip_port.append(":");
-          snprintf(port_buf, sizeof(port_buf), "%d", ntohs(cliaddr.sin_port));
-          ip_port.append(port_buf);
-
           /*
            * Handle new connection,
            * implemented in derived class
@@ -245,6 +254,7 @@ void* ServerThread::ThreadMain() {
           /*
            * this branch means there is error on the listen fd
            */
+          net_multiplexer_->NetDelEvent(pfe->fd, 0);
           close(pfe->fd);
           continue;
         }
@@ -13,6 +13,7 @@
 #include "dispatch_thread.h"
 #include "net/include/net_conn.h"
 #include "net/src/net_item.h"
+#include "net/src/server_socket.h"
 
 namespace net {
 
@@ -71,6 +72,34 @@ bool WorkerThread::MoveConnIn(const std::shared_ptr<NetConn>& conn, const Notify
 
 bool WorkerThread::MoveConnIn(const NetItem& it, bool force) { return net_multiplexer_->Register(it, force); }
 
+void WorkerThread::AddListener(const std::shared_ptr<ServerSocket>& socket) {
+  listeners_.push_back(socket);
+  listen_fds_.insert(socket->sockfd());
+  net_multiplexer_->NetAddEvent(socket->sockfd(), kReadable);
+}
+
+void WorkerThread::NewConn(int connfd, const std::string& ip_port) {
+  std::shared_ptr<NetConn> tc =
+      conn_factory_->NewNetConn(connfd, ip_port, server_thread_, private_data_, net_multiplexer_.get());
+  if (!tc || !tc->SetNonblock()) {
+    return;
+  }
+
+#ifdef __ENABLE_SSL
+  // Create SSL failed
+  if (server_thread_->security() && !tc->CreateSSL(server_thread_->ssl_ctx())) {
+    CloseFd(tc);
+    return;
+  }
+#endif
+
+  {
+    std::lock_guard lock(rwlock_);
+    conns_[connfd] = tc;
+  }
+  net_multiplexer_->NetAddEvent(connfd, kReadable);
+}
+
 void* WorkerThread::ThreadMain() {
   int nfds;
   NetFiredEvent* pfe = nullptr;
@@ -118,25 +147,7 @@ void* WorkerThread::ThreadMain() {
             for (int32_t idx = 0; idx < nread; ++idx) {
               NetItem ti = net_multiplexer_->NotifyQueuePop();
               if (ti.notify_type() == kNotiConnect) {
-                std::shared_ptr<NetConn> tc = conn_factory_->NewNetConn(ti.fd(), ti.ip_port(), server_thread_,
-                                                                        private_data_, net_multiplexer_.get());
-                if (!tc || !tc->SetNonblock()) {
-                  continue;
-                }
-
-#ifdef __ENABLE_SSL
-                // Create SSL failed
-                if (server_thread_->security() && !tc->CreateSSL(server_thread_->ssl_ctx())) {
-                  CloseFd(tc);
-                  continue;
-                }
-#endif
-
-                {
-                  std::lock_guard lock(rwlock_);
-                  conns_[ti.fd()] = tc;
-                }
-                net_multiplexer_->NetAddEvent(ti.fd(), kReadable);
+                NewConn(ti.fd(), ti.ip_port());
               } else if (ti.notify_type() == kNotiClose) {
                 // should close?
               } else if (ti.notify_type() == kNotiEpollout) {
@@ -154,6 +165,19 @@ void* WorkerThread::ThreadMain() {
         } else {
           continue;
         }
+      } else if (listen_fds_.find(pfe->fd) != listen_fds_.end()) {
+        if ((pfe->mask & kReadable) != 0) {
+          std::string ip_port;
+          int connfd = server_thread_->AcceptConn(pfe->fd, &ip_port);
+          if (connfd != -1) {
+            LOG(INFO) << "accept new conn fd: " << connfd << ", ip_port: " << ip_port;
+            NewConn(connfd, ip_port);
+          }
+        } else if ((pfe->mask & kErrorEvent) != 0) {
+          LOG(ERROR) << "error on the listen fd " << pfe->fd << ", stop accepting on it";
+          net_multiplexer_->NetDelEvent(pfe->fd, 0);
+          listen_fds_.erase(pfe->fd);
+        }
       } else {
         in_conn = nullptr;
         int should_close = 0;
@@ -202,7 +226,6 @@ void* WorkerThread::ThreadMain() {
         if (((pfe->mask & kErrorEvent) != 0) || (should_close != 0)) {
           //check if this conn disconnected from being blocked by blpop/brpop
           dynamic_cast<net::DispatchThread*>(server_thread_)->ClosingConnCheckForBlrPop(std::dynamic_pointer_cast<net::RedisConn>(in_conn));
-          net_multiplexer_->NetDelEvent(pfe->fd, 0);
           CloseFd(in_conn);
           in_conn = nullptr;
           {
@@ -233,9 +256,9 @@ void WorkerThread::DoCronTask() {
       for (auto& conn : conns_) {
         to_close.push_back(conn.second);
       }
+      // closed below with the others, conns_ is left empty for the loop
       conns_.clear();
       deleting_conn_ipport_.clear();
-      return;
     }
 
     auto iter = conns_.begin();
@@ -302,6 +325,8 @@ bool WorkerThread::TryKillConn(const std::string& ip_port) {
 }
 
 void WorkerThread::CloseFd(const std::shared_ptr<NetConn>& conn) {
+  // deregister before close, the fd number may be reused at once
+  net_multiplexer_->NetDelEvent(conn->fd(), 0);
   close(conn->fd());
   if (auto dispatcher = dynamic_cast<DispatchThread *>(server_thread_); dispatcher != nullptr ) {
     dispatcher->RemoveWatchKeys(conn);
@@ -310,6 +335,8 @@ void WorkerThread::CloseFd(const std::shared_ptr<NetConn>& conn) {
 }
 
 void WorkerThread::Cleanup() {
+  listen_fds_.clear();
+  listeners_.clear();
   std::map<int, std::shared_ptr<NetConn>> to_close;
   {
     std::lock_guard l(rwlock_);
@@ -45,6 +45,9 @@ class WorkerThread : public Thread {
 
   bool MoveConnIn(const NetItem& it, bool force);
 
+  // Accept the connections of socket in this thread, add before StartThread
+  void AddListener(const std::shared_ptr<ServerSocket>& socket);
+
   NetMultiplexer* net_multiplexer() { return net_multiplexer_.get(); }
   bool TryKillConn(const std::string& ip_port);
 
@@ -67,8 +70,15 @@ class WorkerThread : public Thread {
 
   std::atomic<int> keepalive_timeout_;  // keepalive second
 
+  /*
+   * The SO_REUSEPORT sockets this thread accepts on
+   */
+  std::vector<std::shared_ptr<ServerSocket>> listeners_;
+  std::set<int> listen_fds_;
+
   void* ThreadMain() override;
   void DoCronTask();
+  void NewConn(int connfd, const std::string& ip_port);
 
   pstd::Mutex killer_mutex_;
   std::set<std::string> deleting_conn_ipport_;
@@ -962,7 +962,13 @@ void InfoCmd::InfoClients(std::string& info) {
   std::stringstream tmp_stream;
   tmp_stream << "# Clients"
              << "\r\n";
-  tmp_stream << "connected_clients:" << g_pika_server->ClientList() << "\r\n";
+  std::vector<int> worker_conn_nums;
+  tmp_stream << "connected_clients:" << g_pika_server->ClientList(nullptr, &worker_conn_nums) << "\r\n";
+  tmp_stream << "connected_clients_per_thread:";
+  for (size_t i = 0; i < worker_conn_nums.size(); i++) {
+    tmp_stream << (i == 0 ? "" : ",") << worker_conn_nums[i];
+  }
+  tmp_stream << "\r\n";
 
   info.append(tmp_stream.str());
 }
@@ -1199,7 +1205,8 @@ void InfoCmd::InfoKeyspace(std::string& info) {
     if (keyspace_scan_dbs_.find(db_item.first) != keyspace_scan_dbs_.end()) {
       db_name = db_item.second->GetDBName();
       key_scan_info = db_item.second->GetKeyScanInfo();
-      key_infos = key_scan_info.key_infos;
+      // kept by the writes, the scan only reconciles them
+      db_item.second->storage()->GetKeyCounts(&key_infos);
       duration = key_scan_info.duration;
       if (key_infos.size() != (size_t)(storage::DataTypeNum)) {
         LOG(ERROR) << "key_infos size is not equal with expected, potential data inconsistency";
@@ -1491,6 +1498,12 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeNumber(&config_body, g_pika_conf->thread_pool_size());
   }
 
+  if (pstd::stringmatch(pattern.data(), "reuse-port", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "reuse-port");
+    EncodeString(&config_body, g_pika_conf->reuse_port() ? "yes" : "no");
+  }
+
   if (pstd::stringmatch(pattern.data(), "slow-cmd-thread-pool-size", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "slow-cmd-thread-pool-size");
@@ -1675,6 +1688,60 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeNumber(&config_body, g_pika_conf->small_compaction_duration_threshold());
   }
 
+  if (pstd::stringmatch(pattern.data(), "storage-key-format", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "storage-key-format");
+    EncodeString(&config_body, g_pika_conf->storage_key_format());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "hash-max-inline-entries", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "hash-max-inline-entries");
+    EncodeNumber(&config_body, g_pika_conf->hash_max_inline_entries());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "hash-max-inline-value", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "hash-max-inline-value");
+    EncodeNumber(&config_body, g_pika_conf->hash_max_inline_value());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "set-max-inline-entries", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "set-max-inline-entries");
+    EncodeNumber(&config_body, g_pika_conf->set_max_inline_entries());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "set-max-inline-value", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "set-max-inline-value");
+    EncodeNumber(&config_body, g_pika_conf->set_max_inline_value());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "reclaim-min-count", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "reclaim-min-count");
+    EncodeNumber(&config_body, g_pika_conf->reclaim_min_count());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "reclaim-ranges-per-sec", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "reclaim-ranges-per-sec");
+    EncodeNumber(&config_body, g_pika_conf->reclaim_ranges_per_sec());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "enable-ttl-index", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "enable-ttl-index");
+    EncodeString(&config_body, g_pika_conf->enable_ttl_index() ? "yes" : "no");
+  }
+
+  if (pstd::stringmatch(pattern.data(), "active-expire-batch-size", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "active-expire-batch-size");
+    EncodeNumber(&config_body, g_pika_conf->active_expire_batch_size());
+  }
+
   if (pstd::stringmatch(pattern.data(), "max-background-flushes", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "max-background-flushes");
@@ -1794,6 +1861,42 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeNumber(&config_body, g_pika_conf->binlog_file_size());
   }
 
+  if (pstd::stringmatch(pattern.data(), "binlog-sync-policy", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-sync-policy");
+    EncodeString(&config_body, g_pika_conf->binlog_sync_policy());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "binlog-sync-interval-ms", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-sync-interval-ms");
+    EncodeNumber(&config_body, g_pika_conf->binlog_sync_interval_ms());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "binlog-sync-bytes", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-sync-bytes");
+    EncodeNumber(&config_body, g_pika_conf->binlog_sync_bytes());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "binlog-content-format", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-content-format");
+    EncodeString(&config_body, g_pika_conf->binlog_content_format());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "binlog-compression", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-compression");
+    EncodeString(&config_body, g_pika_conf->binlog_compression());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "binlog-reader-mmap", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-reader-mmap");
+    EncodeString(&config_body, g_pika_conf->binlog_reader_mmap() ? "yes" : "no");
+  }
+
   if (pstd::stringmatch(pattern.data(), "max-write-buffer-size", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "max-write-buffer-size");
@@ -2068,6 +2171,18 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeNumber(&config_body, g_pika_conf->max_rsync_parallel_num());
   }
 
+  if (pstd::stringmatch(pattern.data(), "rsync-window-size", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "rsync-window-size");
+    EncodeNumber(&config_body, g_pika_conf->rsync_window_size());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "rsync-chunk-size", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "rsync-chunk-size");
+    EncodeNumber(&config_body, g_pika_conf->rsync_chunk_size());
+  }
+
   if (pstd::stringmatch(pattern.data(), "replication-id", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "replication-id");
@@ -2168,6 +2283,10 @@ void ConfigCmd::ConfigSet(std::shared_ptr<DB> db) {
         "max-cache-statistic-keys",
         "small-compaction-threshold",
         "small-compaction-duration-threshold",
+        "hash-max-inline-entries",
+        "hash-max-inline-value",
+        "set-max-inline-entries",
+        "set-max-inline-value",
         "max-client-response-size",
         "db-sync-speed",
         "compact-cron",
@@ -2192,6 +2311,8 @@ void ConfigCmd::ConfigSet(std::shared_ptr<DB> db) {
         "arena-block-size",
         "throttle-bytes-per-second",
         "max-rsync-parallel-num",
+        "rsync-window-size",
+        "rsync-chunk-size",
         "cache-model",
         "cache-type",
         "zset-cache-start-direction",
@@ -2362,6 +2483,38 @@ void ConfigCmd::ConfigSet(std::shared_ptr<DB> db) {
     g_pika_conf->SetSmallCompactionDurationThreshold(static_cast<int>(ival));
     g_pika_server->DBSetSmallCompactionDurationThreshold(static_cast<int>(ival));
     res_.AppendStringRaw("+OK\r\n");
+  } else if (set_item == "hash-max-inline-entries") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0 || ival > 512) {
+      res_.AppendStringRaw("-ERR Invalid argument \'" + value + "\' for CONFIG SET 'hash-max-inline-entries'\r\n");
+      return;
+    }
+    g_pika_conf->SetHashMaxInlineEntries(static_cast<int>(ival));
+    g_pika_server->DBSetHashMaxInline(g_pika_conf->hash_max_inline_entries(), g_pika_conf->hash_max_inline_value());
+    res_.AppendStringRaw("+OK\r\n");
+  } else if (set_item == "hash-max-inline-value") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0 || ival > 4096) {
+      res_.AppendStringRaw("-ERR Invalid argument \'" + value + "\' for CONFIG SET 'hash-max-inline-value'\r\n");
+      return;
+    }
+    g_pika_conf->SetHashMaxInlineValue(static_cast<int>(ival));
+    g_pika_server->DBSetHashMaxInline(g_pika_conf->hash_max_inline_entries(), g_pika_conf->hash_max_inline_value());
+    res_.AppendStringRaw("+OK\r\n");
+  } else if (set_item == "set-max-inline-entries") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0 || ival > 512) {
+      res_.AppendStringRaw("-ERR Invalid argument \'" + value + "\' for CONFIG SET 'set-max-inline-entries'\r\n");
+      return;
+    }
+    g_pika_conf->SetSetMaxInlineEntries(static_cast<int>(ival));
+    g_pika_server->DBSetSetMaxInline(g_pika_conf->set_max_inline_entries(), g_pika_conf->set_max_inline_value());
+    res_.AppendStringRaw("+OK\r\n");
+  } else if (set_item == "set-max-inline-value") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0 || ival > 4096) {
+      res_.AppendStringRaw("-ERR Invalid argument \'" + value + "\' for CONFIG SET 'set-max-inline-value'\r\n");
+      return;
+    }
+    g_pika_conf->SetSetMaxInlineValue(static_cast<int>(ival));
+    g_pika_server->DBSetSetMaxInline(g_pika_conf->set_max_inline_entries(), g_pika_conf->set_max_inline_value());
+    res_.AppendStringRaw("+OK\r\n");
   } else if (set_item == "disable_auto_compactions") {
     if (value != "true" && value != "false") {
       res_.AppendStringRaw("-ERR invalid disable_auto_compactions (true or false)\r\n");
@@ -2716,6 +2869,21 @@ void ConfigCmd::ConfigSet(std::shared_ptr<DB> db) {
     }
     g_pika_conf->SetMaxRsyncParallelNum(static_cast<int>(ival));
     res_.AppendStringRaw("+OK\r\n");
+  } else if (set_item == "rsync-window-size") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival > kMaxRsyncWindowSize || ival <= 0) {
+      res_.AppendStringRaw("-ERR Invalid argument \'" + value + "\' for CONFIG SET 'rsync-window-size'\r\n");
+      return;
+    }
+    g_pika_conf->SetRsyncWindowSize(static_cast<int>(ival));
+    res_.AppendStringRaw("+OK\r\n");
+  } else if (set_item == "rsync-chunk-size") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival > kMaxRsyncChunkSize ||
+        ival < kMinRsyncChunkSize) {
+      res_.AppendStringRaw("-ERR Invalid argument \'" + value + "\' for CONFIG SET 'rsync-chunk-size'\r\n");
+      return;
+    }
+    g_pika_conf->SetRsyncChunkSize(ival);
+    res_.AppendStringRaw("+OK\r\n");
   } else if (set_item == "cache-num") {
     if (!pstd::string2int(value.data(), value.size(), &ival) || ival < 0) {
       res_.AppendStringRaw("-ERR Invalid argument " + value + " for CONFIG SET 'cache-num'\r\n");
@@ -2910,8 +3078,8 @@ void DbsizeCmd::Do() {
       }
       res_.AppendInteger(dbsize);
     }
-    KeyScanInfo key_scan_info = dbs->GetKeyScanInfo();
-    std::vector<storage::KeyInfo> key_infos = key_scan_info.key_infos;
+    std::vector<storage::KeyInfo> key_infos;
+    dbs->storage()->GetKeyCounts(&key_infos);
     if (key_infos.size() != (size_t)(storage::DataTypeNum)) {
       res_.SetRes(CmdRes::kErrOther, "Mismatch in expected data types and actual key info count");
       return;
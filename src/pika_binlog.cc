@@ -7,8 +7,12 @@
 
 #include <fcntl.h>
 #include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
 
+#include <chrono>
 #include <utility>
 
 #include "include/pika_binlog_transverter.h"
@@ -32,13 +36,15 @@ Version::Version(const std::shared_ptr<pstd::RWFile>& save) :  save_(save) {
 
 Version::~Version() { StableSave(); }
 
-Status Version::StableSave() {
+Status Version::StableSave() { return StableSave(pro_num_, pro_offset_, logic_id_); }
+
+Status Version::StableSave(uint32_t pro_num, uint64_t pro_offset, uint64_t logic_id) {
   char* p = save_->GetData();
-  memcpy(p, &pro_num_, sizeof(uint32_t));
+  memcpy(p, &pro_num, sizeof(uint32_t));
   p += 4;
-  memcpy(p, &pro_offset_, sizeof(uint64_t));
+  memcpy(p, &pro_offset, sizeof(uint64_t));
   p += 8;
-  memcpy(p, &logic_id_, sizeof(uint64_t));
+  memcpy(p, &logic_id, sizeof(uint64_t));
   p += 8;
   memcpy(p, &term_, sizeof(uint32_t));
   return Status::OK();
@@ -57,6 +63,39 @@ Status Version::Init() {
   }
 }
 
+/*
+ * BinlogMapping
+ */
+BinlogMapping::~BinlogMapping() {
+  if (base_ != nullptr) {
+    munmap(base_, size_);
+  }
+}
+
+std::shared_ptr<BinlogMapping> BinlogMapping::Open(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  auto size = static_cast<size_t>(st.st_size);
+  void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping holds the file, fd is no longer needed
+  close(fd);
+  if (ptr == MAP_FAILED) {  // NOLINT
+    LOG(WARNING) << "Binlog: mmap " << filename << " failed, " << strerror(errno);
+    return nullptr;
+  }
+  // Readers go through the file once, read ahead aggressively and drop
+  // the pages behind soon
+  madvise(ptr, size, MADV_SEQUENTIAL);
+  return std::shared_ptr<BinlogMapping>(new BinlogMapping(reinterpret_cast<char*>(ptr), size));
+}
+
 /*
  * Binlog
  */
@@ -111,6 +150,8 @@ Binlog::Binlog(std::string  binlog_path, const int file_size)
     }
 
     profile = NewFileName(filename_, pro_num_);
+    RecoverTail();
+
     DLOG(INFO) << "Binlog: open profile " << profile;
     s = pstd::AppendWritableFile(profile, queue_, version_->pro_offset_);
     if (!s.ok()) {
@@ -125,6 +166,7 @@ Binlog::Binlog(std::string  binlog_path, const int file_size)
 }
 
 Binlog::~Binlog() {
+  StopSyncer();
   std::lock_guard l(mutex_);
   Close();
 }
@@ -136,6 +178,215 @@ void Binlog::Close() {
   opened_.store(false);
 }
 
+// Unless the sync policy is kRecord the manifest is saved behind the file,
+// the records appended after the saved producer offset are scanned here,
+// or they would be overwritten by the following appends.
+void Binlog::RecoverTail() {
+  std::string profile = NewFileName(filename_, version_->pro_num_);
+  std::unique_ptr<pstd::SequentialFile> file;
+  if (!pstd::NewSequentialFile(profile, file).ok() || !file->Skip(version_->pro_offset_).ok()) {
+    return;
+  }
+
+  uint64_t cursor = version_->pro_offset_;
+  uint64_t recovered_offset = cursor;
+  uint64_t recovered_logic_id = version_->logic_id_;
+  std::unique_ptr<char[]> scratch = std::make_unique<char[]>(kBlockSize);
+  std::string record;
+  bool in_record = false;
+  pstd::Slice fragment;
+  while (true) {
+    const uint64_t leftover = kBlockSize - cursor % kBlockSize;
+    if (leftover < kHeaderSize) {
+      // Trailer of the block
+      file->Read(leftover, &fragment, scratch.get());
+      if (fragment.size() < leftover) {
+        break;
+      }
+      cursor += leftover;
+      continue;
+    }
+
+    file->Read(kHeaderSize, &fragment, scratch.get());
+    if (fragment.size() < kHeaderSize) {
+      break;
+    }
+    const auto* header = reinterpret_cast<const uint8_t*>(fragment.data());
+    const uint32_t length = header[0] | (header[1] << 8) | (header[2] << 16);
+    const uint8_t type = header[7];
+    // The file is preallocated, zeros follow the last record. A fragment
+    // may be empty, Produce emits an empty kFirstType one when exactly
+    // kHeaderSize bytes are left in the block.
+    if (type == kZeroType || type > kLastType || kHeaderSize + length > leftover) {
+      break;
+    }
+    fragment.clear();
+    if (length > 0) {
+      file->Read(length, &fragment, scratch.get());
+      if (fragment.size() < length) {
+        break;
+      }
+    }
+    cursor += kHeaderSize + length;
+
+    if (type == kFullType || type == kFirstType) {
+      if (in_record) {
+        break;
+      }
+      record.assign(fragment.data(), fragment.size());
+      in_record = type == kFirstType;
+    } else if (type == kMiddleType || type == kLastType) {
+      if (!in_record) {
+        break;
+      }
+      record.append(fragment.data(), fragment.size());
+      in_record = type == kMiddleType;
+    } else {
+      break;
+    }
+    if (in_record) {
+      continue;
+    }
+
+    BinlogItem item;
+    if (!PikaBinlogTransverter::BinlogDecode(BinlogType::TypeFirst, record, &item)) {
+      break;
+    }
+    recovered_offset = cursor;
+    recovered_logic_id = item.logic_id();
+  }
+
+  if (recovered_offset != version_->pro_offset_) {
+    LOG(INFO) << "Binlog: recover producer offset of " << profile << " from " << version_->pro_offset_ << " to "
+              << recovered_offset << ", logic id " << recovered_logic_id;
+    std::lock_guard l(version_->rwlock_);
+    version_->pro_offset_ = recovered_offset;
+    version_->logic_id_ = recovered_logic_id;
+    version_->StableSave();
+  }
+}
+
+void Binlog::StartSyncer(BinlogSyncPolicy policy, uint64_t interval_ms, uint64_t bytes) {
+  sync_policy_ = policy;
+  sync_interval_ms_ = interval_ms == 0 ? 1 : interval_ms;
+  sync_bytes_ = bytes == 0 ? 1 : bytes;
+  if (sync_policy_ == BinlogSyncPolicy::kRecord) {
+    return;
+  }
+  syncer_ = std::thread(&Binlog::RunSyncer, this);
+}
+
+void Binlog::StopSyncer() {
+  if (!syncer_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard l(sync_mu_);
+    sync_exit_ = true;
+  }
+  sync_cv_.notify_one();
+  syncer_.join();
+  Sync();
+}
+
+void Binlog::RunSyncer() {
+  std::unique_lock l(sync_mu_);
+  while (!sync_exit_) {
+    if (sync_policy_ == BinlogSyncPolicy::kInterval) {
+      sync_cv_.wait_for(l, std::chrono::milliseconds(sync_interval_ms_), [this] { return sync_exit_; });
+    } else {
+      sync_cv_.wait(l, [this] { return sync_exit_ || unsynced_bytes_.load() >= sync_bytes_; });
+    }
+    if (sync_exit_) {
+      break;
+    }
+    l.unlock();
+    Status s = Sync();
+    // Busy after the binlog is closed
+    if (!s.ok() && !s.IsBusy()) {
+      LOG(WARNING) << "Binlog: sync " << filename_ << " failed, " << s.ToString();
+    }
+    l.lock();
+  }
+}
+
+Status Binlog::Sync() {
+  uint32_t pro_num = 0;
+  uint64_t pro_offset = 0;
+  uint64_t logic_id = 0;
+  uint64_t epoch = 0;
+  uint64_t unsynced = 0;
+  {
+    std::lock_guard l(mutex_);
+    if (!opened_.load()) {
+      return Status::Busy("Binlog is not open yet");
+    }
+    unsynced = unsynced_bytes_.exchange(0);
+    if (unsynced == 0) {
+      return Status::OK();
+    }
+    std::shared_lock vl(version_->rwlock_);
+    pro_num = version_->pro_num_;
+    pro_offset = version_->pro_offset_;
+    logic_id = version_->logic_id_;
+    epoch = version_->epoch_;
+  }
+
+  // The appends go on while the file is synced, the records up to the
+  // snapshot are already in the page cache through the mapping of the file
+  const std::string profile = NewFileName(filename_, pro_num);
+  const int fd = open(profile.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    unsynced_bytes_.fetch_add(unsynced);
+    return Status::IOError(profile, strerror(errno));
+  }
+#if defined(__APPLE__)
+  const int ret = fsync(fd);
+#else
+  const int ret = fdatasync(fd);
+#endif
+  const int sync_errno = errno;
+  close(fd);
+  if (ret != 0) {
+    unsynced_bytes_.fetch_add(unsynced);
+    return Status::IOError(profile, strerror(sync_errno));
+  }
+
+  {
+    // The manifest never points behind the synced records. If the producer
+    // has moved since the snapshot, it has been saved by whoever moved it.
+    std::lock_guard vl(version_->rwlock_);
+    if (version_->epoch_ != epoch) {
+      return Status::OK();
+    }
+    version_->StableSave(pro_num, pro_offset, logic_id);
+  }
+  return versionfile_->Sync();
+}
+
+std::shared_ptr<BinlogMapping> Binlog::MapFile(uint32_t filenum) {
+  uint32_t pro_num = 0;
+  uint64_t pro_offset = 0;
+  if (!GetProducerStatus(&pro_num, &pro_offset).ok() || filenum >= pro_num) {
+    return nullptr;
+  }
+
+  std::lock_guard l(mappings_mu_);
+  for (auto iter = mappings_.begin(); iter != mappings_.end();) {
+    if (iter->second.expired()) {
+      iter = mappings_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  std::shared_ptr<BinlogMapping> mapping = mappings_[filenum].lock();
+  if (!mapping) {
+    mapping = BinlogMapping::Open(NewFileName(filename_, filenum));
+    mappings_[filenum] = mapping;
+  }
+  return mapping;
+}
+
 void Binlog::InitLogFile() {
   assert(queue_ != nullptr);
 
@@ -164,11 +415,59 @@ Status Binlog::GetProducerStatus(uint32_t* filenum, uint64_t* pro_offset, uint32
   return Status::OK();
 }
 
-// Note: mutex lock should be held
 Status Binlog::Put(const std::string& item) {
   if (!opened_.load()) {
     return Status::Busy("Binlog is not open yet");
   }
+
+  Writer w(&item);
+  std::unique_lock l(writers_mu_);
+  writers_.push_back(&w);
+  w.cv.wait(l, [&w, this] { return w.done || &w == writers_.front(); });
+  if (w.done) {
+    return w.status;
+  }
+
+  // We are the leader, append the records of the group without writers_mu_
+  // so that the following callers can queue up behind the group
+  std::vector<Writer*> group;
+  BuildGroup(&group);
+  l.unlock();
+
+  size_t appended = 0;
+  Status s = PutGroup(group, &appended);
+
+  l.lock();
+  for (size_t i = 0; i < group.size(); i++) {
+    Writer* ready = writers_.front();
+    writers_.pop_front();
+    ready->status = i < appended ? Status::OK() : s;
+    if (ready != &w) {
+      ready->done = true;
+      ready->cv.notify_one();
+    }
+  }
+  // Notify the leader of the next group
+  if (!writers_.empty()) {
+    writers_.front()->cv.notify_one();
+  }
+  return w.status;
+}
+
+void Binlog::BuildGroup(std::vector<Writer*>* group) {
+  size_t size = 0;
+  for (Writer* w : writers_) {
+    // The leader is always taken, however large its record is
+    if (!group->empty() && size + w->item->size() > kBinlogGroupMaxSize) {
+      break;
+    }
+    size += w->item->size();
+    group->push_back(w);
+  }
+}
+
+// Note: mutex lock should not be held
+Status Binlog::PutGroup(const std::vector<Writer*>& group, size_t* appended) {
   uint32_t filenum = 0;
   uint32_t term = 0;
   uint64_t offset = 0;
@@ -179,15 +478,47 @@ Status Binlog::Put(const std::string& item) {
     Unlock();
   };
 
-  Status s = GetProducerStatus(&filenum, &offset, &term, &logic_id);
-  if (!s.ok()) {
-    return s;
+  Status s;
+  uint64_t appended_bytes = 0;
+  for (Writer* w : group) {
+    // Roll before the record is encoded, so that it carries the filenum and
+    // offset it is really written at
+    s = MaybeRoll();
+    if (!s.ok()) {
+      break;
+    }
+    s = GetProducerStatus(&filenum, &offset, &term, &logic_id);
+    if (!s.ok()) {
+      break;
+    }
+    logic_id++;
+    std::string data = PikaBinlogTransverter::BinlogEncode(BinlogType::TypeFirst,
+        time(nullptr), term, logic_id, filenum, offset, *w->item, {});
+
+    s = Put(data.c_str(), static_cast<int>(data.size()));
+    if (!s.ok()) {
+      break;
+    }
+    appended_bytes += data.size();
+    (*appended)++;
   }
-  logic_id++;
-  std::string data = PikaBinlogTransverter::BinlogEncode(BinlogType::TypeFirst,
-      time(nullptr), term, logic_id, filenum, offset, item, {});
 
-  s = Put(data.c_str(), static_cast<int>(data.size()));
+  if (*appended > 0) {
+    Status fs = queue_->Flush();
+    if (!fs.ok()) {
+      *appended = 0;
+      s = fs;
+    }
+    if (sync_policy_ == BinlogSyncPolicy::kRecord) {
+      std::lock_guard l(version_->rwlock_);
+      version_->StableSave();
+    } else if (unsynced_bytes_.fetch_add(appended_bytes) + appended_bytes >= sync_bytes_ &&
+               sync_policy_ == BinlogSyncPolicy::kBytes) {
+      // Under sync_mu_, or the syncer may miss the notification
+      std::lock_guard l(sync_mu_);
+      sync_cv_.notify_one();
+    }
+  }
   if (!s.ok()) {
     binlog_io_error_.store(true);
   }
@@ -195,12 +526,20 @@ Status Binlog::Put(const std::string& item) {
 }
 
 // Note: mutex lock should be held
-Status Binlog::Put(const char* item, int len) {
+Status Binlog::MaybeRoll() {
   Status s;
-
-  /* Check to roll log file */
   uint64_t filesize = queue_->Filesize();
   if (filesize > file_size_) {
+    s = queue_->Flush();
+    if (!s.ok()) {
+      return s;
+    }
+    // Only the tail of the current file is recovered on open, the file
+    // rolled over must be on disk before the manifest points past it
+    s = queue_->Sync();
+    if (!s.ok()) {
+      return s;
+    }
     std::unique_ptr<pstd::WritableFile> queue;
     std::string profile = NewFileName(filename_, pro_num_ + 1);
     s = pstd::NewWritableFile(profile, queue);
@@ -216,18 +555,22 @@ Status Binlog::Put(const char* item, int len) {
       std::lock_guard l(version_->rwlock_);
       version_->pro_offset_ = 0;
       version_->pro_num_ = pro_num_;
+      version_->epoch_++;
       version_->StableSave();
     }
     InitLogFile();
   }
+  return s;
+}
 
+// Note: mutex lock should be held
+Status Binlog::Put(const char* item, int len) {
   int pro_offset;
-  s = Produce(pstd::Slice(item, len), &pro_offset);
+  Status s = Produce(pstd::Slice(item, len), &pro_offset);
   if (s.ok()) {
     std::lock_guard l(version_->rwlock_);
     version_->pro_offset_ = pro_offset;
     version_->logic_id_++;
-    version_->StableSave();
   }
 
   return s;
@@ -256,9 +599,6 @@ Status Binlog::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n, int*
   s = queue_->Append(pstd::Slice(buf, kHeaderSize));
   if (s.ok()) {
     s = queue_->Append(pstd::Slice(ptr, n));
-    if (s.ok()) {
-      s = queue_->Flush();
-    }
   }
   block_offset_ += static_cast<int32_t>(kHeaderSize + n);
 
@@ -391,6 +731,7 @@ Status Binlog::SetProducerStatus(uint32_t pro_num, uint64_t pro_offset, uint32_t
     version_->pro_offset_ = pro_offset;
     version_->term_ = term;
     version_->logic_id_ = index;
+    version_->epoch_++;
     version_->StableSave();
   }
 
@@ -416,6 +757,7 @@ Status Binlog::Truncate(uint32_t pro_num, uint64_t pro_offset, uint64_t index) {
     version_->pro_num_ = pro_num;
     version_->pro_offset_ = pro_offset;
     version_->logic_id_ = index;
+    version_->epoch_++;
     version_->StableSave();
   }
 
@@ -7,8 +7,46 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+
+#include "include/pika_conf.h"
+
 using pstd::Status;
 
+extern std::unique_ptr<PikaConf> g_pika_conf;
+
+namespace {
+
+// Reads from a shared BinlogMapping, the slices returned point into the
+// mapping instead of being copied into scratch
+class MmapSequentialFile : public pstd::SequentialFile {
+ public:
+  explicit MmapSequentialFile(std::shared_ptr<BinlogMapping> mapping) : mapping_(std::move(mapping)) {}
+
+  Status Read(size_t n, pstd::Slice* result, char* scratch) override {
+    size_t r = std::min(n, mapping_->size() - pos_);
+    *result = pstd::Slice(mapping_->data() + pos_, r);
+    pos_ += r;
+    if (r < n) {
+      return Status::EndFile("end file");
+    }
+    return Status::OK();
+  }
+
+  Status Skip(uint64_t n) override {
+    pos_ = std::min(mapping_->size(), static_cast<size_t>(pos_ + n));
+    return Status::OK();
+  }
+
+  char* ReadLine(char* buf, int n) override { return nullptr; }
+
+ private:
+  std::shared_ptr<BinlogMapping> mapping_;
+  size_t pos_ = 0;
+};
+
+}  // namespace
+
 PikaBinlogReader::PikaBinlogReader(uint32_t cur_filenum, uint64_t cur_offset)
     : cur_filenum_(cur_filenum),
       cur_offset_(cur_offset),
@@ -42,7 +80,7 @@ int PikaBinlogReader::Seek(const std::shared_ptr<Binlog>& logger, uint32_t filen
     return -1;
   }
   std::unique_ptr<pstd::SequentialFile> readfile;
-  if (!pstd::NewSequentialFile(confile, readfile).ok()) {
+  if (!OpenFile(logger, filenum, &readfile).ok()) {
     LOG(WARNING) << "New swquential " << confile << " failed";
     return -1;
   }
@@ -81,6 +119,18 @@ int PikaBinlogReader::Seek(const std::shared_ptr<Binlog>& logger, uint32_t filen
   return 0;
 }
 
+Status PikaBinlogReader::OpenFile(const std::shared_ptr<Binlog>& logger, uint32_t filenum,
+                                  std::unique_ptr<pstd::SequentialFile>* file) {
+  if (g_pika_conf->binlog_reader_mmap()) {
+    std::shared_ptr<BinlogMapping> mapping = logger->MapFile(filenum);
+    if (mapping) {
+      *file = std::make_unique<MmapSequentialFile>(std::move(mapping));
+      return Status::OK();
+    }
+  }
+  return pstd::NewSequentialFile(NewFileName(logger->filename(), filenum), *file);
+}
+
 bool PikaBinlogReader::GetNext(uint64_t* size) {
   uint64_t offset = 0;
   pstd::Status s;
@@ -247,7 +297,7 @@ Status PikaBinlogReader::Get(std::string* scratch, uint32_t* filenum, uint64_t*
         queue_.reset();
         queue_ = nullptr;
 
-        pstd::NewSequentialFile(confile, queue_);
+        OpenFile(logger_, cur_filenum_ + 1, &queue_);
         {
           std::lock_guard l(rwlock_);
           cur_filenum_++;
@@ -6,6 +6,8 @@
 #include "include/pika_binlog_transverter.h"
 
 #include <glog/logging.h>
+#include <lz4.h>
+#include <zstd.h>
 #include <cassert>
 #include <sstream>
 
@@ -63,6 +65,7 @@ std::string PikaBinlogTransverter::BinlogEncode(BinlogType type, uint32_t exec_t
                                                 uint64_t logic_id, uint32_t filenum, uint64_t offset,
                                                 const std::string& content, const std::vector<std::string>& extends) {
   std::string binlog;
+  binlog.reserve(BINLOG_ITEM_HEADER_SIZE + content.size());
   pstd::PutFixed16(&binlog, type);
   pstd::PutFixed32(&binlog, exec_time);
   pstd::PutFixed32(&binlog, term_id);
@@ -174,3 +177,139 @@ bool PikaBinlogTransverter::BinlogItemWithoutContentDecode(BinlogType type, cons
   pstd::GetFixed64(&binlog_str, &binlog_item->offset_);
   return true;
 }
+
+// Read "<prefix><len>\r\n" at *pos
+static bool GetRespLen(const std::string& resp, char prefix, size_t* pos, uint64_t* len) {
+  if (*pos >= resp.size() || resp[*pos] != prefix) {
+    return false;
+  }
+  size_t end = resp.find(kNewLine, *pos);
+  if (end == std::string::npos || end == *pos + 1) {
+    return false;
+  }
+  *len = 0;
+  for (size_t i = *pos + 1; i < end; i++) {
+    if (resp[i] < '0' || resp[i] > '9') {
+      return false;
+    }
+    *len = *len * 10 + (resp[i] - '0');
+  }
+  *pos = end + kNewLine.size();
+  return true;
+}
+
+void PikaBinlogTransverter::ContentEncode(const std::vector<std::string>& argv, const std::string& compression,
+                                          std::string* content) {
+  // A varint32 takes at most 5 bytes
+  size_t size = 1 + 5;
+  for (const auto& arg : argv) {
+    size += 5 + arg.size();
+  }
+  content->clear();
+  content->reserve(size);
+  content->push_back(static_cast<char>(kBinlogContentBinary));
+  pstd::PutVarint32(content, static_cast<uint32_t>(argv.size()));
+  for (const auto& arg : argv) {
+    pstd::PutVarint32(content, static_cast<uint32_t>(arg.size()));
+    content->append(arg);
+  }
+
+  const char* args = content->data() + 1;
+  const size_t args_size = content->size() - 1;
+  if (args_size < kBinlogCompressMinSize || (compression != "lz4" && compression != "zstd")) {
+    return;
+  }
+  std::string compressed;
+  compressed.push_back(static_cast<char>(compression == "lz4" ? kBinlogContentLZ4 : kBinlogContentZSTD));
+  pstd::PutVarint32(&compressed, static_cast<uint32_t>(args_size));
+  const size_t header_size = compressed.size();
+  if (compression == "lz4") {
+    int bound = LZ4_compressBound(static_cast<int>(args_size));
+    compressed.resize(header_size + bound);
+    int n = LZ4_compress_default(args, compressed.data() + header_size, static_cast<int>(args_size), bound);
+    if (n <= 0 || static_cast<size_t>(n) >= args_size) {
+      return;
+    }
+    compressed.resize(header_size + n);
+  } else {
+    size_t bound = ZSTD_compressBound(args_size);
+    compressed.resize(header_size + bound);
+    size_t n = ZSTD_compress(compressed.data() + header_size, bound, args, args_size, 1);
+    if (ZSTD_isError(n) != 0 || n >= args_size) {
+      return;
+    }
+    compressed.resize(header_size + n);
+  }
+  content->swap(compressed);
+}
+
+bool PikaBinlogTransverter::ContentDecode(const char* content, size_t size, std::vector<std::string>* argv) {
+  argv->clear();
+  if (size == 0) {
+    return false;
+  }
+  const char* limit = content + size;
+
+  if (content[0] == '*') {
+    std::string resp(content, size);
+    size_t pos = 0;
+    uint64_t argc = 0;
+    if (!GetRespLen(resp, '*', &pos, &argc)) {
+      return false;
+    }
+    for (uint64_t i = 0; i < argc; i++) {
+      uint64_t len = 0;
+      if (!GetRespLen(resp, '$', &pos, &len) || resp.size() < pos + len + kNewLine.size()) {
+        return false;
+      }
+      argv->emplace_back(resp, pos, len);
+      pos += len + kNewLine.size();
+    }
+    return true;
+  }
+
+  std::string args;
+  const char* ptr = content + 1;
+  auto format = static_cast<uint8_t>(content[0]);
+  if (format == kBinlogContentLZ4 || format == kBinlogContentZSTD) {
+    uint32_t args_len = 0;
+    ptr = pstd::GetVarint32Ptr(ptr, limit, &args_len);
+    if (ptr == nullptr) {
+      return false;
+    }
+    args.resize(args_len);
+    if (format == kBinlogContentLZ4) {
+      int n = LZ4_decompress_safe(ptr, args.data(), static_cast<int>(limit - ptr), static_cast<int>(args_len));
+      if (n < 0 || static_cast<uint32_t>(n) != args_len) {
+        return false;
+      }
+    } else {
+      size_t n = ZSTD_decompress(args.data(), args_len, ptr, limit - ptr);
+      if (ZSTD_isError(n) != 0 || n != args_len) {
+        return false;
+      }
+    }
+    ptr = args.data();
+    limit = args.data() + args.size();
+  } else if (format != kBinlogContentBinary) {
+    LOG(ERROR) << "Binlog Item content format error, format: " << static_cast<int>(format);
+    return false;
+  }
+
+  uint32_t argc = 0;
+  ptr = pstd::GetVarint32Ptr(ptr, limit, &argc);
+  if (ptr == nullptr) {
+    return false;
+  }
+  argv->reserve(argc);
+  for (uint32_t i = 0; i < argc; i++) {
+    uint32_t len = 0;
+    ptr = pstd::GetVarint32Ptr(ptr, limit, &len);
+    if (ptr == nullptr || static_cast<size_t>(limit - ptr) < len) {
+      return false;
+    }
+    argv->emplace_back(ptr, len);
+    ptr += len;
+  }
+  return true;
+}
@@ -34,7 +34,7 @@ PikaClientConn::PikaClientConn(int fd, const std::string& ip_port, net::Thread*
   time_stat_.reset(new TimeStat());
 }
 
-std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const std::string& opt,
+std::shared_ptr<Cmd> PikaClientConn::DoCmd(PikaCmdArgsType& argv, const std::string& opt,
                                            const std::shared_ptr<std::string>& resp_ptr) {
   // Get command info
   std::shared_ptr<Cmd> c_ptr = g_pika_cmd_table_manager->GetCmd(opt);
@@ -56,8 +56,8 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
       return c_ptr;
     }
   }
-  // Initial
-  c_ptr->Initial(argv, current_db_);
+  // Initial, argv is moved into the command, use c_ptr->argv() from here on
+  c_ptr->Initial(std::move(argv), current_db_);
   if (!c_ptr->res().ok()) {
     if (IsInTxn()) {
       SetTxnInitFailState(true);
@@ -67,10 +67,10 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
 
   int8_t subCmdIndex = -1;
   std::string errKey;
-  auto checkRes = user_->CheckUserPermission(c_ptr, argv, subCmdIndex, &errKey);
+  auto checkRes = user_->CheckUserPermission(c_ptr, c_ptr->argv(), subCmdIndex, &errKey);
   std::string cmdName = c_ptr->name();
   if (subCmdIndex >= 0 && checkRes == AclDeniedCmd::CMD) {
-    cmdName += "|" + argv[1];
+    cmdName += "|" + c_ptr->argv()[1];
   }
 
   std::string object;
@@ -91,7 +91,7 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
       object = errKey;
       break;
     case AclDeniedCmd::NO_SUB_CMD:
-      c_ptr->res().SetRes(CmdRes::kErrOther, fmt::format("unknown subcommand '{}' subcommand", argv[1]));
+      c_ptr->res().SetRes(CmdRes::kErrOther, fmt::format("unknown subcommand '{}' subcommand", c_ptr->argv()[1]));
       break;
     case AclDeniedCmd::NO_AUTH:
       c_ptr->res().AppendContent("-NOAUTH Authentication required.");
@@ -126,7 +126,7 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
 
   bool is_monitoring = g_pika_server->HasMonitorClients();
   if (is_monitoring) {
-    ProcessMonitor(argv);
+    ProcessMonitor(c_ptr->argv());
   }
 
   g_pika_server->UpdateQueryNumAndExecCountDB(current_db_, opt, c_ptr->is_write());
@@ -209,7 +209,7 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
   }
 
   if (g_pika_conf->slowlog_slower_than() >= 0) {
-    ProcessSlowlog(argv, c_ptr->GetDoDuration());
+    ProcessSlowlog(c_ptr->argv(), c_ptr->GetDoDuration());
   }
 
   return c_ptr;
@@ -255,12 +255,13 @@ void PikaClientConn::ProcessMonitor(const PikaCmdArgsType& argv) {
   g_pika_server->AddMonitorMessage(monitor_message);
 }
 
-void PikaClientConn::ProcessRedisCmds(const std::vector<net::RedisCmdArgsType>& argvs, bool async,
+void PikaClientConn::ProcessRedisCmds(std::vector<net::RedisCmdArgsType>&& argvs, bool async,
                                       std::string* response) {
   time_stat_->Reset();
   if (async) {
     auto arg = new BgTaskArg();
-    arg->redis_cmds = argvs;
+    std::string opt = argvs[0][0];
+    arg->redis_cmds = std::move(argvs);
     time_stat_->enqueue_ts_ = pstd::NowMicros();
     arg->conn_ptr = std::dynamic_pointer_cast<PikaClientConn>(shared_from_this());
     /**
@@ -269,7 +270,6 @@ void PikaClientConn::ProcessRedisCmds(const std::vector<net::RedisCmdArgsType>&
      * However, if using the pipeline method for Codis, it can correctly distinguish between
      * fast and slow commands, but it cannot guarantee sequential execution.
      */
-    std::string opt = argvs[0][0];
     pstd::StringToLower(opt);
     bool is_slow_cmd = g_pika_conf->is_slow_cmd(opt);
     g_pika_server->ScheduleClientPool(&DoBackgroundTask, arg, is_slow_cmd);
@@ -296,9 +296,9 @@ void PikaClientConn::DoBackgroundTask(void* arg) {
   conn_ptr->BatchExecRedisCmd(bg_arg->redis_cmds);
 }
 
-void PikaClientConn::BatchExecRedisCmd(const std::vector<net::RedisCmdArgsType>& argvs) {
+void PikaClientConn::BatchExecRedisCmd(std::vector<net::RedisCmdArgsType>& argvs) {
   resp_num.store(static_cast<int32_t>(argvs.size()));
-  for (const auto& argv : argvs) {
+  for (auto& argv : argvs) {
     std::shared_ptr<std::string> resp_ptr = std::make_shared<std::string>();
     resp_array.push_back(resp_ptr);
     ExecRedisCmd(argv, resp_ptr);
@@ -311,7 +311,7 @@ void PikaClientConn::TryWriteResp() {
   int expected = 0;
   if (resp_num.compare_exchange_strong(expected, -1)) {
     for (auto& resp : resp_array) {
-      WriteResp(*resp);
+      WriteResp(std::move(resp));
     }
     if (write_completed_cb_) {
       write_completed_cb_();
@@ -426,7 +426,7 @@ void PikaClientConn::ExitTxn() {
   }
 }
 
-void PikaClientConn::ExecRedisCmd(const PikaCmdArgsType& argv, std::shared_ptr<std::string>& resp_ptr) {
+void PikaClientConn::ExecRedisCmd(PikaCmdArgsType& argv, std::shared_ptr<std::string>& resp_ptr) {
   // get opt
   std::string opt = argv[0];
   pstd::StringToLower(opt);
@@ -438,7 +438,7 @@ void PikaClientConn::ExecRedisCmd(const PikaCmdArgsType& argv, std::shared_ptr<s
   }
 
   std::shared_ptr<Cmd> cmd_ptr = DoCmd(argv, opt, resp_ptr);
-  *resp_ptr = std::move(cmd_ptr->res().message());
+  *resp_ptr = cmd_ptr->res().TakeMessage();
   resp_num--;
 }
 
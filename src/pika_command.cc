@@ -9,6 +9,7 @@
 #include <glog/logging.h>
 #include "include/pika_acl.h"
 #include "include/pika_admin.h"
+#include "include/pika_binlog_transverter.h"
 #include "include/pika_bit.h"
 #include "include/pika_command.h"
 #include "include/pika_geo.h"
@@ -573,6 +574,10 @@ void InitCmdTable(CmdTable* cmd_table) {
   std::unique_ptr<Cmd> zscoreptr =
       std::make_unique<ZScoreCmd>(kCmdNameZScore, 3, kCmdFlagsRead |  kCmdFlagsZset |kCmdFlagsDoThroughDB | kCmdFlagsReadCache | kCmdFlagsFast);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameZScore, std::move(zscoreptr)));
+  ////ZMScoreCmd
+  std::unique_ptr<Cmd> zmscoreptr =
+      std::make_unique<ZMScoreCmd>(kCmdNameZMScore, -3, kCmdFlagsRead |  kCmdFlagsZset |kCmdFlagsDoThroughDB | kCmdFlagsReadCache | kCmdFlagsFast);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameZMScore, std::move(zmscoreptr)));
   ////ZRangebylexCmd
   std::unique_ptr<Cmd> zrangebylexptr =
       std::make_unique<ZRangebylexCmd>(kCmdNameZRangebylex, -4, kCmdFlagsRead |  kCmdFlagsZset | kCmdFlagsSlow);
@@ -653,6 +658,10 @@ void InitCmdTable(CmdTable* cmd_table) {
   std::unique_ptr<Cmd> sismemberptr =
       std::make_unique<SIsmemberCmd>(kCmdNameSIsmember, 3, kCmdFlagsRead |  kCmdFlagsSet |kCmdFlagsDoThroughDB | kCmdFlagsReadCache | kCmdFlagsUpdateCache | kCmdFlagsFast);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameSIsmember, std::move(sismemberptr)));
+  ////SMIsmemberCmd
+  std::unique_ptr<Cmd> smismemberptr =
+      std::make_unique<SMIsmemberCmd>(kCmdNameSMIsmember, -3, kCmdFlagsRead |  kCmdFlagsSet |kCmdFlagsDoThroughDB | kCmdFlagsReadCache | kCmdFlagsUpdateCache | kCmdFlagsFast);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameSMIsmember, std::move(smismemberptr)));
   ////SDiffCmd
   std::unique_ptr<Cmd> sdiffptr =
       std::make_unique<SDiffCmd>(kCmdNameSDiff, -2, kCmdFlagsWrite | kCmdFlagsSet | kCmdFlagsSlow);
@@ -832,7 +841,12 @@ Cmd::Cmd(std::string name, int arity, uint32_t flag, uint32_t aclCategory)
 }
 
 void Cmd::Initial(const PikaCmdArgsType& argv, const std::string& db_name) {
-  argv_ = argv;
+  PikaCmdArgsType args = argv;
+  Initial(std::move(args), db_name);
+}
+
+void Cmd::Initial(PikaCmdArgsType&& argv, const std::string& db_name) {
+  argv_ = std::move(argv);
   db_name_ = db_name;
   res_.clear();  // Clear res content
   db_ = g_pika_server->GetDB(db_name_);
@@ -1012,11 +1026,13 @@ void Cmd::AddAclCategory(uint32_t aclCategory) { aclCategory_ |= aclCategory; }
 uint32_t Cmd::flag() const { return flag_; }
 
 std::string Cmd::ToRedisProtocol() {
+  PikaCmdArgsType rewritten;
+  const PikaCmdArgsType& args = RewriteBinlogArgs(&rewritten) ? rewritten : argv_;
   std::string content;
   content.reserve(RAW_ARGS_LEN);
-  RedisAppendLenUint64(content, argv_.size(), "*");
+  RedisAppendLenUint64(content, args.size(), "*");
 
-  for (const auto& v : argv_) {
+  for (const auto& v : args) {
     RedisAppendLenUint64(content, v.size(), "$");
     RedisAppendContent(content, v);
   }
@@ -1024,6 +1040,14 @@ std::string Cmd::ToRedisProtocol() {
   return content;
 }
 
+std::string Cmd::ToBinlogBinary(const std::string& compression) {
+  PikaCmdArgsType rewritten;
+  const PikaCmdArgsType& args = RewriteBinlogArgs(&rewritten) ? rewritten : argv_;
+  std::string content;
+  PikaBinlogTransverter::ContentEncode(args, compression, &content);
+  return content;
+}
+
 void Cmd::LogCommand() const {
   std::string command;
   for (const auto& item : argv_) {
@@ -158,6 +158,10 @@ int PikaConf::Load() {
     thread_pool_size_ = 100;
   }
 
+  std::string reuse_port;
+  GetConfStr("reuse-port", &reuse_port);
+  reuse_port_ = reuse_port == "yes";
+
   GetConfInt("slow-cmd-thread-pool-size", &slow_cmd_thread_pool_size_);
   if (slow_cmd_thread_pool_size_ < 0) {
     slow_cmd_thread_pool_size_ = 8;
@@ -430,6 +434,69 @@ int PikaConf::Load() {
     small_compaction_duration_threshold_ = 1000000;
   }
 
+  GetConfStr("storage-key-format", &storage_key_format_);
+  if (storage_key_format_ != "legacy" && storage_key_format_ != "compact") {
+    storage_key_format_ = "legacy";
+  }
+
+  hash_max_inline_entries_ = 16;
+  GetConfInt("hash-max-inline-entries", &hash_max_inline_entries_);
+  if (hash_max_inline_entries_ < 0) {
+    hash_max_inline_entries_ = 0;
+  } else if (hash_max_inline_entries_ > 512) {
+    hash_max_inline_entries_ = 512;
+  }
+
+  hash_max_inline_value_ = 64;
+  GetConfInt("hash-max-inline-value", &hash_max_inline_value_);
+  if (hash_max_inline_value_ < 0) {
+    hash_max_inline_value_ = 0;
+  } else if (hash_max_inline_value_ > 4096) {
+    hash_max_inline_value_ = 4096;
+  }
+
+  set_max_inline_entries_ = 16;
+  GetConfInt("set-max-inline-entries", &set_max_inline_entries_);
+  if (set_max_inline_entries_ < 0) {
+    set_max_inline_entries_ = 0;
+  } else if (set_max_inline_entries_ > 512) {
+    set_max_inline_entries_ = 512;
+  }
+
+  set_max_inline_value_ = 64;
+  GetConfInt("set-max-inline-value", &set_max_inline_value_);
+  if (set_max_inline_value_ < 0) {
+    set_max_inline_value_ = 0;
+  } else if (set_max_inline_value_ > 4096) {
+    set_max_inline_value_ = 4096;
+  }
+
+  reclaim_min_count_ = 10000;
+  GetConfInt("reclaim-min-count", &reclaim_min_count_);
+  if (reclaim_min_count_ < 0) {
+    reclaim_min_count_ = 0;
+  }
+
+  reclaim_ranges_per_sec_ = 100;
+  GetConfInt("reclaim-ranges-per-sec", &reclaim_ranges_per_sec_);
+  if (reclaim_ranges_per_sec_ < 0) {
+    reclaim_ranges_per_sec_ = 0;
+  } else if (reclaim_ranges_per_sec_ > 10000) {
+    reclaim_ranges_per_sec_ = 10000;
+  }
+
+  std::string eti;
+  GetConfStr("enable-ttl-index", &eti);
+  enable_ttl_index_ = eti == "yes";
+
+  active_expire_batch_size_ = 1000;
+  GetConfInt("active-expire-batch-size", &active_expire_batch_size_);
+  if (active_expire_batch_size_ < 1) {
+    active_expire_batch_size_ = 1;
+  } else if (active_expire_batch_size_ > 100000) {
+    active_expire_batch_size_ = 100000;
+  }
+
   // max-background-flushes and max-background-compactions should both be -1 or both not
   GetConfInt("max-background-flushes", &max_background_flushes_);
   if (max_background_flushes_ <= 0 && max_background_flushes_ != -1) {
@@ -526,6 +593,29 @@ int PikaConf::Load() {
   if (binlog_file_size_ < 1024 || static_cast<int64_t>(binlog_file_size_) > (1024LL * 1024 * 1024)) {
     binlog_file_size_ = 100 * 1024 * 1024;  // 100M
   }
+  GetConfStr("binlog-sync-policy", &binlog_sync_policy_);
+  if (binlog_sync_policy_ != "record" && binlog_sync_policy_ != "interval" && binlog_sync_policy_ != "bytes") {
+    binlog_sync_policy_ = "record";
+  }
+  GetConfInt("binlog-sync-interval-ms", &binlog_sync_interval_ms_);
+  if (binlog_sync_interval_ms_ < 1 || binlog_sync_interval_ms_ > 60000) {
+    binlog_sync_interval_ms_ = 100;
+  }
+  GetConfInt64Human("binlog-sync-bytes", &binlog_sync_bytes_);
+  if (binlog_sync_bytes_ < 4096 || binlog_sync_bytes_ > (1024LL * 1024 * 1024)) {
+    binlog_sync_bytes_ = 1024 * 1024;
+  }
+  GetConfStr("binlog-content-format", &binlog_content_format_);
+  if (binlog_content_format_ != "resp" && binlog_content_format_ != "binary") {
+    binlog_content_format_ = "resp";
+  }
+  GetConfStr("binlog-compression", &binlog_compression_);
+  if (binlog_compression_ != "none" && binlog_compression_ != "lz4" && binlog_compression_ != "zstd") {
+    binlog_compression_ = "none";
+  }
+  std::string brm;
+  GetConfStr("binlog-reader-mmap", &brm);
+  binlog_reader_mmap_ = brm == "yes";
   GetConfStr("pidfile", &pidfile_);
 
   // db sync
@@ -686,6 +776,20 @@ int PikaConf::Load() {
   } else {
     rsync_timeout_ms_.store(tmp_rsync_timeout_ms);
   }
+
+  int tmp_rsync_window_size = 4;
+  GetConfInt("rsync-window-size", &tmp_rsync_window_size);
+  if (tmp_rsync_window_size <= 0 || tmp_rsync_window_size > kMaxRsyncWindowSize) {
+    tmp_rsync_window_size = 4;
+  }
+  rsync_window_size_.store(tmp_rsync_window_size);
+
+  int64_t tmp_rsync_chunk_size = 4 << 20;
+  GetConfInt64Human("rsync-chunk-size", &tmp_rsync_chunk_size);
+  if (tmp_rsync_chunk_size < kMinRsyncChunkSize || tmp_rsync_chunk_size > kMaxRsyncChunkSize) {
+    tmp_rsync_chunk_size = 4 << 20;
+  }
+  rsync_chunk_size_.store(tmp_rsync_chunk_size);
   return ret;
 }
 
@@ -748,6 +852,14 @@ int PikaConf::ConfigRewrite() {
   SetConfInt("max-cache-statistic-keys", max_cache_statistic_keys_);
   SetConfInt("small-compaction-threshold", small_compaction_threshold_);
   SetConfInt("small-compaction-duration-threshold", small_compaction_duration_threshold_);
+  SetConfInt("hash-max-inline-entries", hash_max_inline_entries_);
+  SetConfInt("hash-max-inline-value", hash_max_inline_value_);
+  SetConfInt("set-max-inline-entries", set_max_inline_entries_);
+  SetConfInt("set-max-inline-value", set_max_inline_value_);
+  SetConfInt("reclaim-min-count", reclaim_min_count_);
+  SetConfInt("reclaim-ranges-per-sec", reclaim_ranges_per_sec_);
+  SetConfStr("enable-ttl-index", enable_ttl_index_ ? "yes" : "no");
+  SetConfInt("active-expire-batch-size", active_expire_batch_size_);
   SetConfInt("max-client-response-size", static_cast<int32_t>(max_client_response_size_));
   SetConfInt("db-sync-speed", db_sync_speed_);
   SetConfStr("compact-cron", compact_cron_);
@@ -760,6 +872,8 @@ int PikaConf::ConfigRewrite() {
   SetConfInt("slave-priority", slave_priority_);
   SetConfInt("throttle-bytes-per-second", throttle_bytes_per_second_);
   SetConfInt("max-rsync-parallel-num", max_rsync_parallel_num_);
+  SetConfInt("rsync-window-size", rsync_window_size_.load());
+  SetConfInt64("rsync-chunk-size", rsync_chunk_size_.load());
   SetConfInt("sync-window-size", sync_window_size_.load());
   SetConfInt("consensus-level", consensus_level_.load());
   SetConfInt("replication-num", replication_num_.load());
@@ -364,7 +364,9 @@ Status ConsensusCoordinator::UpdateSlave(const std::string& ip, int port, const
 }
 
 Status ConsensusCoordinator::InternalAppendBinlog(const std::shared_ptr<Cmd>& cmd_ptr) {
-  std::string content = cmd_ptr->ToRedisProtocol();
+  std::string content = g_pika_conf->binlog_content_format() == "binary"
+                            ? cmd_ptr->ToBinlogBinary(g_pika_conf->binlog_compression())
+                            : cmd_ptr->ToRedisProtocol();
   Status s = stable_logger_->Logger()->Put(content);
   if (!s.ok()) {
     std::string db_name = cmd_ptr->db_name().empty() ? g_pika_conf->default_db() : cmd_ptr->db_name();
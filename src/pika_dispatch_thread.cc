@@ -18,6 +18,9 @@ PikaDispatchThread::PikaDispatchThread(std::set<std::string>& ips, int port, int
                                        int queue_limit, int max_conn_rbuf_size)
     : conn_factory_(max_conn_rbuf_size), handles_(this) {
   thread_rep_ = net::NewDispatchThread(ips, port, work_num, &conn_factory_, cron_interval, queue_limit, &handles_);
+  if (g_pika_conf->reuse_port()) {
+    dynamic_cast<net::DispatchThread*>(thread_rep_)->set_reuse_port(true);
+  }
   thread_rep_->set_thread_name("Dispatcher");
 }
 
@@ -29,7 +32,10 @@ PikaDispatchThread::~PikaDispatchThread() {
 
 int PikaDispatchThread::StartThread() { return thread_rep_->StartThread(); }
 
-uint64_t PikaDispatchThread::ThreadClientList(std::vector<ClientInfo>* clients) {
+uint64_t PikaDispatchThread::ThreadClientList(std::vector<ClientInfo>* clients, std::vector<int>* worker_conn_nums) {
+  if (worker_conn_nums) {
+    *worker_conn_nums = dynamic_cast<net::DispatchThread*>(thread_rep_)->worker_conn_nums();
+  }
   std::vector<net::ServerThread::ConnInfo> conns_info = thread_rep_->conns_info();
   if (clients) {
     for (auto& info : conns_info) {
@@ -118,33 +118,16 @@ void SetCmd::DoUpdateCache() {
   }
 }
 
-std::string SetCmd::ToRedisProtocol() {
-  if (condition_ == SetCmd::kEXORPX) {
-    std::string content;
-    content.reserve(RAW_ARGS_LEN);
-    RedisAppendLen(content, 4, "*");
-
-    // to pksetexat cmd
-    std::string pksetexat_cmd("pksetexat");
-    RedisAppendLenUint64(content, pksetexat_cmd.size(), "$");
-    RedisAppendContent(content, pksetexat_cmd);
-    // key
-    RedisAppendLenUint64(content, key_.size(), "$");
-    RedisAppendContent(content, key_);
-    // time_stamp
-    char buf[100];
-    auto time_stamp = time(nullptr) + sec_;
-    pstd::ll2string(buf, 100, time_stamp);
-    std::string at(buf);
-    RedisAppendLenUint64(content, at.size(), "$");
-    RedisAppendContent(content, at);
-    // value
-    RedisAppendLenUint64(content, value_.size(), "$");
-    RedisAppendContent(content, value_);
-    return content;
-  } else {
-    return Cmd::ToRedisProtocol();
+bool SetCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
+  if (condition_ != SetCmd::kEXORPX) {
+    return false;
   }
+  // to pksetexat cmd
+  char buf[100];
+  auto time_stamp = time(nullptr) + sec_;
+  pstd::ll2string(buf, 100, time_stamp);
+  *args = {"pksetexat", key_, buf, value_};
+  return true;
 }
 
 void GetCmd::DoInitial() {
@@ -237,13 +220,15 @@ void DelCmd::Split(const HintKeys& hint_keys) {
 void DelCmd::Merge() { res_.AppendInteger(split_res_); }
 
 void DelCmd::DoBinlog() {
-  std::string opt = argv_.at(0);
+  // the client's args are kept for the slowlog
+  PikaCmdArgsType argv = std::move(argv_);
   for(auto& key: keys_) {
     argv_.clear();
-    argv_.emplace_back(opt);
+    argv_.emplace_back(argv.at(0));
     argv_.emplace_back(key);
     Cmd::DoBinlog();
   }
+  argv_ = std::move(argv);
 }
 
 void IncrCmd::DoInitial() {
@@ -710,23 +695,10 @@ void SetnxCmd::Do() {
   }
 }
 
-std::string SetnxCmd::ToRedisProtocol() {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLen(content, 3, "*");
-
+bool SetnxCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
   // don't check variable 'success_', because if 'success_' was false, an empty binlog will be saved into file.
-  // to setnx cmd
-  std::string set_cmd("setnx");
-  RedisAppendLenUint64(content, set_cmd.size(), "$");
-  RedisAppendContent(content, set_cmd);
-  // key
-  RedisAppendLenUint64(content, key_.size(), "$");
-  RedisAppendContent(content, key_);
-  // value
-  RedisAppendLenUint64(content, value_.size(), "$");
-  RedisAppendContent(content, value_);
-  return content;
+  *args = {"setnx", key_, value_};
+  return true;
 }
 
 void SetexCmd::DoInitial() {
@@ -764,29 +736,13 @@ void SetexCmd::DoUpdateCache() {
   }
 }
 
-std::string SetexCmd::ToRedisProtocol() {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLen(content, 4, "*");
-
+bool SetexCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
   // to pksetexat cmd
-  std::string pksetexat_cmd("pksetexat");
-  RedisAppendLenUint64(content, pksetexat_cmd.size(), "$");
-  RedisAppendContent(content, pksetexat_cmd);
-  // key
-  RedisAppendLenUint64(content, key_.size(), "$");
-  RedisAppendContent(content, key_);
-  // time_stamp
   char buf[100];
   auto time_stamp = time(nullptr) + sec_;
   pstd::ll2string(buf, 100, time_stamp);
-  std::string at(buf);
-  RedisAppendLenUint64(content, at.size(), "$");
-  RedisAppendContent(content, at);
-  // value
-  RedisAppendLenUint64(content, value_.size(), "$");
-  RedisAppendContent(content, value_);
-  return content;
+  *args = {"pksetexat", key_, buf, value_};
+  return true;
 }
 
 void PsetexCmd::DoInitial() {
@@ -823,29 +779,13 @@ void PsetexCmd::DoUpdateCache() {
   }
 }
 
-std::string PsetexCmd::ToRedisProtocol() {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLen(content, 4, "*");
-
+bool PsetexCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
   // to pksetexat cmd
-  std::string pksetexat_cmd("pksetexat");
-  RedisAppendLenUint64(content, pksetexat_cmd.size(), "$");
-  RedisAppendContent(content, pksetexat_cmd);
-  // key
-  RedisAppendLenUint64(content, key_.size(), "$");
-  RedisAppendContent(content, key_);
-  // time_stamp
   char buf[100];
   auto time_stamp = time(nullptr) + usec_ / 1000;
   pstd::ll2string(buf, 100, time_stamp);
-  std::string at(buf);
-  RedisAppendLenUint64(content, at.size(), "$");
-  RedisAppendContent(content, at);
-  // value
-  RedisAppendLenUint64(content, value_.size(), "$");
-  RedisAppendContent(content, value_);
-  return content;
+  *args = {"pksetexat", key_, buf, value_};
+  return true;
 }
 
 void DelvxCmd::DoInitial() {
@@ -1216,26 +1156,13 @@ void ExpireCmd::Do() {
   }
 }
 
-std::string ExpireCmd::ToRedisProtocol() {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLen(content, 3, "*");
-
+bool ExpireCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
   // to expireat cmd
-  std::string expireat_cmd("expireat");
-  RedisAppendLenUint64(content, expireat_cmd.size(), "$");
-  RedisAppendContent(content, expireat_cmd);
-  // key
-  RedisAppendLenUint64(content, key_.size(), "$");
-  RedisAppendContent(content, key_);
-  // sec
   char buf[100];
   int64_t expireat = time(nullptr) + sec_;
   pstd::ll2string(buf, 100, expireat);
-  std::string at(buf);
-  RedisAppendLenUint64(content, at.size(), "$");
-  RedisAppendContent(content, at);
-  return content;
+  *args = {"expireat", key_, buf};
+  return true;
 }
 
 void ExpireCmd::DoThroughDB() {
@@ -1271,26 +1198,13 @@ void PexpireCmd::Do() {
   }
 }
 
-std::string PexpireCmd::ToRedisProtocol() {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLenUint64(content, argv_.size(), "*");
-
+bool PexpireCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
   // to expireat cmd
-  std::string expireat_cmd("expireat");
-  RedisAppendLenUint64(content, expireat_cmd.size(), "$");
-  RedisAppendContent(content, expireat_cmd);
-  // key
-  RedisAppendLenUint64(content, key_.size(), "$");
-  RedisAppendContent(content, key_);
-  // sec
   char buf[100];
   int64_t expireat = time(nullptr) + msec_ / 1000;
   pstd::ll2string(buf, 100, expireat);
-  std::string at(buf);
-  RedisAppendLenUint64(content, at.size(), "$");
-  RedisAppendContent(content, at);
-  return content;
+  *args = {"expireat", key_, buf};
+  return true;
 }
 
 void PexpireCmd::DoThroughDB(){
@@ -1348,26 +1262,13 @@ void PexpireatCmd::DoInitial() {
   }
 }
 
-std::string PexpireatCmd::ToRedisProtocol() {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLenUint64(content, argv_.size(), "*");
-
+bool PexpireatCmd::RewriteBinlogArgs(PikaCmdArgsType* args) {
   // to expireat cmd
-  std::string expireat_cmd("expireat");
-  RedisAppendLenUint64(content, expireat_cmd.size(), "$");
-  RedisAppendContent(content, expireat_cmd);
-  // key
-  RedisAppendLenUint64(content, key_.size(), "$");
-  RedisAppendContent(content, key_);
-  // sec
   char buf[100];
   int64_t expireat = time_stamp_ms_ / 1000;
   pstd::ll2string(buf, 100, expireat);
-  std::string at(buf);
-  RedisAppendLenUint64(content, at.size(), "$");
-  RedisAppendContent(content, at);
-  return content;
+  *args = {"expireat", key_, buf};
+  return true;
 }
 
 void PexpireatCmd::Do() {
@@ -3,6 +3,10 @@
 // LICENSE file in the root directory of this source tree. An additional grant
 // of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
 #include <glog/logging.h>
 
 #include "include/pika_repl_bgworker.h"
@@ -17,7 +21,7 @@ extern PikaServer* g_pika_server;
 extern std::unique_ptr<PikaReplicaManager> g_pika_rm;
 extern std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
 
-PikaReplBgWorker::PikaReplBgWorker(int queue_size) : bg_thread_(queue_size) {
+PikaReplBgWorker::PikaReplBgWorker(int queue_size) : bg_thread_(queue_size), queue_size_(queue_size) {
   bg_thread_.set_thread_name("ReplBgWorker");
   net::RedisParserSettings settings;
   settings.DealMessage = &(PikaReplBgWorker::HandleWriteBinlog);
@@ -26,6 +30,12 @@ PikaReplBgWorker::PikaReplBgWorker(int queue_size) : bg_thread_(queue_size) {
   db_name_ = g_pika_conf->default_db();
 }
 
+PikaReplBgWorker::~PikaReplBgWorker() {
+  for (auto task_arg : write_db_tasks_) {
+    delete task_arg;
+  }
+}
+
 int PikaReplBgWorker::StartThread() { return bg_thread_.StartThread(); }
 
 int PikaReplBgWorker::StopThread() { return bg_thread_.StopThread(); }
@@ -139,6 +149,17 @@ void PikaReplBgWorker::HandleBGWorkerWriteBinlog(void* arg) {
     }
     const char* redis_parser_start = binlog_res.binlog().data() + BINLOG_ENCODE_LEN;
     int redis_parser_len = static_cast<int>(binlog_res.binlog().size()) - BINLOG_ENCODE_LEN;
+    // Content in the binary format
+    if (redis_parser_len > 0 && redis_parser_start[0] != '*') {
+      net::RedisCmdArgsType argv;
+      if (!PikaBinlogTransverter::ContentDecode(redis_parser_start, redis_parser_len, &argv) || argv.empty() ||
+          HandleWriteBinlog(&worker->redis_parser_, argv) != 0) {
+        LOG(WARNING) << "Binlog content decode failed";
+        slave_db->SetReplState(ReplState::kTryConnect);
+        return;
+      }
+      continue;
+    }
     int processed_len = 0;
     net::RedisParserStatus ret =
         worker->redis_parser_.ProcessInputBuffer(redis_parser_start, redis_parser_len, &processed_len);
@@ -204,12 +225,209 @@ int PikaReplBgWorker::HandleWriteBinlog(net::RedisParser* parser, const net::Red
   return 0;
 }
 
+void PikaReplBgWorker::ScheduleWriteDB(ReplClientWriteDBTaskArg* task_arg, bool wait_room) {
+  std::unique_lock l(write_db_mu_);
+  if (wait_room) {
+    write_db_cv_.wait(l, [this] { return write_db_tasks_.size() < queue_size_ || write_db_cancelled_; });
+  }
+  if (write_db_cancelled_) {
+    if (task_arg->barrier) {
+      task_arg->barrier->Cancel();
+    }
+    delete task_arg;
+    return;
+  }
+  write_db_tasks_.push_back(task_arg);
+  if (!write_db_scheduled_) {
+    write_db_scheduled_ = true;
+    Schedule(&PikaReplBgWorker::HandleBGWorkerWriteDB, static_cast<void*>(this));
+  }
+}
+
+void PikaReplBgWorker::WaitWriteDBRoom() {
+  std::unique_lock l(write_db_mu_);
+  write_db_cv_.wait(l, [this] { return write_db_tasks_.size() < queue_size_ || write_db_cancelled_; });
+}
+
+void PikaReplBgWorker::CancelWriteDB() {
+  std::lock_guard l(write_db_mu_);
+  write_db_cancelled_ = true;
+  for (auto task_arg : write_db_tasks_) {
+    if (task_arg->barrier) {
+      task_arg->barrier->Cancel();
+    }
+  }
+  write_db_cv_.notify_all();
+}
+
+// Whether a command can be applied in a WriteBatch with other ones: a write
+// of keys whose storage writes are all held by Storage::BeginWriteBatch.
+// The zsets are left out as their rank index is built in the background
+// from what is written, and so are the commands writing the slot keys
+// aside from their own keys, or touching a key twice
+static bool CanApplyInBatch(const ReplClientWriteDBTaskArg& task) {
+  const std::shared_ptr<Cmd>& c_ptr = task.cmd_ptr;
+  if (!c_ptr || task.barrier || !c_ptr->is_write() || c_ptr->IsSuspend() || c_ptr->hasFlag(kCmdFlagsAdmin) ||
+      g_pika_conf->slotmigrate()) {
+    return false;
+  }
+  if (!c_ptr->hasFlag(kCmdFlagsKv | kCmdFlagsHash | kCmdFlagsList | kCmdFlagsSet | kCmdFlagsBit |
+                      kCmdFlagsHyperLogLog | kCmdFlagsOperateKey) ||
+      c_ptr->hasFlag(kCmdFlagsZset | kCmdFlagsGeo | kCmdFlagsStream)) {
+    return false;
+  }
+  std::vector<std::string> keys = c_ptr->current_key();
+  std::unordered_set<std::string> distinct_keys(keys.begin(), keys.end());
+  return !keys.empty() && distinct_keys.size() == keys.size();
+}
+
+static bool UseCache(const std::shared_ptr<Cmd>& c_ptr) {
+  return c_ptr->IsNeedCacheDo()
+      && PIKA_CACHE_NONE != g_pika_conf->cache_mode()
+      && c_ptr->GetDB()->cache()->CacheStatus() == PIKA_CACHE_STATUS_OK;
+}
+
+// Fail the transactions watching the keys of an applied command
+static void SetTxnWatchFailState(const std::shared_ptr<Cmd>& c_ptr) {
+  if (c_ptr->res().ok()
+      && c_ptr->is_write()
+      && c_ptr->name() != kCmdNameFlushdb
+      && c_ptr->name() != kCmdNameFlushall
+      && c_ptr->name() != kCmdNameExec) {
+    auto table_keys = c_ptr->current_key();
+    for (auto& key : table_keys) {
+      key = c_ptr->db_name().append(key);
+    }
+    auto dispatcher = dynamic_cast<net::DispatchThread*>(g_pika_server->pika_dispatch_thread()->server_thread());
+    auto involved_conns = dispatcher->GetInvolvedTxn(table_keys);
+    for (auto& conn : involved_conns) {
+      auto c = std::dynamic_pointer_cast<PikaClientConn>(conn);
+      c->SetTxnWatchFailState(true);
+    }
+  }
+}
+
+static void PushSlowlog(const PikaCmdArgsType& argv, uint64_t start_us, uint64_t end_us) {
+  if (g_pika_conf->slowlog_slower_than() >= 0) {
+    auto start_time = static_cast<int32_t>(start_us / 1000000);
+    auto duration = static_cast<int64_t>(end_us - start_us);
+    if (duration > g_pika_conf->slowlog_slower_than()) {
+      g_pika_server->SlowlogPushEntry(argv, start_time, duration);
+      if (g_pika_conf->slowlog_write_errorlog()) {
+        LOG(ERROR) << "command: " << argv[0] << ", start_time(s): " << start_time << ", duration(us): " << duration;
+      }
+    }
+  }
+}
+
 void PikaReplBgWorker::HandleBGWorkerWriteDB(void* arg) {
-  std::unique_ptr<ReplClientWriteDBTaskArg> task_arg(static_cast<ReplClientWriteDBTaskArg*>(arg));
-  const std::shared_ptr<Cmd> c_ptr = task_arg->cmd_ptr;
+  auto worker = static_cast<PikaReplBgWorker*>(arg);
+  std::vector<std::unique_ptr<ReplClientWriteDBTaskArg>> tasks;
+  {
+    std::lock_guard l(worker->write_db_mu_);
+    while (!worker->write_db_tasks_.empty() && tasks.size() < PIKA_REPL_WRITE_DB_BATCH_SIZE) {
+      tasks.emplace_back(worker->write_db_tasks_.front());
+      worker->write_db_tasks_.pop_front();
+    }
+    // The worker runs one task at a time, the next drain comes after this one
+    if (worker->write_db_tasks_.empty()) {
+      worker->write_db_scheduled_ = false;
+    } else {
+      worker->Schedule(&PikaReplBgWorker::HandleBGWorkerWriteDB, arg);
+    }
+  }
+  worker->write_db_cv_.notify_all();
+
+  // The commands with no barrier are applied in runs, one WriteBatch per
+  // run, see CanApplyInBatch. A run ends before a command sharing one of
+  // its keys or of another db, and before any other task, so that the
+  // order of the commands of a key is kept.
+  std::vector<std::shared_ptr<Cmd>> run;
+  std::unordered_set<std::string> run_keys;
+  std::map<std::string, LogOffset> applied_offsets;
+  auto apply_run = [&run, &run_keys]() {
+    if (run.size() == 1) {
+      WriteDB(run.front());
+    } else if (!run.empty()) {
+      WriteDB(run);
+    }
+    run.clear();
+    run_keys.clear();
+  };
+  for (const auto& task : tasks) {
+    if (!worker->WaitArrivedBarriers(*task)) {
+      // stopped, let the other parts of the barrier go too
+      if (task->barrier) {
+        task->barrier->Cancel();
+      }
+      continue;
+    }
+    if (CanApplyInBatch(*task)) {
+      std::vector<std::string> keys = task->cmd_ptr->current_key();
+      bool conflicts = !run.empty() && run.front()->GetDB() != task->cmd_ptr->GetDB();
+      for (const auto& key : keys) {
+        conflicts = conflicts || run_keys.count(key) != 0;
+      }
+      if (conflicts) {
+        apply_run();
+      }
+      run.push_back(task->cmd_ptr);
+      run_keys.insert(keys.begin(), keys.end());
+      applied_offsets[task->db_name] = task->offset;
+      continue;
+    }
+    apply_run();
+    if (task->barrier && !task->cmd_ptr) {
+      task->barrier->Arrive();
+      worker->arrived_barriers_.push_back(task->barrier);
+      continue;
+    }
+    if (task->barrier) {
+      if (task->barrier->WaitArrived()) {
+        WriteDB(task->cmd_ptr);
+        task->barrier->Applied();
+        applied_offsets[task->db_name] = task->offset;
+      }
+      continue;
+    }
+    WriteDB(task->cmd_ptr);
+    applied_offsets[task->db_name] = task->offset;
+  }
+  apply_run();
+
+  for (const auto& applied : applied_offsets) {
+    std::shared_ptr<SyncSlaveDB> slave_db = g_pika_rm->GetSyncSlaveDBByName(DBInfo(applied.first));
+    if (slave_db) {
+      slave_db->SetAppliedOffset(applied.second);
+    }
+  }
+}
+
+bool PikaReplBgWorker::WaitArrivedBarriers(const ReplClientWriteDBTaskArg& task) {
+  arrived_barriers_.erase(
+      std::remove_if(arrived_barriers_.begin(), arrived_barriers_.end(),
+                     [](const std::shared_ptr<ReplWriteDBBarrier>& barrier) { return barrier->IsDone(); }),
+      arrived_barriers_.end());
+  if (arrived_barriers_.empty()) {
+    return true;
+  }
+
+  std::vector<std::string> keys;
+  if (task.cmd_ptr) {
+    keys = task.cmd_ptr->current_key();
+  }
+  for (const auto& barrier : arrived_barriers_) {
+    bool conflicts =
+        task.cmd_ptr ? barrier->Conflicts(keys, task.cmd_ptr->IsSuspend()) : barrier->Conflicts(*task.barrier);
+    if (conflicts && !barrier->WaitApplied()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PikaReplBgWorker::WriteDB(const std::shared_ptr<Cmd>& c_ptr) {
   const PikaCmdArgsType& argv = c_ptr->argv();
-  LogOffset offset = task_arg->offset;
-  std::string db_name = task_arg->db_name;
 
   uint64_t start_us = 0;
   if (g_pika_conf->slowlog_slower_than() >= 0) {
@@ -221,9 +439,7 @@ void PikaReplBgWorker::HandleBGWorkerWriteDB(void* arg) {
   if (!c_ptr->IsSuspend()) {
     c_ptr->GetDB()->DBLockShared();
   }
-  if (c_ptr->IsNeedCacheDo()
-      && PIKA_CACHE_NONE != g_pika_conf->cache_mode()
-      && c_ptr->GetDB()->cache()->CacheStatus() == PIKA_CACHE_STATUS_OK) {
+  if (UseCache(c_ptr)) {
     if (c_ptr->is_write()) {
       c_ptr->DoThroughDB();
       if (c_ptr->IsNeedUpdateCache()) {
@@ -239,32 +455,58 @@ void PikaReplBgWorker::HandleBGWorkerWriteDB(void* arg) {
     c_ptr->GetDB()->DBUnlockShared();
   }
 
-  if (c_ptr->res().ok()
-      && c_ptr->is_write()
-      && c_ptr->name() != kCmdNameFlushdb
-      && c_ptr->name() != kCmdNameFlushall
-      && c_ptr->name() != kCmdNameExec) {
-    auto table_keys = c_ptr->current_key();
-    for (auto& key : table_keys) {
-      key = c_ptr->db_name().append(key);
-    }
-    auto dispatcher = dynamic_cast<net::DispatchThread*>(g_pika_server->pika_dispatch_thread()->server_thread());
-    auto involved_conns = dispatcher->GetInvolvedTxn(table_keys);
-    for (auto& conn : involved_conns) {
-      auto c = std::dynamic_pointer_cast<PikaClientConn>(conn);
-      c->SetTxnWatchFailState(true);
-    }
-  }
+  SetTxnWatchFailState(c_ptr);
 
   record_lock.Unlock(c_ptr->current_key());
   if (g_pika_conf->slowlog_slower_than() >= 0) {
-    auto start_time = static_cast<int32_t>(start_us / 1000000);
-    auto duration = static_cast<int64_t>(pstd::NowMicros() - start_us);
-    if (duration > g_pika_conf->slowlog_slower_than()) {
-      g_pika_server->SlowlogPushEntry(argv, start_time, duration);
-      if (g_pika_conf->slowlog_write_errorlog()) {
-        LOG(ERROR) << "command: " << argv[0] << ", start_time(s): " << start_time << ", duration(us): " << duration;
-      }
+    PushSlowlog(argv, start_us, pstd::NowMicros());
+  }
+}
+
+void PikaReplBgWorker::WriteDB(const std::vector<std::shared_ptr<Cmd>>& cmds) {
+  bool slowlog = g_pika_conf->slowlog_slower_than() >= 0;
+  // the time each command took to run, the commit is not counted
+  std::vector<std::pair<uint64_t, uint64_t>> durations;
+  const std::shared_ptr<DB>& db = cmds.front()->GetDB();
+  std::vector<std::string> keys;
+  for (const auto& c_ptr : cmds) {
+    std::vector<std::string> cmd_keys = c_ptr->current_key();
+    keys.insert(keys.end(), cmd_keys.begin(), cmd_keys.end());
+  }
+  pstd::lock::MultiRecordLock record_lock(db->LockMgr());
+  record_lock.Lock(keys);
+  db->DBLockShared();
+
+  // the writes of the commands are held until CommitWriteBatch, the cache
+  // is updated once they are written
+  db->storage()->BeginWriteBatch();
+  for (const auto& c_ptr : cmds) {
+    uint64_t start_us = slowlog ? pstd::NowMicros() : 0;
+    if (UseCache(c_ptr)) {
+      c_ptr->DoThroughDB();
+    } else {
+      c_ptr->Do();
+    }
+    if (slowlog) {
+      durations.emplace_back(start_us, pstd::NowMicros());
+    }
+  }
+  rocksdb::Status s = db->storage()->CommitWriteBatch(keys);
+  for (const auto& c_ptr : cmds) {
+    if (!s.ok()) {
+      LOG(WARNING) << "write db of command " << c_ptr->name() << " failed, " << s.ToString();
+      c_ptr->res().SetRes(CmdRes::kErrOther, s.ToString());
+    } else if (UseCache(c_ptr) && c_ptr->IsNeedUpdateCache()) {
+      c_ptr->DoUpdateCache();
     }
   }
+  db->DBUnlockShared();
+
+  for (const auto& c_ptr : cmds) {
+    SetTxnWatchFailState(c_ptr);
+  }
+  record_lock.Unlock(keys);
+  for (size_t i = 0; i < durations.size(); i++) {
+    PushSlowlog(cmds[i]->argv(), durations[i].first, durations[i].second);
+  }
 }
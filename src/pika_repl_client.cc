@@ -8,6 +8,7 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <set>
 
 #include <utility>
 
@@ -74,6 +75,11 @@ int PikaReplClient::Stop() {
   for (auto & binlog_worker : write_binlog_workers_) {
     binlog_worker->StopThread();
   }
+  // A worker stops without draining its queue, the barriers left there
+  // would hold the other workers forever
+  for (auto &db_worker: write_db_workers_) {
+    db_worker->CancelWriteDB();
+  }
   for (auto &db_worker: write_db_workers_) {
     db_worker->StopThread();
   }
@@ -103,8 +109,39 @@ void PikaReplClient::ScheduleWriteDBTask(const std::shared_ptr<Cmd>& cmd_ptr, co
   const PikaCmdArgsType& argv = cmd_ptr->argv();
   std::string dispatch_key = argv.size() >= 2 ? argv[1] : argv[0];
   size_t index = GetHashIndexByKey(dispatch_key);
-  auto task_arg = new ReplClientWriteDBTaskArg(cmd_ptr, offset, db_name);
-  write_db_workers_[index]->Schedule(&PikaReplBgWorker::HandleBGWorkerWriteDB, static_cast<void*>(task_arg));
+
+  // The other workers holding keys the command touches, a suspend command
+  // such as flushdb touches every key
+  std::set<size_t> involved;
+  if (cmd_ptr->IsSuspend()) {
+    for (size_t i = 0; i < write_db_workers_.size(); i++) {
+      involved.insert(i);
+    }
+  } else {
+    for (const auto& key : cmd_ptr->current_key()) {
+      involved.insert(GetHashIndexByKey(key));
+    }
+  }
+  involved.erase(index);
+
+  if (involved.empty()) {
+    write_db_workers_[index]->ScheduleWriteDB(new ReplClientWriteDBTaskArg(cmd_ptr, offset, db_name));
+    return;
+  }
+  auto barrier = std::make_shared<ReplWriteDBBarrier>(involved.size(), cmd_ptr->current_key(), cmd_ptr->IsSuspend());
+  {
+    // A full queue is not waited for here, its worker may be held by a
+    // barrier whose other parts would be queued by the next caller
+    std::lock_guard l(write_db_schedule_mu_);
+    for (size_t i : involved) {
+      write_db_workers_[i]->ScheduleWriteDB(new ReplClientWriteDBTaskArg(nullptr, offset, db_name, barrier), false);
+    }
+    write_db_workers_[index]->ScheduleWriteDB(new ReplClientWriteDBTaskArg(cmd_ptr, offset, db_name, barrier), false);
+  }
+  for (size_t i : involved) {
+    write_db_workers_[i]->WaitWriteDBRoom();
+  }
+  write_db_workers_[index]->WaitWriteDBRoom();
 }
 
 size_t PikaReplClient::GetBinlogWorkerIndexByDBName(const std::string &db_name) {
@@ -427,6 +427,19 @@ void SyncSlaveDB::SetLastRecvTime(uint64_t time) {
   m_info_.SetLastRecvTime(time);
 }
 
+void SyncSlaveDB::SetAppliedOffset(const LogOffset& offset) {
+  std::lock_guard l(db_mu_);
+  // the workers apply the commands of different keys out of order
+  if (applied_offset_ < offset) {
+    applied_offset_ = offset;
+  }
+}
+
+LogOffset SyncSlaveDB::AppliedOffset() {
+  std::lock_guard l(db_mu_);
+  return applied_offset_;
+}
+
 Status SyncSlaveDB::CheckSyncTimeout(uint64_t now) {
   std::lock_guard l(db_mu_);
   // no need to do session keepalive return ok
@@ -444,6 +457,7 @@ Status SyncSlaveDB::GetInfo(std::string* info) {
   std::string tmp_str = "  Role: Slave\r\n";
   tmp_str += "  master: " + MasterIp() + ":" + std::to_string(MasterPort()) + "\r\n";
   tmp_str += "  slave status: " + ReplStateMsg[repl_state_] + "\r\n";
+  tmp_str += "  applied offset: " + AppliedOffset().ToString() + "\r\n";
   info->append(tmp_str);
   return Status::OK();
 }
@@ -465,7 +479,7 @@ void SyncSlaveDB::Deactivate() {
 std::string SyncSlaveDB::ToStringStatus() {
   return "  Master: " + MasterIp() + ":" + std::to_string(MasterPort()) + "\r\n" +
          "  SessionId: " + std::to_string(MasterSessionId()) + "\r\n" + "  SyncStatus " + ReplStateMsg[repl_state_] +
-         "\r\n";
+         "\r\n" + "  AppliedOffset " + AppliedOffset().ToString() + "\r\n";
 }
 
 const std::string& SyncSlaveDB::MasterIp() {
@@ -448,6 +448,24 @@ void PikaServer::DBSetSmallCompactionThreshold(uint32_t small_compaction_thresho
   }
 }
 
+void PikaServer::DBSetHashMaxInline(uint32_t hash_max_inline_entries, uint32_t hash_max_inline_value) {
+  std::shared_lock rwl(dbs_rw_);
+  for (const auto& db_item : dbs_) {
+    db_item.second->DBLockShared();
+    db_item.second->storage()->SetHashMaxInline(hash_max_inline_entries, hash_max_inline_value);
+    db_item.second->DBUnlockShared();
+  }
+}
+
+void PikaServer::DBSetSetMaxInline(uint32_t set_max_inline_entries, uint32_t set_max_inline_value) {
+  std::shared_lock rwl(dbs_rw_);
+  for (const auto& db_item : dbs_) {
+    db_item.second->DBLockShared();
+    db_item.second->storage()->SetSetMaxInline(set_max_inline_entries, set_max_inline_value);
+    db_item.second->DBUnlockShared();
+  }
+}
+
 void PikaServer::DBSetSmallCompactionDurationThreshold(uint32_t small_compaction_duration_threshold) {
   std::shared_lock rwl(dbs_rw_);
   for (const auto& db_item : dbs_) {
@@ -842,9 +860,9 @@ int PikaServer::ClientKill(const std::string& ip_port) {
   return 0;
 }
 
-int64_t PikaServer::ClientList(std::vector<ClientInfo>* clients) {
+int64_t PikaServer::ClientList(std::vector<ClientInfo>* clients, std::vector<int>* worker_conn_nums) {
   int64_t clients_num = 0;
-  clients_num += static_cast<int64_t>(pika_dispatch_thread_->ThreadClientList(clients));
+  clients_num += static_cast<int64_t>(pika_dispatch_thread_->ThreadClientList(clients, worker_conn_nums));
   return clients_num;
 }
 
@@ -1066,6 +1084,8 @@ int PikaServer::ClientPubSubChannelPatternSize(const std::shared_ptr<NetConn>& c
 void PikaServer::DoTimingTask() {
   // Maybe schedule compactrange
   AutoCompactRange();
+  // Delete the keys expired in the ttl index
+  AutoActiveExpire();
   // Purge log
   AutoPurge();
   // Delete expired dump
@@ -1096,6 +1116,16 @@ void PikaServer::StatDiskUsage() {
   disk_statistic_.log_size_.store(pstd::Du(g_pika_conf->log_path()));
 }
 
+void PikaServer::AutoActiveExpire() {
+  if (!g_pika_conf->enable_ttl_index()) {
+    return;
+  }
+  std::shared_lock db_rwl(dbs_rw_);
+  for (const auto& db_item : dbs_) {
+    db_item.second->storage()->ActiveExpire();
+  }
+}
+
 void PikaServer::AutoCompactRange() {
   struct statfs disk_info;
   int ret = statfs(g_pika_conf->db_path().c_str(), &disk_info);
@@ -1366,6 +1396,16 @@ void PikaServer::InitStorageOptions() {
   // For Storage small compaction
   storage_options_.statistics_max_size = g_pika_conf->max_cache_statistic_keys();
   storage_options_.small_compaction_threshold = g_pika_conf->small_compaction_threshold();
+  storage_options_.key_format =
+      g_pika_conf->storage_key_format() == "compact" ? storage::KeyFormat::kCompact : storage::KeyFormat::kLegacy;
+  storage_options_.hash_max_inline_entries = g_pika_conf->hash_max_inline_entries();
+  storage_options_.hash_max_inline_value = g_pika_conf->hash_max_inline_value();
+  storage_options_.set_max_inline_entries = g_pika_conf->set_max_inline_entries();
+  storage_options_.set_max_inline_value = g_pika_conf->set_max_inline_value();
+  storage_options_.reclaim_min_count = g_pika_conf->reclaim_min_count();
+  storage_options_.reclaim_ranges_per_sec = g_pika_conf->reclaim_ranges_per_sec();
+  storage_options_.enable_ttl_index = g_pika_conf->enable_ttl_index();
+  storage_options_.active_expire_batch_size = g_pika_conf->active_expire_batch_size();
 
   // rocksdb blob
   if (g_pika_conf->enable_blob_files()) {
@@ -503,6 +503,60 @@ void SIsmemberCmd::DoUpdateCache() {
   }
 }
 
+void SMIsmemberCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameSMIsmember);
+    return;
+  }
+  key_ = argv_[1];
+  members_.assign(argv_.begin() + 2, argv_.end());
+}
+
+void SMIsmemberCmd::Do() {
+  std::vector<int32_t> is_members;
+  s_ = db_->storage()->SMIsmember(key_, members_, &is_members);
+  if (s_.ok() || s_.IsNotFound()) {
+    res_.AppendArrayLenUint64(is_members.size());
+    for (const auto& is_member : is_members) {
+      res_.AppendContent(is_member != 0 ? ":1" : ":0");
+    }
+  } else if (s_.IsInvalidArgument()) {
+    res_.SetRes(CmdRes::kMultiKey);
+  } else {
+    res_.SetRes(CmdRes::kErrOther, s_.ToString());
+  }
+}
+
+void SMIsmemberCmd::ReadCache() {
+  // a member missing from the cache may still be in the db, answer from the
+  // cache only when every member is found there
+  for (auto& member : members_) {
+    auto s = db_->cache()->SIsmember(key_, member);
+    if (s.IsNotFound()) {
+      res_.SetRes(CmdRes::kCacheMiss);
+      return;
+    } else if (!s.ok()) {
+      res_.SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+  }
+  res_.AppendArrayLenUint64(members_.size());
+  for (size_t i = 0; i < members_.size(); ++i) {
+    res_.AppendContent(":1");
+  }
+}
+
+void SMIsmemberCmd::DoThroughDB() {
+  res_.clear();
+  Do();
+}
+
+void SMIsmemberCmd::DoUpdateCache() {
+  if (s_.ok()) {
+    db_->cache()->PushKeyToAsyncLoadQueue(PIKA_KEY_TYPE_SET, key_, db_);
+  }
+}
+
 void SDiffCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameSDiff);
@@ -22,6 +22,13 @@ extern std::unique_ptr<PikaReplicaManager> g_pika_rm;
 StableLog::StableLog(std::string db_name, std::string log_path)
     : purging_(false), db_name_(std::move(db_name)), log_path_(std::move(log_path)) {
   stable_logger_ = std::make_shared<Binlog>(log_path_, g_pika_conf->binlog_file_size());
+  BinlogSyncPolicy sync_policy = BinlogSyncPolicy::kRecord;
+  if (g_pika_conf->binlog_sync_policy() == "interval") {
+    sync_policy = BinlogSyncPolicy::kInterval;
+  } else if (g_pika_conf->binlog_sync_policy() == "bytes") {
+    sync_policy = BinlogSyncPolicy::kBytes;
+  }
+  stable_logger_->StartSyncer(sync_policy, g_pika_conf->binlog_sync_interval_ms(), g_pika_conf->binlog_sync_bytes());
   std::map<uint32_t, std::string> binlogs;
   if (!GetBinlogFiles(&binlogs)) {
     LOG(FATAL) << log_path_ << " Could not get binlog files!";
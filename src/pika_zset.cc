@@ -1088,6 +1088,69 @@ void ZScoreCmd::DoUpdateCache() {
   return;
 }
 
+void ZMScoreCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameZMScore);
+    return;
+  }
+  key_ = argv_[1];
+  members_.assign(argv_.begin() + 2, argv_.end());
+}
+
+void ZMScoreCmd::Do() {
+  std::vector<storage::ScoreStatus> score_statuses;
+  s_ = db_->storage()->ZMScore(key_, members_, &score_statuses);
+  if (s_.ok() || s_.IsNotFound()) {
+    char buf[32];
+    res_.AppendArrayLenUint64(score_statuses.size());
+    for (const auto& score_status : score_statuses) {
+      if (score_status.status.ok()) {
+        int64_t len = pstd::d2string(buf, sizeof(buf), score_status.score);
+        res_.AppendStringLen(len);
+        res_.AppendContent(buf);
+      } else {
+        res_.AppendContent("$-1");
+      }
+    }
+  } else if (s_.IsInvalidArgument()) {
+    res_.SetRes(CmdRes::kMultiKey);
+  } else {
+    res_.SetRes(CmdRes::kErrOther, s_.ToString());
+  }
+}
+
+void ZMScoreCmd::ReadCache() {
+  // a member missing from the cache may still be in the db, answer from the
+  // cache only when every member is found there
+  std::vector<double> scores(members_.size());
+  for (size_t i = 0; i < members_.size(); ++i) {
+    auto s = db_->cache()->ZScore(key_, members_[i], &scores[i], db_);
+    if (s.IsNotFound()) {
+      res_.SetRes(CmdRes::kCacheMiss);
+      return;
+    } else if (!s.ok()) {
+      res_.SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+  }
+  char buf[32];
+  res_.AppendArrayLenUint64(scores.size());
+  for (const auto& score : scores) {
+    int64_t len = pstd::d2string(buf, sizeof(buf), score);
+    res_.AppendStringLen(len);
+    res_.AppendContent(buf);
+  }
+}
+
+void ZMScoreCmd::DoThroughDB() {
+  res_.clear();
+  Do();
+}
+
+void ZMScoreCmd::DoUpdateCache() {
+  return;
+}
+
 static int32_t DoMemberRange(const std::string& raw_min_member, const std::string& raw_max_member, bool* left_close,
                              bool* right_close, std::string* min_member, std::string* max_member) {
   if (raw_min_member == "-") {
@@ -109,6 +109,7 @@ class RWFile : public pstd::noncopyable {
   RWFile() = default;
   virtual ~RWFile();
   virtual char* GetData() = 0;
+  virtual Status Sync() = 0;
 };
 
 // A file abstraction for random reading and writing.
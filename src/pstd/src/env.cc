@@ -506,6 +506,13 @@ class MmapRWFile : public RWFile {
   char* GetData() override { return base_; }
   char* base() { return base_; }
 
+  Status Sync() override {
+    if (msync(base_, map_size_, MS_SYNC) < 0) {
+      return IOError(filename_, errno);
+    }
+    return Status::OK();
+  }
+
  private:
   static size_t Roundup(size_t x, size_t y) { return ((x + y - 1) / y) * y; }
   std::string filename_;
@@ -4,6 +4,8 @@
 // of patent rights can be found in the PATENTS file in the same directory.
 
 #include <stdio.h>
+#include <zlib.h>
+#include <algorithm>
 #include <fstream>
 
 #include "rocksdb/env.h"
@@ -18,7 +20,6 @@ using namespace RsyncService;
 extern PikaServer* g_pika_server;
 
 const int kFlushIntervalUs = 10 * 1000 * 1000;
-const int kBytesPerRequest = 4 << 20;
 const int kThrottleCheckCycle = 10;
 
 namespace rsync {
@@ -101,8 +102,28 @@ void* RsyncClient::ThreadMain() {
     LOG(FATAL) << "unable to open meta file " << meta_file_path << ", error:"  << strerror(errno);
     return nullptr;
   }
+  std::ofstream blockfile;
+  blockfile.open(GetBlockMetaFilePath(), std::ios_base::app);
+  if (!blockfile.is_open()) {
+    LOG(WARNING) << "unable to open block meta file, error:" << strerror(errno) << ", the sync can not resume";
+  }
   DEFER {
     outfile.close();
+    blockfile.close();
+  };
+  auto flush_blocks = [this, &blockfile]() {
+    std::vector<std::string> blocks;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      blocks.swap(block_table_);
+    }
+    if (!blockfile.is_open()) {
+      return;
+    }
+    for (const auto& line : blocks) {
+      blockfile << line;
+    }
+    blockfile.flush();
   };
 
   std::string meta_rep;
@@ -133,6 +154,7 @@ void* RsyncClient::ThreadMain() {
     outfile << meta_rep;
     outfile.flush();
     meta_rep.clear();
+    flush_blocks();
 
     if (finished_work_cnt_.load() == GetParallelNum()) {
       break;
@@ -142,67 +164,161 @@ void* RsyncClient::ThreadMain() {
   for (int i = 0; i < GetParallelNum(); i++) {
     work_threads_[i].join();
   }
+  // keep what the workers wrote since the last flush for the next resume
+  flush_blocks();
   finished_work_cnt_.store(0);
   state_.store(STOP);
   LOG(INFO) << "RsyncClient copy remote files done";
   return nullptr;
 }
 
+/*
+ * Keep up to rsync-window-size file requests in flight, each asking for
+ * rsync-chunk-size bytes, the chunks are written at their offsets in
+ * whatever order they arrive. Until the master tells the size of the file
+ * (masters older than this never do), only one request is in flight.
+ *
+ * Blocks written by an interrupted sync of the same snapshot are checked
+ * against their crc32 and are not asked for again, a partial file is kept
+ * on failure for the next attempt to resume.
+ */
 Status RsyncClient::CopyRemoteFile(const std::string& filename, int index) {
+    struct Inflight {
+      size_t count;
+      uint64_t send_time_us;
+    };
     const std::string filepath = dir_ + "/" + filename;
     std::unique_ptr<RsyncWriter> writer(new RsyncWriter(filepath));
     Status s = Status::OK();
-    size_t offset = 0;
+    // requests in flight, and ranges to request again, keyed by offset
+    std::map<size_t, Inflight> inflight;
+    std::map<size_t, size_t> gaps;
+    size_t next_offset = 0;
+    bool size_known = false;
+    size_t file_size = 0;
     int retries = 0;
+    RsyncBlockMap& blocks = file_blocks_.at(filename);
+    VerifyLocalBlocks(filepath, &blocks);
+    // move offset past the blocks already written, and cut want short of the next one
+    auto skip_written = [&blocks](size_t* offset, size_t* want) {
+      auto iter = blocks.upper_bound(*offset);
+      while (iter != blocks.begin()) {
+        auto prev = std::prev(iter);
+        if (prev->first + prev->second.count <= *offset) {
+          break;
+        }
+        *offset = prev->first + prev->second.count;
+        iter = blocks.upper_bound(*offset);
+      }
+      if (want != nullptr && iter != blocks.end()) {
+        *want = std::min(*want, iter->first - *offset);
+      }
+    };
 
     DEFER {
       if (writer) {
         writer->Close();
         writer.reset();
       }
-      if (!s.ok()) {
-        DeleteFile(filepath);
-      }
     };
 
+    WaitObject* wo = wo_mgr_->UpdateWaitObject(index, filename, kRsyncFile, kInvalidOffset);
     while (retries < max_retries_) {
       if (state_.load() != RUNNING) {
         break;
       }
-      size_t copy_file_begin_time = pstd::NowMicros();
-      size_t count = Throttle::GetInstance().ThrottledByThroughput(kBytesPerRequest);
-      if (count == 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / kThrottleCheckCycle));
-        continue;
+      // written blocks are skipped only once the master told the size of
+      // the file, so an older master never sees a request past EOF
+      if (size_known) {
+        skip_written(&next_offset, nullptr);
       }
-      RsyncRequest request;
-      request.set_reader_index(index);
-      request.set_type(kRsyncFile);
-      request.set_db_name(db_name_);
-      /*
-       * Since the slot field is written in protobuffer,
-       * slot_id is set to the default value 0 for compatibility
-       * with older versions, but slot_id is not used
-       */
-      request.set_slot_id(0);
-      FileRequest* file_req = request.mutable_file_req();
-      file_req->set_filename(filename);
-      file_req->set_offset(offset);
-      file_req->set_count(count);
-
-      std::string to_send;
-      request.SerializeToString(&to_send);
-      WaitObject* wo = wo_mgr_->UpdateWaitObject(index, filename, kRsyncFile, offset);
-      s = client_thread_->Write(master_ip_, master_port_, to_send);
-      if (!s.ok()) {
-        LOG(WARNING) << "send rsync request failed";
+      if (size_known && inflight.empty() && gaps.empty() && next_offset >= file_size) {
+        s = writer->Fsync();
+        if (!s.ok()) {
+            return s;
+        }
+        mu_.lock();
+        meta_table_[filename] = "";
+        mu_.unlock();
+        break;
+      }
+
+      size_t window = size_known ? g_pika_conf->rsync_window_size() : 1;
+      while (inflight.size() < window) {
+        size_t offset = next_offset;
+        size_t want = g_pika_conf->rsync_chunk_size();
+        bool is_gap = !gaps.empty();
+        if (is_gap) {
+          offset = gaps.begin()->first;
+          want = gaps.begin()->second;
+        } else if (size_known) {
+          skip_written(&next_offset, &want);
+          if (next_offset >= file_size) {
+            break;
+          }
+          offset = next_offset;
+          want = std::min(want, file_size - next_offset);
+        }
+        size_t count = Throttle::GetInstance().ThrottledByThroughput(want);
+        if (count == 0) {
+          break;
+        }
+
+        RsyncRequest request;
+        request.set_reader_index(index);
+        request.set_type(kRsyncFile);
+        request.set_db_name(db_name_);
+        /*
+         * Since the slot field is written in protobuffer,
+         * slot_id is set to the default value 0 for compatibility
+         * with older versions, but slot_id is not used
+         */
+        request.set_slot_id(0);
+        FileRequest* file_req = request.mutable_file_req();
+        file_req->set_filename(filename);
+        file_req->set_offset(offset);
+        file_req->set_count(count);
+
+        std::string to_send;
+        request.SerializeToString(&to_send);
+        wo->AddOffset(offset);
+        s = client_thread_->Write(master_ip_, master_port_, to_send);
+        if (!s.ok()) {
+          LOG(WARNING) << "send rsync request failed";
+          Throttle::GetInstance().ReturnUnusedThroughput(count, 0, 0);
+          break;
+        }
+
+        if (is_gap) {
+          gaps.erase(gaps.begin());
+          if (count < want) {
+            gaps[offset + count] = want - count;
+          }
+        } else {
+          next_offset = offset + count;
+        }
+        inflight[offset] = {count, pstd::NowMicros()};
+      }
+
+      if (inflight.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / kThrottleCheckCycle));
         continue;
       }
 
+      // chunks are written as they come, waiting on the oldest one is enough
+      // to tell the master stopped answering
+      auto iter = inflight.begin();
+      size_t offset = iter->first;
+      size_t count = iter->second.count;
       std::shared_ptr<RsyncResponse> resp = nullptr;
-      s = wo->Wait(resp);
+      s = wo->WaitOffset(offset, resp);
       if (s.IsTimeout() || resp == nullptr) {
         LOG(WARNING) << s.ToString();
+        for (const auto& item : inflight) {
+          gaps[item.first] = item.second.count;
+        }
+        inflight.clear();
+        wo = wo_mgr_->UpdateWaitObject(index, filename, kRsyncFile, kInvalidOffset);
         retries++;
         continue;
       }
@@ -212,8 +328,9 @@ Status RsyncClient::CopyRemoteFile(const std::string& filename, int index) {
       }
 
       size_t ret_count = resp->file_resp().count();
-      size_t elaspe_time_us = pstd::NowMicros() - copy_file_begin_time;
+      size_t elaspe_time_us = pstd::NowMicros() - iter->second.send_time_us;
       Throttle::GetInstance().ReturnUnusedThroughput(count, ret_count, elaspe_time_us);
+      inflight.erase(iter);
 
       if (resp->snapshot_uuid() != snapshot_uuid_) {
         LOG(WARNING) << "receive newer dump, reset state to STOP, local_snapshot_uuid:"
@@ -222,24 +339,39 @@ Status RsyncClient::CopyRemoteFile(const std::string& filename, int index) {
         return s;
       }
 
+      if (ret_count == 0 && !resp->file_resp().eof()) {
+        s = Status::IOError("kRsyncFile request failed, master returned no data at offset " + std::to_string(offset));
+        return s;
+      }
       s = writer->Write((uint64_t)offset, ret_count, resp->file_resp().data().c_str());
       if (!s.ok()) {
         LOG(WARNING) << "rsync client write file error";
         break;
       }
+      AddBlock(filename, offset, ret_count, resp->file_resp().data().c_str());
+      retries = 0;
 
-      offset += resp->file_resp().count();
-      if (resp->file_resp().eof()) {
-        s = writer->Fsync();
-        if (!s.ok()) {
-            return s;
-        } 
-        mu_.lock();
-        meta_table_[filename] = "";
-        mu_.unlock();
-        break;
+      if (!size_known && resp->file_resp().has_file_size()) {
+        size_known = true;
+        file_size = resp->file_resp().file_size();
+      }
+      if (!size_known) {
+        // one request at a time, go on from where the master stopped
+        next_offset = offset + ret_count;
+        if (resp->file_resp().eof()) {
+          s = writer->Fsync();
+          if (!s.ok()) {
+              return s;
+          }
+          mu_.lock();
+          meta_table_[filename] = "";
+          mu_.unlock();
+          break;
+        }
+      } else if (ret_count < count && offset + ret_count < file_size) {
+        // older masters cut a chunk at the end of their read ahead block
+        gaps[offset + ret_count] = count - ret_count;
       }
-      retries = 0;
     }
 
   return s;
@@ -287,6 +419,16 @@ bool RsyncClient::ComparisonUpdate() {
     local_file_set.insert(file.first);
   }
 
+  // blocks of the files an interrupted sync of this snapshot left behind
+  std::map<std::string, RsyncBlockMap> local_blocks;
+  if (remote_snapshot_uuid == local_snapshot_uuid) {
+    s = LoadBlockMeta(local_snapshot_uuid, &local_blocks);
+    if (!s.ok()) {
+      LOG(WARNING) << "load block meta failed, copy the files from the beginning, error: " << s.ToString();
+      local_blocks.clear();
+    }
+  }
+
   std::set<std::string> expired_files;
   if (remote_snapshot_uuid != local_snapshot_uuid) {
     snapshot_uuid_ = remote_snapshot_uuid;
@@ -313,6 +455,15 @@ bool RsyncClient::ComparisonUpdate() {
     LOG(WARNING) << "update local meta failed";
     return false;
   }
+  file_blocks_.clear();
+  for (const auto& file : file_set_) {
+    file_blocks_[file] = std::move(local_blocks[file]);
+  }
+  s = ResetBlockMeta();
+  if (!s.ok()) {
+    LOG(WARNING) << "reset block meta failed";
+    return false;
+  }
 
   state_ = RUNNING;
   LOG(INFO) << "copy meta data done, db name: " << db_name_
@@ -464,10 +615,8 @@ Status RsyncClient::CleanUpExpiredFiles(bool need_reset_path, const std::set<std
 
 Status RsyncClient::UpdateLocalMeta(const std::string& snapshot_uuid, const std::set<std::string>& expired_files,
                                     std::map<std::string, std::string>* localFileMap) {
-  if (localFileMap->empty()) {
-    return Status::OK();
-  }
-  
+  // written even without any local file, LoadLocalMeta expects the uuid
+  // on the first line, or the next sync can not resume this one
   for (const auto& item : expired_files) {
     localFileMap->erase(item);
   }
@@ -500,6 +649,147 @@ std::string RsyncClient::GetLocalMetaFilePath() {
   return db_path + kDumpMetaFileName;
 }
 
+std::string RsyncClient::GetBlockMetaFilePath() {
+  std::string db_path = dir_ + (dir_.back() == '/' ? "" : "/");
+  return db_path + kDumpBlockMetaFileName;
+}
+
+/*
+ * DUMP_BLOCK_META holds the uuid of the snapshot on the first line, then
+ * one line for every block written:
+ * filename:offset:count:crc32
+ * A torn last line of a crash is skipped, blocks it describes are copied again.
+ */
+Status RsyncClient::LoadBlockMeta(const std::string& snapshot_uuid,
+                                  std::map<std::string, RsyncBlockMap>* file_blocks) {
+  std::string block_file_path = GetBlockMetaFilePath();
+  if (!FileExists(block_file_path)) {
+    return Status::OK();
+  }
+  std::ifstream infile(block_file_path);
+  if (!infile.is_open()) {
+    return Status::IOError("open block meta file failed", block_file_path);
+  }
+
+  std::string line;
+  if (!std::getline(infile, line) || line != kUuidPrefix + snapshot_uuid) {
+    LOG(WARNING) << "block meta belongs to another snapshot, ignore it";
+    return Status::OK();
+  }
+  while (std::getline(infile, line)) {
+    std::vector<std::string> fields;
+    std::string::size_type end = line.size();
+    for (int i = 0; i < 3; i++) {
+      std::string::size_type pos = line.rfind(':', end - 1);
+      if (pos == std::string::npos || pos == 0) {
+        break;
+      }
+      fields.push_back(line.substr(pos + 1, end - pos - 1));
+      end = pos;
+    }
+    unsigned long offset = 0;
+    unsigned long count = 0;
+    unsigned long checksum = 0;
+    if (fields.size() != 3 || !pstd::string2int(fields[2].data(), fields[2].size(), &offset) ||
+        !pstd::string2int(fields[1].data(), fields[1].size(), &count) ||
+        !pstd::string2int(fields[0].data(), fields[0].size(), &checksum) || count == 0) {
+      LOG(WARNING) << "invalid block meta line: " << line;
+      continue;
+    }
+    RsyncBlock& block = (*file_blocks)[line.substr(0, end)][offset];
+    block.count = count;
+    block.checksum = static_cast<uint32_t>(checksum);
+  }
+  return Status::OK();
+}
+
+// Rewrite DUMP_BLOCK_META with the blocks of the files still to copy only
+Status RsyncClient::ResetBlockMeta() {
+  std::string block_file_path = GetBlockMetaFilePath();
+  pstd::DeleteFile(block_file_path);
+
+  std::unique_ptr<WritableFile> file;
+  pstd::Status s = pstd::NewWritableFile(block_file_path, file);
+  if (!s.ok()) {
+    LOG(WARNING) << "create block meta file failed, block_file_path: " << block_file_path;
+    return s;
+  }
+  file->Append(kUuidPrefix + snapshot_uuid_ + "\n");
+  for (const auto& item : file_blocks_) {
+    for (const auto& block : item.second) {
+      file->Append(item.first + ":" + std::to_string(block.first) + ":" + std::to_string(block.second.count) + ":" +
+                   std::to_string(block.second.checksum) + "\n");
+    }
+  }
+  s = file->Close();
+  if (!s.ok()) {
+    LOG(WARNING) << "flush block meta file failed, block_file_path: " << block_file_path;
+    return s;
+  }
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    block_table_.clear();
+  }
+  return Status::OK();
+}
+
+// Drop the blocks whose data on disk does not match their crc32
+void RsyncClient::VerifyLocalBlocks(const std::string& filepath, RsyncBlockMap* blocks) {
+  if (blocks->empty()) {
+    return;
+  }
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    blocks->clear();
+    return;
+  }
+  DEFER {
+    close(fd);
+  };
+
+  std::string buf;
+  size_t verified_bytes = 0;
+  for (auto iter = blocks->begin(); iter != blocks->end();) {
+    buf.resize(iter->second.count);
+    size_t read_bytes = 0;
+    while (read_bytes < buf.size()) {
+      ssize_t n = pread(fd, &buf[read_bytes], buf.size() - read_bytes,
+                        static_cast<off_t>(iter->first + read_bytes));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      read_bytes += n;
+    }
+    if (read_bytes != buf.size() ||
+        crc32(0L, reinterpret_cast<const Bytef*>(buf.data()), buf.size()) != iter->second.checksum) {
+      iter = blocks->erase(iter);
+      continue;
+    }
+    verified_bytes += buf.size();
+    ++iter;
+  }
+  LOG(INFO) << "resume copying file " << filepath << ", " << blocks->size() << " blocks, "
+            << verified_bytes << " bytes on disk verified";
+}
+
+void RsyncClient::AddBlock(const std::string& filename, size_t offset, size_t count, const char* data) {
+  if (count == 0) {
+    return;
+  }
+  RsyncBlock block;
+  block.count = count;
+  block.checksum = static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(data), count));
+  file_blocks_.at(filename)[offset] = block;
+
+  std::string line = filename + ":" + std::to_string(offset) + ":" + std::to_string(count) + ":" +
+                     std::to_string(block.checksum) + "\n";
+  std::lock_guard<std::mutex> guard(mu_);
+  block_table_.push_back(std::move(line));
+}
+
 int RsyncClient::GetParallelNum() {
   return parallel_num_;
 }
@@ -8,7 +8,6 @@
 #include <glog/logging.h>
 #include <google/protobuf/map.h>
 
-#include "pstd_hash.h"
 #include "include/pika_server.h"
 #include "include/rsync_server.h"
 #include "pstd/include/pstd_defer.h"
@@ -30,6 +29,46 @@ void RsyncWriteResp(RsyncService::RsyncResponse& response, std::shared_ptr<net::
   conn->NotifyWrite();
 }
 
+static void AppendVarint32(uint32_t value, std::string* dst) {
+  while (value >= 0x80) {
+    dst->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  dst->push_back(static_cast<char>(value));
+}
+
+/*
+ * Send the data of a file response straight from the file. A parser merges
+ * the fields of an embedded message which shows up more than once, so the
+ * response is serialized with empty data, followed by a second file_resp
+ * holding only the data, whose bytes the connection sends with sendfile:
+ * | response | file_resp tag | len | data tag | count | <count bytes of fd> |
+ */
+void RsyncWriteFileResp(RsyncService::RsyncResponse& response, int fd, size_t offset, size_t count,
+                        std::shared_ptr<net::PbConn> conn) {
+  const uint32_t kFileRespTag = (RsyncService::RsyncResponse::kFileRespFieldNumber << 3) | 2;
+  const uint32_t kDataTag = (RsyncService::FileResponse::kDataFieldNumber << 3) | 2;
+  std::string reply_str;
+  if (!response.SerializeToString(&reply_str)) {
+    LOG(WARNING) << "Process FileRsync request serialization failed";
+    close(fd);
+    conn->NotifyClose();
+    return;
+  }
+  std::string data_head;
+  AppendVarint32(kDataTag, &data_head);
+  AppendVarint32(static_cast<uint32_t>(count), &data_head);
+  AppendVarint32(kFileRespTag, &reply_str);
+  AppendVarint32(static_cast<uint32_t>(data_head.size() + count), &reply_str);
+  reply_str.append(data_head);
+  if (conn->WriteResp(reply_str, fd, static_cast<off_t>(offset), count) != 0) {
+    LOG(WARNING) << "Process FileRsync request write response failed";
+    conn->NotifyClose();
+    return;
+  }
+  conn->NotifyWrite();
+}
+
 RsyncServer::RsyncServer(const std::set<std::string>& ips, const int port) {
   work_thread_ = std::make_unique<net::ThreadPool>(2, 100000, "RsyncServerWork");
   rsync_server_thread_ = std::make_unique<RsyncServerThread>(ips, port, 1 * 1000, this);
@@ -196,30 +235,32 @@ void RsyncServerConn::HandleFileRsyncRequest(void* arg) {
   }
 
   const std::string filepath = db->bgsave_info().path + "/" + filename;
-  char* buffer = new char[req->file_req().count() + 1];
+  int fd = -1;
   size_t bytes_read{0};
-  std::string checksum = "";
   bool is_eof = false;
+  size_t file_size = 0;
   std::shared_ptr<RsyncReader> reader = conn->readers_[req->reader_index()];
-  s = reader->Read(filepath, offset, count, buffer,
-                   &bytes_read, &checksum, &is_eof);
+  s = reader->Read(filepath, offset, count, &fd, &bytes_read, &is_eof, &file_size);
   if (!s.ok()) {
     response.set_code(RsyncService::kErr);
     RsyncWriteResp(response, conn);
-    delete []buffer;
     return;
   }
 
   RsyncService::FileResponse* file_resp = response.mutable_file_resp();
-  file_resp->set_data(buffer, bytes_read);
+  file_resp->set_data("");
   file_resp->set_eof(is_eof);
-  file_resp->set_checksum(checksum);
+  file_resp->set_checksum("");
   file_resp->set_filename(filename);
   file_resp->set_count(bytes_read);
+  file_resp->set_file_size(file_size);
   file_resp->set_offset(offset);
 
-  RsyncWriteResp(response, conn);
-  delete []buffer;
+  if (fd < 0) {
+    RsyncWriteResp(response, conn);
+    return;
+  }
+  RsyncWriteFileResp(response, fd, offset, bytes_read, conn);
 }
 
 RsyncServerThread::RsyncServerThread(const std::set<std::string>& ips, int port, int cron_interval, RsyncServer* arg)
@@ -226,6 +226,36 @@ void BenchScan() {
   std::cout << "Test case 3, Scan " << kv_num << " Cost: " << cost << "s" << std::endl;
 }
 
+// On-disk bytes per entry of small strings and hash fields, the suffix
+// of every value and the reserves of every key are a large share of it,
+// see kCompactSuffixFlag and KeyFormat
+void BenchValueSize(storage::KeyFormat key_format, const std::string& path) {
+  printf("====== ValueSize ======\n");
+  storage::StorageOptions storage_options;
+  storage_options.options.create_if_missing = true;
+  storage_options.key_format = key_format;
+  storage::Storage db;
+  storage::Status s = db.Open(storage_options, path);
+
+  if (!s.ok()) {
+    printf("Open db failed, error: %s\n", s.ToString().c_str());
+    return;
+  }
+
+  const size_t kv_num = 1000000;
+  int32_t ret = 0;
+  for (size_t i = 0; i < kv_num; ++i) {
+    db.Set("small_key_" + std::to_string(i), "value_" + std::to_string(i));
+    db.HSet("small_hash_" + std::to_string(i % 1000), "field_" + std::to_string(i), std::to_string(i), &ret);
+  }
+  db.Compact(DataType::kAll, true);
+
+  uint64_t sst_size = db.GetProperty("rocksdb.total-sst-files-size");
+  std::cout << "Test case 1, " << (key_format == storage::KeyFormat::kCompact ? "compact" : "legacy") << " keys, "
+            << 2 * kv_num << " small entries, SST size: " << sst_size << " bytes, "
+            << static_cast<double>(sst_size) / (2 * kv_num) << " bytes per entry" << std::endl;
+}
+
 int main(int argc, char** argv) {
   // keys
   BenchSet();
@@ -235,4 +265,8 @@ int main(int argc, char** argv) {
 
   // Iterator
   BenchScan();
+
+  // on-disk format
+  BenchValueSize(storage::KeyFormat::kLegacy, "./db_value_size");
+  BenchValueSize(storage::KeyFormat::kCompact, "./db_value_size_compact");
 }
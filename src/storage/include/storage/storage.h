@@ -71,6 +71,20 @@ struct StorageOptions {
   size_t statistics_max_size = 0;
   size_t small_compaction_threshold = 5000;
   size_t small_compaction_duration_threshold = 10000;
+  size_t hash_max_inline_entries = 16;
+  size_t hash_max_inline_value = 64;
+  size_t set_max_inline_entries = 16;
+  size_t set_max_inline_value = 64;
+  // The key format of the databases created, an existing database keeps its own
+  KeyFormat key_format = KeyFormat::kLegacy;
+  // Collections of at least reclaim_min_count entries have their data
+  // range-deleted in the background when dropped, 0 disables it
+  size_t reclaim_min_count = 10000;
+  size_t reclaim_ranges_per_sec = 100;
+  // Index keys by their etime, so that expired keys are deleted in the
+  // background rather than left for the compaction, see ActiveExpire
+  bool enable_ttl_index = false;
+  size_t active_expire_batch_size = 1000;
   Status ResetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options_map);
 };
 
@@ -108,6 +122,11 @@ struct ValueStatus {
   bool operator==(const ValueStatus& vs) const { return (vs.value == value && vs.status == status && vs.ttl == ttl); }
 };
 
+struct ScoreStatus {
+  double score = 0;
+  Status status;
+};
+
 struct FieldValue {
   std::string field;
   std::string value;
@@ -153,7 +172,12 @@ enum BitOpType { kBitOpAnd = 1, kBitOpOr, kBitOpXor, kBitOpNot, kBitOpDefault };
 enum Operation {
   kNone = 0,
   kCleanAll,
-  kCompactRange
+  kCompactRange,
+  kReclaimRange,
+  kActiveExpire,
+  kRenumberList,
+  kBuildRankIndex,
+  kCountKeys
 };
 
 struct BGTask {
@@ -462,6 +486,10 @@ class Storage {
   // Returns if member is a member of the set stored at key.
   Status SIsmember(const Slice& key, const Slice& member, int32_t* ret);
 
+  // Returns for every member whether it is a member of the set stored at key,
+  // rets is filled in the order of members
+  Status SMIsmember(const Slice& key, const std::vector<std::string>& members, std::vector<int32_t>* rets);
+
   // Returns all the members of the set value stored at key.
   // This has the same effect as running SINTER with one argument key.
   Status SMembers(const Slice& key, std::vector<std::string>* members);
@@ -853,6 +881,10 @@ class Storage {
   // returned.
   Status ZScore(const Slice& key, const Slice& member, double* ret);
 
+  // Returns the scores of members in the sorted set at key, a member which
+  // does not exist gets a NotFound status in sss
+  Status ZMScore(const Slice& key, const std::vector<std::string>& members, std::vector<ScoreStatus>* sss);
+
   // Computes the union of numkeys sorted sets given by the specified keys, and
   // stores the result in destination. It is mandatory to provide the number of
   // input keys (numkeys) before passing the input keys and the other (optional)
@@ -1063,15 +1095,28 @@ class Storage {
   // Admin Commands
   Status StartBGThread();
   Status RunBGTask();
+  // kReclaimRange, kRenumberList and kBuildRankIndex tasks go to a queue and a thread of their own
   Status AddBGTask(const BGTask& bg_task);
+  Status RunReclaimTask();
 
   Status Compact(const DataType& type, bool sync = false);
   Status CompactRange(const DataType& type, const std::string& start, const std::string& end, bool sync = false);
   Status DoCompactRange(const DataType& type, const std::string& start, const std::string& end);
   Status DoCompactSpecificKey(const DataType& type, const std::string& key);
+  Status DoReclaimRange(const DataType& type, const std::string& key, uint64_t version);
+  Status DoRenumberList(const std::string& key);
+  Status DoBuildRankIndex(const std::string& key);
+  // Queue one round of active expiration, every instance deletes up to
+  // active_expire_batch_size expired keys
+  Status ActiveExpire();
+  Status DoActiveExpire();
 
   Status SetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys);
   Status SetSmallCompactionThreshold(uint32_t small_compaction_threshold);
+  // Inline hashes larger than the new limits move to the per-field layout on their next write
+  Status SetHashMaxInline(uint32_t hash_max_inline_entries, uint32_t hash_max_inline_value);
+  // Same for inline sets
+  Status SetSetMaxInline(uint32_t set_max_inline_entries, uint32_t set_max_inline_value);
   Status SetSmallCompactionDurationThreshold(uint32_t small_compaction_duration_threshold);
 
   std::string GetCurrentTaskType();
@@ -1079,8 +1124,21 @@ class Storage {
   Status GetUsage(const std::string& property, std::map<int, uint64_t>* type_result);
   uint64_t GetProperty(const std::string& property);
 
+  // Scan the keys of every instance, and reconcile the counts kept by the writes with them
   Status GetKeyNum(std::vector<KeyInfo>* key_infos);
   Status StopScanKeyNum();
+  // The counts kept by the writes, no scan
+  Status GetKeyCounts(std::vector<KeyInfo>* key_infos);
+  // The counts start from a scan once the instances are open
+  Status DoCountKeys();
+
+  // Until CommitWriteBatch, the writes of the calling thread are held in one
+  // WriteBatch per instance and are not visible to its reads, so the
+  // commands of a batch should not touch the same keys.
+  void BeginWriteBatch();
+  // Write the WriteBatch of every instance, keys are all the keys written
+  // since BeginWriteBatch. The first error if one fails
+  Status CommitWriteBatch(const std::vector<std::string>& keys);
 
   rocksdb::DB* GetDBByIndex(int index);
 
@@ -1094,6 +1152,8 @@ class Storage {
   void GetRocksDBInfo(std::string& info);
 
  private:
+  Status MGetByInstance(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss, bool with_ttl);
+
   std::vector<std::unique_ptr<Redis>> insts_;
   std::unique_ptr<SlotIndexer> slot_indexer_;
   std::atomic<bool> is_opened_ = {false};
@@ -1112,6 +1172,19 @@ class Storage {
   std::atomic<int> current_task_type_ = {kNone};
   std::atomic<bool> bg_tasks_should_exit_ = {false};
 
+  // Range deletions, list renumbers and rank index builds run on their own
+  // thread, so that their rate limit never holds up the compactions and
+  // active expirations
+  pthread_t reclaim_thread_id_ = 0;
+  pstd::Mutex reclaim_mutex_;
+  pstd::CondVar reclaim_cond_var_;
+  std::queue<BGTask> reclaim_queue_;
+  uint64_t reclaim_interval_us_ = 0;
+
+  bool enable_ttl_index_ = false;
+  size_t active_expire_batch_size_ = 1000;
+  std::atomic<bool> active_expire_queued_ = {false};
+
   // For scan keys in data base
   std::atomic<bool> scan_keynum_exit_ = {false};
   Status MGetWithTTL(const Slice& key, std::string* value, int64_t* ttl);
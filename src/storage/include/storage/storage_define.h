@@ -7,6 +7,7 @@
 #define STORAGE_DEFINE_H_
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include "stdint.h"
 
@@ -32,6 +33,26 @@ const int kListValueIndexLength = 16;
 const int kTypeLength = 1;
 const int kTimestampLength = 8;
 
+/*
+ * Keys are written in one of two formats. The legacy format frames every
+ * key with kPrefixReserveLength zero bytes in front and kSuffixReserveLength
+ * zero bytes at the end, the compact format drops both, 24 bytes less per
+ * key, and writes the values with the compact suffix, see
+ * kCompactSuffixFlag. The format of a database is chosen when it is created,
+ * and all the databases opened by a process share it, see Redis::Open.
+ */
+enum class KeyFormat : uint8_t { kLegacy = 0, kCompact = 1 };
+
+inline std::atomic<KeyFormat> g_key_format{KeyFormat::kLegacy};
+
+inline size_t KeyPrefixReserveLength() {
+  return g_key_format.load(std::memory_order_relaxed) == KeyFormat::kLegacy ? kPrefixReserveLength : 0;
+}
+
+inline size_t KeySuffixReserveLength() {
+  return g_key_format.load(std::memory_order_relaxed) == KeyFormat::kLegacy ? kSuffixReserveLength : 0;
+}
+
 /*
  * kMetaCF is used to store the metadata of all types of
  * data and all information of type string
@@ -44,6 +65,9 @@ enum ColumnFamilyIndex {
   kZsetsDataCF = 4,
   kZsetsScoreCF = 5,
   kStreamsDataCF = 6,
+  kZsetsRankCF = 7,
+  kTTLIndexCF = 8,
+  kZsetsRankGroupCF = 9,
 };
 
 const static char kNeedTransformCharacter = '\u0000';
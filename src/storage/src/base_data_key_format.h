@@ -16,6 +16,7 @@ using Slice = rocksdb::Slice;
 * used for Hash/Set/Zset's member data key. format:
 * | reserve1 | key | version | data | reserve2 |
 * |    8B    |     |    8B   |      |   16B    |
+* the reserves are left out by the compact key format, see KeyFormat
 */
 class BaseDataKey {
  public:
@@ -30,7 +31,8 @@ class BaseDataKey {
   }
 
   Slice EncodeSeekKey() {
-    size_t meta_size = sizeof(reserve1_) + sizeof(version_);
+    size_t prefix_length = KeyPrefixReserveLength();
+    size_t meta_size = prefix_length + sizeof(version_);
     size_t usize = key_.size() + data_.size() + kEncodedKeyDelimSize;
     size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
     usize += nzero;
@@ -49,8 +51,8 @@ class BaseDataKey {
 
     start_ = dst;
     // reserve1: 8 byte
-    memcpy(dst, reserve1_, sizeof(reserve1_));
-    dst += sizeof(reserve1_);
+    memcpy(dst, reserve1_, prefix_length);
+    dst += prefix_length;
     // key
     dst = EncodeUserKey(key_, dst, nzero);
     // version 8 byte
@@ -63,7 +65,9 @@ class BaseDataKey {
   }
 
   Slice Encode() {
-    size_t meta_size = sizeof(reserve1_) + sizeof(version_) + sizeof(reserve2_);
+    size_t prefix_length = KeyPrefixReserveLength();
+    size_t suffix_length = KeySuffixReserveLength();
+    size_t meta_size = prefix_length + sizeof(version_) + suffix_length;
     size_t usize = key_.size() + data_.size() + kEncodedKeyDelimSize;
     size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
     usize += nzero;
@@ -82,8 +86,8 @@ class BaseDataKey {
 
     start_ = dst;
     // reserve1: 8 byte
-    memcpy(dst, reserve1_, sizeof(reserve1_));
-    dst += sizeof(reserve1_);
+    memcpy(dst, reserve1_, prefix_length);
+    dst += prefix_length;
     // key
     dst = EncodeUserKey(key_, dst, nzero);
     // version 8 byte
@@ -92,9 +96,8 @@ class BaseDataKey {
     // data
     memcpy(dst, data_.data(), data_.size());
     dst += data_.size();
-    // TODO(wangshaoyi): too much for reserve
     // reserve2: 16 byte
-    memcpy(dst, reserve2_, sizeof(reserve2_));
+    memcpy(dst, reserve2_, suffix_length);
     return Slice(start_, needed);
   }
 
@@ -125,9 +128,9 @@ class ParsedBaseDataKey {
   void decode(const char* ptr, const char* end_ptr) {
     const char* start = ptr;
     // skip head reserve1_
-    ptr += sizeof(reserve1_);
+    ptr += KeyPrefixReserveLength();
     // skip tail reserve2_
-    end_ptr -= kSuffixReserveLength;
+    end_ptr -= KeySuffixReserveLength();
     // user key
     ptr = DecodeUserKey(ptr, std::distance(ptr, end_ptr), &key_str_);
 
@@ -146,7 +149,6 @@ class ParsedBaseDataKey {
 
  protected:
   std::string key_str_;
-  char reserve1_[8] = {0};
   uint64_t version_ = (uint64_t)(-1);
   Slice data_;
 };
@@ -19,8 +19,9 @@
 namespace storage {
 /*
 * hash/set/zset/list data value format
-* | value | reserve | ctime |
-* |       |   16B   |   8B  |
+* | value | suffix |
+* suffix is either | reserve 16B | ctime 8B | (legacy)
+* or the compact one without etime, see kCompactSuffixFlag
 */
 class BaseDataValue : public InternalValue {
 public:
@@ -32,21 +33,15 @@ public:
 
   virtual rocksdb::Slice Encode() {
     size_t usize = user_value_.size();
-    size_t needed = usize + kSuffixReserveLength + kTimestampLength;
+    size_t needed = usize + SuffixLength(ctime_, etime_, false);
     char* dst = ReAllocIfNeeded(needed);
     char* start_pos = dst;
 
     memcpy(dst, user_value_.data(), user_value_.size());
     dst += user_value_.size();
-    memcpy(dst, reserve_, kSuffixReserveLength);
-    dst += kSuffixReserveLength;
-    EncodeFixed64(dst, ctime_);
-    dst += kTimestampLength;
+    EncodeSuffix(dst, reserve_, ctime_, etime_, false);
     return rocksdb::Slice(start_pos, needed);
   }
-
-private:
-  const size_t kDefaultValueSuffixLength = kSuffixReserveLength + kTimestampLength;
 };
 
 class ParsedBaseDataValue : public ParsedInternalValue {
@@ -55,10 +50,8 @@ public:
   // the implement of user interfaces and may need to modify the
   // original value suffix, so the value_ must point to the string
   explicit ParsedBaseDataValue(std::string* value) : ParsedInternalValue(value) {
-    if (value_->size() >= kBaseDataValueSuffixLength) {
-      user_value_ = rocksdb::Slice(value_->data(), value_->size() - kBaseDataValueSuffixLength);
-      memcpy(reserve_, value_->data() + user_value_.size(), kSuffixReserveLength);
-      ctime_ = DecodeFixed64(value_->data() + user_value_.size() + kSuffixReserveLength);
+    if (DecodeSuffix(value_->data(), value_->size(), false)) {
+      user_value_ = rocksdb::Slice(value_->data(), value_->size() - suffix_length_);
     }
   }
 
@@ -67,10 +60,8 @@ public:
   // the rocksdb::Slice, so don't need to modify the original value, value_ can be
   // set to nullptr
   explicit ParsedBaseDataValue(const rocksdb::Slice& value) : ParsedInternalValue(value)  {
-    if (value.size() >= kBaseDataValueSuffixLength) {
-      user_value_ = rocksdb::Slice(value.data(), value.size() - kBaseDataValueSuffixLength);
-      memcpy(reserve_, value.data() + user_value_.size(), kSuffixReserveLength);
-      ctime_ = DecodeFixed64(value.data() + user_value_.size() + kSuffixReserveLength);
+    if (DecodeSuffix(value.data(), value.size(), false)) {
+      user_value_ = rocksdb::Slice(value.data(), value.size() - suffix_length_);
     }
   }
 
@@ -78,31 +69,18 @@ public:
 
   void SetEtimeToValue() override {}
 
-  void SetCtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kTimestampLength;
-      EncodeFixed64(dst, ctime_);
-    }
-  }
+  void SetCtimeToValue() override { SetSuffixToValue(false); }
 
-  void SetReserveToValue() {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kBaseDataValueSuffixLength;
-      memcpy(dst, reserve_, kSuffixReserveLength);
-    }
-  }
+  void SetReserveToValue() { SetSuffixToValue(false); }
 
   virtual void StripSuffix() override {
-    if (value_) {
-      value_->erase(value_->size() - kBaseDataValueSuffixLength, kBaseDataValueSuffixLength);
+    if (value_ && suffix_length_ != 0) {
+      value_->erase(value_->size() - suffix_length_, suffix_length_);
     }
   }
 
 protected:
   virtual void SetVersionToValue() override {};
-
-private:
-  const size_t kBaseDataValueSuffixLength = kSuffixReserveLength + kTimestampLength;
 };
 
 }  //  namespace storage
@@ -6,6 +6,7 @@
 #ifndef SRC_BASE_FILTER_H_
 #define SRC_BASE_FILTER_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -15,6 +16,7 @@
 #include "src/base_data_key_format.h"
 #include "src/base_value_format.h"
 #include "src/base_meta_value_format.h"
+#include "src/keyspace_counters.h"
 #include "src/lists_meta_value_format.h"
 #include "src/pika_stream_meta_value.h"
 #include "src/strings_value_format.h"
@@ -23,11 +25,53 @@
 
 namespace storage {
 
+// Read amplification of the data cf compaction filters, shared by all the
+// filters of one instance and reported by Redis::GetRocksDBInfo
+struct CompactionFilterStats {
+  // data keys handed to the filters
+  std::atomic<uint64_t> filtered_keys{0};
+  // point lookups issued on the meta cf, one per run of data keys of a user key
+  std::atomic<uint64_t> meta_lookups{0};
+  // data keys kept because they are newer than the meta read for them
+  std::atomic<uint64_t> skipped_keys{0};
+};
+
+inline void AddCompactionFilterStat(CompactionFilterStats* stats, std::atomic<uint64_t> CompactionFilterStats::*stat) {
+  if (stats != nullptr) {
+    (stats->*stat).fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 class BaseMetaFilter : public rocksdb::CompactionFilter {
  public:
   BaseMetaFilter() = default;
+  BaseMetaFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr,
+                 KeyspaceCounters* counters)
+      : db_(db), cf_handles_ptr_(cf_handles_ptr), counters_(counters) {
+    default_read_options_.fill_cache = false;
+  }
+
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
+    if (!Drop(key, value)) {
+      return false;
+    }
+    // the value may be shadowed by a newer one out of this compaction,
+    // whose write counted the change already
+    if (counters_ != nullptr && db_ != nullptr && !cf_handles_ptr_->empty()) {
+      rocksdb::PinnableSlice latest;
+      Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[0], key, &latest);
+      if (s.ok() && latest == value) {
+        counters_->Change(KeyspaceCounters::ParseState(value), KeyspaceCounters::KeyState());
+      }
+    }
+    return true;
+  }
+
+  const char* Name() const override { return "BaseMetaFilter"; }
+
+ private:
+  bool Drop(const rocksdb::Slice& key, const rocksdb::Slice& value) const {
     int64_t unix_time;
     rocksdb::Env::Default()->GetCurrentTime(&unix_time);
     auto cur_time = static_cast<uint64_t>(unix_time);
@@ -96,26 +140,45 @@ class BaseMetaFilter : public rocksdb::CompactionFilter {
     }
   }
 
-  const char* Name() const override { return "BaseMetaFilter"; }
+  rocksdb::DB* db_ = nullptr;
+  std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  KeyspaceCounters* counters_ = nullptr;
+  rocksdb::ReadOptions default_read_options_;
 };
 
 class BaseMetaFilterFactory : public rocksdb::CompactionFilterFactory {
  public:
   BaseMetaFilterFactory() = default;
+  BaseMetaFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr,
+                        KeyspaceCounters* counters)
+      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), counters_(counters) {}
   std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
       const rocksdb::CompactionFilter::Context& context) override {
-    return std::unique_ptr<rocksdb::CompactionFilter>(new BaseMetaFilter());
+    if (db_ptr_ == nullptr) {
+      return std::unique_ptr<rocksdb::CompactionFilter>(new BaseMetaFilter());
+    }
+    return std::make_unique<BaseMetaFilter>(*db_ptr_, cf_handles_ptr_, counters_);
   }
   const char* Name() const override { return "BaseMetaFilterFactory"; }
+
+ private:
+  rocksdb::DB** db_ptr_ = nullptr;
+  std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  KeyspaceCounters* counters_ = nullptr;
 };
 
 class BaseDataFilter : public rocksdb::CompactionFilter {
  public:
-  BaseDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr, enum DataType type)
+  BaseDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr, enum DataType type,
+                 CompactionFilterStats* stats = nullptr)
       : db_(db),
         cf_handles_ptr_(cf_handles_ptr),
-        type_(type)
-        {}
+        stats_(stats),
+        type_(type) {
+    // the meta of a user key is read once for the run of its data keys,
+    // keep it out of the block cache
+    default_read_options_.fill_cache = false;
+  }
 
   bool Filter(int level, const Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
@@ -130,10 +193,11 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
 
     const char* ptr = key.data();
     int key_size = key.size();
-    ptr = SeekUserkeyDelim(ptr + kPrefixReserveLength, key_size - kPrefixReserveLength);
+    ptr = SeekUserkeyDelim(ptr + KeyPrefixReserveLength(), key_size - KeyPrefixReserveLength());
     std::string meta_key_enc(key.data(), std::distance(key.data(), ptr));
-    meta_key_enc.append(kSuffixReserveLength, kNeedTransformCharacter);
+    meta_key_enc.append(KeySuffixReserveLength(), kNeedTransformCharacter);
 
+    AddCompactionFilterStat(stats_, &CompactionFilterStats::filtered_keys);
     if (meta_key_enc != cur_key_) {
       cur_meta_etime_ = 0;
       cur_meta_version_ = 0;
@@ -144,6 +208,7 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
       if (cf_handles_ptr_->empty()) {
         return false;
       }
+      AddCompactionFilterStat(stats_, &CompactionFilterStats::meta_lookups);
       Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[0], cur_key_, &meta_value);
       if (s.ok()) {
         /*
@@ -181,20 +246,25 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
       return true;
     }
 
+    if (cur_meta_version_ > parsed_base_data_key.Version()) {
+      TRACE("Drop[data_key_version < cur_meta_version]");
+      return true;
+    }
+    // written since the meta was read, the meta read tells nothing about it
+    if (cur_meta_version_ < parsed_base_data_key.Version()) {
+      AddCompactionFilterStat(stats_, &CompactionFilterStats::skipped_keys);
+      TRACE("Reserve[data_key_version > cur_meta_version]");
+      return false;
+    }
+
     int64_t unix_time;
     rocksdb::Env::Default()->GetCurrentTime(&unix_time);
     if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time)) {
       TRACE("Drop[Timeout]");
       return true;
     }
-
-    if (cur_meta_version_ > parsed_base_data_key.Version()) {
-      TRACE("Drop[data_key_version < cur_meta_version]");
-      return true;
-    } else {
-      TRACE("Reserve[data_key_version == cur_meta_version]");
-      return false;
-    }
+    TRACE("Reserve[data_key_version == cur_meta_version]");
+    return false;
   }
 
   /*
@@ -219,6 +289,7 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
  private:
   rocksdb::DB* db_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  CompactionFilterStats* stats_ = nullptr;
   rocksdb::ReadOptions default_read_options_;
   mutable std::string cur_key_;
   mutable bool meta_not_found_ = false;
@@ -229,11 +300,12 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
 
 class BaseDataFilterFactory : public rocksdb::CompactionFilterFactory {
  public:
-  BaseDataFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type)
-      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), type_(type) {}
+  BaseDataFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type,
+                        CompactionFilterStats* stats = nullptr)
+      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), type_(type), stats_(stats) {}
   std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
       const rocksdb::CompactionFilter::Context& context) override {
-    return std::make_unique<BaseDataFilter>(BaseDataFilter(*db_ptr_, cf_handles_ptr_, type_));
+    return std::make_unique<BaseDataFilter>(*db_ptr_, cf_handles_ptr_, type_, stats_);
   }
   const char* Name() const override { return "BaseDataFilterFactory"; }
 
@@ -241,6 +313,7 @@ class BaseDataFilterFactory : public rocksdb::CompactionFilterFactory {
   rocksdb::DB** db_ptr_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
   enum DataType type_ = DataType::kNones;
+  CompactionFilterStats* stats_ = nullptr;
 };
 
 using HashesMetaFilter = BaseMetaFilter;
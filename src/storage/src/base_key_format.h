@@ -13,6 +13,7 @@ namespace storage {
 * used for string data key or hash/zset/set/list's meta key. format:
 * | reserve1 | key | reserve2 |
 * |    8B    |     |   16B    |
+* the reserves are left out by the compact key format, see KeyFormat
 */
 
 class BaseKey {
@@ -26,7 +27,9 @@ class BaseKey {
   }
 
   Slice Encode() {
-    size_t meta_size = sizeof(reserve1_) + sizeof(reserve2_);
+    size_t prefix_length = KeyPrefixReserveLength();
+    size_t suffix_length = KeySuffixReserveLength();
+    size_t meta_size = prefix_length + suffix_length;
     size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
     size_t usize = nzero + kEncodedKeyDelimSize + key_.size();
     size_t needed = meta_size + usize;
@@ -44,13 +47,12 @@ class BaseKey {
 
     start_ = dst;
     // reserve1: 8 byte
-    memcpy(dst, reserve1_, sizeof(reserve1_));
-    dst += sizeof(reserve1_);
+    memcpy(dst, reserve1_, prefix_length);
+    dst += prefix_length;
     // key
     dst = EncodeUserKey(key_, dst, nzero);
-    // TODO(wangshaoyi): no need to reserve tailing,
-    // since we already set delimiter
-    memcpy(dst, reserve2_, sizeof(reserve2_));
+    // reserve2: 16 byte
+    memcpy(dst, reserve2_, suffix_length);
     return Slice(start_, needed);
   }
 
@@ -78,9 +80,9 @@ class ParsedBaseKey {
 
   void decode(const char* ptr, const char* end_ptr) {
     // skip head reserve
-    ptr += kPrefixReserveLength;
+    ptr += KeyPrefixReserveLength();
     // skip tail reserve2_
-    end_ptr -= kSuffixReserveLength;
+    end_ptr -= KeySuffixReserveLength();
     DecodeUserKey(ptr, std::distance(ptr, end_ptr), &key_str_);
   }
 
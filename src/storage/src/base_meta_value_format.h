@@ -15,8 +15,18 @@
 namespace storage {
 
 /*
-*| type | value |  version | reserve | cdate | timestamp |
-*|  1B  |       |    8B   |   16B    |   8B  |     8B    |
+ * reserve[0] of the hash and set meta value holds the flags below.
+ * kMetaInlineFlag: the fields of the hash, or the members of the set, are
+ * packed into the meta value right after the count instead of being stored
+ * in the data column family, see src/inline_fields_format.h.
+ */
+const char kMetaInlineFlag = 0x01;
+
+/*
+*| type | value | version | suffix |
+*|  1B  |       |    8B   |        |
+* suffix is either | reserve 16B | cdate 8B | timestamp 8B | (legacy)
+* or the compact one, see kCompactSuffixFlag
 */
 // TODO(wangshaoyi): reformat encode, AppendTimestampAndVersion
 class BaseMetaValue : public InternalValue {
@@ -27,21 +37,16 @@ class BaseMetaValue : public InternalValue {
   explicit BaseMetaValue(DataType type, const Slice& user_value) : InternalValue(type, user_value) {}
   rocksdb::Slice Encode() override {
     size_t usize = user_value_.size();
-    size_t needed = usize + kVersionLength + kSuffixReserveLength + 2 * kTimestampLength + kTypeLength;
+    size_t needed = usize + kVersionLength + SuffixLength(ctime_, etime_, true) + kTypeLength;
     char* dst = ReAllocIfNeeded(needed);
     memcpy(dst, &type_, sizeof(type_));
     dst += sizeof(type_);
-    char* start_pos = dst;
 
     memcpy(dst, user_value_.data(), user_value_.size());
     dst += user_value_.size();
     EncodeFixed64(dst, version_);
     dst += sizeof(version_);
-    memcpy(dst, reserve_, sizeof(reserve_));
-    dst += sizeof(reserve_);
-    EncodeFixed64(dst, ctime_);
-    dst += sizeof(ctime_);
-    EncodeFixed64(dst, etime_);
+    EncodeSuffix(dst, reserve_, ctime_, etime_, true);
     return {start_, needed};
   }
 
@@ -54,78 +59,46 @@ class BaseMetaValue : public InternalValue {
     }
     return version_;
   }
+
+  void SetInline(bool is_inline) {
+    reserve_[0] = static_cast<char>(is_inline ? (reserve_[0] | kMetaInlineFlag) : (reserve_[0] & ~kMetaInlineFlag));
+  }
 };
 
 class ParsedBaseMetaValue : public ParsedInternalValue {
  public:
   // Use this constructor after rocksdb::DB::Get();
   explicit ParsedBaseMetaValue(std::string* internal_value_str) : ParsedInternalValue(internal_value_str) {
-    if (internal_value_str->size() >= kBaseMetaValueSuffixLength) {
-      size_t offset = 0;
-      type_ = static_cast<DataType>(static_cast<uint8_t>((*internal_value_str)[0]));
-      offset += kTypeLength;
-      user_value_ = Slice(internal_value_str->data() + offset,
-                             internal_value_str->size() - kBaseMetaValueSuffixLength - offset);
-      offset += user_value_.size();
-      version_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += sizeof(version_);
-      memcpy(reserve_, internal_value_str->data() + offset, sizeof(reserve_));
-      offset += sizeof(reserve_);
-      ctime_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += sizeof(ctime_);
-      etime_ = DecodeFixed64(internal_value_str->data() + offset);
-    }
-    count_ = DecodeFixed32(internal_value_str->data() + kTypeLength);
+    Decode(*internal_value_str);
   }
 
   // Use this constructor in rocksdb::CompactionFilter::Filter();
   explicit ParsedBaseMetaValue(const Slice& internal_value_slice) : ParsedInternalValue(internal_value_slice) {
-    if (internal_value_slice.size() >= kBaseMetaValueSuffixLength) {
-      size_t offset = 0;
-      type_ = static_cast<DataType>(static_cast<uint8_t>(internal_value_slice[0]));
-      offset += kTypeLength;
-      user_value_ = Slice(internal_value_slice.data() + offset,
-                          internal_value_slice.size() - kBaseMetaValueSuffixLength - offset);
-      offset += user_value_.size();
-      version_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += sizeof(uint64_t);
-      memcpy(reserve_, internal_value_slice.data() + offset, sizeof(reserve_));
-      offset += sizeof(reserve_);
-      ctime_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += sizeof(ctime_);
-      etime_ = DecodeFixed64(internal_value_slice.data() + offset);
-    }
-    count_ = DecodeFixed32(internal_value_slice.data() + kTypeLength);
+    Decode(internal_value_slice);
   }
 
   void StripSuffix() override {
-    if (value_) {
-      value_->erase(value_->size() - kBaseMetaValueSuffixLength, kBaseMetaValueSuffixLength);
+    if (value_ && suffix_length_ != 0) {
+      value_->erase(value_->size() - suffix_length_ - kVersionLength, suffix_length_ + kVersionLength);
     }
   }
 
   void SetVersionToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kBaseMetaValueSuffixLength;
+    if (value_ && suffix_length_ != 0) {
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - suffix_length_ - kVersionLength;
       EncodeFixed64(dst, version_);
     }
   }
 
-  void SetCtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - 2 * kTimestampLength;
-      EncodeFixed64(dst, ctime_);
-    }
-  }
+  void SetCtimeToValue() override { SetSuffixToValue(true); }
 
-  void SetEtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kTimestampLength;
-      EncodeFixed64(dst, etime_);
-    }
-  }
+  void SetEtimeToValue() override { SetSuffixToValue(true); }
 
   uint64_t InitialMetaValue() {
+    if (this->IsInline()) {
+      this->SetInline(false);
+      this->SetInlinePayload(Slice());
+    }
     this->SetCount(0);
     this->SetEtime(0);
     this->SetCtime(0);
@@ -182,8 +155,47 @@ class ParsedBaseMetaValue : public ParsedInternalValue {
     return version_;
   }
 
+  bool IsInline() { return (reserve_[0] & kMetaInlineFlag) != 0; }
+
+  void SetInline(bool is_inline) {
+    reserve_[0] = static_cast<char>(is_inline ? (reserve_[0] | kMetaInlineFlag) : (reserve_[0] & ~kMetaInlineFlag));
+    SetSuffixToValue(true);
+  }
+
+  // The packed fields or members of an inline hash or set, everything after the count
+  Slice InlinePayload() {
+    if (user_value_.size() <= sizeof(count_)) {
+      return Slice();
+    }
+    return Slice(user_value_.data() + sizeof(count_), user_value_.size() - sizeof(count_));
+  }
+
+  // Replace the packed fields or members, the value is resized in place
+  void SetInlinePayload(const Slice& payload) {
+    if (value_ && user_value_.size() >= sizeof(count_)) {
+      size_t suffix_length = kVersionLength + suffix_length_;
+      std::string suffix = value_->substr(value_->size() - suffix_length);
+      value_->resize(kTypeLength + sizeof(count_));
+      value_->append(payload.data(), payload.size());
+      value_->append(suffix);
+      user_value_ = Slice(value_->data() + kTypeLength, value_->size() - suffix_length - kTypeLength);
+    }
+  }
+
  private:
-  static const size_t kBaseMetaValueSuffixLength = kVersionLength + kSuffixReserveLength + 2 * kTimestampLength;
+  void Decode(const Slice& value) {
+    if (value.size() >= kTypeLength + sizeof(count_) + kVersionLength &&
+        DecodeSuffix(value.data(), value.size(), true) &&
+        value.size() >= kTypeLength + sizeof(count_) + kVersionLength + suffix_length_) {
+      type_ = static_cast<DataType>(static_cast<uint8_t>(value[0]));
+      user_value_ = Slice(value.data() + kTypeLength, value.size() - suffix_length_ - kVersionLength - kTypeLength);
+      version_ = DecodeFixed64(value.data() + value.size() - suffix_length_ - kVersionLength);
+      count_ = DecodeFixed32(value.data() + kTypeLength);
+    } else {
+      suffix_length_ = 0;
+    }
+  }
+
   int32_t count_ = 0;
 };
 
@@ -13,6 +13,7 @@
 
 #include "src/coding.h"
 #include "src/mutex.h"
+#include "storage/storage_define.h"
 
 #include "pstd/include/env.h"
 
@@ -38,6 +39,70 @@ constexpr char DataTypeToTag(DataType type) {
   return DataTypeTag[static_cast<int>(type)];
 }
 
+/*
+ * Every value ends with a suffix holding its timestamps. Values written by
+ * older releases use the legacy suffix:
+ * | reserve | ctime | etime |
+ * |   16B   |   8B  |   8B  |
+ * and databases of the compact key format use the compact suffix:
+ * | reserve[0] | ctime  | etime  | suffix length |
+ * |     1B     | varint | varint |      1B       |
+ * Data values (hash/set/zset/list members) carry no etime in either format.
+ *
+ * The last byte of a legacy value is the high byte of a fixed 8 bytes
+ * timestamp in seconds and thus always 0, the last byte of a compact value
+ * is its suffix length with kCompactSuffixFlag set, so the format of a value
+ * is told from its last byte and both are read in either database. The
+ * compact suffix is only written where the key format is compact, whose
+ * marker cf keeps older releases from opening the database, see KeyFormat;
+ * a legacy database is written in the legacy suffix only and stays readable
+ * by every release.
+ */
+const uint8_t kCompactSuffixFlag = 0x80;
+
+inline size_t CompactSuffixLength(uint64_t ctime, uint64_t etime, bool with_etime) {
+  return 2 + VarintLength(ctime) + (with_etime ? VarintLength(etime) : 0);
+}
+
+inline size_t LegacySuffixLength(bool with_etime) {
+  return kSuffixReserveLength + (with_etime ? 2 : 1) * kTimestampLength;
+}
+
+inline char* EncodeCompactSuffix(char* dst, char reserve, uint64_t ctime, uint64_t etime, bool with_etime) {
+  char* start = dst;
+  *(dst++) = reserve;
+  dst = EncodeVarint64(dst, ctime);
+  if (with_etime) {
+    dst = EncodeVarint64(dst, etime);
+  }
+  *dst = static_cast<char>(kCompactSuffixFlag | (dst - start + 1));
+  return dst + 1;
+}
+
+inline bool CompactValueSuffix() {
+  return g_key_format.load(std::memory_order_relaxed) == KeyFormat::kCompact;
+}
+
+// The length of the suffix written for the key format in use
+inline size_t SuffixLength(uint64_t ctime, uint64_t etime, bool with_etime) {
+  return CompactValueSuffix() ? CompactSuffixLength(ctime, etime, with_etime) : LegacySuffixLength(with_etime);
+}
+
+inline char* EncodeSuffix(char* dst, const char* reserve, uint64_t ctime, uint64_t etime, bool with_etime) {
+  if (CompactValueSuffix()) {
+    return EncodeCompactSuffix(dst, reserve[0], ctime, etime, with_etime);
+  }
+  memcpy(dst, reserve, kSuffixReserveLength);
+  dst += kSuffixReserveLength;
+  EncodeFixed64(dst, ctime);
+  dst += kTimestampLength;
+  if (with_etime) {
+    EncodeFixed64(dst, etime);
+    dst += kTimestampLength;
+  }
+  return dst;
+}
+
 class InternalValue {
 public:
  explicit InternalValue(DataType type, const rocksdb::Slice& user_value) : type_(type), user_value_(user_value) {
@@ -50,6 +115,7 @@ public:
     }
   }
   void SetEtime(uint64_t etime = 0) { etime_ = etime; }
+  uint64_t Etime() const { return etime_; }
   void setCtime(uint64_t ctime) { ctime_ = ctime; }
   rocksdb::Status SetRelativeTimestamp(int64_t ttl) {
     int64_t unix_time;
@@ -147,6 +213,64 @@ public:
   virtual void StripSuffix() = 0;
 
 protected:
+  // Decode the suffix of either format at the end of [data, data + size),
+  // return false if it is malformed.
+  bool DecodeSuffix(const char* data, size_t size, bool with_etime) {
+    if (size == 0) {
+      return false;
+    }
+    auto last = static_cast<uint8_t>(data[size - 1]);
+    if ((last & kCompactSuffixFlag) == 0) {
+      size_t length = LegacySuffixLength(with_etime);
+      if (size < length) {
+        return false;
+      }
+      const char* ptr = data + size - length;
+      memcpy(reserve_, ptr, kSuffixReserveLength);
+      ptr += kSuffixReserveLength;
+      ctime_ = DecodeFixed64(ptr);
+      ptr += kTimestampLength;
+      if (with_etime) {
+        etime_ = DecodeFixed64(ptr);
+      }
+      suffix_length_ = length;
+      return true;
+    }
+
+    size_t length = last & ~kCompactSuffixFlag;
+    if (length < 3 || length > size) {
+      return false;
+    }
+    const char* ptr = data + size - length;
+    const char* limit = data + size - 1;
+    reserve_[0] = *(ptr++);
+    ptr = DecodeVarint64(ptr, limit, &ctime_);
+    if (ptr != nullptr && with_etime) {
+      ptr = DecodeVarint64(ptr, limit, &etime_);
+    }
+    if (ptr != limit) {
+      return false;
+    }
+    suffix_length_ = length;
+    return true;
+  }
+
+  // Rewrite the suffix of value_ in the format of the key format in use,
+  // value_ is resized when the suffix changes format or length.
+  void SetSuffixToValue(bool with_etime) {
+    if (!value_ || suffix_length_ == 0) {
+      return;
+    }
+    size_t user_value_offset = user_value_.data() - value_->data();
+    size_t user_value_size = user_value_.size();
+    size_t prefix_length = value_->size() - suffix_length_;
+    size_t length = SuffixLength(ctime_, etime_, with_etime);
+    value_->resize(prefix_length + length);
+    EncodeSuffix(&(*value_)[prefix_length], reserve_, ctime_, etime_, with_etime);
+    suffix_length_ = length;
+    user_value_ = rocksdb::Slice(value_->data() + user_value_offset, user_value_size);
+  }
+
   virtual void SetVersionToValue() = 0;
   virtual void SetEtimeToValue() = 0;
   virtual void SetCtimeToValue() = 0;
@@ -156,7 +280,9 @@ protected:
   uint64_t ctime_ = 0;
   uint64_t etime_ = 0;
   DataType type_;
-  char reserve_[16] = {0}; //unused
+  char reserve_[16] = {0}; // only reserve[0] is kept by the compact suffix
+  // length of the suffix in value_, 0 if the value is malformed
+  size_t suffix_length_ = 0;
 };
 
 }  //  namespace storage
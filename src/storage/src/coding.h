@@ -82,5 +82,41 @@ inline uint64_t DecodeFixed64(const char* ptr) {
   }
 }
 
+inline int VarintLength(uint64_t v) {
+  int len = 1;
+  while (v >= 128) {
+    v >>= 7;
+    len++;
+  }
+  return len;
+}
+
+inline char* EncodeVarint64(char* dst, uint64_t v) {
+  auto ptr = reinterpret_cast<unsigned char*>(dst);
+  while (v >= 128) {
+    *(ptr++) = static_cast<unsigned char>(v | 128);
+    v >>= 7;
+  }
+  *(ptr++) = static_cast<unsigned char>(v);
+  return reinterpret_cast<char*>(ptr);
+}
+
+// Return the position after the varint, or nullptr if it is truncated
+inline const char* DecodeVarint64(const char* p, const char* limit, uint64_t* value) {
+  uint64_t result = 0;
+  for (uint32_t shift = 0; shift <= 63 && p < limit; shift += 7) {
+    uint64_t byte = static_cast<unsigned char>(*p);
+    p++;
+    if ((byte & 128) != 0) {
+      result |= ((byte & 127) << shift);
+    } else {
+      result |= (byte << shift);
+      *value = result;
+      return p;
+    }
+  }
+  return nullptr;
+}
+
 }  // namespace storage
 #endif  // SRC_CODING_H_
@@ -17,6 +17,7 @@ namespace storage {
 /* list data key pattern
 * | reserve1 | key | version | index | reserve2 |
 * |    8B    |     |    8B   |  8B   |   16B    |
+* the reserves are left out by the compact key format, see KeyFormat
 */
 class ListsDataKeyComparatorImpl : public rocksdb::Comparator {
  public:
@@ -32,10 +33,11 @@ class ListsDataKeyComparatorImpl : public rocksdb::Comparator {
     auto a_size = static_cast<int32_t>(a.size());
     auto b_size = static_cast<int32_t>(b.size());
 
-    ptr_a += kPrefixReserveLength;
-    ptr_b += kPrefixReserveLength;
-    ptr_a = SeekUserkeyDelim(ptr_a, a_size - kPrefixReserveLength);
-    ptr_b = SeekUserkeyDelim(ptr_b, b_size - kPrefixReserveLength);
+    const auto prefix_length = static_cast<int32_t>(KeyPrefixReserveLength());
+    ptr_a += prefix_length;
+    ptr_b += prefix_length;
+    ptr_a = SeekUserkeyDelim(ptr_a, a_size - prefix_length);
+    ptr_b = SeekUserkeyDelim(ptr_b, b_size - prefix_length);
 
     rocksdb::Slice a_prefix(a.data(), std::distance(a.data(), ptr_a));
     rocksdb::Slice b_prefix(b.data(), std::distance(b.data(), ptr_b));
@@ -87,24 +89,26 @@ class ListsDataKeyComparatorImpl : public rocksdb::Comparator {
 /* zset score key pattern
  *  | <Reserve 1> |      <Key>      |  <Version>  |  <Score>  | <Member> | <Reserve2> |
  *  |   8 Bytes   |  Key Size Bytes |   8 Bytes   |  8 Bytes  |          |     16B    |
+ * the reserves are left out by the compact key format, see KeyFormat
  */
 class ZSetsScoreKeyComparatorImpl : public rocksdb::Comparator {
  public:
   // keep compatible with floyd
   const char* Name() const override { return "floyd.ZSetsScoreKeyComparator"; }
   int Compare(const rocksdb::Slice& a, const rocksdb::Slice& b) const override {
-    assert(a.size() > kPrefixReserveLength);
-    assert(b.size() > kPrefixReserveLength);
+    assert(a.size() > KeyPrefixReserveLength());
+    assert(b.size() > KeyPrefixReserveLength());
+    const auto prefix_length = static_cast<int32_t>(KeyPrefixReserveLength());
 
     const char* ptr_a = a.data();
     const char* ptr_b = b.data();
     auto a_size = static_cast<int32_t>(a.size());
     auto b_size = static_cast<int32_t>(b.size());
 
-    ptr_a += kPrefixReserveLength;
-    ptr_b += kPrefixReserveLength;
-    const char* p_a = SeekUserkeyDelim(ptr_a, a_size - kPrefixReserveLength);
-    const char* p_b = SeekUserkeyDelim(ptr_b, b_size - kPrefixReserveLength);
+    ptr_a += prefix_length;
+    ptr_b += prefix_length;
+    const char* p_a = SeekUserkeyDelim(ptr_a, a_size - prefix_length);
+    const char* p_b = SeekUserkeyDelim(ptr_b, b_size - prefix_length);
     rocksdb::Slice p_a_prefix = Slice(ptr_a, std::distance(ptr_a, p_a));
     rocksdb::Slice p_b_prefix = Slice(ptr_b, std::distance(ptr_b, p_b));
     int ret = p_a_prefix.compare(p_b_prefix);
@@ -153,15 +157,16 @@ class ZSetsScoreKeyComparatorImpl : public rocksdb::Comparator {
   // i.e., an implementation of this method that does nothing is correct.
   // TODO(wangshaoyi): need reformat, if pkey differs, why return limit directly?
   void FindShortestSeparator(std::string* start, const rocksdb::Slice& limit) const override {
-    assert(start->size() > kPrefixReserveLength);
-    assert(limit.size() > kPrefixReserveLength);
+    const size_t prefix_length = KeyPrefixReserveLength();
+    assert(start->size() > prefix_length);
+    assert(limit.size() > prefix_length);
 
     const char* head_start = start->data();
     const char* head_limit = limit.data();
     const char* ptr_start = start->data();
     const char* ptr_limit = limit.data();
-    ptr_start += kPrefixReserveLength;
-    ptr_limit += kPrefixReserveLength;
+    ptr_start += prefix_length;
+    ptr_limit += prefix_length;
     ptr_start = SeekUserkeyDelim(ptr_start, start->size() - std::distance(head_start, ptr_start));
     ptr_limit = SeekUserkeyDelim(ptr_limit, limit.size() - std::distance(head_limit, ptr_limit));
 
@@ -257,5 +262,37 @@ class ZSetsScoreKeyComparatorImpl : public rocksdb::Comparator {
   void FindShortSuccessor(std::string* key) const override {}
 };
 
+/* zset rank group key pattern
+* | level | zset score key |
+* |  1B   |                |
+* the levels are kept apart, each is ordered like zset score keys, see
+* ZSetsRankIndex
+ */
+class ZSetsRankGroupKeyComparatorImpl : public rocksdb::Comparator {
+ public:
+  const char* Name() const override { return "pika.ZSetsRankGroupKeyComparator"; }
+  int Compare(const rocksdb::Slice& a, const rocksdb::Slice& b) const override {
+    assert(!a.empty());
+    assert(!b.empty());
+    auto level_a = static_cast<uint8_t>(a[0]);
+    auto level_b = static_cast<uint8_t>(b[0]);
+    if (level_a != level_b) {
+      return level_a < level_b ? -1 : 1;
+    }
+    return score_key_comparator_.Compare(rocksdb::Slice(a.data() + 1, a.size() - 1),
+                                         rocksdb::Slice(b.data() + 1, b.size() - 1));
+  }
+
+  bool Equal(const rocksdb::Slice& a, const rocksdb::Slice& b) const override { return Compare(a, b) == 0; }
+
+  // the keys are left as they are, which is always correct
+  void FindShortestSeparator(std::string* start, const rocksdb::Slice& limit) const override {}
+
+  void FindShortSuccessor(std::string* key) const override {}
+
+ private:
+  ZSetsScoreKeyComparatorImpl score_key_comparator_;
+};
+
 }  //  namespace storage
 #endif  //  INCLUDE_CUSTOM_COMPARATOR_H_
@@ -0,0 +1,213 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_INLINE_FIELDS_FORMAT_H_
+#define SRC_INLINE_FIELDS_FORMAT_H_
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/iterator.h"
+
+#include "src/base_data_key_format.h"
+#include "src/base_data_value_format.h"
+#include "src/coding.h"
+
+namespace storage {
+
+/*
+ * Fields of an inline hash, packed into the meta value after the count
+ * (see kMetaInlineFlag), sorted by field:
+ * | field len | field | value len | value | field len | field | ...
+ * |    4B     |       |    4B     |       |    4B     |       |
+ */
+inline void EncodeInlineFields(const std::map<std::string, std::string>& fields, std::string* dst) {
+  char buf[sizeof(uint32_t)];
+  dst->clear();
+  for (const auto& fv : fields) {
+    EncodeFixed32(buf, static_cast<uint32_t>(fv.first.size()));
+    dst->append(buf, sizeof(buf));
+    dst->append(fv.first);
+    EncodeFixed32(buf, static_cast<uint32_t>(fv.second.size()));
+    dst->append(buf, sizeof(buf));
+    dst->append(fv.second);
+  }
+}
+
+// Walk the packed fields, stop early when the callback returns false.
+// Return false if the payload is truncated.
+template <typename Func>
+inline bool ForEachInlineField(const rocksdb::Slice& payload, Func&& func) {
+  const char* ptr = payload.data();
+  const char* limit = payload.data() + payload.size();
+  while (ptr < limit) {
+    rocksdb::Slice field_value[2];
+    for (auto& slice : field_value) {
+      if (limit - ptr < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+        return false;
+      }
+      uint32_t len = DecodeFixed32(ptr);
+      ptr += sizeof(uint32_t);
+      if (static_cast<uint64_t>(limit - ptr) < len) {
+        return false;
+      }
+      slice = rocksdb::Slice(ptr, len);
+      ptr += len;
+    }
+    if (!func(field_value[0], field_value[1])) {
+      break;
+    }
+  }
+  return true;
+}
+
+inline bool DecodeInlineFields(const rocksdb::Slice& payload, std::map<std::string, std::string>* fields) {
+  return ForEachInlineField(payload, [&](const rocksdb::Slice& field, const rocksdb::Slice& value) {
+    (*fields)[field.ToString()] = value.ToString();
+    return true;
+  });
+}
+
+inline bool FindInlineField(const rocksdb::Slice& payload, const rocksdb::Slice& field, std::string* value) {
+  bool found = false;
+  ForEachInlineField(payload, [&](const rocksdb::Slice& f, const rocksdb::Slice& v) {
+    if (f == field) {
+      value->assign(v.data(), v.size());
+      found = true;
+    }
+    return !found;
+  });
+  return found;
+}
+
+/*
+ * Members of an inline set, packed the same way without values:
+ * | member len | member | member len | member | ...
+ * |     4B     |        |     4B     |        |
+ */
+inline void EncodeInlineMembers(const std::vector<std::string>& members, std::string* dst) {
+  char buf[sizeof(uint32_t)];
+  dst->clear();
+  for (const auto& member : members) {
+    EncodeFixed32(buf, static_cast<uint32_t>(member.size()));
+    dst->append(buf, sizeof(buf));
+    dst->append(member);
+  }
+}
+
+template <typename Func>
+inline bool ForEachInlineMember(const rocksdb::Slice& payload, Func&& func) {
+  const char* ptr = payload.data();
+  const char* limit = payload.data() + payload.size();
+  while (ptr < limit) {
+    if (limit - ptr < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+      return false;
+    }
+    uint32_t len = DecodeFixed32(ptr);
+    ptr += sizeof(uint32_t);
+    if (static_cast<uint64_t>(limit - ptr) < len) {
+      return false;
+    }
+    if (!func(rocksdb::Slice(ptr, len))) {
+      break;
+    }
+    ptr += len;
+  }
+  return true;
+}
+
+inline bool DecodeInlineMembers(const rocksdb::Slice& payload, std::set<std::string>* members) {
+  return ForEachInlineMember(payload, [&](const rocksdb::Slice& member) {
+    members->insert(member.ToString());
+    return true;
+  });
+}
+
+inline bool FindInlineMember(const rocksdb::Slice& payload, const rocksdb::Slice& member) {
+  bool found = false;
+  ForEachInlineMember(payload, [&](const rocksdb::Slice& m) {
+    found = m == member;
+    return !found;
+  });
+  return found;
+}
+
+/*
+ * Iterator over the fields of an inline hash, it yields the same keys and
+ * values as an iterator over kHashesDataCF would if the fields were stored
+ * there, so the scan commands work unchanged on both layouts.
+ */
+class InlineFieldsIterator : public rocksdb::Iterator {
+ public:
+  InlineFieldsIterator(const rocksdb::Slice& key, uint64_t version, const rocksdb::Slice& payload) {
+    bool ok = ForEachInlineField(payload, [&](const rocksdb::Slice& field, const rocksdb::Slice& value) {
+      HashesDataKey data_key(key, version, field);
+      BaseDataValue data_value(value);
+      entries_.emplace_back(data_key.Encode().ToString(), data_value.Encode().ToString());
+      return true;
+    });
+    Finish(ok, "invalid inline hash");
+  }
+
+  bool Valid() const override { return pos_ < entries_.size(); }
+  void SeekToFirst() override { pos_ = 0; }
+  void SeekToLast() override { pos_ = entries_.empty() ? 0 : entries_.size() - 1; }
+
+  void Seek(const rocksdb::Slice& target) override {
+    auto iter = std::lower_bound(entries_.begin(), entries_.end(), target,
+                                 [](const Entry& entry, const rocksdb::Slice& t) { return t.compare(entry.first) > 0; });
+    pos_ = iter - entries_.begin();
+  }
+
+  void SeekForPrev(const rocksdb::Slice& target) override {
+    auto iter = std::upper_bound(entries_.begin(), entries_.end(), target,
+                                 [](const rocksdb::Slice& t, const Entry& entry) { return t.compare(entry.first) < 0; });
+    pos_ = iter == entries_.begin() ? entries_.size() : iter - entries_.begin() - 1;
+  }
+
+  void Next() override { pos_++; }
+  void Prev() override { pos_ = pos_ == 0 ? entries_.size() : pos_ - 1; }
+  rocksdb::Slice key() const override { return entries_[pos_].first; }
+  rocksdb::Slice value() const override { return entries_[pos_].second; }
+  rocksdb::Status status() const override { return status_; }
+
+ protected:
+  InlineFieldsIterator() = default;
+
+  void Finish(bool ok, const char* error) {
+    if (!ok) {
+      entries_.clear();
+      status_ = rocksdb::Status::Corruption(error);
+    }
+    std::sort(entries_.begin(), entries_.end());
+    pos_ = entries_.size();
+  }
+
+  using Entry = std::pair<std::string, std::string>;
+  std::vector<Entry> entries_;
+  size_t pos_ = 0;
+  rocksdb::Status status_;
+};
+
+// Same over the members of an inline set, as kSetsDataCF would hold them
+class InlineMembersIterator : public InlineFieldsIterator {
+ public:
+  InlineMembersIterator(const rocksdb::Slice& key, uint64_t version, const rocksdb::Slice& payload) {
+    bool ok = ForEachInlineMember(payload, [&](const rocksdb::Slice& member) {
+      SetsMemberKey member_key(key, version, member);
+      BaseDataValue data_value(rocksdb::Slice{});
+      entries_.emplace_back(member_key.Encode().ToString(), data_value.Encode().ToString());
+      return true;
+    });
+    Finish(ok, "invalid inline set");
+  }
+};
+
+}  //  namespace storage
+#endif  // SRC_INLINE_FIELDS_FORMAT_H_
@@ -0,0 +1,162 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/keyspace_counters.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "src/base_meta_value_format.h"
+#include "src/lists_meta_value_format.h"
+#include "src/pika_stream_meta_value.h"
+#include "src/strings_value_format.h"
+
+namespace storage {
+
+KeyspaceCounters::KeyState KeyspaceCounters::ParseState(const rocksdb::Slice& meta_value) {
+  KeyState state;
+  if (meta_value.empty()) {
+    return state;
+  }
+  auto type = static_cast<enum DataType>(static_cast<uint8_t>(meta_value[0]));
+  if (type == DataType::kStrings) {
+    ParsedStringsValue parsed_strings_value(meta_value);
+    state.etime = parsed_strings_value.Etime();
+  } else if (type == DataType::kLists) {
+    ParsedListsMetaValue parsed_lists_meta_value(meta_value);
+    state.empty = parsed_lists_meta_value.Count() == 0;
+    state.etime = parsed_lists_meta_value.Etime();
+  } else if (type == DataType::kStreams) {
+    ParsedStreamMetaValue parsed_stream_meta_value(meta_value);
+    state.empty = parsed_stream_meta_value.length() == 0;
+  } else if (type == DataType::kHashes || type == DataType::kSets || type == DataType::kZSets) {
+    ParsedBaseMetaValue parsed_base_meta_value(meta_value);
+    state.empty = parsed_base_meta_value.Count() == 0;
+    state.etime = parsed_base_meta_value.Etime();
+  } else {
+    return state;
+  }
+  state.type = type;
+  return state;
+}
+
+void KeyspaceCounters::Apply(TypeCounts* counts, const KeyState& state, int64_t delta, uint64_t expired_before) {
+  if (state.empty) {
+    counts->empty += delta;
+    return;
+  }
+  counts->keys += delta;
+  if (state.etime == 0) {
+    return;
+  }
+  counts->expires += delta;
+  if (state.etime < expired_before) {
+    counts->expired += delta;
+    return;
+  }
+  auto iter = counts->ttl_buckets.emplace(state.etime, 0).first;
+  iter->second += delta;
+  if (iter->second == 0) {
+    counts->ttl_buckets.erase(iter);
+  }
+  // wraps around while the changes kept aside for a scan are negative
+  counts->etime_sum += static_cast<uint64_t>(delta) * state.etime;
+}
+
+void KeyspaceCounters::Add(TypeCounts* counts, const TypeCounts& other) {
+  counts->keys += other.keys;
+  counts->expires += other.expires;
+  counts->expired += other.expired;
+  counts->empty += other.empty;
+  for (const auto& bucket : other.ttl_buckets) {
+    auto iter = counts->ttl_buckets.emplace(bucket.first, 0).first;
+    iter->second += bucket.second;
+    if (iter->second == 0) {
+      counts->ttl_buckets.erase(iter);
+    }
+  }
+  counts->etime_sum += other.etime_sum;
+}
+
+void KeyspaceCounters::MoveExpired(TypeCounts* counts, uint64_t expired_before) {
+  auto end = counts->ttl_buckets.lower_bound(expired_before);
+  for (auto iter = counts->ttl_buckets.begin(); iter != end; ++iter) {
+    counts->expired += iter->second;
+    counts->etime_sum -= static_cast<uint64_t>(iter->second) * iter->first;
+  }
+  counts->ttl_buckets.erase(counts->ttl_buckets.begin(), end);
+}
+
+void KeyspaceCounters::Change(const KeyState& from, const KeyState& to) {
+  std::lock_guard l(mu_);
+  if (from.type != DataType::kNones) {
+    Apply(&counts_[static_cast<int>(from.type)], from, -1, expired_before_);
+    if (reconciling_) {
+      Apply(&pending_[static_cast<int>(from.type)], from, -1, expired_before_);
+    }
+  }
+  if (to.type != DataType::kNones) {
+    Apply(&counts_[static_cast<int>(to.type)], to, 1, expired_before_);
+    if (reconciling_) {
+      Apply(&pending_[static_cast<int>(to.type)], to, 1, expired_before_);
+    }
+  }
+}
+
+void KeyspaceCounters::GetKeyInfos(uint64_t now, std::vector<KeyInfo>* key_infos) {
+  // the order of key_infos is strings, hashes, lists, zsets, sets, streams
+  static const int kKeyInfoIndex[] = {0, 1, 4, 2, 3, 5};
+  key_infos->assign(DataTypeNum, KeyInfo());
+
+  std::lock_guard l(mu_);
+  // a key is stale once its etime is before now
+  if (now > expired_before_) {
+    expired_before_ = now;
+    for (auto& counts : counts_) {
+      MoveExpired(&counts, expired_before_);
+    }
+  }
+  for (int i = 0; i < DataTypeNum; i++) {
+    const TypeCounts& counts = counts_[i];
+    KeyInfo& key_info = (*key_infos)[kKeyInfoIndex[i]];
+    int64_t ttl_keys = counts.expires - counts.expired;
+    key_info.keys = std::max<int64_t>(counts.keys - counts.expired, 0);
+    key_info.expires = std::max<int64_t>(ttl_keys, 0);
+    key_info.invaild_keys = std::max<int64_t>(counts.expired + counts.empty, 0);
+    if (ttl_keys > 0 && counts.etime_sum / ttl_keys > now) {
+      key_info.avg_ttl = counts.etime_sum / ttl_keys - now;
+    }
+  }
+}
+
+bool KeyspaceCounters::BeginReconcile() {
+  std::lock_guard l(mu_);
+  if (reconciling_) {
+    return false;
+  }
+  reconciling_ = true;
+  pending_.assign(DataTypeNum, TypeCounts());
+  return true;
+}
+
+void KeyspaceCounters::EndReconcile(const KeyspaceCounters& scanned) {
+  std::lock_guard l(mu_);
+  for (int i = 0; i < DataTypeNum; i++) {
+    TypeCounts counts = scanned.counts_[i];
+    Add(&counts, pending_[i]);
+    MoveExpired(&counts, expired_before_);
+    counts_[i] = std::move(counts);
+  }
+  reconciling_ = false;
+  pending_.clear();
+}
+
+void KeyspaceCounters::AbortReconcile() {
+  std::lock_guard l(mu_);
+  reconciling_ = false;
+  pending_.clear();
+}
+
+}  //  namespace storage
@@ -0,0 +1,90 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_KEYSPACE_COUNTERS_H_
+#define SRC_KEYSPACE_COUNTERS_H_
+
+#include <map>
+#include <vector>
+
+#include "rocksdb/slice.h"
+
+#include "pstd/include/pstd_mutex.h"
+#include "src/base_value_format.h"
+#include "storage/storage.h"
+
+namespace storage {
+
+/*
+ * Key counts of each type of one instance, kept by the writes to kMetaCF
+ * so that INFO KEYSPACE and DBSIZE do not scan.
+ *
+ * A meta value is absent, empty (a collection with no member left) or
+ * counted. A counted key is not written when its etime passes: it stays
+ * in ttl_buckets until the counts are read after its etime, which moves
+ * it to expired. It leaves expired when it is deleted or written again,
+ * or when the meta filter drops it in a compaction.
+ *
+ * A compaction dropping a key while it is written makes the counts drift.
+ * Reconcile replaces them with the counts of a scan of kMetaCF, plus the
+ * changes made since its snapshot.
+ */
+class KeyspaceCounters {
+ public:
+  struct KeyState {
+    DataType type = DataType::kNones;
+    bool empty = false;
+    uint64_t etime = 0;
+  };
+
+  // the state of a meta value read from kMetaCF
+  static KeyState ParseState(const rocksdb::Slice& meta_value);
+
+  KeyspaceCounters() : counts_(DataTypeNum) {}
+
+  // a meta value went from `from` to `to`, kNones when absent
+  void Change(const KeyState& from, const KeyState& to);
+
+  // in the order of Storage::GetKeyNum: strings, hashes, lists, zsets,
+  // sets, streams
+  void GetKeyInfos(uint64_t now, std::vector<KeyInfo>* key_infos);
+
+  // Called before the snapshot of the scan is taken, false if another
+  // scan is reconciling. The changes made until EndReconcile are kept
+  // aside and added to the counts of the scan.
+  bool BeginReconcile();
+  // scanned: Change(KeyState(), state) for every meta value of the snapshot
+  void EndReconcile(const KeyspaceCounters& scanned);
+  void AbortReconcile();
+
+ private:
+  struct TypeCounts {
+    // counted keys, expired or not
+    int64_t keys = 0;
+    // counted keys having an etime
+    int64_t expires = 0;
+    // counted keys whose etime passed, moved out of ttl_buckets
+    int64_t expired = 0;
+    int64_t empty = 0;
+    // the counted keys not expired yet by etime
+    std::map<uint64_t, int64_t> ttl_buckets;
+    // sum of the etimes in ttl_buckets, for avg_ttl
+    uint64_t etime_sum = 0;
+  };
+
+  static void Apply(TypeCounts* counts, const KeyState& state, int64_t delta, uint64_t expired_before);
+  static void Add(TypeCounts* counts, const TypeCounts& other);
+  static void MoveExpired(TypeCounts* counts, uint64_t expired_before);
+
+  pstd::Mutex mu_;
+  // the etimes before it were moved to expired
+  uint64_t expired_before_ = 0;
+  std::vector<TypeCounts> counts_;
+  bool reconciling_ = false;
+  std::vector<TypeCounts> pending_;
+};
+
+}  //  namespace storage
+#endif  // SRC_KEYSPACE_COUNTERS_H_
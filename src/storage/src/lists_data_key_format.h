@@ -14,6 +14,7 @@ namespace storage {
 * used for List data key. format:
 * | reserve1 | key | version | index | reserve2 |
 * |    8B    |     |    8B   |   8B  |   16B    |
+* the reserves are left out by the compact key format, see KeyFormat
 */
 class ListsDataKey {
 public:
@@ -27,7 +28,9 @@ public:
   }
 
   Slice Encode() {
-    size_t meta_size = sizeof(reserve1_) + sizeof(version_) + sizeof(reserve2_);
+    size_t prefix_length = KeyPrefixReserveLength();
+    size_t suffix_length = KeySuffixReserveLength();
+    size_t meta_size = prefix_length + sizeof(version_) + suffix_length;
     size_t usize = key_.size() + sizeof(index_) + kEncodedKeyDelimSize;
     size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
     usize += nzero;
@@ -46,8 +49,8 @@ public:
 
     start_ = dst;
     // reserve1: 8 byte
-    memcpy(dst, reserve1_, sizeof(reserve1_));
-    dst += sizeof(reserve1_);
+    memcpy(dst, reserve1_, prefix_length);
+    dst += prefix_length;
     dst = EncodeUserKey(key_, dst, nzero);
     // version 8 byte
     EncodeFixed64(dst, version_);
@@ -55,9 +58,8 @@ public:
     // index
     EncodeFixed64(dst, index_);
     dst += sizeof(index_);
-    // TODO(wangshaoyi): too much for reserve
     // reserve2: 16 byte
-    memcpy(dst, reserve2_, sizeof(reserve2_));
+    memcpy(dst, reserve2_, suffix_length);
     return Slice(start_, needed);
   }
 
@@ -88,9 +90,9 @@ class ParsedListsDataKey {
   void decode(const char* ptr, const char* end_ptr) {
     const char* start = ptr;
     // skip head reserve1_
-    ptr += sizeof(reserve1_);
+    ptr += KeyPrefixReserveLength();
     // skip tail reserve2_
-    end_ptr -= sizeof(reserve2_);
+    end_ptr -= KeySuffixReserveLength();
 
     ptr = DecodeUserKey(ptr, std::distance(ptr, end_ptr), &key_str_);
     version_ = DecodeFixed64(ptr);
@@ -108,10 +110,8 @@ class ParsedListsDataKey {
 
  private:
   std::string key_str_;
-  char reserve1_[8] = {0};
   uint64_t version_ = (uint64_t)(-1);
   uint64_t index_ = 0;
-  char reserve2_[16] = {0};
 };
 
 }  //  namespace storage
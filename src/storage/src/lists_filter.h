@@ -12,6 +12,7 @@
 
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/db.h"
+#include "src/base_filter.h"
 #include "src/debug.h"
 #include "src/lists_data_key_format.h"
 #include "src/lists_meta_value_format.h"
@@ -26,11 +27,14 @@ namespace storage {
 
 class ListsDataFilter : public rocksdb::CompactionFilter {
  public:
-  ListsDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr, enum DataType type)
+  ListsDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr, enum DataType type,
+                  CompactionFilterStats* stats = nullptr)
       : db_(db),
         cf_handles_ptr_(cf_handles_ptr),
-        type_(type)
-        {}
+        stats_(stats),
+        type_(type) {
+    default_read_options_.fill_cache = false;
+  }
 
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
@@ -45,10 +49,11 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
 
     const char* ptr = key.data();
     int key_size = key.size();
-    ptr = SeekUserkeyDelim(ptr + kPrefixReserveLength, key_size - kPrefixReserveLength);
+    ptr = SeekUserkeyDelim(ptr + KeyPrefixReserveLength(), key_size - KeyPrefixReserveLength());
     std::string meta_key_enc(key.data(), std::distance(key.data(), ptr));
-    meta_key_enc.append(kSuffixReserveLength, kNeedTransformCharacter);
+    meta_key_enc.append(KeySuffixReserveLength(), kNeedTransformCharacter);
 
+    AddCompactionFilterStat(stats_, &CompactionFilterStats::filtered_keys);
     if (meta_key_enc != cur_key_) {
       cur_key_ = meta_key_enc;
       cur_meta_etime_ = 0;
@@ -59,6 +64,7 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
       if (cf_handles_ptr_->empty()) {
         return false;
       }
+      AddCompactionFilterStat(stats_, &CompactionFilterStats::meta_lookups);
       rocksdb::Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[0], cur_key_, &meta_value);
       if (s.ok()) {
         /*
@@ -88,20 +94,25 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
       return true;
     }
 
+    if (cur_meta_version_ > parsed_lists_data_key.Version()) {
+      TRACE("Drop[list_data_key_version < cur_meta_version]");
+      return true;
+    }
+    // written since the meta was read, the meta read tells nothing about it
+    if (cur_meta_version_ < parsed_lists_data_key.Version()) {
+      AddCompactionFilterStat(stats_, &CompactionFilterStats::skipped_keys);
+      TRACE("Reserve[list_data_key_version > cur_meta_version]");
+      return false;
+    }
+
     int64_t unix_time;
     rocksdb::Env::Default()->GetCurrentTime(&unix_time);
     if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time)) {
       TRACE("Drop[Timeout]");
       return true;
     }
-
-    if (cur_meta_version_ > parsed_lists_data_key.Version()) {
-      TRACE("Drop[list_data_key_version < cur_meta_version]");
-      return true;
-    } else {
-      TRACE("Reserve[list_data_key_version == cur_meta_version]");
-      return false;
-    }
+    TRACE("Reserve[list_data_key_version == cur_meta_version]");
+    return false;
   }
 
   /*
@@ -125,6 +136,7 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
  private:
   rocksdb::DB* db_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  CompactionFilterStats* stats_ = nullptr;
   rocksdb::ReadOptions default_read_options_;
   mutable std::string cur_key_;
   mutable bool meta_not_found_ = false;
@@ -135,12 +147,13 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
 
 class ListsDataFilterFactory : public rocksdb::CompactionFilterFactory {
  public:
-  ListsDataFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type)
-      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), type_(type) {}
+  ListsDataFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type,
+                         CompactionFilterStats* stats = nullptr)
+      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), type_(type), stats_(stats) {}
 
   std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
       const rocksdb::CompactionFilter::Context& context) override {
-    return std::unique_ptr<rocksdb::CompactionFilter>(new ListsDataFilter(*db_ptr_, cf_handles_ptr_, type_));
+    return std::unique_ptr<rocksdb::CompactionFilter>(new ListsDataFilter(*db_ptr_, cf_handles_ptr_, type_, stats_));
   }
   const char* Name() const override { return "ListsDataFilterFactory"; }
 
@@ -148,6 +161,7 @@ class ListsDataFilterFactory : public rocksdb::CompactionFilterFactory {
   rocksdb::DB** db_ptr_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
   enum DataType type_ = DataType::kNones;
+  CompactionFilterStats* stats_ = nullptr;
 };
 
 }  //  namespace storage
@@ -13,12 +13,33 @@
 
 namespace storage {
 
+/*
+ * Distance between the indexes of two neighbouring elements, so that
+ * LINSERT can put an element between them without moving the others.
+ * Lists created by older versions use a distance of 1.
+ */
+const uint64_t kListsIndexStep = 1 << 16;
+
 const uint64_t InitalLeftIndex = 9223372036854775807;
-const uint64_t InitalRightIndex = 9223372036854775808U;
+const uint64_t InitalRightIndex = InitalLeftIndex + kListsIndexStep;
+
+/*
+ * reserve[0] of the list meta value holds the flags below.
+ * kListsGappedFlag: an element was inserted into or removed from the middle
+ * of the list, the indexes are no longer evenly spaced and the position of
+ * an element can not be computed from the left index. The LINSERT or LREM
+ * that sets the flag queues the list to be renumbered in the background,
+ * see Redis::ListsRenumber, which clears the flag again. Until then lookups
+ * walk the list from the nearer end.
+ */
+const char kListsGappedFlag = 0x01;
 
 /*
-*| type | list_size | version | left index | right index | reserve |  cdate | timestamp |
-*|  1B  |     8B    |    8B   |     8B     |      8B     |   16B   |    8B  |     8B    |
+*| type | list_size | version | left index | right index | suffix |
+*|  1B  |     8B    |    8B   |     16B    |      16B    |        |
+* each index takes the first 8B of its 16B slot, the other 8B are zero
+* suffix is either | reserve 16B | cdate 8B | timestamp 8B | (legacy)
+* or the compact one, see kCompactSuffixFlag
 */
 class ListsMetaValue : public InternalValue {
  public:
@@ -28,25 +49,21 @@ class ListsMetaValue : public InternalValue {
   rocksdb::Slice Encode() override {
     size_t usize = user_value_.size();
     size_t needed = usize + kVersionLength + 2 * kListValueIndexLength +
-                    kSuffixReserveLength + 2 * kTimestampLength + kTypeLength;
+                    SuffixLength(ctime_, etime_, true) + kTypeLength;
     char* dst = ReAllocIfNeeded(needed);
     memcpy(dst, &type_, sizeof(type_));
     dst += sizeof(type_);
-    char* start_pos = dst;
 
     memcpy(dst, user_value_.data(), usize);
     dst += usize;
     EncodeFixed64(dst, version_);
     dst += kVersionLength;
+    memset(dst, 0, 2 * kListValueIndexLength);
     EncodeFixed64(dst, left_index_);
     dst += kListValueIndexLength;
     EncodeFixed64(dst, right_index_);
     dst += kListValueIndexLength;
-    memcpy(dst, reserve_, sizeof(reserve_));
-    dst += kSuffixReserveLength;
-    EncodeFixed64(dst, ctime_);
-    dst += kTimestampLength;
-    EncodeFixed64(dst, etime_);
+    EncodeSuffix(dst, reserve_, ctime_, etime_, true);
     return {start_, needed};
   }
 
@@ -79,87 +96,35 @@ class ParsedListsMetaValue : public ParsedInternalValue {
   // Use this constructor after rocksdb::DB::Get();
   explicit ParsedListsMetaValue(std::string* internal_value_str)
       : ParsedInternalValue(internal_value_str) {
-    assert(internal_value_str->size() >= kListsMetaValueSuffixLength);
-    if (internal_value_str->size() >= kListsMetaValueSuffixLength) {
-      size_t offset = 0;
-      type_ = static_cast<DataType>(static_cast<uint8_t>((*internal_value_str)[0]));
-      offset += kTypeLength;
-      user_value_ = rocksdb::Slice(internal_value_str->data() + kTypeLength,
-                                   internal_value_str->size() - kListsMetaValueSuffixLength - kTypeLength);
-      offset += user_value_.size();
-      version_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += kVersionLength;
-      left_index_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += kListValueIndexLength;
-      right_index_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += kListValueIndexLength;
-      memcpy(reserve_, internal_value_str->data() + offset, sizeof(reserve_));
-      offset += kSuffixReserveLength;
-      ctime_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += kTimestampLength;
-      etime_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += kTimestampLength;
-    }
-    count_ = DecodeFixed64(internal_value_str->data() + kTypeLength);
+    Decode(*internal_value_str);
   }
 
   // Use this constructor in rocksdb::CompactionFilter::Filter();
   explicit ParsedListsMetaValue(const rocksdb::Slice& internal_value_slice)
       : ParsedInternalValue(internal_value_slice) {
-    assert(internal_value_slice.size() >= kListsMetaValueSuffixLength);
-    if (internal_value_slice.size() >= kListsMetaValueSuffixLength) {
-      size_t offset = 0;
-      type_ = static_cast<DataType>(static_cast<uint8_t>(internal_value_slice[0]));
-      offset += kTypeLength;
-      user_value_ = rocksdb::Slice(internal_value_slice.data() + kTypeLength,
-                                   internal_value_slice.size() - kListsMetaValueSuffixLength - kTypeLength);
-      offset += user_value_.size();
-      version_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += kVersionLength;
-      left_index_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += kListValueIndexLength;
-      right_index_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += kListValueIndexLength;
-      memcpy(reserve_, internal_value_slice.data() + offset, sizeof(reserve_));
-      offset += kSuffixReserveLength;
-      ctime_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += kTimestampLength;
-      etime_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += kTimestampLength;
-    }
-    count_ = DecodeFixed64(internal_value_slice.data() + kTypeLength);
+    Decode(internal_value_slice);
   }
 
   void StripSuffix() override {
     if (value_) {
-      value_->erase(value_->size() - kListsMetaValueSuffixLength, kListsMetaValueSuffixLength);
+      value_->erase(value_->size() - MetaSuffixLength(), MetaSuffixLength());
     }
   }
 
   void SetVersionToValue() override {
     if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kListsMetaValueSuffixLength;
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - MetaSuffixLength();
       EncodeFixed64(dst, version_);
     }
   }
 
-  void SetCtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - 2 * kTimestampLength;
-      EncodeFixed64(dst, ctime_);
-    }
-  }
+  void SetCtimeToValue() override { SetSuffixToValue(true); }
 
-  void SetEtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kTimestampLength;
-      EncodeFixed64(dst, etime_);
-    }
-  }
+  void SetEtimeToValue() override { SetSuffixToValue(true); }
 
   void SetIndexToValue() {
     if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kListsMetaValueSuffixLength + kVersionLength;
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - MetaSuffixLength() + kVersionLength;
       EncodeFixed64(dst, left_index_);
       dst += sizeof(left_index_);
       EncodeFixed64(dst, right_index_);
@@ -170,6 +135,7 @@ class ParsedListsMetaValue : public ParsedInternalValue {
     this->SetCount(0);
     this->set_left_index(InitalLeftIndex);
     this->set_right_index(InitalRightIndex);
+    this->SetGapped(false);
     this->SetEtime(0);
     this->SetCtime(0);
     return this->UpdateVersion();
@@ -214,7 +180,7 @@ class ParsedListsMetaValue : public ParsedInternalValue {
   void set_left_index(uint64_t index) {
     left_index_ = index;
     if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kListsMetaValueSuffixLength + kVersionLength;
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - MetaSuffixLength() + kVersionLength;
       EncodeFixed64(dst, left_index_);
     }
   }
@@ -222,7 +188,7 @@ class ParsedListsMetaValue : public ParsedInternalValue {
   void ModifyLeftIndex(uint64_t index) {
     left_index_ -= index;
     if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kListsMetaValueSuffixLength + kVersionLength;
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - MetaSuffixLength() + kVersionLength;
       EncodeFixed64(dst, left_index_);
     }
   }
@@ -232,7 +198,7 @@ class ParsedListsMetaValue : public ParsedInternalValue {
   void set_right_index(uint64_t index) {
     right_index_ = index;
     if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kListsMetaValueSuffixLength + kVersionLength + kListValueIndexLength;
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - MetaSuffixLength() + kVersionLength + kListValueIndexLength;
       EncodeFixed64(dst, right_index_);
     }
   }
@@ -240,13 +206,50 @@ class ParsedListsMetaValue : public ParsedInternalValue {
   void ModifyRightIndex(uint64_t index) {
     right_index_ += index;
     if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() - kListsMetaValueSuffixLength + kVersionLength + kListValueIndexLength;
+      char* dst = const_cast<char*>(value_->data()) + value_->size() - MetaSuffixLength() + kVersionLength + kListValueIndexLength;
       EncodeFixed64(dst, right_index_);
     }
   }
 
+  bool IsGapped() { return (reserve_[0] & kListsGappedFlag) != 0; }
+
+  void SetGapped(bool gapped) {
+    reserve_[0] = static_cast<char>(gapped ? (reserve_[0] | kListsGappedFlag) : (reserve_[0] & ~kListsGappedFlag));
+    SetSuffixToValue(true);
+  }
+
+  // The index distance used when pushing to either end. Evenly spaced lists
+  // keep their own distance, gapped lists just use kListsIndexStep.
+  uint64_t IndexStep() {
+    if (IsGapped()) {
+      return kListsIndexStep;
+    }
+    return (right_index_ - left_index_) / (count_ + 1);
+  }
+
 private:
-  const size_t kListsMetaValueSuffixLength = kVersionLength + 2 * kListValueIndexLength + kSuffixReserveLength + 2 * kTimestampLength;
+  // version and indexes, between the list size and the suffix
+  static const size_t kListsMetaValueFixedLength = kVersionLength + 2 * kListValueIndexLength;
+
+  size_t MetaSuffixLength() { return kListsMetaValueFixedLength + suffix_length_; }
+
+  void Decode(const rocksdb::Slice& value) {
+    if (value.size() >= kTypeLength + sizeof(count_) + kListsMetaValueFixedLength &&
+        DecodeSuffix(value.data(), value.size(), true) &&
+        value.size() >= kTypeLength + sizeof(count_) + MetaSuffixLength()) {
+      size_t offset = value.size() - MetaSuffixLength();
+      type_ = static_cast<DataType>(static_cast<uint8_t>(value[0]));
+      user_value_ = rocksdb::Slice(value.data() + kTypeLength, offset - kTypeLength);
+      version_ = DecodeFixed64(value.data() + offset);
+      offset += kVersionLength;
+      left_index_ = DecodeFixed64(value.data() + offset);
+      offset += kListValueIndexLength;
+      right_index_ = DecodeFixed64(value.data() + offset);
+      count_ = DecodeFixed64(value.data() + kTypeLength);
+    } else {
+      suffix_length_ = 0;
+    }
+  }
 
  private:
   uint64_t count_ = 0;
@@ -3,19 +3,43 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <unordered_map>
 
 #include "rocksdb/env.h"
+#include "rocksdb/write_batch.h"
 
 #include "src/redis.h"
 #include "src/lists_filter.h"
 #include "src/base_filter.h"
 #include "src/zsets_filter.h"
+#include "src/base_data_key_format.h"
+#include "src/base_key_format.h"
+#include "src/lists_data_key_format.h"
+#include "src/zsets_data_key_format.h"
+#include "src/zsets_rank_index.h"
+#include "src/scope_record_lock.h"
+#include "src/scope_snapshot.h"
+#include "src/strings_value_format.h"
+#include "src/ttl_index_format.h"
 
 namespace storage {
 
 constexpr const char* ErrTypeMessage = "WRONGTYPE";
 
+// Marks a database of the compact key format, see KeyFormat. The cf stays
+// empty, it is part of the database so that checkpoints carry it along.
+const std::string kCompactKeysCFName = "compact_keys_cf";
+
+// The number of databases open in the process, they share g_key_format
+static std::mutex key_format_mutex;
+static int key_format_users = 0;
+
 const rocksdb::Comparator* ListsDataKeyComparator() {
   static ListsDataKeyComparatorImpl ldkc;
   return &ldkc;
@@ -26,6 +50,11 @@ rocksdb::Comparator* ZSetsScoreKeyComparator() {
   return &zsets_score_key_compare;
 }
 
+rocksdb::Comparator* ZSetsRankGroupKeyComparator() {
+  static ZSetsRankGroupKeyComparatorImpl zsets_rank_group_key_compare;
+  return &zsets_rank_group_key_compare;
+}
+
 Redis::Redis(Storage* const s, int32_t index)
     : storage_(s), index_(index),
       lock_mgr_(std::make_shared<LockMgr>(1000, 0, std::make_shared<MutexFactoryImpl>())),
@@ -43,6 +72,10 @@ Redis::Redis(Storage* const s, int32_t index)
 }
 
 Redis::~Redis() {
+  if (key_format_user_) {
+    std::lock_guard l(key_format_mutex);
+    key_format_users--;
+  }
   rocksdb::CancelAllBackgroundWork(db_, true);
   std::vector<rocksdb::ColumnFamilyHandle*> tmp_handles = handles_;
   handles_.clear();
@@ -60,6 +93,12 @@ Redis::~Redis() {
 Status Redis::Open(const StorageOptions& storage_options, const std::string& db_path) {
   statistics_store_->SetCapacity(storage_options.statistics_max_size);
   small_compaction_threshold_ = storage_options.small_compaction_threshold;
+  hash_max_inline_entries_ = storage_options.hash_max_inline_entries;
+  hash_max_inline_value_ = storage_options.hash_max_inline_value;
+  set_max_inline_entries_ = storage_options.set_max_inline_entries;
+  set_max_inline_value_ = storage_options.set_max_inline_value;
+  reclaim_min_count_ = storage_options.reclaim_min_count;
+  ttl_index_enabled_ = storage_options.enable_ttl_index;
 
   rocksdb::BlockBasedTableOptions table_ops(storage_options.table_options);
   table_ops.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, true));
@@ -75,7 +114,7 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
    */
   // meta & string column-family options
   rocksdb::ColumnFamilyOptions meta_cf_ops(storage_options.options);
-  meta_cf_ops.compaction_filter_factory = std::make_shared<MetaFilterFactory>();
+  meta_cf_ops.compaction_filter_factory = std::make_shared<MetaFilterFactory>(&db_, &handles_, &keyspace_counters_);
   rocksdb::BlockBasedTableOptions meta_table_ops(table_ops);
 
   rocksdb::BlockBasedTableOptions string_table_ops(table_ops);
@@ -86,7 +125,8 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
 
   // hash column-family options
   rocksdb::ColumnFamilyOptions hash_data_cf_ops(storage_options.options);
-  hash_data_cf_ops.compaction_filter_factory = std::make_shared<HashesDataFilterFactory>(&db_, &handles_, DataType::kHashes);
+  hash_data_cf_ops.compaction_filter_factory = std::make_shared<HashesDataFilterFactory>(&db_, &handles_, DataType::kHashes,
+                                                                                         &compaction_filter_stats_);
   rocksdb::BlockBasedTableOptions hash_data_cf_table_ops(table_ops);
   if (!storage_options.share_block_cache && storage_options.block_cache_size > 0) {
     hash_data_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
@@ -95,7 +135,8 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
 
   // list column-family options
   rocksdb::ColumnFamilyOptions list_data_cf_ops(storage_options.options);
-  list_data_cf_ops.compaction_filter_factory = std::make_shared<ListsDataFilterFactory>(&db_, &handles_, DataType::kLists);
+  list_data_cf_ops.compaction_filter_factory = std::make_shared<ListsDataFilterFactory>(&db_, &handles_, DataType::kLists,
+                                                                                        &compaction_filter_stats_);
   list_data_cf_ops.comparator = ListsDataKeyComparator();
 
   rocksdb::BlockBasedTableOptions list_data_cf_table_ops(table_ops);
@@ -106,7 +147,8 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
 
   // set column-family options
   rocksdb::ColumnFamilyOptions set_data_cf_ops(storage_options.options);
-  set_data_cf_ops.compaction_filter_factory = std::make_shared<SetsMemberFilterFactory>(&db_, &handles_, DataType::kSets);
+  set_data_cf_ops.compaction_filter_factory = std::make_shared<SetsMemberFilterFactory>(&db_, &handles_, DataType::kSets,
+                                                                                        &compaction_filter_stats_);
   rocksdb::BlockBasedTableOptions set_data_cf_table_ops(table_ops);
   if (!storage_options.share_block_cache && storage_options.block_cache_size > 0) {
     set_data_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
@@ -116,8 +158,10 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   // zset column-family options
   rocksdb::ColumnFamilyOptions zset_data_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions zset_score_cf_ops(storage_options.options);
-  zset_data_cf_ops.compaction_filter_factory = std::make_shared<ZSetsDataFilterFactory>(&db_, &handles_, DataType::kZSets);
-  zset_score_cf_ops.compaction_filter_factory = std::make_shared<ZSetsScoreFilterFactory>(&db_, &handles_, DataType::kZSets);
+  zset_data_cf_ops.compaction_filter_factory = std::make_shared<ZSetsDataFilterFactory>(&db_, &handles_, DataType::kZSets,
+                                                                                        &compaction_filter_stats_);
+  zset_score_cf_ops.compaction_filter_factory = std::make_shared<ZSetsScoreFilterFactory>(&db_, &handles_, DataType::kZSets,
+                                                                                          &compaction_filter_stats_);
   zset_score_cf_ops.comparator = ZSetsScoreKeyComparator();
 
   rocksdb::BlockBasedTableOptions zset_meta_cf_table_ops(table_ops);
@@ -129,15 +173,34 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   zset_data_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(zset_data_cf_table_ops));
   zset_score_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(zset_score_cf_table_ops));
 
+  // zset rank index shares the key format of zset score cf, its groups put
+  // a level byte in front, see zsets_rank_index.h
+  rocksdb::ColumnFamilyOptions zset_rank_cf_ops(storage_options.options);
+  zset_rank_cf_ops.compaction_filter_factory = std::make_shared<ZSetsScoreFilterFactory>(&db_, &handles_, DataType::kZSets,
+                                                                                         &compaction_filter_stats_);
+  zset_rank_cf_ops.comparator = ZSetsScoreKeyComparator();
+  rocksdb::BlockBasedTableOptions zset_rank_cf_table_ops(table_ops);
+  zset_rank_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(zset_rank_cf_table_ops));
+  rocksdb::ColumnFamilyOptions zset_rank_group_cf_ops(zset_rank_cf_ops);
+  zset_rank_group_cf_ops.compaction_filter_factory =
+      std::make_shared<ZSetsRankGroupFilterFactory>(&db_, &handles_, &compaction_filter_stats_);
+  zset_rank_group_cf_ops.comparator = ZSetsRankGroupKeyComparator();
+
   // stream column-family options
   rocksdb::ColumnFamilyOptions stream_data_cf_ops(storage_options.options);
-  stream_data_cf_ops.compaction_filter_factory = std::make_shared<BaseDataFilterFactory>(&db_, &handles_, DataType::kStreams);
+  stream_data_cf_ops.compaction_filter_factory = std::make_shared<BaseDataFilterFactory>(&db_, &handles_, DataType::kStreams,
+                                                                                         &compaction_filter_stats_);
   rocksdb::BlockBasedTableOptions stream_data_cf_table_ops(table_ops);
   if (!storage_options.share_block_cache && storage_options.block_cache_size > 0) {
     stream_data_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
   }
   stream_data_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(stream_data_cf_table_ops));
 
+  // ttl index column-family options
+  rocksdb::ColumnFamilyOptions ttl_index_cf_ops(storage_options.options);
+  rocksdb::BlockBasedTableOptions ttl_index_cf_table_ops(table_ops);
+  ttl_index_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(ttl_index_cf_table_ops));
+
   std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
   // meta & string cf
   column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, meta_cf_ops);
@@ -152,6 +215,32 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   column_families.emplace_back("zset_score_cf", zset_score_cf_ops);
   // stream CF
   column_families.emplace_back("stream_data_cf", stream_data_cf_ops);
+  // zset rank CF
+  column_families.emplace_back("zset_rank_cf", zset_rank_cf_ops);
+  // ttl index CF, always opened so the handles keep their indexes
+  column_families.emplace_back("ttl_index_cf", ttl_index_cf_ops);
+  // zset rank group CF, the upper levels of zset rank CF
+  column_families.emplace_back("zset_rank_group_cf", zset_rank_group_cf_ops);
+
+  // an existing database keeps the key format it was created with
+  KeyFormat key_format = storage_options.key_format;
+  std::vector<std::string> cf_names;
+  if (rocksdb::DB::ListColumnFamilies(db_ops, db_path, &cf_names).ok()) {
+    bool compact = std::find(cf_names.begin(), cf_names.end(), kCompactKeysCFName) != cf_names.end();
+    key_format = compact ? KeyFormat::kCompact : KeyFormat::kLegacy;
+  }
+  if (key_format == KeyFormat::kCompact) {
+    column_families.emplace_back(kCompactKeysCFName, rocksdb::ColumnFamilyOptions(storage_options.options));
+  }
+  {
+    std::lock_guard l(key_format_mutex);
+    if (key_format_users != 0 && g_key_format.load() != key_format) {
+      return Status::NotSupported("the key format of " + db_path + " differs from the databases already open");
+    }
+    g_key_format.store(key_format);
+    key_format_users++;
+    key_format_user_ = true;
+  }
   return rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
 }
 
@@ -196,6 +285,8 @@ Status Redis::CompactRange(const rocksdb::Slice* begin, const rocksdb::Slice* en
   db_->CompactRange(default_compact_range_options_, handles_[kZsetsDataCF], begin, end);
   db_->CompactRange(default_compact_range_options_, handles_[kZsetsScoreCF], begin, end);
   db_->CompactRange(default_compact_range_options_, handles_[kStreamsDataCF], begin, end);
+  db_->CompactRange(default_compact_range_options_, handles_[kZsetsRankCF], begin, end);
+  db_->CompactRange(default_compact_range_options_, handles_[kZsetsRankGroupCF], begin, end);
   return Status::OK();
 }
 
@@ -204,11 +295,397 @@ Status Redis::SetSmallCompactionThreshold(uint64_t small_compaction_threshold) {
   return Status::OK();
 }
 
+Status Redis::SetHashMaxInline(uint64_t hash_max_inline_entries, uint64_t hash_max_inline_value) {
+  hash_max_inline_entries_ = hash_max_inline_entries;
+  hash_max_inline_value_ = hash_max_inline_value;
+  return Status::OK();
+}
+
+Status Redis::SetSetMaxInline(uint64_t set_max_inline_entries, uint64_t set_max_inline_value) {
+  set_max_inline_entries_ = set_max_inline_entries;
+  set_max_inline_value_ = set_max_inline_value;
+  return Status::OK();
+}
+
 Status Redis::SetSmallCompactionDurationThreshold(uint64_t small_compaction_duration_threshold) {
   small_compaction_duration_threshold_ = small_compaction_duration_threshold;
   return Status::OK();
 }
 
+// The number of reclaim tasks an instance may have queued, collections
+// dropped beyond it are left to the compaction filters
+const uint64_t kMaxPendingReclaims = 10000;
+
+void Redis::AddReclaimTaskIfNeeded(const DataType& dtype, const Slice& key, uint64_t version, uint64_t count) {
+  if (reclaim_min_count_ == 0 || count < reclaim_min_count_) {
+    return;
+  }
+  if (reclaim_stats_.pending.load(std::memory_order_relaxed) >= kMaxPendingReclaims) {
+    reclaim_stats_.skipped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  reclaim_stats_.pending.fetch_add(1, std::memory_order_relaxed);
+  storage_->AddBGTask({dtype, kReclaimRange, {key.ToString(), std::to_string(version)}});
+}
+
+// Gapped lists shorter than this are cheap enough to walk
+const uint64_t kListsRenumberMinCount = 128;
+
+void Redis::AddListsRenumberTaskIfNeeded(const Slice& key, uint64_t count) {
+  if (count < kListsRenumberMinCount) {
+    return;
+  }
+  {
+    std::lock_guard l(lists_renumber_mutex_);
+    if (lists_renumber_pending_.size() >= kMaxPendingReclaims ||
+        !lists_renumber_pending_.insert(key.ToString()).second) {
+      return;
+    }
+  }
+  storage_->AddBGTask({DataType::kLists, kRenumberList, {key.ToString()}});
+}
+
+void Redis::AddZsetsRankBuildTaskIfNeeded(const Slice& key, uint64_t count) {
+  // zsets of one block are walked about as fast as they are looked up
+  if (count < static_cast<uint64_t>(kZSetsRankBlockSize)) {
+    return;
+  }
+  {
+    std::lock_guard l(zsets_rank_build_mutex_);
+    if (zsets_rank_build_pending_.size() >= kMaxPendingReclaims ||
+        !zsets_rank_build_pending_.insert(key.ToString()).second) {
+      return;
+    }
+  }
+  storage_->AddBGTask({DataType::kZSets, kBuildRankIndex, {key.ToString()}});
+}
+
+/*
+ * Every data key of one version of a collection lies in one range of each
+ * of its data cfs, delete the ranges instead of leaving the keys for the
+ * compaction filters to find one by one. The version is no longer referenced
+ * by the meta value and new data is never written under it, so the ranges
+ * can be deleted without the record lock.
+ */
+Status Redis::ReclaimVersion(const DataType& dtype, const Slice& key, uint64_t version) {
+  reclaim_stats_.pending.fetch_sub(1, std::memory_order_relaxed);
+
+  rocksdb::WriteBatch batch;
+  // in the data cfs ordered bytewise, the keys of the version share the
+  // prefix | reserve1 | key | version |, end the range at its successor
+  auto delete_prefix = [&](int cf) {
+    BaseDataKey data_key(key, version, Slice());
+    std::string begin = data_key.EncodeSeekKey().ToString();
+    std::string end = begin;
+    while (!end.empty() && static_cast<uint8_t>(end.back()) == 0xff) {
+      end.pop_back();
+    }
+    if (end.empty()) {
+      return;
+    }
+    end.back() = static_cast<char>(static_cast<uint8_t>(end.back()) + 1);
+    batch.DeleteRange(handles_[cf], begin, end);
+  };
+  // the others compare the version as a number
+  auto delete_score_range = [&](int cf) {
+    ZSetsScoreKey begin(key, version, -std::numeric_limits<double>::infinity(), Slice());
+    ZSetsScoreKey end(key, version + 1, -std::numeric_limits<double>::infinity(), Slice());
+    batch.DeleteRange(handles_[cf], begin.Encode(), end.Encode());
+  };
+
+  switch (dtype) {
+    case DataType::kHashes:
+      delete_prefix(kHashesDataCF);
+      break;
+    case DataType::kSets:
+      delete_prefix(kSetsDataCF);
+      break;
+    case DataType::kZSets:
+      delete_prefix(kZsetsDataCF);
+      delete_score_range(kZsetsScoreCF);
+      ZSetsRankIndex::DeleteVersion(&batch, handles_, key, version);
+      break;
+    case DataType::kLists: {
+      ListsDataKey begin(key, version, 0);
+      ListsDataKey end(key, version + 1, 0);
+      batch.DeleteRange(handles_[kListsDataCF], begin.Encode(), end.Encode());
+      break;
+    }
+    default:
+      return Status::InvalidArgument("type can not be reclaimed");
+  }
+  Status s = CountedWrite(&batch);
+  if (s.ok()) {
+    reclaim_stats_.reclaimed.fetch_add(1, std::memory_order_relaxed);
+  }
+  return s;
+}
+
+void Redis::MultiGet(const rocksdb::ReadOptions& read_options, rocksdb::ColumnFamilyHandle* cf,
+                     const std::vector<std::string>& keys, std::vector<std::string>* values,
+                     std::vector<Status>* statuses) {
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  std::vector<rocksdb::PinnableSlice> pinnable_values(keys.size());
+  statuses->assign(keys.size(), Status::OK());
+  db_->MultiGet(read_options, cf, keys.size(), key_slices.data(), pinnable_values.data(), statuses->data());
+  values->resize(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    if ((*statuses)[i].ok()) {
+      (*values)[i].assign(pinnable_values[i].data(), pinnable_values[i].size());
+    } else {
+      (*values)[i].clear();
+    }
+  }
+}
+
+Status Redis::PutWithTTLIndex(const Slice& key, const Slice& meta_key, const Slice& meta_value, uint64_t etime) {
+  if (!ttl_index_enabled_ || etime == 0) {
+    return CountedPut(meta_key, meta_value);
+  }
+  rocksdb::WriteBatch batch;
+  batch.Put(handles_[kMetaCF], meta_key, meta_value);
+  batch.Put(handles_[kTTLIndexCF], TTLIndexKey(etime, key).Encode(), Slice());
+  return CountedWrite(&batch);
+}
+
+// The last write of each key of kMetaCF in a WriteBatch, nullopt for a delete.
+// Copies the WriteBatch to copy_to too unless it is nullptr.
+class MetaWriteCollector : public rocksdb::WriteBatch::Handler {
+ public:
+  MetaWriteCollector(const std::vector<rocksdb::ColumnFamilyHandle*>& handles, rocksdb::WriteBatch* copy_to)
+      : handles_(handles), meta_cf_id_(handles[kMetaCF]->GetID()), copy_to_(copy_to) {}
+
+  Status PutCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+    if (column_family_id == meta_cf_id_) {
+      writes_[key.ToString()] = value;
+    }
+    return copy_to_ == nullptr ? Status::OK() : copy_to_->Put(Handle(column_family_id), key, value);
+  }
+  Status DeleteCF(uint32_t column_family_id, const Slice& key) override {
+    if (column_family_id == meta_cf_id_) {
+      writes_[key.ToString()] = std::nullopt;
+    }
+    return copy_to_ == nullptr ? Status::OK() : copy_to_->Delete(Handle(column_family_id), key);
+  }
+  Status SingleDeleteCF(uint32_t column_family_id, const Slice& key) override {
+    return DeleteCF(column_family_id, key);
+  }
+  // only used on the data cfs
+  Status DeleteRangeCF(uint32_t column_family_id, const Slice& begin_key, const Slice& end_key) override {
+    return copy_to_ == nullptr ? Status::OK() : copy_to_->DeleteRange(Handle(column_family_id), begin_key, end_key);
+  }
+  Status MergeCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+    return copy_to_ == nullptr ? Status::OK() : copy_to_->Merge(Handle(column_family_id), key, value);
+  }
+
+  // the values point into the WriteBatch
+  const std::map<std::string, std::optional<Slice>>& writes() const { return writes_; }
+
+ private:
+  // the id of a cf is not its index in handles_ when it was added to an existing database
+  rocksdb::ColumnFamilyHandle* Handle(uint32_t column_family_id) const {
+    for (auto handle : handles_) {
+      if (handle->GetID() == column_family_id) {
+        return handle;
+      }
+    }
+    return nullptr;
+  }
+
+  const std::vector<rocksdb::ColumnFamilyHandle*>& handles_;
+  uint32_t meta_cf_id_ = 0;
+  rocksdb::WriteBatch* copy_to_ = nullptr;
+  std::map<std::string, std::optional<Slice>> writes_;
+};
+
+// The counted writes held by Redis::BeginWrites on the calling thread
+struct PendingWrites {
+  rocksdb::WriteBatch batch;
+  // the last meta value written to each key of kMetaCF, nullopt for a delete
+  std::map<std::string, std::optional<std::string>> meta_writes;
+};
+static thread_local std::unordered_map<const Redis*, PendingWrites> pending_writes;
+
+Status Redis::CountedWrite(rocksdb::WriteBatch* batch) {
+  auto pending = pending_writes.find(this);
+  MetaWriteCollector collector(handles_, pending == pending_writes.end() ? nullptr : &pending->second.batch);
+  Status s = batch->Iterate(&collector);
+  if (!s.ok()) {
+    return s;
+  }
+  if (pending != pending_writes.end()) {
+    // the changes are taken at the commit, when the old values are known
+    for (const auto& write : collector.writes()) {
+      pending->second.meta_writes[write.first] =
+          write.second ? std::optional<std::string>(write.second->ToString()) : std::nullopt;
+    }
+    return Status::OK();
+  }
+  std::vector<std::pair<KeyspaceCounters::KeyState, KeyspaceCounters::KeyState>> changes;
+  changes.reserve(collector.writes().size());
+  for (const auto& write : collector.writes()) {
+    rocksdb::PinnableSlice old_value;
+    s = db_->Get(default_read_options_, handles_[kMetaCF], write.first, &old_value);
+    if (!s.ok() && !s.IsNotFound()) {
+      return s;
+    }
+    changes.emplace_back(s.ok() ? KeyspaceCounters::ParseState(old_value) : KeyspaceCounters::KeyState(),
+                         write.second ? KeyspaceCounters::ParseState(*write.second) : KeyspaceCounters::KeyState());
+  }
+  std::shared_lock l(keyspace_scan_rw_);
+  s = db_->Write(default_write_options_, batch);
+  if (s.ok()) {
+    for (const auto& change : changes) {
+      keyspace_counters_.Change(change.first, change.second);
+    }
+  }
+  return s;
+}
+
+Status Redis::CountedPut(const Slice& meta_key, const Slice& meta_value) {
+  rocksdb::WriteBatch batch;
+  batch.Put(handles_[kMetaCF], meta_key, meta_value);
+  return CountedWrite(&batch);
+}
+
+Status Redis::CountedDelete(const Slice& meta_key) {
+  rocksdb::WriteBatch batch;
+  batch.Delete(handles_[kMetaCF], meta_key);
+  return CountedWrite(&batch);
+}
+
+void Redis::BeginWrites() {
+  pending_writes.emplace(this, PendingWrites());
+}
+
+Status Redis::CommitWrites(const std::vector<std::string>& keys) {
+  auto iter = pending_writes.find(this);
+  if (iter == pending_writes.end()) {
+    return Status::OK();
+  }
+  PendingWrites pending = std::move(iter->second);
+  pending_writes.erase(iter);
+  if (pending.batch.Count() == 0) {
+    return Status::OK();
+  }
+
+  // the background writes of these keys, such as the ttl index, went on
+  // while the batch was held
+  MultiScopeRecordLock ml(lock_mgr_, keys);
+  std::vector<std::pair<KeyspaceCounters::KeyState, KeyspaceCounters::KeyState>> changes;
+  changes.reserve(pending.meta_writes.size());
+  for (const auto& write : pending.meta_writes) {
+    rocksdb::PinnableSlice old_value;
+    Status s = db_->Get(default_read_options_, handles_[kMetaCF], write.first, &old_value);
+    if (!s.ok() && !s.IsNotFound()) {
+      return s;
+    }
+    changes.emplace_back(s.ok() ? KeyspaceCounters::ParseState(old_value) : KeyspaceCounters::KeyState(),
+                         write.second ? KeyspaceCounters::ParseState(*write.second) : KeyspaceCounters::KeyState());
+  }
+  std::shared_lock l(keyspace_scan_rw_);
+  Status s = db_->Write(default_write_options_, &pending.batch);
+  if (s.ok()) {
+    for (const auto& change : changes) {
+      keyspace_counters_.Change(change.first, change.second);
+    }
+  }
+  return s;
+}
+
+Status Redis::ActiveExpire(size_t max_keys, uint64_t* expired) {
+  *expired = 0;
+  if (!ttl_index_enabled_) {
+    return Status::OK();
+  }
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  auto now = static_cast<uint64_t>(unix_time);
+
+  // a key is stale once its etime is before now
+  std::string upper_bound = TTLIndexKey(now, Slice()).Encode();
+  Slice upper_bound_slice(upper_bound);
+  rocksdb::ReadOptions read_options;
+  read_options.fill_cache = false;
+  read_options.iterate_upper_bound = &upper_bound_slice;
+
+  std::vector<std::string> index_keys;
+  rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kTTLIndexCF]);
+  for (iter->SeekToFirst(); iter->Valid() && index_keys.size() < max_keys; iter->Next()) {
+    index_keys.push_back(iter->key().ToString());
+  }
+  Status s = iter->status();
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+
+  for (const auto& index_key : index_keys) {
+    ParsedTTLIndexKey parsed_ttl_index_key(index_key);
+    bool key_expired = false;
+    s = ExpireIndexedKey(parsed_ttl_index_key.Key(), parsed_ttl_index_key.Etime(), index_key, now, &key_expired);
+    if (!s.ok()) {
+      return s;
+    }
+    if (key_expired) {
+      (*expired)++;
+    }
+  }
+  active_expired_keys_.fetch_add(*expired, std::memory_order_relaxed);
+  return Status::OK();
+}
+
+Status Redis::ExpireIndexedKey(const Slice& key, uint64_t etime, const std::string& index_key, uint64_t now,
+                               bool* expired) {
+  ScopeRecordLock l(lock_mgr_, key);
+  BaseMetaKey base_meta_key(key);
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+
+  rocksdb::WriteBatch batch;
+  batch.Delete(handles_[kTTLIndexCF], index_key);
+  DataType type = DataType::kNones;
+  uint64_t version = 0;
+  uint64_t count = 0;
+  if (s.ok()) {
+    uint64_t meta_etime = 0;
+    type = GetMetaValueType(meta_value);
+    if (type == DataType::kStrings) {
+      ParsedStringsValue parsed_strings_value(&meta_value);
+      meta_etime = parsed_strings_value.Etime();
+    } else if (type == DataType::kLists) {
+      ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
+      meta_etime = parsed_lists_meta_value.Etime();
+      version = parsed_lists_meta_value.Version();
+      count = parsed_lists_meta_value.Count();
+    } else if (type == DataType::kHashes || type == DataType::kSets || type == DataType::kZSets) {
+      ParsedBaseMetaValue parsed_base_meta_value(&meta_value);
+      meta_etime = parsed_base_meta_value.Etime();
+      version = parsed_base_meta_value.Version();
+      count = parsed_base_meta_value.IsInline() ? 0 : parsed_base_meta_value.Count();
+    }
+    // otherwise the etime was changed since the entry was written,
+    // a newer entry covers the key if it still has one
+    if (meta_etime == etime && meta_etime < now) {
+      if (version >= now) {
+        // same as BaseMetaFilter, a collection created again must get a
+        // version newer than this one, keep the meta value for now
+        return Status::OK();
+      }
+      batch.Delete(handles_[kMetaCF], base_meta_key.Encode());
+      *expired = true;
+    }
+  }
+  s = CountedWrite(&batch);
+  if (s.ok() && *expired && type != DataType::kStrings) {
+    AddReclaimTaskIfNeeded(type, key, version, count);
+  }
+  return s;
+}
+
 Status Redis::UpdateSpecificKeyStatistics(const DataType& dtype, const std::string& key, uint64_t count) {
   if ((statistics_store_->Capacity() != 0U) && (count != 0U) && (small_compaction_threshold_ != 0U)) {
     KeyStatistics data;
@@ -336,6 +813,22 @@ void Redis::GetRocksDBInfo(std::string& info, const char* prefix) {
     write_stream_key_value(rocksdb::DB::Properties::kTotalBlobFileSize, "total_blob_file_size");
     write_stream_key_value(rocksdb::DB::Properties::kLiveBlobFileSize, "live_blob_file_size");
 
+    // meta reads of the data cf compaction filters
+    auto write_atomic_stat = [&](const std::atomic<uint64_t>& stat, const char* metric) {
+      string_stream << prefix << metric << ':' << stat.load(std::memory_order_relaxed) << "\r\n";
+    };
+    write_atomic_stat(compaction_filter_stats_.filtered_keys, "compaction_filter_keys");
+    write_atomic_stat(compaction_filter_stats_.meta_lookups, "compaction_filter_meta_lookups");
+    write_atomic_stat(compaction_filter_stats_.skipped_keys, "compaction_filter_skipped_keys");
+
+    // reclaimed collections
+    write_atomic_stat(reclaim_stats_.pending, "reclaim_pending");
+    write_atomic_stat(reclaim_stats_.reclaimed, "reclaim_done");
+    write_atomic_stat(reclaim_stats_.skipped, "reclaim_skipped");
+
+    // active expiration
+    write_atomic_stat(active_expired_keys_, "active_expired_keys");
+
     // column family stats
     std::map<std::string, std::string> mapvalues;
     db_->rocksdb::DB::GetMapProperty(rocksdb::DB::Properties::kCFStats,&mapvalues);
@@ -364,37 +857,56 @@ Status Redis::GetProperty(const std::string& property, uint64_t* out) {
   return Status::OK();
 }
 
-Status Redis::ScanKeyNum(std::vector<KeyInfo>* key_infos) {
-  key_infos->resize(DataTypeNum);
-  rocksdb::Status s;
-  s = ScanStringsKeyNum(&((*key_infos)[0]));
-  if (!s.ok()) {
-    return s;
-  }
-  s = ScanHashesKeyNum(&((*key_infos)[1]));
-  if (!s.ok()) {
-    return s;
-  }
-  s = ScanListsKeyNum(&((*key_infos)[2]));
-  if (!s.ok()) {
-    return s;
-  }
-  s = ScanZsetsKeyNum(&((*key_infos)[3]));
-  if (!s.ok()) {
-    return s;
+Status Redis::ScanKeyNum(std::vector<KeyInfo>* key_infos, const std::atomic<bool>* stop) {
+  // the writes made since the snapshot are added to the counts of the scan
+  std::unique_lock l(keyspace_scan_rw_);
+  bool reconcile = keyspace_counters_.BeginReconcile();
+  const rocksdb::Snapshot* snapshot;
+  ScopeSnapshot ss(db_, &snapshot);
+  l.unlock();
+
+  KeyspaceCounters scanned;
+  rocksdb::ReadOptions iterator_options;
+  iterator_options.snapshot = snapshot;
+  iterator_options.fill_cache = false;
+
+  rocksdb::Iterator* iter = db_->NewIterator(iterator_options, handles_[kMetaCF]);
+  uint64_t scanned_keys = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    if (stop != nullptr && ++scanned_keys % 1024 == 0 && stop->load()) {
+      break;
+    }
+    scanned.Change(KeyspaceCounters::KeyState(), KeyspaceCounters::ParseState(iter->value()));
   }
-  s = ScanSetsKeyNum(&((*key_infos)[4]));
-  if (!s.ok()) {
-    return s;
+  Status s = iter->status();
+  if (s.ok() && iter->Valid()) {
+    s = Status::Incomplete("scan stopped");
   }
-  s = ScanStreamsKeyNum(&((*key_infos)[5]));
+  delete iter;
   if (!s.ok()) {
+    if (reconcile) {
+      keyspace_counters_.AbortReconcile();
+    }
     return s;
   }
 
+  int64_t curtime;
+  rocksdb::Env::Default()->GetCurrentTime(&curtime);
+  if (!reconcile) {
+    scanned.GetKeyInfos(curtime, key_infos);
+    return Status::OK();
+  }
+  keyspace_counters_.EndReconcile(scanned);
+  keyspace_counters_.GetKeyInfos(curtime, key_infos);
   return Status::OK();
 }
 
+void Redis::GetKeyCounts(std::vector<KeyInfo>* key_infos) {
+  int64_t curtime;
+  rocksdb::Env::Default()->GetCurrentTime(&curtime);
+  keyspace_counters_.GetKeyInfos(curtime, key_infos);
+}
+
 void Redis::ScanDatabase() {
   ScanStrings();
   ScanHashes();
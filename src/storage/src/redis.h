@@ -6,15 +6,21 @@
 #ifndef SRC_REDIS_H_
 #define SRC_REDIS_H_
 
+#include <map>
 #include <memory>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 
+#include "src/base_filter.h"
 #include "src/debug.h"
+#include "src/keyspace_counters.h"
 #include "src/lock_mgr.h"
 #include "src/lru_cache.h"
 #include "src/mutex_impl.h"
@@ -39,6 +45,7 @@ class Redis {
   virtual ~Redis();
 
   rocksdb::DB* GetDB() { return db_; }
+  const std::shared_ptr<LockMgr>& GetLockMgr() { return lock_mgr_; }
 
   struct KeyStatistics {
     size_t window_size;
@@ -108,13 +115,17 @@ class Redis {
 
   virtual Status GetProperty(const std::string& property, uint64_t* out);
 
-  Status ScanKeyNum(std::vector<KeyInfo>* key_info);
-  Status ScanStringsKeyNum(KeyInfo* key_info);
-  Status ScanHashesKeyNum(KeyInfo* key_info);
-  Status ScanListsKeyNum(KeyInfo* key_info);
-  Status ScanZsetsKeyNum(KeyInfo* key_info);
-  Status ScanSetsKeyNum(KeyInfo* key_info);
-  Status ScanStreamsKeyNum(KeyInfo* key_info);
+  // Count the keys of every type in one pass over the meta cf, and
+  // reconcile keyspace_counters_ with the counts, stops once *stop is set
+  Status ScanKeyNum(std::vector<KeyInfo>* key_info, const std::atomic<bool>* stop = nullptr);
+  // The key counts kept by the writes, see KeyspaceCounters
+  void GetKeyCounts(std::vector<KeyInfo>* key_infos);
+
+  // Hold the counted writes of the calling thread in one WriteBatch until
+  // CommitWrites, which writes it under the record locks of keys, the keys
+  // of the held writes. See Storage::BeginWriteBatch
+  void BeginWrites();
+  Status CommitWrites(const std::vector<std::string>& keys);
 
   // Keys Commands
   virtual Status StringsExpire(const Slice& key, int64_t ttl, std::string&& prefetch_meta = {});
@@ -157,6 +168,10 @@ class Redis {
   Status MGet(const Slice& key, std::string* value);
   Status GetWithTTL(const Slice& key, std::string* value, int64_t* ttl);
   Status MGetWithTTL(const Slice& key, std::string* value, int64_t* ttl);
+  // Batched versions of the above, one MultiGet for all the keys,
+  // vss is filled in the order of keys
+  Status MGet(const std::vector<Slice>& keys, std::vector<ValueStatus>* vss);
+  Status MGetWithTTL(const std::vector<Slice>& keys, std::vector<ValueStatus>* vss);
   Status GetBit(const Slice& key, int64_t offset, int32_t* ret);
   Status Getrange(const Slice& key, int64_t start_offset, int64_t end_offset, std::string* ret);
   Status GetrangeWithValue(const Slice& key, int64_t start_offset, int64_t end_offset,
@@ -165,7 +180,10 @@ class Redis {
   Status Incrby(const Slice& key, int64_t value, int64_t* ret);
   Status Incrbyfloat(const Slice& key, const Slice& value, std::string* ret);
   Status MSet(const std::vector<KeyValue>& kvs);
-  Status MSetnx(const std::vector<KeyValue>& kvs, int32_t* ret);
+  // MSETNX spans instances, the caller holds the record locks of the keys
+  // of every instance before any of them is checked or written
+  Status MSetnxCheck(const std::vector<KeyValue>& kvs, bool* exist);
+  Status MSetnxWrite(const std::vector<KeyValue>& kvs);
   Status Set(const Slice& key, const Slice& value);
   Status Setxx(const Slice& key, const Slice& value, int32_t* ret, int64_t ttl = 0);
   Status SetBit(const Slice& key, int64_t offset, int32_t value, int32_t* ret);
@@ -183,6 +201,8 @@ class Redis {
 
   Status Exists(const Slice& key);
   Status Del(const Slice& key);
+  // Delete the keys in one WriteBatch, all or none of them
+  Status Del(const std::vector<std::string>& keys, int64_t* count);
   Status Expire(const Slice& key, int64_t timestamp);
   Status Expireat(const Slice& key, int64_t timestamp);
   Status Persist(const Slice& key);
@@ -218,8 +238,22 @@ class Redis {
 
   Status SetMaxCacheStatisticKeys(size_t max_cache_statistic_keys);
   Status SetSmallCompactionThreshold(uint64_t small_compaction_threshold);
+  Status SetHashMaxInline(uint64_t hash_max_inline_entries, uint64_t hash_max_inline_value);
+  Status SetSetMaxInline(uint64_t set_max_inline_entries, uint64_t set_max_inline_value);
   Status SetSmallCompactionDurationThreshold(uint64_t small_compaction_duration_threshold);
 
+  // Drop the data of a collection version which is no longer referenced by
+  // its meta value, run by the background thread of Storage
+  Status ReclaimVersion(const DataType& dtype, const Slice& key, uint64_t version);
+
+  // Give a gapped list dense indexes again, run by the background thread of Storage
+  Status ListsRenumber(const Slice& key);
+  // Build the rank index of a zset which has none, run by the background thread of Storage
+  Status ZsetsBuildRankIndex(const Slice& key);
+
+  // Delete at most max_keys expired keys found in kTTLIndexCF
+  Status ActiveExpire(size_t max_keys, uint64_t* expired);
+
 
   std::vector<rocksdb::ColumnFamilyHandle*> GetStringCFHandles() { return {handles_[kMetaCF]}; }
 
@@ -236,11 +270,14 @@ class Redis {
   }
 
   std::vector<rocksdb::ColumnFamilyHandle*> GetZsetCFHandles() {
-    return {handles_.begin() + kMetaCF, handles_.begin() + kZsetsScoreCF + 1};
+    std::vector<rocksdb::ColumnFamilyHandle*> zset_handles(handles_.begin() + kMetaCF, handles_.begin() + kZsetsScoreCF + 1);
+    zset_handles.push_back(handles_[kZsetsRankCF]);
+    zset_handles.push_back(handles_[kZsetsRankGroupCF]);
+    return zset_handles;
   }
 
   std::vector<rocksdb::ColumnFamilyHandle*> GetStreamCFHandles() {
-    return {handles_.begin() + kMetaCF, handles_.end()};
+    return {handles_.begin() + kMetaCF, handles_.begin() + kStreamsDataCF + 1};
   }
   void GetRocksDBInfo(std::string &info, const char *prefix);
 
@@ -252,6 +289,7 @@ class Redis {
   Status SInter(const std::vector<std::string>& keys, std::vector<std::string>* members);
   Status SInterstore(const Slice& destination, const std::vector<std::string>& keys, std::vector<std::string>& value_to_dest, int32_t* ret);
   Status SIsmember(const Slice& key, const Slice& member, int32_t* ret);
+  Status SMIsmember(const Slice& key, const std::vector<std::string>& members, std::vector<int32_t>* rets);
   Status SMembers(const Slice& key, std::vector<std::string>* members);
   Status SMembersWithTTL(const Slice& key, std::vector<std::string>* members, int64_t* ttl);
   Status SMove(const Slice& source, const Slice& destination, const Slice& member, int32_t* ret);
@@ -301,6 +339,7 @@ class Redis {
                           int64_t offset, std::vector<ScoreMember>* score_members);
   Status ZRevrank(const Slice& key, const Slice& member, int32_t* rank);
   Status ZScore(const Slice& key, const Slice& member, double* score);
+  Status ZMScore(const Slice& key, const std::vector<std::string>& members, std::vector<ScoreStatus>* sss);
   Status ZGetAll(const Slice& key, double weight, std::map<std::string, double>* value_to_dest);
   Status ZUnionstore(const Slice& destination, const std::vector<std::string>& keys, const std::vector<double>& weights,
                      AGGREGATE agg, std::map<std::string, double>& value_to_dest, int32_t* ret);
@@ -431,6 +470,44 @@ class Redis {
   }
 
 private:
+  // Hashes helpers, see kMetaInlineFlag
+  Status HashesLoadInline(std::string* meta_value, bool exists, bool create,
+                          std::map<std::string, std::string>* fields, bool* is_inline);
+  Status HashesStoreInline(const Slice& key, std::string* meta_value, const std::map<std::string, std::string>& fields,
+                           rocksdb::WriteBatch* batch);
+  rocksdb::Iterator* HashesNewIterator(const rocksdb::ReadOptions& read_options, const Slice& key,
+                                       ParsedHashesMetaValue* parsed_hashes_meta_value);
+
+  // Sets helpers, see kMetaInlineFlag
+  Status SetsLoadInline(std::string* meta_value, bool exists, bool create, std::set<std::string>* members,
+                        bool* is_inline);
+  // meta_value must be an inline or an empty set, members must be unique
+  Status SetsStoreInline(const Slice& key, std::string* meta_value, const std::vector<std::string>& members,
+                         rocksdb::WriteBatch* batch);
+  rocksdb::Iterator* SetsNewIterator(const rocksdb::ReadOptions& read_options, const Slice& key,
+                                     ParsedSetsMetaValue* parsed_sets_meta_value);
+  // One of the sets read by SDIFF, SINTER and SUNION, enough of its meta
+  // value to find its members on either layout
+  struct SetsLookup {
+    std::string key;
+    uint64_t version = 0;
+    bool is_inline = false;
+    std::string payload;
+  };
+  void SetsNewLookup(const Slice& key, ParsedSetsMetaValue* parsed_sets_meta_value, SetsLookup* lookup);
+  Status SetsLookupMember(const rocksdb::ReadOptions& read_options, const SetsLookup& lookup, const Slice& member,
+                          bool* found);
+  rocksdb::Iterator* SetsNewIterator(const rocksdb::ReadOptions& read_options, const SetsLookup& lookup);
+
+  // Lists helpers, see kListsGappedFlag
+  Status ListsLocate(const rocksdb::ReadOptions& read_options, const Slice& key,
+                     ParsedListsMetaValue* parsed_lists_meta_value, uint64_t position, uint64_t* index);
+  Status ListsMakeRoom(const Slice& key, ParsedListsMetaValue* parsed_lists_meta_value, uint64_t position,
+                       uint64_t lower_index, uint64_t upper_index, rocksdb::WriteBatch* batch, uint64_t* target_index);
+
+  Status ZsetsRankByIndex(const rocksdb::ReadOptions& read_options, const Slice& key, uint64_t version,
+                          const Slice& member, int32_t* rank);
+
   Status GenerateStreamID(const StreamMetaValue& stream_meta, StreamAddTrimArgs& args);
 
   Status StreamScanRange(const Slice& key, const uint64_t version, const Slice& id_start, const std::string& id_end,
@@ -483,7 +560,18 @@ private:
   Status GetScanStartPoint(const DataType& type, const Slice& key, const Slice& pattern, int64_t cursor, std::string* start_point);
   Status StoreScanNextPoint(const DataType& type, const Slice& key, const Slice& pattern, int64_t cursor, const std::string& next_point);
 
+  // Counted in the users of g_key_format, see Redis::Open
+  bool key_format_user_ = false;
+
+  // Hashes no larger than these are stored inline in the meta value
+  std::atomic_uint64_t hash_max_inline_entries_ = 0;
+  std::atomic_uint64_t hash_max_inline_value_ = 0;
+  // Sets no larger than these are stored inline in the meta value
+  std::atomic_uint64_t set_max_inline_entries_ = 0;
+  std::atomic_uint64_t set_max_inline_value_ = 0;
+
   // For Statistics
+  CompactionFilterStats compaction_filter_stats_;
   std::atomic_uint64_t small_compaction_threshold_;
   std::atomic_uint64_t small_compaction_duration_threshold_;
   std::unique_ptr<LRUCache<std::string, KeyStatistics>> statistics_store_;
@@ -491,6 +579,48 @@ private:
   Status UpdateSpecificKeyStatistics(const DataType& dtype, const std::string& key, uint64_t count);
   Status UpdateSpecificKeyDuration(const DataType& dtype, const std::string& key, uint64_t duration);
   Status AddCompactKeyTaskIfNeeded(const DataType& dtype, const std::string& key, uint64_t count, uint64_t duration);
+
+  // For reclaiming dropped collections, see ReclaimVersion
+  struct ReclaimStats {
+    std::atomic<uint64_t> pending{0};
+    std::atomic<uint64_t> reclaimed{0};
+    std::atomic<uint64_t> skipped{0};
+  };
+  size_t reclaim_min_count_ = 0;
+  ReclaimStats reclaim_stats_;
+  void AddReclaimTaskIfNeeded(const DataType& dtype, const Slice& key, uint64_t version, uint64_t count);
+
+  // For renumbering gapped lists, see ListsRenumber
+  pstd::Mutex lists_renumber_mutex_;
+  std::unordered_set<std::string> lists_renumber_pending_;
+  void AddListsRenumberTaskIfNeeded(const Slice& key, uint64_t count);
+
+  // For building the rank index of zsets, see ZsetsBuildRankIndex
+  pstd::Mutex zsets_rank_build_mutex_;
+  std::unordered_set<std::string> zsets_rank_build_pending_;
+  void AddZsetsRankBuildTaskIfNeeded(const Slice& key, uint64_t count);
+
+  // For active expiration, see ttl_index_format.h
+  bool ttl_index_enabled_ = false;
+  std::atomic<uint64_t> active_expired_keys_{0};
+  // Read the encoded keys of one column family with a single MultiGet,
+  // values[i] is empty unless statuses[i] is ok
+  void MultiGet(const rocksdb::ReadOptions& read_options, rocksdb::ColumnFamilyHandle* cf,
+                const std::vector<std::string>& keys, std::vector<std::string>* values, std::vector<Status>* statuses);
+  Status PutWithTTLIndex(const Slice& key, const Slice& meta_key, const Slice& meta_value, uint64_t etime);
+
+  // For the key counts of INFO KEYSPACE. Every write of kMetaCF goes through
+  // these, under the record locks of its keys, to apply the change of each
+  // meta value to keyspace_counters_.
+  KeyspaceCounters keyspace_counters_;
+  // held shared by the counted writes from the write to the change, so that
+  // a scan takes its snapshot either before or after each of them
+  std::shared_mutex keyspace_scan_rw_;
+  Status CountedWrite(rocksdb::WriteBatch* batch);
+  Status CountedPut(const Slice& meta_key, const Slice& meta_value);
+  Status CountedDelete(const Slice& meta_key);
+  Status ExpireIndexedKey(const Slice& key, uint64_t etime, const std::string& index_key, uint64_t now,
+                          bool* expired);
 };
 
 }  //  namespace storage
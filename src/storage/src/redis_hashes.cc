@@ -5,6 +5,7 @@
 
 #include "src/redis.h"
 
+#include <map>
 #include <memory>
 
 #include <fmt/core.h>
@@ -16,49 +17,10 @@
 #include "src/scope_snapshot.h"
 #include "src/base_data_key_format.h"
 #include "src/base_data_value_format.h"
+#include "src/inline_fields_format.h"
 #include "storage/util.h"
 
 namespace storage {
-Status Redis::ScanHashesKeyNum(KeyInfo* key_info) {
-  uint64_t keys = 0;
-  uint64_t expires = 0;
-  uint64_t ttl_sum = 0;
-  uint64_t invaild_keys = 0;
-
-  rocksdb::ReadOptions iterator_options;
-  const rocksdb::Snapshot* snapshot;
-  ScopeSnapshot ss(db_, &snapshot);
-  iterator_options.snapshot = snapshot;
-  iterator_options.fill_cache = false;
-
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
-
-  rocksdb::Iterator* iter = db_->NewIterator(iterator_options, handles_[kMetaCF]);
-  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (!ExpectedMetaValue(DataType::kHashes, iter->value().ToString())) {
-      continue;
-    }
-    ParsedHashesMetaValue parsed_hashes_meta_value(iter->value());
-    if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
-      invaild_keys++;
-    } else {
-      keys++;
-      if (!parsed_hashes_meta_value.IsPermanentSurvival()) {
-        expires++;
-        ttl_sum += parsed_hashes_meta_value.Etime() - curtime;
-      }
-    }
-  }
-  delete iter;
-
-  key_info->keys = keys;
-  key_info->expires = expires;
-  key_info->avg_ttl = (expires != 0) ? ttl_sum / expires : 0;
-  key_info->invaild_keys = invaild_keys;
-  return Status::OK();
-}
-
 Status Redis::HDel(const Slice& key, const std::vector<std::string>& fields, int32_t* ret) {
   uint32_t statistic = 0;
   std::vector<std::string> filtered_fields;
@@ -94,6 +56,28 @@ Status Redis::HDel(const Slice& key, const std::vector<std::string>& fields, int
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::map<std::string, std::string> inline_fields;
+  bool is_inline = false;
+  if (s.ok()) {
+    s = HashesLoadInline(&meta_value, true, false, &inline_fields, &is_inline);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (is_inline) {
+    for (const auto& field : filtered_fields) {
+      del_cnt += static_cast<int32_t>(inline_fields.erase(field));
+    }
+    *ret = del_cnt;
+    if (del_cnt == 0) {
+      return Status::OK();
+    }
+    s = HashesStoreInline(key, &meta_value, inline_fields, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
@@ -128,7 +112,7 @@ Status Redis::HDel(const Slice& key, const std::vector<std::string>& fields, int
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kHashes, key.ToString(), statistic);
   return s;
 }
@@ -164,6 +148,10 @@ Status Redis::HGet(const Slice& key, const Slice& field, std::string* value) {
       return Status::NotFound("Stale");
     } else if (parsed_hashes_meta_value.Count() == 0) {
       return Status::NotFound();
+    } else if (parsed_hashes_meta_value.IsInline()) {
+      if (!FindInlineField(parsed_hashes_meta_value.InlinePayload(), field, value)) {
+        return Status::NotFound();
+      }
     } else {
       version = parsed_hashes_meta_value.Version();
       HashesDataKey data_key(key, version, field);
@@ -209,7 +197,7 @@ Status Redis::HGetall(const Slice& key, std::vector<FieldValue>* fvs) {
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         ParsedBaseDataValue parsed_internal_value(iter->value());
@@ -262,7 +250,7 @@ Status Redis::HGetallWithTTL(const Slice& key, std::vector<FieldValue>* fvs, int
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         ParsedBaseDataValue parsed_internal_value(iter->value());
@@ -299,6 +287,34 @@ Status Redis::HIncrby(const Slice& key, const Slice& field, int64_t value, int64
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::map<std::string, std::string> inline_fields;
+  bool is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = HashesLoadInline(&meta_value, s.ok(), true, &inline_fields, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    int64_t ival = 0;
+    auto iter = inline_fields.find(field.ToString());
+    if (iter != inline_fields.end()) {
+      if (StrToInt64(iter->second.data(), iter->second.size(), &ival) == 0) {
+        return Status::Corruption("hash value is not an integer");
+      }
+      if ((value >= 0 && LLONG_MAX - value < ival) || (value < 0 && LLONG_MIN - value > ival)) {
+        return Status::InvalidArgument("Overflow");
+      }
+    }
+    *ret = ival + value;
+    Int64ToStr(value_buf, 32, *ret);
+    inline_fields[field.ToString()] = value_buf;
+    s = HashesStoreInline(key, &meta_value, inline_fields, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
@@ -357,7 +373,7 @@ Status Redis::HIncrby(const Slice& key, const Slice& field, int64_t value, int64
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kHashes, key.ToString(), statistic);
   return s;
 }
@@ -391,6 +407,34 @@ Status Redis::HIncrbyfloat(const Slice& key, const Slice& field, const Slice& by
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::map<std::string, std::string> inline_fields;
+  bool is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = HashesLoadInline(&meta_value, s.ok(), true, &inline_fields, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    auto iter = inline_fields.find(field.ToString());
+    if (iter != inline_fields.end()) {
+      long double old_value;
+      if (StrToLongDouble(iter->second.data(), iter->second.size(), &old_value) == -1) {
+        return Status::Corruption("value is not a vaild float");
+      }
+      if (LongDoubleToStr(old_value + long_double_by, new_value) == -1) {
+        return Status::InvalidArgument("Overflow");
+      }
+    } else {
+      LongDoubleToStr(long_double_by, new_value);
+    }
+    inline_fields[field.ToString()] = *new_value;
+    s = HashesStoreInline(key, &meta_value, inline_fields, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
@@ -449,7 +493,7 @@ Status Redis::HIncrbyfloat(const Slice& key, const Slice& field, const Slice& by
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kHashes, key.ToString(), statistic);
   return s;
 }
@@ -486,7 +530,7 @@ Status Redis::HKeys(const Slice& key, std::vector<std::string>* fields) {
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         fields->push_back(parsed_hashes_data_key.field().ToString());
@@ -564,20 +608,36 @@ Status Redis::HMGet(const Slice& key, const std::vector<std::string>& fields, st
         vss->push_back({std::string(), Status::NotFound()});
       }
       return Status::NotFound(is_stale ? "Stale" : "");
+    } else if (parsed_hashes_meta_value.IsInline()) {
+      Slice payload = parsed_hashes_meta_value.InlinePayload();
+      for (const auto& field : fields) {
+        if (FindInlineField(payload, field, &value)) {
+          vss->push_back({value, Status::OK()});
+        } else {
+          vss->push_back({std::string(), Status::NotFound()});
+        }
+      }
     } else {
       version = parsed_hashes_meta_value.Version();
+      std::vector<std::string> data_keys;
+      data_keys.reserve(fields.size());
       for (const auto& field : fields) {
         HashesDataKey hashes_data_key(key, version, field);
-        s = db_->Get(read_options, handles_[kHashesDataCF], hashes_data_key.Encode(), &value);
-        if (s.ok()) {
-          ParsedBaseDataValue parsed_internal_value(&value);
+        data_keys.push_back(hashes_data_key.Encode().ToString());
+      }
+      std::vector<std::string> values;
+      std::vector<Status> statuses;
+      MultiGet(read_options, handles_[kHashesDataCF], data_keys, &values, &statuses);
+      for (size_t idx = 0; idx < fields.size(); ++idx) {
+        if (statuses[idx].ok()) {
+          ParsedBaseDataValue parsed_internal_value(&values[idx]);
           parsed_internal_value.StripSuffix();
-          vss->push_back({value, Status::OK()});
-        } else if (s.IsNotFound()) {
+          vss->push_back({std::move(values[idx]), Status::OK()});
+        } else if (statuses[idx].IsNotFound()) {
           vss->push_back({std::string(), Status::NotFound()});
         } else {
           vss->clear();
-          return s;
+          return statuses[idx];
         }
       }
     }
@@ -621,6 +681,24 @@ Status Redis::HMSet(const Slice& key, const std::vector<FieldValue>& fvs) {
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::map<std::string, std::string> inline_fields;
+  bool is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = HashesLoadInline(&meta_value, s.ok(), true, &inline_fields, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    for (const auto& fv : filtered_fvs) {
+      inline_fields[fv.field] = fv.value;
+    }
+    s = HashesStoreInline(key, &meta_value, inline_fields, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
@@ -670,7 +748,7 @@ Status Redis::HMSet(const Slice& key, const std::vector<FieldValue>& fvs) {
       batch.Put(handles_[kHashesDataCF], hashes_data_key.Encode(), inter_value.Encode());
     }
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kHashes, key.ToString(), statistic);
   return s;
 }
@@ -696,6 +774,27 @@ Status Redis::HSet(const Slice& key, const Slice& field, const Slice& value, int
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::map<std::string, std::string> inline_fields;
+  bool is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = HashesLoadInline(&meta_value, s.ok(), true, &inline_fields, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    auto iter = inline_fields.find(field.ToString());
+    *res = iter == inline_fields.end() ? 1 : 0;
+    if (iter != inline_fields.end() && value.compare(iter->second) == 0) {
+      return Status::OK();
+    }
+    inline_fields[field.ToString()] = value.ToString();
+    s = HashesStoreInline(key, &meta_value, inline_fields, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
@@ -745,7 +844,7 @@ Status Redis::HSet(const Slice& key, const Slice& field, const Slice& value, int
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kHashes, key.ToString(), statistic);
   return s;
 }
@@ -771,6 +870,27 @@ Status Redis::HSetnx(const Slice& key, const Slice& field, const Slice& value, i
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::map<std::string, std::string> inline_fields;
+  bool is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = HashesLoadInline(&meta_value, s.ok(), true, &inline_fields, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    if (inline_fields.find(field.ToString()) != inline_fields.end()) {
+      *ret = 0;
+      return Status::OK();
+    }
+    inline_fields[field.ToString()] = value.ToString();
+    *ret = 1;
+    s = HashesStoreInline(key, &meta_value, inline_fields, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.Count() == 0) {
@@ -810,7 +930,7 @@ Status Redis::HSetnx(const Slice& key, const Slice& field, const Slice& value, i
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
 Status Redis::HVals(const Slice& key, std::vector<std::string>* values) {
@@ -845,7 +965,7 @@ Status Redis::HVals(const Slice& key, std::vector<std::string>* values) {
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedBaseDataValue parsed_internal_value(iter->value());
         values->push_back(parsed_internal_value.UserValue().ToString());
@@ -921,7 +1041,7 @@ Status Redis::HScan(const Slice& key, int64_t cursor, const std::string& pattern
       HashesDataKey hashes_start_data_key(key, version, start_point);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      rocksdb::Iterator* iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(hashes_start_data_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -985,7 +1105,7 @@ Status Redis::HScanx(const Slice& key, const std::string& start_field, const std
       HashesDataKey hashes_start_data_key(key, version, start_field);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      rocksdb::Iterator* iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(hashes_start_data_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -1054,7 +1174,7 @@ Status Redis::PKHScanRange(const Slice& key, const Slice& field_start, const std
       HashesDataKey hashes_start_data_key(key, version, field_start);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      rocksdb::Iterator* iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->Seek(start_no_limit ? prefix : hashes_start_data_key.Encode());
            iter->Valid() && remain > 0 && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -1127,7 +1247,7 @@ Status Redis::PKHRScanRange(const Slice& key, const Slice& field_start, const st
       HashesDataKey hashes_start_data_key(key, start_key_version, start_key_field);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      rocksdb::Iterator* iter = HashesNewIterator(read_options, key, &parsed_hashes_meta_value);
       for (iter->SeekForPrev(hashes_start_data_key.Encode().ToString());
            iter->Valid() && remain > 0 && iter->key().starts_with(prefix); iter->Prev()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -1187,10 +1307,16 @@ Status Redis::HashesExpire(const Slice& key, int64_t ttl, std::string&& prefetch
 
     if (ttl > 0) {
       parsed_hashes_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_hashes_meta_value.Etime());
     } else {
+      uint64_t count = parsed_hashes_meta_value.Count();
+      uint64_t version = parsed_hashes_meta_value.Version();
+      bool is_inline = parsed_hashes_meta_value.IsInline();
       parsed_hashes_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_hashes_meta_value.Etime());
+      if (s.ok() && !is_inline) {
+        AddReclaimTaskIfNeeded(DataType::kHashes, key, version, count);
+      }
     }
   }
   return s;
@@ -1225,9 +1351,14 @@ Status Redis::HashesDel(const Slice& key, std::string&& prefetch_meta) {
       return Status::NotFound();
     } else {
       uint32_t statistic = parsed_hashes_meta_value.Count();
+      uint64_t version = parsed_hashes_meta_value.Version();
+      bool is_inline = parsed_hashes_meta_value.IsInline();
       parsed_hashes_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = CountedPut(base_meta_key.Encode(), meta_value);
       UpdateSpecificKeyStatistics(DataType::kHashes, key.ToString(), statistic);
+      if (s.ok() && !is_inline) {
+        AddReclaimTaskIfNeeded(DataType::kHashes, key, version, statistic);
+      }
     }
   }
   return s;
@@ -1261,12 +1392,18 @@ Status Redis::HashesExpireat(const Slice& key, int64_t timestamp, std::string&&
     } else if (parsed_hashes_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
+      uint64_t count = parsed_hashes_meta_value.Count();
+      uint64_t version = parsed_hashes_meta_value.Version();
+      bool is_inline = parsed_hashes_meta_value.IsInline();
       if (timestamp > 0) {
         parsed_hashes_meta_value.SetEtime(static_cast<uint64_t>(timestamp));
       } else {
         parsed_hashes_meta_value.InitialMetaValue();
       }
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_hashes_meta_value.Etime());
+      if (s.ok() && timestamp <= 0 && !is_inline) {
+        AddReclaimTaskIfNeeded(DataType::kHashes, key, version, count);
+      }
     }
   }
   return s;
@@ -1305,7 +1442,7 @@ Status Redis::HashesPersist(const Slice& key, std::string&& prefetch_meta) {
         return Status::NotFound("Not have an associated timeout");
       } else {
         parsed_hashes_meta_value.SetEtime(0);
-        s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+        s = CountedPut(base_meta_key.Encode(), meta_value);
       }
     }
   }
@@ -1356,6 +1493,83 @@ Status Redis::HashesTTL(const Slice& key, int64_t* timestamp, std::string&& pref
   return s;
 }
 
+Status Redis::HashesLoadInline(std::string* meta_value, bool exists, bool create,
+                               std::map<std::string, std::string>* fields, bool* is_inline) {
+  *is_inline = false;
+  if (exists) {
+    ParsedHashesMetaValue parsed_hashes_meta_value(meta_value);
+    if (!parsed_hashes_meta_value.IsStale() && parsed_hashes_meta_value.Count() != 0) {
+      if (!parsed_hashes_meta_value.IsInline()) {
+        return Status::OK();
+      }
+      if (!DecodeInlineFields(parsed_hashes_meta_value.InlinePayload(), fields)) {
+        return Status::Corruption("invalid inline hash");
+      }
+      *is_inline = true;
+      return Status::OK();
+    }
+    if (!create) {
+      return Status::OK();
+    }
+    // an empty hash starts over, with or without the inline layout
+    parsed_hashes_meta_value.InitialMetaValue();
+    if (hash_max_inline_entries_ != 0) {
+      parsed_hashes_meta_value.SetInline(true);
+      *is_inline = true;
+    }
+  } else if (create && hash_max_inline_entries_ != 0) {
+    char meta_value_buf[4] = {0};
+    HashesMetaValue hashes_meta_value(DataType::kHashes, Slice(meta_value_buf, 4));
+    hashes_meta_value.UpdateVersion();
+    hashes_meta_value.SetInline(true);
+    *meta_value = hashes_meta_value.Encode().ToString();
+    *is_inline = true;
+  }
+  return Status::OK();
+}
+
+Status Redis::HashesStoreInline(const Slice& key, std::string* meta_value,
+                                const std::map<std::string, std::string>& fields, rocksdb::WriteBatch* batch) {
+  ParsedHashesMetaValue parsed_hashes_meta_value(meta_value);
+  if (!parsed_hashes_meta_value.check_set_count(fields.size())) {
+    return Status::InvalidArgument("hash size overflow");
+  }
+  parsed_hashes_meta_value.SetCount(static_cast<int32_t>(fields.size()));
+
+  bool fit = fields.size() <= hash_max_inline_entries_;
+  for (auto iter = fields.begin(); fit && iter != fields.end(); ++iter) {
+    fit = iter->first.size() <= hash_max_inline_value_ && iter->second.size() <= hash_max_inline_value_;
+  }
+  if (fit) {
+    std::string payload;
+    EncodeInlineFields(fields, &payload);
+    parsed_hashes_meta_value.SetInlinePayload(payload);
+  } else {
+    // the hash outgrew the inline layout, move every field to kHashesDataCF,
+    // it never goes back to inline until it is emptied
+    uint64_t version = parsed_hashes_meta_value.Version();
+    for (const auto& fv : fields) {
+      HashesDataKey hashes_data_key(key, version, fv.first);
+      BaseDataValue inter_value(fv.second);
+      batch->Put(handles_[kHashesDataCF], hashes_data_key.Encode(), inter_value.Encode());
+    }
+    parsed_hashes_meta_value.SetInline(false);
+    parsed_hashes_meta_value.SetInlinePayload(Slice());
+  }
+  BaseMetaKey base_meta_key(key);
+  batch->Put(handles_[kMetaCF], base_meta_key.Encode(), *meta_value);
+  return Status::OK();
+}
+
+rocksdb::Iterator* Redis::HashesNewIterator(const rocksdb::ReadOptions& read_options, const Slice& key,
+                                            ParsedHashesMetaValue* parsed_hashes_meta_value) {
+  if (parsed_hashes_meta_value->IsInline()) {
+    return new InlineFieldsIterator(key, parsed_hashes_meta_value->Version(),
+                                    parsed_hashes_meta_value->InlinePayload());
+  }
+  return db_->NewIterator(read_options, handles_[kHashesDataCF]);
+}
+
 void Redis::ScanHashes() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
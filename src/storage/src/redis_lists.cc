@@ -3,6 +3,7 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <limits>
 #include <memory>
 
 #include <fmt/core.h>
@@ -18,46 +19,6 @@
 #include "src/debug.h"
 
 namespace storage {
-Status Redis::ScanListsKeyNum(KeyInfo* key_info) {
-  uint64_t keys = 0;
-  uint64_t expires = 0;
-  uint64_t ttl_sum = 0;
-  uint64_t invaild_keys = 0;
-
-  rocksdb::ReadOptions iterator_options;
-  const rocksdb::Snapshot* snapshot;
-  ScopeSnapshot ss(db_, &snapshot);
-  iterator_options.snapshot = snapshot;
-  iterator_options.fill_cache = false;
-
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
-
-  rocksdb::Iterator* iter = db_->NewIterator(iterator_options, handles_[kMetaCF]);
-  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (!ExpectedMetaValue(DataType::kLists, iter->value().ToString())) {
-      continue;
-    }
-    ParsedListsMetaValue parsed_lists_meta_value(iter->value());
-    if (parsed_lists_meta_value.IsStale() || parsed_lists_meta_value.Count() == 0) {
-      invaild_keys++;
-    } else {
-      keys++;
-      if (!parsed_lists_meta_value.IsPermanentSurvival()) {
-        expires++;
-        ttl_sum += parsed_lists_meta_value.Etime() - curtime;
-      }
-    }
-  }
-  delete iter;
-
-  key_info->keys = keys;
-  key_info->expires = expires;
-  key_info->avg_ttl = (expires != 0) ? ttl_sum / expires : 0;
-  key_info->invaild_keys = invaild_keys;
-  return Status::OK();
-}
-
 Status Redis::LIndex(const Slice& key, int64_t index, std::string* element) {
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
@@ -86,18 +47,22 @@ Status Redis::LIndex(const Slice& key, int64_t index, std::string* element) {
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t target_index =
-          index >= 0 ? parsed_lists_meta_value.LeftIndex() + index + 1 : parsed_lists_meta_value.RightIndex() + index;
-      if (parsed_lists_meta_value.LeftIndex() < target_index && target_index < parsed_lists_meta_value.RightIndex()) {
-        ListsDataKey lists_data_key(key, version, target_index);
-        s = db_->Get(read_options, handles_[kListsDataCF], lists_data_key.Encode(), element);
-        if (s.ok()) {
-          ParsedBaseDataValue parsed_value(element);
-          parsed_value.StripSuffix();
-        }
-      } else {
+      auto count = static_cast<int64_t>(parsed_lists_meta_value.Count());
+      int64_t position = index >= 0 ? index : count + index;
+      if (position < 0 || position >= count) {
         return Status::NotFound();
       }
+      uint64_t target_index = 0;
+      s = ListsLocate(read_options, key, &parsed_lists_meta_value, position, &target_index);
+      if (!s.ok()) {
+        return s;
+      }
+      ListsDataKey lists_data_key(key, version, target_index);
+      s = db_->Get(read_options, handles_[kListsDataCF], lists_data_key.Encode(), element);
+      if (s.ok()) {
+        ParsedBaseDataValue parsed_value(element);
+        parsed_value.StripSuffix();
+      }
     }
   }
   return s;
@@ -131,84 +96,65 @@ Status Redis::LInsert(const Slice& key, const BeforeOrAfter& before_or_after, co
     } else {
       bool find_pivot = false;
       uint64_t pivot_index = 0;
+      uint64_t position = 0;
+      uint64_t count = parsed_lists_meta_value.Count();
       uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t current_index = parsed_lists_meta_value.LeftIndex() + 1;
+      uint64_t lower_index = parsed_lists_meta_value.LeftIndex();
+      uint64_t upper_index = parsed_lists_meta_value.RightIndex();
       rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-      ListsDataKey start_data_key(key, version, current_index);
-      for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_index < parsed_lists_meta_value.RightIndex();
-           iter->Next(), current_index++) {
+      ListsDataKey start_data_key(key, version, parsed_lists_meta_value.LeftIndex() + 1);
+      for (iter->Seek(start_data_key.Encode()); iter->Valid() && position < count; iter->Next(), position++) {
         ParsedBaseDataValue parsed_value(iter->value());
         if (pivot.compare(parsed_value.UserValue().ToString()) == 0) {
           find_pivot = true;
-          pivot_index = current_index;
+          pivot_index = ParsedListsDataKey(iter->key()).index();
           break;
         }
       }
+      // the new element goes between lower_index and upper_index, which are
+      // the indexes of its neighbours or the bounds of the list
+      if (find_pivot) {
+        if (before_or_after == Before) {
+          upper_index = pivot_index;
+          if (position != 0) {
+            iter->Prev();
+            lower_index = ParsedListsDataKey(iter->key()).index();
+          }
+        } else {
+          lower_index = pivot_index;
+          position++;
+          if (position != count) {
+            iter->Next();
+            upper_index = ParsedListsDataKey(iter->key()).index();
+          }
+        }
+      }
       delete iter;
       if (!find_pivot) {
         *ret = -1;
         return Status::NotFound();
       } else {
         uint64_t target_index;
-        std::vector<std::string> list_nodes;
-        uint64_t mid_index = parsed_lists_meta_value.LeftIndex() +
-                             (parsed_lists_meta_value.RightIndex() - parsed_lists_meta_value.LeftIndex()) / 2;
-        if (pivot_index <= mid_index) {
-          target_index = (before_or_after == Before) ? pivot_index - 1 : pivot_index;
-          current_index = parsed_lists_meta_value.LeftIndex() + 1;
-          rocksdb::Iterator* first_half_iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          ListsDataKey start_data_key(key, version, current_index);
-          for (first_half_iter->Seek(start_data_key.Encode()); first_half_iter->Valid() && current_index <= pivot_index;
-               first_half_iter->Next(), current_index++) {
-            ParsedBaseDataValue parsed_value(first_half_iter->value());
-            if (current_index == pivot_index) {
-              if (before_or_after == After) {
-                list_nodes.push_back(parsed_value.UserValue().ToString());
-              }
-              break;
-            }
-            list_nodes.push_back(parsed_value.UserValue().ToString());
-          }
-          delete first_half_iter;
-
-          current_index = parsed_lists_meta_value.LeftIndex();
-          for (const auto& node : list_nodes) {
-            ListsDataKey lists_data_key(key, version, current_index++);
-            BaseDataValue i_val(node);
-            batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-          }
-          parsed_lists_meta_value.ModifyLeftIndex(1);
+        if (upper_index - lower_index >= 2) {
+          target_index = lower_index + (upper_index - lower_index) / 2;
         } else {
-          target_index = (before_or_after == Before) ? pivot_index : pivot_index + 1;
-          current_index = pivot_index;
-          rocksdb::Iterator* after_half_iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          ListsDataKey start_data_key(key, version, current_index);
-          for (after_half_iter->Seek(start_data_key.Encode());
-               after_half_iter->Valid() && current_index < parsed_lists_meta_value.RightIndex();
-               after_half_iter->Next(), current_index++) {
-            if (current_index == pivot_index && before_or_after == BeforeOrAfter::After) {
-              continue;
-            }
-            ParsedBaseDataValue parsed_value(after_half_iter->value());
-            list_nodes.push_back(parsed_value.UserValue().ToString());
-          }
-          delete after_half_iter;
-
-          current_index = target_index + 1;
-          for (const auto& node : list_nodes) {
-            ListsDataKey lists_data_key(key, version, current_index++);
-            BaseDataValue i_val(node);
-            batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
+          s = ListsMakeRoom(key, &parsed_lists_meta_value, position, lower_index, upper_index, &batch, &target_index);
+          if (!s.ok()) {
+            return s;
           }
-          parsed_lists_meta_value.ModifyRightIndex(1);
         }
+        parsed_lists_meta_value.SetGapped(true);
         parsed_lists_meta_value.ModifyCount(1);
         batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
         ListsDataKey lists_target_key(key, version, target_index);
         BaseDataValue i_val(value);
         batch.Put(handles_[kListsDataCF], lists_target_key.Encode(), i_val.Encode());
         *ret = static_cast<int32_t>(parsed_lists_meta_value.Count());
-        return db_->Write(default_write_options_, &batch);
+        s = CountedWrite(&batch);
+        if (s.ok()) {
+          AddListsRenumberTaskIfNeeded(key, parsed_lists_meta_value.Count());
+        }
+        return s;
       }
     }
   } else if (s.IsNotFound()) {
@@ -294,14 +240,14 @@ Status Redis::LPop(const Slice& key, int64_t count, std::vector<std::string>* el
         batch.Delete(handles_[kListsDataCF],iter->key());
 
         parsed_lists_meta_value.ModifyCount(-1);
-        parsed_lists_meta_value.ModifyLeftIndex(-1);
+        parsed_lists_meta_value.set_left_index(ParsedListsDataKey(iter->key()).index());
       }
       batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
       delete iter;
     }
   }
   if (batch.Count() != 0U) {
-    s = db_->Write(default_write_options_, &batch);
+    s = CountedWrite(&batch);
     if (s.ok()) {
       batch.Clear();
     }
@@ -338,9 +284,10 @@ Status Redis::LPush(const Slice& key, const std::vector<std::string>& values, ui
     } else {
       version = parsed_lists_meta_value.Version();
     }
+    uint64_t step = parsed_lists_meta_value.IndexStep();
     for (const auto& value : values) {
       index = parsed_lists_meta_value.LeftIndex();
-      parsed_lists_meta_value.ModifyLeftIndex(1);
+      parsed_lists_meta_value.ModifyLeftIndex(step);
       parsed_lists_meta_value.ModifyCount(1);
       ListsDataKey lists_data_key(key, version, index);
       BaseDataValue i_val(value);
@@ -355,17 +302,17 @@ Status Redis::LPush(const Slice& key, const std::vector<std::string>& values, ui
     version = lists_meta_value.UpdateVersion();
     for (const auto& value : values) {
       index = lists_meta_value.LeftIndex();
-      lists_meta_value.ModifyLeftIndex(1);
+      lists_meta_value.ModifyLeftIndex(kListsIndexStep);
       ListsDataKey lists_data_key(key, version, index);
       BaseDataValue i_val(value);
       batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
     }
     batch.Put(handles_[kMetaCF], base_meta_key.Encode(), lists_meta_value.Encode());
-    *ret = lists_meta_value.RightIndex() - lists_meta_value.LeftIndex() - 1;
+    *ret = values.size();
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
 Status Redis::LPushx(const Slice& key, const std::vector<std::string>& values, uint64_t* len) {
@@ -395,17 +342,18 @@ Status Redis::LPushx(const Slice& key, const std::vector<std::string>& values, u
       return Status::NotFound();
     } else {
       uint64_t version = parsed_lists_meta_value.Version();
+      uint64_t step = parsed_lists_meta_value.IndexStep();
       for (const auto& value : values) {
         uint64_t index = parsed_lists_meta_value.LeftIndex();
         parsed_lists_meta_value.ModifyCount(1);
-        parsed_lists_meta_value.ModifyLeftIndex(1);
+        parsed_lists_meta_value.ModifyLeftIndex(step);
         ListsDataKey lists_data_key(key, version, index);
         BaseDataValue i_val(value);
         batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
       }
       batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
       *len = parsed_lists_meta_value.Count();
-      return db_->Write(default_write_options_, &batch);
+      return CountedWrite(&batch);
     }
   }
   return s;
@@ -439,26 +387,29 @@ Status Redis::LRange(const Slice& key, int64_t start, int64_t stop, std::vector<
       return Status::NotFound();
     } else {
       uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + 1;
-      uint64_t origin_right_index = parsed_lists_meta_value.RightIndex() - 1;
-      uint64_t sublist_left_index = start >= 0 ? origin_left_index + start : origin_right_index + start + 1;
-      uint64_t sublist_right_index = stop >= 0 ? origin_left_index + stop : origin_right_index + stop + 1;
+      auto count = static_cast<int64_t>(parsed_lists_meta_value.Count());
+      int64_t start_position = start >= 0 ? start : count + start;
+      int64_t stop_position = stop >= 0 ? stop : count + stop;
 
-      if (sublist_left_index > sublist_right_index || sublist_left_index > origin_right_index ||
-          sublist_right_index < origin_left_index) {
+      if (start_position > stop_position || start_position >= count || stop_position < 0) {
         return Status::OK();
       } else {
-        if (sublist_left_index < origin_left_index) {
-          sublist_left_index = origin_left_index;
+        if (start_position < 0) {
+          start_position = 0;
         }
-        if (sublist_right_index > origin_right_index) {
-          sublist_right_index = origin_right_index;
+        if (stop_position >= count) {
+          stop_position = count - 1;
+        }
+        uint64_t start_index = 0;
+        s = ListsLocate(read_options, key, &parsed_lists_meta_value, start_position, &start_index);
+        if (!s.ok()) {
+          return s;
         }
         rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
-        uint64_t current_index = sublist_left_index;
-        ListsDataKey start_data_key(key, version, current_index);
-        for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_index <= sublist_right_index;
-             iter->Next(), current_index++) {
+        int64_t current_position = start_position;
+        ListsDataKey start_data_key(key, version, start_index);
+        for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_position <= stop_position;
+             iter->Next(), current_position++) {
           ParsedBaseDataValue parsed_value(iter->value());
           ret->push_back(parsed_value.UserValue().ToString());
         }
@@ -509,28 +460,32 @@ Status Redis::LRangeWithTTL(const Slice& key, int64_t start, int64_t stop, std::
       }
 
       uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + 1;
-      uint64_t origin_right_index = parsed_lists_meta_value.RightIndex() - 1;
-      uint64_t sublist_left_index = start >= 0 ? origin_left_index + start : origin_right_index + start + 1;
-      uint64_t sublist_right_index = stop >= 0 ? origin_left_index + stop : origin_right_index + stop + 1;
-
-      if (sublist_left_index > sublist_right_index
-          || sublist_left_index > origin_right_index
-          || sublist_right_index < origin_left_index) {
+      auto count = static_cast<int64_t>(parsed_lists_meta_value.Count());
+      int64_t start_position = start >= 0 ? start : count + start;
+      int64_t stop_position = stop >= 0 ? stop : count + stop;
+
+      if (start_position > stop_position
+          || start_position >= count
+          || stop_position < 0) {
         return Status::OK();
       } else {
-        if (sublist_left_index < origin_left_index) {
-          sublist_left_index = origin_left_index;
+        if (start_position < 0) {
+          start_position = 0;
         }
-        if (sublist_right_index > origin_right_index) {
-          sublist_right_index = origin_right_index;
+        if (stop_position >= count) {
+          stop_position = count - 1;
+        }
+        uint64_t start_index = 0;
+        s = ListsLocate(read_options, key, &parsed_lists_meta_value, start_position, &start_index);
+        if (!s.ok()) {
+          return s;
         }
         rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
-        uint64_t current_index = sublist_left_index;
-        ListsDataKey start_data_key(key, version, current_index);
+        int64_t current_position = start_position;
+        ListsDataKey start_data_key(key, version, start_index);
         for (iter->Seek(start_data_key.Encode());
-             iter->Valid() && current_index <= sublist_right_index;
-             iter->Next(), current_index++) {
+             iter->Valid() && current_position <= stop_position;
+             iter->Next(), current_position++) {
           ParsedBaseDataValue parsed_value(iter->value());
           ret->push_back(parsed_value.UserValue().ToString());
         }
@@ -568,106 +523,52 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t current_index;
-      std::vector<uint64_t> target_index;
-      std::vector<uint64_t> delete_index;
+      uint64_t current_position = 0;
+      std::vector<std::string> target_keys;
       uint64_t rest = (count < 0) ? -count : count;
       uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t start_index = parsed_lists_meta_value.LeftIndex() + 1;
-      uint64_t stop_index = parsed_lists_meta_value.RightIndex() - 1;
-      ListsDataKey start_data_key(key, version, start_index);
-      ListsDataKey stop_data_key(key, version, stop_index);
+      uint64_t list_count = parsed_lists_meta_value.Count();
+      ListsDataKey start_data_key(key, version, parsed_lists_meta_value.LeftIndex() + 1);
+      ListsDataKey stop_data_key(key, version, parsed_lists_meta_value.RightIndex() - 1);
+      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
       if (count >= 0) {
-        current_index = start_index;
-        rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-        for (iter->Seek(start_data_key.Encode());
-             iter->Valid() && current_index <= stop_index && ((count == 0) || rest != 0);
-             iter->Next(), current_index++) {
-          ParsedBaseDataValue parsed_value(iter->value());
-          if (value.compare(parsed_value.UserValue()) == 0) {
-            target_index.push_back(current_index);
-            if (count != 0) {
-              rest--;
-            }
-          }
-        }
-        delete iter;
+        iter->Seek(start_data_key.Encode());
       } else {
-        current_index = stop_index;
-        rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-        for (iter->Seek(stop_data_key.Encode());
-             iter->Valid() && current_index >= start_index && ((count == 0) || rest != 0);
-             iter->Prev(), current_index--) {
-          ParsedBaseDataValue parsed_value(iter->value());
-          if (value.compare(parsed_value.UserValue()) == 0) {
-            target_index.push_back(current_index);
-            if (count != 0) {
-              rest--;
-            }
+        iter->SeekForPrev(stop_data_key.Encode());
+      }
+      for (; iter->Valid() && current_position < list_count && ((count == 0) || rest != 0); current_position++) {
+        ParsedBaseDataValue parsed_value(iter->value());
+        if (value.compare(parsed_value.UserValue()) == 0) {
+          target_keys.push_back(iter->key().ToString());
+          if (count != 0) {
+            rest--;
           }
         }
-        delete iter;
+        if (count >= 0) {
+          iter->Next();
+        } else {
+          iter->Prev();
+        }
       }
-      if (target_index.empty()) {
+      delete iter;
+      if (target_keys.empty()) {
         *ret = 0;
         return Status::NotFound();
       } else {
-        rest = target_index.size();
-        uint64_t sublist_left_index = (count >= 0) ? target_index[0] : target_index[target_index.size() - 1];
-        uint64_t sublist_right_index = (count >= 0) ? target_index[target_index.size() - 1] : target_index[0];
-        uint64_t left_part_len = sublist_right_index - start_index;
-        uint64_t right_part_len = stop_index - sublist_left_index;
-        if (left_part_len <= right_part_len) {
-          uint64_t left = sublist_right_index;
-          current_index = sublist_right_index;
-          ListsDataKey sublist_right_key(key, version, sublist_right_index);
-          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          for (iter->Seek(sublist_right_key.Encode()); iter->Valid() && current_index >= start_index;
-               iter->Prev(), current_index--) {
-            ParsedBaseDataValue parsed_value(iter->value());
-            if (value.compare(parsed_value.UserValue()) == 0 && rest > 0) {
-              rest--;
-            } else {
-              ListsDataKey lists_data_key(key, version, left--);
-              batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), iter->value());
-            }
-          }
-          delete iter;
-          uint64_t left_index = parsed_lists_meta_value.LeftIndex();
-          for (uint64_t idx = 0; idx < target_index.size(); ++idx) {
-            delete_index.push_back(left_index + idx + 1);
-          }
-          parsed_lists_meta_value.ModifyLeftIndex(-target_index.size());
-        } else {
-          uint64_t right = sublist_left_index;
-          current_index = sublist_left_index;
-          ListsDataKey sublist_left_key(key, version, sublist_left_index);
-          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          for (iter->Seek(sublist_left_key.Encode()); iter->Valid() && current_index <= stop_index;
-               iter->Next(), current_index++) {
-            ParsedBaseDataValue parsed_value(iter->value());
-            if ((value.compare(parsed_value.UserValue()) == 0) && rest > 0) {
-              rest--;
-            } else {
-              ListsDataKey lists_data_key(key, version, right++);
-              batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), iter->value());
-            }
-          }
-          delete iter;
-          uint64_t right_index = parsed_lists_meta_value.RightIndex();
-          for (uint64_t idx = 0; idx < target_index.size(); ++idx) {
-            delete_index.push_back(right_index - idx - 1);
-          }
-          parsed_lists_meta_value.ModifyRightIndex(-target_index.size());
+        // the neighbours of the removed elements keep their indexes, the
+        // left and right index are still valid bounds of the list
+        for (const auto& target_key : target_keys) {
+          batch.Delete(handles_[kListsDataCF], target_key);
         }
-        parsed_lists_meta_value.ModifyCount(-target_index.size());
+        parsed_lists_meta_value.ModifyCount(-target_keys.size());
+        parsed_lists_meta_value.SetGapped(true);
         batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
-        for (const auto& idx : delete_index) {
-          ListsDataKey lists_data_key(key, version, idx);
-          batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
+        *ret = target_keys.size();
+        s = CountedWrite(&batch);
+        if (s.ok()) {
+          AddListsRenumberTaskIfNeeded(key, parsed_lists_meta_value.Count());
         }
-        *ret = target_index.size();
-        return db_->Write(default_write_options_, &batch);
+        return s;
       }
     }
   } else if (s.IsNotFound()) {
@@ -701,15 +602,21 @@ Status Redis::LSet(const Slice& key, int64_t index, const Slice& value) {
       return Status::NotFound();
     } else {
       uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t target_index =
-          index >= 0 ? parsed_lists_meta_value.LeftIndex() + index + 1 : parsed_lists_meta_value.RightIndex() + index;
-      if (target_index <= parsed_lists_meta_value.LeftIndex() ||
-          target_index >= parsed_lists_meta_value.RightIndex()) {
+      auto count = static_cast<int64_t>(parsed_lists_meta_value.Count());
+      int64_t position = index >= 0 ? index : count + index;
+      if (position < 0 || position >= count) {
         return Status::Corruption("index out of range");
       }
+      uint64_t target_index = 0;
+      s = ListsLocate(default_read_options_, key, &parsed_lists_meta_value, position, &target_index);
+      if (!s.ok()) {
+        return s;
+      }
       ListsDataKey lists_data_key(key, version, target_index);
       BaseDataValue i_val(value);
-      s = db_->Put(default_write_options_, handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
+      rocksdb::WriteBatch batch;
+      batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
+      s = CountedWrite(&batch);
       statistic++;
       UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), statistic);
       return s;
@@ -745,46 +652,65 @@ Status Redis::LTrim(const Slice& key, int64_t start, int64_t stop) {
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + 1;
-      uint64_t origin_right_index = parsed_lists_meta_value.RightIndex() - 1;
-      uint64_t sublist_left_index = start >= 0 ? origin_left_index + start : origin_right_index + start + 1;
-      uint64_t sublist_right_index = stop >= 0 ? origin_left_index + stop : origin_right_index + stop + 1;
+      auto count = static_cast<int64_t>(parsed_lists_meta_value.Count());
+      int64_t start_position = start >= 0 ? start : count + start;
+      int64_t stop_position = stop >= 0 ? stop : count + stop;
 
-      if (sublist_left_index > sublist_right_index || sublist_left_index > origin_right_index ||
-          sublist_right_index < origin_left_index) {
+      if (start_position > stop_position || start_position >= count || stop_position < 0) {
         parsed_lists_meta_value.InitialMetaValue();
         batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
       } else {
-        if (sublist_left_index < origin_left_index) {
-          sublist_left_index = origin_left_index;
+        if (start_position < 0) {
+          start_position = 0;
         }
-
-        if (sublist_right_index > origin_right_index) {
-          sublist_right_index = origin_right_index;
+        if (stop_position >= count) {
+          stop_position = count - 1;
         }
 
-        uint64_t delete_node_num =
-            (sublist_left_index - origin_left_index) + (origin_right_index - sublist_right_index);
-        parsed_lists_meta_value.ModifyLeftIndex(-(sublist_left_index - origin_left_index));
-        parsed_lists_meta_value.ModifyRightIndex(-(origin_right_index - sublist_right_index));
+        uint64_t delete_node_num = start_position + (count - 1 - stop_position);
+        if (!parsed_lists_meta_value.IsGapped()) {
+          uint64_t step = parsed_lists_meta_value.IndexStep();
+          uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + step;
+          uint64_t origin_right_index = parsed_lists_meta_value.RightIndex() - step;
+          for (int64_t pos = 0; pos < start_position; ++pos) {
+            statistic++;
+            ListsDataKey lists_data_key(key, version, origin_left_index + pos * step);
+            batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
+          }
+          for (int64_t pos = count - 1; pos > stop_position; --pos) {
+            statistic++;
+            ListsDataKey lists_data_key(key, version, origin_right_index - (count - 1 - pos) * step);
+            batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
+          }
+          parsed_lists_meta_value.ModifyLeftIndex(-(start_position * step));
+          parsed_lists_meta_value.ModifyRightIndex(-((count - 1 - stop_position) * step));
+        } else {
+          // gapped list, walk in from both ends to find the trimmed elements
+          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+          ListsDataKey start_data_key(key, version, parsed_lists_meta_value.LeftIndex() + 1);
+          iter->Seek(start_data_key.Encode());
+          for (int64_t pos = 0; iter->Valid() && pos < start_position; iter->Next(), ++pos) {
+            statistic++;
+            batch.Delete(handles_[kListsDataCF], iter->key());
+            parsed_lists_meta_value.set_left_index(ParsedListsDataKey(iter->key()).index());
+          }
+          ListsDataKey stop_data_key(key, version, parsed_lists_meta_value.RightIndex() - 1);
+          iter->SeekForPrev(stop_data_key.Encode());
+          for (int64_t pos = count - 1; iter->Valid() && pos > stop_position; iter->Prev(), --pos) {
+            statistic++;
+            batch.Delete(handles_[kListsDataCF], iter->key());
+            parsed_lists_meta_value.set_right_index(ParsedListsDataKey(iter->key()).index());
+          }
+          delete iter;
+        }
         parsed_lists_meta_value.ModifyCount(-delete_node_num);
         batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
-        for (uint64_t idx = origin_left_index; idx < sublist_left_index; ++idx) {
-          statistic++;
-          ListsDataKey lists_data_key(key, version, idx);
-          batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
-        }
-        for (uint64_t idx = origin_right_index; idx > sublist_right_index; --idx) {
-          statistic++;
-          ListsDataKey lists_data_key(key, version, idx);
-          batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
-        }
       }
     }
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), statistic);
   return s;
 }
@@ -831,14 +757,14 @@ Status Redis::RPop(const Slice& key, int64_t count, std::vector<std::string>* el
         batch.Delete(handles_[kListsDataCF],iter->key());
 
         parsed_lists_meta_value.ModifyCount(-1);
-        parsed_lists_meta_value.ModifyRightIndex(-1);
+        parsed_lists_meta_value.set_right_index(ParsedListsDataKey(iter->key()).index());
       }
       batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
       delete iter;
     }
   }
   if (batch.Count() != 0U) {
-    s = db_->Write(default_write_options_, &batch);
+    s = CountedWrite(&batch);
     if (s.ok()) {
       batch.Clear();
     }
@@ -876,7 +802,12 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
       } else {
         std::string target;
         uint64_t version = parsed_lists_meta_value.Version();
-        uint64_t last_node_index = parsed_lists_meta_value.RightIndex() - 1;
+        uint64_t last_node_index = 0;
+        s = ListsLocate(default_read_options_, source, &parsed_lists_meta_value, parsed_lists_meta_value.Count() - 1,
+                        &last_node_index);
+        if (!s.ok()) {
+          return s;
+        }
         ListsDataKey lists_data_key(source, version, last_node_index);
         s = db_->Get(default_read_options_, handles_[kListsDataCF], lists_data_key.Encode(), &target);
         if (s.ok()) {
@@ -886,15 +817,16 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
           if (parsed_lists_meta_value.Count() == 1) {
             return Status::OK();
           } else {
+            uint64_t step = parsed_lists_meta_value.IndexStep();
             uint64_t target_index = parsed_lists_meta_value.LeftIndex();
             ListsDataKey lists_target_key(source, version, target_index);
             batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
             batch.Put(handles_[kListsDataCF], lists_target_key.Encode(), target);
             statistic++;
-            parsed_lists_meta_value.ModifyRightIndex(-1);
-            parsed_lists_meta_value.ModifyLeftIndex(1);
+            parsed_lists_meta_value.set_right_index(last_node_index);
+            parsed_lists_meta_value.ModifyLeftIndex(step);
             batch.Put(handles_[kMetaCF], base_source.Encode(), meta_value);
-            s = db_->Write(default_write_options_, &batch);
+            s = CountedWrite(&batch);
             UpdateSpecificKeyStatistics(DataType::kLists, source.ToString(), statistic);
             return s;
           }
@@ -930,14 +862,19 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
       return Status::NotFound();
     } else {
       version = parsed_lists_meta_value.Version();
-      uint64_t last_node_index = parsed_lists_meta_value.RightIndex() - 1;
+      uint64_t last_node_index = 0;
+      s = ListsLocate(default_read_options_, source, &parsed_lists_meta_value, parsed_lists_meta_value.Count() - 1,
+                      &last_node_index);
+      if (!s.ok()) {
+        return s;
+      }
       ListsDataKey lists_data_key(source, version, last_node_index);
       s = db_->Get(default_read_options_, handles_[kListsDataCF], lists_data_key.Encode(), &target);
       if (s.ok()) {
         batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
         statistic++;
         parsed_lists_meta_value.ModifyCount(-1);
-        parsed_lists_meta_value.ModifyRightIndex(-1);
+        parsed_lists_meta_value.set_right_index(last_node_index);
         batch.Put(handles_[kMetaCF], base_source.Encode(), source_meta_value);
       } else {
         return s;
@@ -967,11 +904,12 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
     } else {
       version = parsed_lists_meta_value.Version();
     }
+    uint64_t step = parsed_lists_meta_value.IndexStep();
     uint64_t target_index = parsed_lists_meta_value.LeftIndex();
     ListsDataKey lists_data_key(destination, version, target_index);
     batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), target);
     parsed_lists_meta_value.ModifyCount(1);
-    parsed_lists_meta_value.ModifyLeftIndex(1);
+    parsed_lists_meta_value.ModifyLeftIndex(step);
     batch.Put(handles_[kMetaCF], base_destination.Encode(), destination_meta_value);
   } else if (s.IsNotFound()) {
     char str[8];
@@ -981,13 +919,13 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
     uint64_t target_index = lists_meta_value.LeftIndex();
     ListsDataKey lists_data_key(destination, version, target_index);
     batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), target);
-    lists_meta_value.ModifyLeftIndex(1);
+    lists_meta_value.ModifyLeftIndex(kListsIndexStep);
     batch.Put(handles_[kMetaCF], base_destination.Encode(), lists_meta_value.Encode());
   } else {
     return s;
   }
 
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kLists, source.ToString(), statistic);
   if (s.ok()) {
     ParsedBaseDataValue parsed_value(&target);
@@ -1024,9 +962,10 @@ Status Redis::RPush(const Slice& key, const std::vector<std::string>& values, ui
     } else {
       version = parsed_lists_meta_value.Version();
     }
+    uint64_t step = parsed_lists_meta_value.IndexStep();
     for (const auto& value : values) {
       index = parsed_lists_meta_value.RightIndex();
-      parsed_lists_meta_value.ModifyRightIndex(1);
+      parsed_lists_meta_value.ModifyRightIndex(step);
       parsed_lists_meta_value.ModifyCount(1);
       ListsDataKey lists_data_key(key, version, index);
       BaseDataValue i_val(value);
@@ -1041,17 +980,17 @@ Status Redis::RPush(const Slice& key, const std::vector<std::string>& values, ui
     version = lists_meta_value.UpdateVersion();
     for (const auto& value : values) {
       index = lists_meta_value.RightIndex();
-      lists_meta_value.ModifyRightIndex(1);
+      lists_meta_value.ModifyRightIndex(kListsIndexStep);
       ListsDataKey lists_data_key(key, version, index);
       BaseDataValue i_val(value);
       batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
     }
     batch.Put(handles_[kMetaCF], base_meta_key.Encode(), lists_meta_value.Encode());
-    *ret = lists_meta_value.RightIndex() - lists_meta_value.LeftIndex() - 1;
+    *ret = values.size();
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
 Status Redis::RPushx(const Slice& key, const std::vector<std::string>& values, uint64_t* len) {
@@ -1081,19 +1020,226 @@ Status Redis::RPushx(const Slice& key, const std::vector<std::string>& values, u
       return Status::NotFound();
     } else {
       uint64_t version = parsed_lists_meta_value.Version();
+      uint64_t step = parsed_lists_meta_value.IndexStep();
       for (const auto& value : values) {
         uint64_t index = parsed_lists_meta_value.RightIndex();
         parsed_lists_meta_value.ModifyCount(1);
-        parsed_lists_meta_value.ModifyRightIndex(1);
+        parsed_lists_meta_value.ModifyRightIndex(step);
         ListsDataKey lists_data_key(key, version, index);
         BaseDataValue i_val(value);
         batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
       }
       batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
       *len = parsed_lists_meta_value.Count();
-      return db_->Write(default_write_options_, &batch);
+      return CountedWrite(&batch);
+    }
+  }
+  return s;
+}
+
+Status Redis::ListsLocate(const rocksdb::ReadOptions& read_options, const Slice& key,
+                          ParsedListsMetaValue* parsed_lists_meta_value, uint64_t position, uint64_t* index) {
+  if (!parsed_lists_meta_value->IsGapped()) {
+    *index = parsed_lists_meta_value->LeftIndex() + (position + 1) * parsed_lists_meta_value->IndexStep();
+    return Status::OK();
+  }
+
+  // gapped list, walk from the nearer end. The write that gapped it has
+  // queued a renumber, queue it again in case that was dropped.
+  uint64_t count = parsed_lists_meta_value->Count();
+  AddListsRenumberTaskIfNeeded(key, count);
+  uint64_t version = parsed_lists_meta_value->Version();
+  rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
+  if (position < count - position) {
+    ListsDataKey start_data_key(key, version, parsed_lists_meta_value->LeftIndex() + 1);
+    iter->Seek(start_data_key.Encode());
+    for (uint64_t cur = 0; iter->Valid() && cur < position; cur++) {
+      iter->Next();
+    }
+  } else {
+    ListsDataKey stop_data_key(key, version, parsed_lists_meta_value->RightIndex() - 1);
+    iter->SeekForPrev(stop_data_key.Encode());
+    for (uint64_t cur = count - 1; iter->Valid() && cur > position; cur--) {
+      iter->Prev();
+    }
+  }
+  Status s;
+  if (iter->Valid()) {
+    *index = ParsedListsDataKey(iter->key()).index();
+  } else {
+    s = Status::Corruption("list data missing, key: " + key.ToString());
+  }
+  delete iter;
+  return s;
+}
+
+Status Redis::ListsMakeRoom(const Slice& key, ParsedListsMetaValue* parsed_lists_meta_value, uint64_t position,
+                            uint64_t lower_index, uint64_t upper_index, rocksdb::WriteBatch* batch,
+                            uint64_t* target_index) {
+  // Renumber the elements between the insert point and the nearer end of the
+  // list, walking outwards until there is room for them and the new element
+  // with a gap left behind each, or until the end is reached, where the list
+  // can simply grow.
+  uint64_t count = parsed_lists_meta_value->Count();
+  uint64_t version = parsed_lists_meta_value->Version();
+  bool toward_left = position <= count - position;
+  uint64_t bound = toward_left ? lower_index : upper_index;
+  uint64_t fixed = toward_left ? upper_index : lower_index;
+  uint64_t max_moved = toward_left ? position : count - position;
+  std::vector<std::pair<uint64_t, std::string>> moved_nodes;
+
+  rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+  ListsDataKey bound_data_key(key, version, bound);
+  iter->Seek(bound_data_key.Encode());
+  Status s;
+  while ((toward_left ? fixed - bound : bound - fixed) < 2 * (moved_nodes.size() + 2)) {
+    if (moved_nodes.size() == max_moved) {
+      uint64_t span = (moved_nodes.size() + 2) * kListsIndexStep;
+      if (toward_left) {
+        bound = fixed - span;
+        parsed_lists_meta_value->set_left_index(bound);
+      } else {
+        bound = fixed + span;
+        parsed_lists_meta_value->set_right_index(bound);
+      }
+      break;
+    }
+    if (!iter->Valid()) {
+      s = Status::Corruption("list data missing, key: " + key.ToString());
+      break;
+    }
+    moved_nodes.emplace_back(bound, iter->value().ToString());
+    if (moved_nodes.size() == max_moved) {
+      bound = toward_left ? parsed_lists_meta_value->LeftIndex() : parsed_lists_meta_value->RightIndex();
+    } else {
+      if (toward_left) {
+        iter->Prev();
+      } else {
+        iter->Next();
+      }
+      if (!iter->Valid()) {
+        s = Status::Corruption("list data missing, key: " + key.ToString());
+        break;
+      }
+      bound = ParsedListsDataKey(iter->key()).index();
+    }
+  }
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+
+  // moved_nodes are ordered from the insert point outwards, the i-th one
+  // gets the (moved - i)-th slot counting from the bound
+  uint64_t moved = moved_nodes.size();
+  uint64_t step = (toward_left ? fixed - bound : bound - fixed) / (moved + 2);
+  for (const auto& node : moved_nodes) {
+    ListsDataKey lists_data_key(key, version, node.first);
+    batch->Delete(handles_[kListsDataCF], lists_data_key.Encode());
+  }
+  for (uint64_t i = 0; i < moved; ++i) {
+    uint64_t new_index = toward_left ? bound + step * (moved - i) : bound - step * (moved - i);
+    ListsDataKey lists_data_key(key, version, new_index);
+    batch->Put(handles_[kListsDataCF], lists_data_key.Encode(), moved_nodes[i].second);
+  }
+  *target_index = toward_left ? bound + step * (moved + 1) : bound - step * (moved + 1);
+  return Status::OK();
+}
+
+// The elements moved by one write of ListsRenumber
+const uint64_t kListsRenumberBatchSize = 1024;
+
+/*
+ * Give the elements of a gapped list dense indexes again, kListsIndexStep
+ * apart, and clear kListsGappedFlag so positions are computed instead of
+ * walked. The elements keep their version and move to indexes wholly outside
+ * the current bounds, to the left if there is room, in batches that each leave
+ * a valid gapped list behind: the first one widens the bound on that side,
+ * the last one narrows the other and clears the flag. A list left half way by
+ * a crash is just renumbered again once it is walked.
+ */
+Status Redis::ListsRenumber(const Slice& key) {
+  {
+    std::lock_guard l(lists_renumber_mutex_);
+    lists_renumber_pending_.erase(key.ToString());
+  }
+  ScopeRecordLock l(lock_mgr_, key);
+  std::string meta_value;
+  BaseMetaKey base_meta_key(key);
+  Status s = db_->Get(default_read_options_, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
+  if (s.IsNotFound() || (s.ok() && !ExpectedMetaValue(DataType::kLists, meta_value))) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
+  uint64_t count = parsed_lists_meta_value.Count();
+  if (parsed_lists_meta_value.IsStale() || count == 0 || !parsed_lists_meta_value.IsGapped()) {
+    return Status::OK();
+  }
+  uint64_t version = parsed_lists_meta_value.Version();
+  uint64_t left_index = parsed_lists_meta_value.LeftIndex();
+  uint64_t right_index = parsed_lists_meta_value.RightIndex();
+  if (count >= std::numeric_limits<uint64_t>::max() / kListsIndexStep - 1) {
+    return Status::OK();
+  }
+  // the span taken by the elements and both bounds
+  uint64_t span = (count + 1) * kListsIndexStep;
+  bool toward_left = left_index > span;
+  if (!toward_left && std::numeric_limits<uint64_t>::max() - right_index < span) {
+    return Status::OK();
+  }
+  // the new index of the leftmost element
+  uint64_t base = toward_left ? left_index - count * kListsIndexStep : right_index + kListsIndexStep;
+
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
+  rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
+  if (toward_left) {
+    ListsDataKey start_data_key(key, version, left_index + 1);
+    iter->Seek(start_data_key.Encode());
+    parsed_lists_meta_value.set_left_index(base - kListsIndexStep);
+  } else {
+    ListsDataKey stop_data_key(key, version, right_index - 1);
+    iter->SeekForPrev(stop_data_key.Encode());
+    parsed_lists_meta_value.set_right_index(base + count * kListsIndexStep);
+  }
+
+  rocksdb::WriteBatch batch;
+  for (uint64_t moved = 0; moved < count; moved++) {
+    if (!iter->Valid()) {
+      s = Status::Corruption("list data missing, key: " + key.ToString());
+      break;
+    }
+    uint64_t position = toward_left ? moved : count - 1 - moved;
+    ListsDataKey lists_data_key(key, version, base + position * kListsIndexStep);
+    batch.Delete(handles_[kListsDataCF], iter->key());
+    batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), iter->value());
+    if (moved + 1 == count) {
+      if (toward_left) {
+        parsed_lists_meta_value.set_right_index(base + count * kListsIndexStep);
+      } else {
+        parsed_lists_meta_value.set_left_index(base - kListsIndexStep);
+      }
+      parsed_lists_meta_value.SetGapped(false);
+    }
+    if (moved + 1 == count || batch.Count() >= 2 * kListsRenumberBatchSize) {
+      batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = CountedWrite(&batch);
+      if (!s.ok()) {
+        break;
+      }
+      batch.Clear();
+    }
+    if (toward_left) {
+      iter->Next();
+    } else {
+      iter->Prev();
     }
   }
+  delete iter;
   return s;
 }
 
@@ -1128,10 +1274,15 @@ Status Redis::ListsExpire(const Slice& key, int64_t ttl, std::string&& prefetch_
 
     if (ttl > 0) {
       parsed_lists_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_lists_meta_value.Etime());
     } else {
+      uint64_t count = parsed_lists_meta_value.Count();
+      uint64_t version = parsed_lists_meta_value.Version();
       parsed_lists_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_lists_meta_value.Etime());
+      if (s.ok()) {
+        AddReclaimTaskIfNeeded(DataType::kLists, key, version, count);
+      }
     }
   }
   return s;
@@ -1166,9 +1317,13 @@ Status Redis::ListsDel(const Slice& key, std::string&& prefetch_meta) {
       return Status::NotFound();
     } else {
       uint64_t statistic = parsed_lists_meta_value.Count();
+      uint64_t version = parsed_lists_meta_value.Version();
       parsed_lists_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = CountedPut(base_meta_key.Encode(), meta_value);
       UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), statistic);
+      if (s.ok()) {
+        AddReclaimTaskIfNeeded(DataType::kLists, key, version, statistic);
+      }
     }
   }
   return s;
@@ -1202,12 +1357,18 @@ Status Redis::ListsExpireat(const Slice& key, int64_t timestamp, std::string&& p
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
+      uint64_t count = parsed_lists_meta_value.Count();
+      uint64_t version = parsed_lists_meta_value.Version();
       if (timestamp > 0) {
         parsed_lists_meta_value.SetEtime(static_cast<uint64_t>(timestamp));
       } else {
         parsed_lists_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_lists_meta_value.Etime());
+      if (s.ok() && timestamp <= 0) {
+        AddReclaimTaskIfNeeded(DataType::kLists, key, version, count);
+      }
+      return s;
     }
   }
   return s;
@@ -1246,7 +1407,7 @@ Status Redis::ListsPersist(const Slice& key, std::string&& prefetch_meta) {
         return Status::NotFound("Not have an associated timeout");
       } else {
         parsed_lists_meta_value.SetEtime(0);
-        return db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+        return CountedPut(base_meta_key.Encode(), meta_value);
       }
     }
   }
@@ -9,6 +9,7 @@
 #include <map>
 #include <memory>
 #include <random>
+#include <set>
 
 #include <glog/logging.h>
 #include <fmt/core.h>
@@ -17,51 +18,12 @@
 #include "src/scope_snapshot.h"
 #include "src/scope_record_lock.h"
 #include "src/base_data_value_format.h"
+#include "src/inline_fields_format.h"
 #include "pstd/include/env.h"
 #include "pstd/include/pika_codis_slot.h"
 #include "storage/util.h"
 
 namespace storage {
-rocksdb::Status Redis::ScanSetsKeyNum(KeyInfo* key_info) {
-  uint64_t keys = 0;
-  uint64_t expires = 0;
-  uint64_t ttl_sum = 0;
-  uint64_t invaild_keys = 0;
-
-  rocksdb::ReadOptions iterator_options;
-  const rocksdb::Snapshot* snapshot;
-  ScopeSnapshot ss(db_, &snapshot);
-  iterator_options.snapshot = snapshot;
-  iterator_options.fill_cache = false;
-
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
-
-  rocksdb::Iterator* iter = db_->NewIterator(iterator_options, handles_[kMetaCF]);
-  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (!ExpectedMetaValue(DataType::kSets, iter->value().ToString())) {
-      continue;
-    }
-    ParsedSetsMetaValue parsed_sets_meta_value(iter->value());
-    if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.Count() == 0) {
-      invaild_keys++;
-    } else {
-      keys++;
-      if (!parsed_sets_meta_value.IsPermanentSurvival()) {
-        expires++;
-        ttl_sum += parsed_sets_meta_value.Etime() - curtime;
-      }
-    }
-  }
-  delete iter;
-
-  key_info->keys = keys;
-  key_info->expires = expires;
-  key_info->avg_ttl = (expires != 0) ? ttl_sum / expires : 0;
-  key_info->invaild_keys = invaild_keys;
-  return rocksdb::Status::OK();
-}
-
 rocksdb::Status Redis::SAdd(const Slice& key, const std::vector<std::string>& members, int32_t* ret) {
   std::unordered_set<std::string> unique;
   std::vector<std::string> filtered_members;
@@ -89,6 +51,28 @@ rocksdb::Status Redis::SAdd(const Slice& key, const std::vector<std::string>& me
           DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::set<std::string> inline_members;
+  bool is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = SetsLoadInline(&meta_value, s.ok(), true, &inline_members, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    size_t old_count = inline_members.size();
+    inline_members.insert(filtered_members.begin(), filtered_members.end());
+    *ret = static_cast<int32_t>(inline_members.size() - old_count);
+    if (*ret == 0) {
+      return rocksdb::Status::OK();
+    }
+    s = SetsStoreInline(key, &meta_value, std::vector<std::string>(inline_members.begin(), inline_members.end()),
+                        &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.Count() == 0) {
@@ -146,7 +130,7 @@ rocksdb::Status Redis::SAdd(const Slice& key, const std::vector<std::string>& me
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
 rocksdb::Status Redis::SCard(const Slice& key, int32_t* ret, std::string&& meta) {
@@ -194,7 +178,7 @@ rocksdb::Status Redis::SDiff(const std::vector<std::string>& keys, std::vector<s
   uint64_t version = 0;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
+  std::vector<SetsLookup> vaild_sets;
   rocksdb::Status s;
 
   for (uint32_t idx = 1; idx < keys.size(); ++idx) {
@@ -213,7 +197,8 @@ rocksdb::Status Redis::SDiff(const std::vector<std::string>& keys, std::vector<s
     if (s.ok()) {
       ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
       if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.Version()});
+        vaild_sets.emplace_back();
+        SetsNewLookup(keys[idx], &parsed_sets_meta_value, &vaild_sets.back());
       }
     } else if (!s.IsNotFound()) {
       return s;
@@ -237,27 +222,25 @@ rocksdb::Status Redis::SDiff(const std::vector<std::string>& keys, std::vector<s
     if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
       bool found;
       Slice prefix;
-      std::string member_value;
       version = parsed_sets_meta_value.Version();
       SetsMemberKey sets_member_key(keys[0], version, Slice());
       prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto iter = SetsNewIterator(read_options, keys[0], &parsed_sets_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         Slice member = parsed_sets_member_key.member();
 
         found = false;
-        for (const auto& key_version : vaild_sets) {
-          SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-          s = db_->Get(read_options, handles_[kSetsDataCF], sets_member_key.Encode(), &member_value);
-          if (s.ok()) {
-            found = true;
-            break;
-          } else if (!s.IsNotFound()) {
+        for (const auto& lookup : vaild_sets) {
+          s = SetsLookupMember(read_options, lookup, member, &found);
+          if (!s.ok()) {
             delete iter;
             return s;
           }
+          if (found) {
+            break;
+          }
         }
         if (!found) {
           members->push_back(member.ToString());
@@ -285,7 +268,7 @@ rocksdb::Status Redis::SDiffstore(const Slice& destination, const std::vector<st
   ScopeRecordLock l(lock_mgr_, destination);
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
+  std::vector<SetsLookup> vaild_sets;
   rocksdb::Status s;
 
   for (uint32_t idx = 1; idx < keys.size(); ++idx) {
@@ -304,7 +287,8 @@ rocksdb::Status Redis::SDiffstore(const Slice& destination, const std::vector<st
     if (s.ok()) {
       ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
       if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.Version()});
+        vaild_sets.emplace_back();
+        SetsNewLookup(keys[idx], &parsed_sets_meta_value, &vaild_sets.back());
       }
     } else if (!s.IsNotFound()) {
       return s;
@@ -328,27 +312,25 @@ rocksdb::Status Redis::SDiffstore(const Slice& destination, const std::vector<st
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
       bool found;
-      std::string member_value;
       version = parsed_sets_meta_value.Version();
       SetsMemberKey sets_member_key(keys[0], version, Slice());
       Slice prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto iter = SetsNewIterator(read_options, keys[0], &parsed_sets_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         Slice member = parsed_sets_member_key.member();
 
         found = false;
-        for (const auto& key_version : vaild_sets) {
-          SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-          s = db_->Get(read_options, handles_[kSetsDataCF], sets_member_key.Encode(), &member_value);
-          if (s.ok()) {
-            found = true;
-            break;
-          } else if (!s.IsNotFound()) {
+        for (const auto& lookup : vaild_sets) {
+          s = SetsLookupMember(read_options, lookup, member, &found);
+          if (!s.ok()) {
             delete iter;
             return s;
           }
+          if (found) {
+            break;
+          }
         }
         if (!found) {
           members.push_back(member.ToString());
@@ -376,28 +358,21 @@ rocksdb::Status Redis::SDiffstore(const Slice& destination, const std::vector<st
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     statistic = parsed_sets_meta_value.Count();
-    version = parsed_sets_meta_value.InitialMetaValue();
-    if (!parsed_sets_meta_value.check_set_count(static_cast<int32_t>(members.size()))) {
-      return Status::InvalidArgument("set size overflow");
-    }
-    parsed_sets_meta_value.SetCount(static_cast<int32_t>(members.size()));
-    batch.Put(handles_[kMetaCF], base_destination.Encode(), meta_value);
+    parsed_sets_meta_value.InitialMetaValue();
   } else if (s.IsNotFound()) {
-    char str[4];
-    EncodeFixed32(str, members.size());
+    char str[4] = {0};
     SetsMetaValue sets_meta_value(DataType::kSets, Slice(str, 4));
-    version = sets_meta_value.UpdateVersion();
-    batch.Put(handles_[kMetaCF], base_destination.Encode(), sets_meta_value.Encode());
+    sets_meta_value.UpdateVersion();
+    meta_value = sets_meta_value.Encode().ToString();
   } else {
     return s;
   }
-  for (const auto& member : members) {
-    SetsMemberKey sets_member_key(destination, version, member);
-    BaseDataValue iter_value(Slice{});
-    batch.Put(handles_[kSetsDataCF], sets_member_key.Encode(), iter_value.Encode());
+  s = SetsStoreInline(destination, &meta_value, members, &batch);
+  if (!s.ok()) {
+    return s;
   }
   *ret = static_cast<int32_t>(members.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kSets, destination.ToString(), statistic);
   value_to_dest = std::move(members);
   return s;
@@ -415,7 +390,7 @@ rocksdb::Status Redis::SInter(const std::vector<std::string>& keys, std::vector<
   uint64_t version = 0;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
+  std::vector<SetsLookup> vaild_sets;
   rocksdb::Status s;
 
   for (uint32_t idx = 1; idx < keys.size(); ++idx) {
@@ -436,7 +411,8 @@ rocksdb::Status Redis::SInter(const std::vector<std::string>& keys, std::vector<
       if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.Count() == 0) {
         return rocksdb::Status::OK();
       } else {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.Version()});
+        vaild_sets.emplace_back();
+        SetsNewLookup(keys[idx], &parsed_sets_meta_value, &vaild_sets.back());
       }
     } else if (s.IsNotFound()) {
       return rocksdb::Status::OK();
@@ -463,29 +439,25 @@ rocksdb::Status Redis::SInter(const std::vector<std::string>& keys, std::vector<
       return rocksdb::Status::OK();
     } else {
       bool reliable;
-      std::string member_value;
       version = parsed_sets_meta_value.Version();
       SetsMemberKey sets_member_key(keys[0], version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
       Slice prefix = sets_member_key.EncodeSeekKey();
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto iter = SetsNewIterator(read_options, keys[0], &parsed_sets_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         Slice member = parsed_sets_member_key.member();
 
         reliable = true;
-        for (const auto& key_version : vaild_sets) {
-          SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-          s = db_->Get(read_options, handles_[kSetsDataCF], sets_member_key.Encode(), &member_value);
-          if (s.ok()) {
-            continue;
-          } else if (s.IsNotFound()) {
-            reliable = false;
-            break;
-          } else {
+        for (const auto& lookup : vaild_sets) {
+          s = SetsLookupMember(read_options, lookup, member, &reliable);
+          if (!s.ok()) {
             delete iter;
             return s;
           }
+          if (!reliable) {
+            break;
+          }
         }
         if (reliable) {
           members->push_back(member.ToString());
@@ -516,7 +488,7 @@ rocksdb::Status Redis::SInterstore(const Slice& destination, const std::vector<s
   ScopeRecordLock l(lock_mgr_, destination);
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
+  std::vector<SetsLookup> vaild_sets;
   rocksdb::Status s;
 
   for (uint32_t idx = 1; idx < keys.size(); ++idx) {
@@ -538,7 +510,8 @@ rocksdb::Status Redis::SInterstore(const Slice& destination, const std::vector<s
         have_invalid_sets = true;
         break;
       } else {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.Version()});
+        vaild_sets.emplace_back();
+        SetsNewLookup(keys[idx], &parsed_sets_meta_value, &vaild_sets.back());
       }
     } else if (s.IsNotFound()) {
       have_invalid_sets = true;
@@ -568,29 +541,25 @@ rocksdb::Status Redis::SInterstore(const Slice& destination, const std::vector<s
         have_invalid_sets = true;
       } else {
         bool reliable;
-        std::string member_value;
         version = parsed_sets_meta_value.Version();
         SetsMemberKey sets_member_key(keys[0], version, Slice());
         Slice prefix = sets_member_key.EncodeSeekKey();
         KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
-        auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+        auto iter = SetsNewIterator(read_options, keys[0], &parsed_sets_meta_value);
         for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
           ParsedSetsMemberKey parsed_sets_member_key(iter->key());
           Slice member = parsed_sets_member_key.member();
 
           reliable = true;
-          for (const auto& key_version : vaild_sets) {
-            SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-            s = db_->Get(read_options, handles_[kSetsDataCF], sets_member_key.Encode(), &member_value);
-            if (s.ok()) {
-              continue;
-            } else if (s.IsNotFound()) {
-              reliable = false;
-              break;
-            } else {
+          for (const auto& lookup : vaild_sets) {
+            s = SetsLookupMember(read_options, lookup, member, &reliable);
+            if (!s.ok()) {
               delete iter;
               return s;
             }
+            if (!reliable) {
+              break;
+            }
           }
           if (reliable) {
             members.push_back(member.ToString());
@@ -620,28 +589,21 @@ rocksdb::Status Redis::SInterstore(const Slice& destination, const std::vector<s
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     statistic = parsed_sets_meta_value.Count();
-    version = parsed_sets_meta_value.InitialMetaValue();
-    if (!parsed_sets_meta_value.check_set_count(static_cast<int32_t>(members.size()))) {
-      return Status::InvalidArgument("set size overflow");
-    }
-    parsed_sets_meta_value.SetCount(static_cast<int32_t>(members.size()));
-    batch.Put(handles_[kMetaCF], base_destination.Encode(), meta_value);
+    parsed_sets_meta_value.InitialMetaValue();
   } else if (s.IsNotFound()) {
-    char str[4];
-    EncodeFixed32(str, members.size());
+    char str[4] = {0};
     SetsMetaValue sets_meta_value(DataType::kSets, Slice(str, 4));
-    version = sets_meta_value.UpdateVersion();
-    batch.Put(handles_[kMetaCF], base_destination.Encode(), sets_meta_value.Encode());
+    sets_meta_value.UpdateVersion();
+    meta_value = sets_meta_value.Encode().ToString();
   } else {
     return s;
   }
-  for (const auto& member : members) {
-    SetsMemberKey sets_member_key(destination, version, member);
-    BaseDataValue iter_value(Slice{});
-    batch.Put(handles_[kSetsDataCF], sets_member_key.Encode(), iter_value.Encode());
+  s = SetsStoreInline(destination, &meta_value, members, &batch);
+  if (!s.ok()) {
+    return s;
   }
   *ret = static_cast<int32_t>(members.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kSets, destination.ToString(), statistic);
   value_to_dest = std::move(members);
   return s;
@@ -675,6 +637,9 @@ rocksdb::Status Redis::SIsmember(const Slice& key, const Slice& member, int32_t*
       return rocksdb::Status::NotFound("Stale");
     } else if (parsed_sets_meta_value.Count() == 0) {
       return rocksdb::Status::NotFound();
+    } else if (parsed_sets_meta_value.IsInline()) {
+      s = FindInlineMember(parsed_sets_meta_value.InlinePayload(), member) ? Status::OK() : Status::NotFound();
+      *ret = s.ok() ? 1 : 0;
     } else {
       std::string member_value;
       version = parsed_sets_meta_value.Version();
@@ -688,6 +653,63 @@ rocksdb::Status Redis::SIsmember(const Slice& key, const Slice& member, int32_t*
   return s;
 }
 
+rocksdb::Status Redis::SMIsmember(const Slice& key, const std::vector<std::string>& members,
+                                   std::vector<int32_t>* rets) {
+  rets->assign(members.size(), 0);
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot;
+
+  std::string meta_value;
+  uint64_t version = 0;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
+
+  BaseMetaKey base_meta_key(key);
+  rocksdb::Status s = db_->Get(read_options, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
+  if (s.ok() && !ExpectedMetaValue(DataType::kSets, meta_value)) {
+    if (ExpectedStale(meta_value)) {
+      s = Status::NotFound();
+    } else {
+        return Status::InvalidArgument(
+          "WRONGTYPE, key: " + key.ToString() + ", expect type: " +
+          DataTypeStrings[static_cast<int>(DataType::kSets)] + ", get type: " +
+          DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
+    }
+  }
+  if (s.ok()) {
+    ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
+    if (parsed_sets_meta_value.IsStale()) {
+      return rocksdb::Status::NotFound("Stale");
+    } else if (parsed_sets_meta_value.Count() == 0) {
+      return rocksdb::Status::NotFound();
+    } else if (parsed_sets_meta_value.IsInline()) {
+      Slice payload = parsed_sets_meta_value.InlinePayload();
+      for (size_t idx = 0; idx < members.size(); ++idx) {
+        (*rets)[idx] = FindInlineMember(payload, members[idx]) ? 1 : 0;
+      }
+    } else {
+      version = parsed_sets_meta_value.Version();
+      std::vector<std::string> member_keys;
+      member_keys.reserve(members.size());
+      for (const auto& member : members) {
+        SetsMemberKey sets_member_key(key, version, member);
+        member_keys.push_back(sets_member_key.Encode().ToString());
+      }
+      std::vector<std::string> member_values;
+      std::vector<Status> statuses;
+      MultiGet(read_options, handles_[kSetsDataCF], member_keys, &member_values, &statuses);
+      for (size_t idx = 0; idx < members.size(); ++idx) {
+        if (statuses[idx].ok()) {
+          (*rets)[idx] = 1;
+        } else if (!statuses[idx].IsNotFound()) {
+          return statuses[idx];
+        }
+      }
+    }
+  }
+  return s;
+}
+
 rocksdb::Status Redis::SMembers(const Slice& key, std::vector<std::string>* members) {
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
@@ -730,7 +752,7 @@ rocksdb::Status Redis::SMembers(const Slice& key, std::vector<std::string>* memb
       SetsMemberKey sets_member_key(key, version, Slice());
       Slice prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto iter = SetsNewIterator(read_options, key, &parsed_sets_meta_value);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         members->push_back(parsed_sets_member_key.member().ToString());
@@ -784,7 +806,7 @@ Status Redis::SMembersWithTTL(const Slice& key,
       SetsMemberKey sets_member_key(key, version, Slice());
       Slice prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto iter = SetsNewIterator(read_options, key, &parsed_sets_meta_value);
       for (iter->Seek(prefix);
            iter->Valid() && iter->key().starts_with(prefix);
            iter->Next()) {
@@ -825,7 +847,26 @@ rocksdb::Status Redis::SMove(const Slice& source, const Slice& destination, cons
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::set<std::string> inline_members;
+  bool is_inline = false;
   if (s.ok()) {
+    s = SetsLoadInline(&meta_value, true, false, &inline_members, &is_inline);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (is_inline) {
+    if (inline_members.erase(member.ToString()) == 0) {
+      *ret = 0;
+      return rocksdb::Status::NotFound();
+    }
+    *ret = 1;
+    s = SetsStoreInline(source, &meta_value, std::vector<std::string>(inline_members.begin(), inline_members.end()),
+                        &batch);
+    if (!s.ok()) {
+      return s;
+    }
+  } else if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale()) {
       return rocksdb::Status::NotFound("Stale");
@@ -871,7 +912,23 @@ rocksdb::Status Redis::SMove(const Slice& source, const Slice& destination, cons
         DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
-  if (s.ok()) {
+  inline_members.clear();
+  is_inline = false;
+  if (s.ok() || s.IsNotFound()) {
+    Status inline_s = SetsLoadInline(&meta_value, s.ok(), true, &inline_members, &is_inline);
+    if (!inline_s.ok()) {
+      return inline_s;
+    }
+  }
+  if (is_inline) {
+    if (inline_members.insert(member.ToString()).second) {
+      s = SetsStoreInline(destination, &meta_value,
+                          std::vector<std::string>(inline_members.begin(), inline_members.end()), &batch);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  } else if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.Count() == 0) {
       version = parsed_sets_meta_value.InitialMetaValue();
@@ -909,7 +966,7 @@ rocksdb::Status Redis::SMove(const Slice& source, const Slice& destination, cons
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kSets, source.ToString(), 1);
   return s;
 }
@@ -935,6 +992,27 @@ rocksdb::Status Redis::SPop(const Slice& key, std::vector<std::string>* members,
           DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::set<std::string> inline_members;
+  bool is_inline = false;
+  if (s.ok()) {
+    s = SetsLoadInline(&meta_value, true, false, &inline_members, &is_inline);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (is_inline) {
+    std::vector<std::string> rest(inline_members.begin(), inline_members.end());
+    engine.seed(time(nullptr));
+    std::shuffle(rest.begin(), rest.end(), engine);
+    size_t popped = std::min(static_cast<size_t>(std::max<int64_t>(cnt, 0)), rest.size());
+    members->assign(rest.end() - popped, rest.end());
+    rest.resize(rest.size() - popped);
+    s = SetsStoreInline(key, &meta_value, rest, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale()) {
@@ -1011,7 +1089,7 @@ rocksdb::Status Redis::SPop(const Slice& key, std::vector<std::string>* members,
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
 rocksdb::Status Redis::ResetSpopCount(const std::string& key) { return spop_counts_store_->Remove(key); }
@@ -1086,7 +1164,7 @@ rocksdb::Status Redis::SRandmember(const Slice& key, int32_t count, std::vector<
       int32_t idx = 0;
       SetsMemberKey sets_member_key(key, version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      auto iter = db_->NewIterator(default_read_options_, handles_[kSetsDataCF]);
+      auto iter = SetsNewIterator(default_read_options_, key, &parsed_sets_meta_value);
       for (iter->Seek(sets_member_key.EncodeSeekKey()); iter->Valid() && cur_index < size; iter->Next(), cur_index++) {
         if (static_cast<size_t>(idx) >= targets.size()) {
           break;
@@ -1126,6 +1204,30 @@ rocksdb::Status Redis::SRem(const Slice& key, const std::vector<std::string>& me
           DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
     }
   }
+  std::set<std::string> inline_members;
+  bool is_inline = false;
+  if (s.ok()) {
+    s = SetsLoadInline(&meta_value, true, false, &inline_members, &is_inline);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (is_inline) {
+    int32_t cnt = 0;
+    for (const auto& member : members) {
+      cnt += static_cast<int32_t>(inline_members.erase(member));
+    }
+    *ret = cnt;
+    if (cnt == 0) {
+      return rocksdb::Status::OK();
+    }
+    s = SetsStoreInline(key, &meta_value, std::vector<std::string>(inline_members.begin(), inline_members.end()),
+                        &batch);
+    if (!s.ok()) {
+      return s;
+    }
+    return CountedWrite(&batch);
+  }
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale()) {
@@ -1161,7 +1263,7 @@ rocksdb::Status Redis::SRem(const Slice& key, const std::vector<std::string>& me
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kSets, key.ToString(), statistic);
   return s;
 }
@@ -1177,7 +1279,7 @@ rocksdb::Status Redis::SUnion(const std::vector<std::string>& keys, std::vector<
   std::string meta_value;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
+  std::vector<SetsLookup> vaild_sets;
   rocksdb::Status s;
 
   for (const auto & key : keys) {
@@ -1196,7 +1298,8 @@ rocksdb::Status Redis::SUnion(const std::vector<std::string>& keys, std::vector<
     if (s.ok()) {
       ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
       if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
-        vaild_sets.push_back({key, parsed_sets_meta_value.Version()});
+        vaild_sets.emplace_back();
+        SetsNewLookup(key, &parsed_sets_meta_value, &vaild_sets.back());
       }
     } else if (!s.IsNotFound()) {
       return s;
@@ -1205,11 +1308,11 @@ rocksdb::Status Redis::SUnion(const std::vector<std::string>& keys, std::vector<
 
   Slice prefix;
   std::map<std::string, bool> result_flag;
-  for (const auto& key_version : vaild_sets) {
-    SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
+  for (const auto& lookup : vaild_sets) {
+    SetsMemberKey sets_member_key(lookup.key, lookup.version, Slice());
     prefix = sets_member_key.EncodeSeekKey();
-    KeyStatisticsDurationGuard guard(this, DataType::kSets, key_version.key);
-    auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+    KeyStatisticsDurationGuard guard(this, DataType::kSets, lookup.key);
+    auto iter = SetsNewIterator(read_options, lookup);
     for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
       ParsedSetsMemberKey parsed_sets_member_key(iter->key());
       std::string member = parsed_sets_member_key.member().ToString();
@@ -1233,11 +1336,10 @@ rocksdb::Status Redis::SUnionstore(const Slice& destination, const std::vector<s
   const rocksdb::Snapshot* snapshot;
 
   std::string meta_value;
-  uint64_t version = 0;
   ScopeRecordLock l(lock_mgr_, destination);
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
+  std::vector<SetsLookup> vaild_sets;
   rocksdb::Status s;
 
   for (const auto & key : keys) {
@@ -1256,7 +1358,8 @@ rocksdb::Status Redis::SUnionstore(const Slice& destination, const std::vector<s
     if (s.ok()) {
       ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
       if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
-        vaild_sets.push_back({key, parsed_sets_meta_value.Version()});
+        vaild_sets.emplace_back();
+        SetsNewLookup(key, &parsed_sets_meta_value, &vaild_sets.back());
       }
     } else if (!s.IsNotFound()) {
       return s;
@@ -1266,11 +1369,11 @@ rocksdb::Status Redis::SUnionstore(const Slice& destination, const std::vector<s
   Slice prefix;
   std::vector<std::string> members;
   std::map<std::string, bool> result_flag;
-  for (const auto& key_version : vaild_sets) {
-    SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
+  for (const auto& lookup : vaild_sets) {
+    SetsMemberKey sets_member_key(lookup.key, lookup.version, Slice());
     prefix = sets_member_key.EncodeSeekKey();
-    KeyStatisticsDurationGuard guard(this, DataType::kSets, key_version.key);
-    auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+    KeyStatisticsDurationGuard guard(this, DataType::kSets, lookup.key);
+    auto iter = SetsNewIterator(read_options, lookup);
     for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
       ParsedSetsMemberKey parsed_sets_member_key(iter->key());
       std::string member = parsed_sets_member_key.member().ToString();
@@ -1298,28 +1401,21 @@ rocksdb::Status Redis::SUnionstore(const Slice& destination, const std::vector<s
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     statistic = parsed_sets_meta_value.Count();
-    version = parsed_sets_meta_value.InitialMetaValue();
-    if (!parsed_sets_meta_value.check_set_count(static_cast<int32_t>(members.size()))) {
-      return Status::InvalidArgument("set size overflow");
-    }
-    parsed_sets_meta_value.SetCount(static_cast<int32_t>(members.size()));
-    batch.Put(handles_[kMetaCF], destination, meta_value);
+    parsed_sets_meta_value.InitialMetaValue();
   } else if (s.IsNotFound()) {
-    char str[4];
-    EncodeFixed32(str, members.size());
+    char str[4] = {0};
     SetsMetaValue sets_meta_value(DataType::kSets, Slice(str, 4));
-    version = sets_meta_value.UpdateVersion();
-    batch.Put(handles_[kMetaCF], base_destination.Encode(), sets_meta_value.Encode());
+    sets_meta_value.UpdateVersion();
+    meta_value = sets_meta_value.Encode().ToString();
   } else {
     return s;
   }
-  for (const auto& member : members) {
-    SetsMemberKey sets_member_key(destination, version, member);
-    BaseDataValue i_val(Slice{});
-    batch.Put(handles_[kSetsDataCF], sets_member_key.Encode(), i_val.Encode());
+  s = SetsStoreInline(destination, &meta_value, members, &batch);
+  if (!s.ok()) {
+    return s;
   }
   *ret = static_cast<int32_t>(members.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kSets, destination.ToString(), statistic);
   value_to_dest = std::move(members);
   return s;
@@ -1379,7 +1475,7 @@ rocksdb::Status Redis::SScan(const Slice& key, int64_t cursor, const std::string
       SetsMemberKey sets_member_key(key, version, start_point);
       std::string prefix = sets_member_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      rocksdb::Iterator* iter = SetsNewIterator(read_options, key, &parsed_sets_meta_value);
       for (iter->Seek(sets_member_key.EncodeSeekKey()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
@@ -1438,10 +1534,16 @@ rocksdb::Status Redis::SetsExpire(const Slice& key, int64_t ttl, std::string&& p
 
     if (ttl > 0) {
       parsed_sets_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_sets_meta_value.Etime());
     } else {
+      uint64_t count = parsed_sets_meta_value.Count();
+      uint64_t version = parsed_sets_meta_value.Version();
+      bool is_inline = parsed_sets_meta_value.IsInline();
       parsed_sets_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_sets_meta_value.Etime());
+      if (s.ok() && !is_inline) {
+        AddReclaimTaskIfNeeded(DataType::kSets, key, version, count);
+      }
     }
   }
   return s;
@@ -1476,9 +1578,14 @@ rocksdb::Status Redis::SetsDel(const Slice& key, std::string&& prefetch_meta) {
       return rocksdb::Status::NotFound();
     } else {
       uint32_t statistic = parsed_sets_meta_value.Count();
+      uint64_t version = parsed_sets_meta_value.Version();
+      bool is_inline = parsed_sets_meta_value.IsInline();
       parsed_sets_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = CountedPut(base_meta_key.Encode(), meta_value);
       UpdateSpecificKeyStatistics(DataType::kSets, key.ToString(), statistic);
+      if (s.ok() && !is_inline) {
+        AddReclaimTaskIfNeeded(DataType::kSets, key, version, statistic);
+      }
     }
   }
   return s;
@@ -1512,12 +1619,19 @@ rocksdb::Status Redis::SetsExpireat(const Slice& key, int64_t timestamp, std::st
     } else if (parsed_sets_meta_value.Count() == 0) {
       return rocksdb::Status::NotFound();
     } else {
+      uint64_t count = parsed_sets_meta_value.Count();
+      uint64_t version = parsed_sets_meta_value.Version();
+      bool is_inline = parsed_sets_meta_value.IsInline();
       if (timestamp > 0) {
         parsed_sets_meta_value.SetEtime(static_cast<uint64_t>(timestamp));
       } else {
         parsed_sets_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_sets_meta_value.Etime());
+      if (s.ok() && timestamp <= 0 && !is_inline) {
+        AddReclaimTaskIfNeeded(DataType::kSets, key, version, count);
+      }
+      return s;
     }
   }
   return s;
@@ -1556,7 +1670,7 @@ rocksdb::Status Redis::SetsPersist(const Slice& key, std::string&& prefetch_meta
         return rocksdb::Status::NotFound("Not have an associated timeout");
       } else {
         parsed_sets_meta_value.SetEtime(0);
-        return db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+        return CountedPut(base_meta_key.Encode(), meta_value);
       }
     }
   }
@@ -1607,6 +1721,112 @@ rocksdb::Status Redis::SetsTTL(const Slice& key, int64_t* timestamp, std::string
   return s;
 }
 
+Status Redis::SetsLoadInline(std::string* meta_value, bool exists, bool create, std::set<std::string>* members,
+                             bool* is_inline) {
+  *is_inline = false;
+  if (exists) {
+    ParsedSetsMetaValue parsed_sets_meta_value(meta_value);
+    if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.Count() != 0) {
+      if (!parsed_sets_meta_value.IsInline()) {
+        return Status::OK();
+      }
+      if (!DecodeInlineMembers(parsed_sets_meta_value.InlinePayload(), members)) {
+        return Status::Corruption("invalid inline set");
+      }
+      *is_inline = true;
+      return Status::OK();
+    }
+    if (!create) {
+      return Status::OK();
+    }
+    // an empty set starts over, with or without the inline layout
+    parsed_sets_meta_value.InitialMetaValue();
+    if (set_max_inline_entries_ != 0) {
+      parsed_sets_meta_value.SetInline(true);
+      *is_inline = true;
+    }
+  } else if (create && set_max_inline_entries_ != 0) {
+    char meta_value_buf[4] = {0};
+    SetsMetaValue sets_meta_value(DataType::kSets, Slice(meta_value_buf, 4));
+    sets_meta_value.UpdateVersion();
+    sets_meta_value.SetInline(true);
+    *meta_value = sets_meta_value.Encode().ToString();
+    *is_inline = true;
+  }
+  return Status::OK();
+}
+
+Status Redis::SetsStoreInline(const Slice& key, std::string* meta_value, const std::vector<std::string>& members,
+                              rocksdb::WriteBatch* batch) {
+  ParsedSetsMetaValue parsed_sets_meta_value(meta_value);
+  if (!parsed_sets_meta_value.check_set_count(static_cast<int32_t>(members.size()))) {
+    return Status::InvalidArgument("set size overflow");
+  }
+  parsed_sets_meta_value.SetCount(static_cast<int32_t>(members.size()));
+
+  bool fit = set_max_inline_entries_ != 0 && members.size() <= set_max_inline_entries_;
+  for (auto iter = members.begin(); fit && iter != members.end(); ++iter) {
+    fit = iter->size() <= set_max_inline_value_;
+  }
+  if (fit) {
+    std::string payload;
+    EncodeInlineMembers(members, &payload);
+    parsed_sets_meta_value.SetInline(true);
+    parsed_sets_meta_value.SetInlinePayload(payload);
+  } else {
+    // the set outgrew the inline layout, or is written by a store command,
+    // move every member to kSetsDataCF
+    uint64_t version = parsed_sets_meta_value.Version();
+    for (const auto& member : members) {
+      SetsMemberKey sets_member_key(key, version, member);
+      BaseDataValue iter_value(Slice{});
+      batch->Put(handles_[kSetsDataCF], sets_member_key.Encode(), iter_value.Encode());
+    }
+    parsed_sets_meta_value.SetInline(false);
+    parsed_sets_meta_value.SetInlinePayload(Slice());
+  }
+  BaseMetaKey base_meta_key(key);
+  batch->Put(handles_[kMetaCF], base_meta_key.Encode(), *meta_value);
+  return Status::OK();
+}
+
+rocksdb::Iterator* Redis::SetsNewIterator(const rocksdb::ReadOptions& read_options, const Slice& key,
+                                          ParsedSetsMetaValue* parsed_sets_meta_value) {
+  if (parsed_sets_meta_value->IsInline()) {
+    return new InlineMembersIterator(key, parsed_sets_meta_value->Version(), parsed_sets_meta_value->InlinePayload());
+  }
+  return db_->NewIterator(read_options, handles_[kSetsDataCF]);
+}
+
+void Redis::SetsNewLookup(const Slice& key, ParsedSetsMetaValue* parsed_sets_meta_value, SetsLookup* lookup) {
+  lookup->key = key.ToString();
+  lookup->version = parsed_sets_meta_value->Version();
+  lookup->is_inline = parsed_sets_meta_value->IsInline();
+  if (lookup->is_inline) {
+    lookup->payload = parsed_sets_meta_value->InlinePayload().ToString();
+  }
+}
+
+Status Redis::SetsLookupMember(const rocksdb::ReadOptions& read_options, const SetsLookup& lookup,
+                               const Slice& member, bool* found) {
+  if (lookup.is_inline) {
+    *found = FindInlineMember(lookup.payload, member);
+    return Status::OK();
+  }
+  std::string member_value;
+  SetsMemberKey sets_member_key(lookup.key, lookup.version, member);
+  Status s = db_->Get(read_options, handles_[kSetsDataCF], sets_member_key.Encode(), &member_value);
+  *found = s.ok();
+  return s.IsNotFound() ? Status::OK() : s;
+}
+
+rocksdb::Iterator* Redis::SetsNewIterator(const rocksdb::ReadOptions& read_options, const SetsLookup& lookup) {
+  if (lookup.is_inline) {
+    return new InlineMembersIterator(lookup.key, lookup.version, lookup.payload);
+  }
+  return db_->NewIterator(read_options, handles_[kSetsDataCF]);
+}
+
 void Redis::ScanSets() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
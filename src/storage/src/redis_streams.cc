@@ -91,7 +91,7 @@ Status Redis::XAdd(const Slice& key, const std::string& serialized_message, Stre
 
   // 5 update stream meta
   BaseMetaKey base_meta_key(key);
-  s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), stream_meta.value());
+  s = CountedPut(base_meta_key.Encode(), stream_meta.value());
   if (!s.ok()) {
     return s;
   }
@@ -118,7 +118,7 @@ Status Redis::XTrim(const Slice& key, StreamAddTrimArgs& args, int32_t& count) {
 
   // 3 update stream meta
   BaseMetaKey base_meta_key(key);
-  s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), stream_meta.value());
+  s = CountedPut(base_meta_key.Encode(), stream_meta.value());
   if (!s.ok()) {
     return s;
   }
@@ -172,7 +172,7 @@ Status Redis::XDel(const Slice& key, const std::vector<streamID>& ids, int32_t&
     }
   }
 
-  return db_->Put(default_write_options_, handles_[kMetaCF], BaseMetaKey(key).Encode(), stream_meta.value());
+  return CountedPut(BaseMetaKey(key).Encode(), stream_meta.value());
 }
 
 Status Redis::XRange(const Slice& key, const StreamScanArgs& args, std::vector<IdMessage>& field_values, std::string&& prefetch_meta) {
@@ -326,40 +326,6 @@ Status Redis::XInfo(const Slice& key, StreamInfoResult& result) {
   return Status::OK();
 }
 
-Status Redis::ScanStreamsKeyNum(KeyInfo* key_info) {
-  uint64_t keys = 0;
-  uint64_t expires = 0;
-  uint64_t ttl_sum = 0;
-  uint64_t invaild_keys = 0;
-
-  rocksdb::ReadOptions iterator_options;
-  const rocksdb::Snapshot* snapshot;
-  ScopeSnapshot ss(db_, &snapshot);
-  iterator_options.snapshot = snapshot;
-  iterator_options.fill_cache = false;
-
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
-
-  rocksdb::Iterator* iter = db_->NewIterator(iterator_options, handles_[kMetaCF]);
-  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (!ExpectedMetaValue(DataType::kStreams, iter->value().ToString())) {
-      continue;
-    }
-    ParsedStreamMetaValue parsed_stream_meta_value(iter->value());
-    if (parsed_stream_meta_value.length() == 0) {
-      invaild_keys++;
-    } else {
-      keys++;
-    }
-  }
-  delete iter;
-
-  key_info->keys = keys;
-  key_info->invaild_keys = invaild_keys;
-  return Status::OK();
-}
-
 Status Redis::StreamsDel(const Slice& key, std::string&& prefetch_meta) {
   std::string meta_value(std::move(prefetch_meta));
   BaseMetaKey base_meta_key(key);
@@ -388,7 +354,7 @@ Status Redis::StreamsDel(const Slice& key, std::string&& prefetch_meta) {
     } else {
       uint32_t statistic = stream_meta_value.length();
       stream_meta_value.InitMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), stream_meta_value.value());
+      s = CountedPut(base_meta_key.Encode(), stream_meta_value.value());
       UpdateSpecificKeyStatistics(DataType::kStreams, key.ToString(), statistic);
     }
   }
@@ -760,7 +726,7 @@ Status Redis::DeleteStreamMessages(const rocksdb::Slice& key, const StreamMetaVa
     StreamDataKey stream_data_key(key, stream_meta.version(), sid);
     batch.Delete(handles_[kStreamsDataCF], stream_data_key.Encode());
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
 inline Status Redis::SetFirstID(const rocksdb::Slice& key, StreamMetaValue& stream_meta,
@@ -8,6 +8,7 @@
 #include <climits>
 #include <limits>
 #include <memory>
+#include <unordered_set>
 
 #include <fmt/core.h>
 #include <glog/logging.h>
@@ -21,48 +22,6 @@
 #include "storage/util.h"
 
 namespace storage {
-Status Redis::ScanStringsKeyNum(KeyInfo* key_info) {
-  uint64_t keys = 0;
-  uint64_t expires = 0;
-  uint64_t ttl_sum = 0;
-  uint64_t invaild_keys = 0;
-
-  rocksdb::ReadOptions iterator_options;
-  const rocksdb::Snapshot* snapshot;
-  ScopeSnapshot ss(db_, &snapshot);
-  iterator_options.snapshot = snapshot;
-  iterator_options.fill_cache = false;
-
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
-
-  // Note: This is a string type and does not need to pass the column family as
-  // a parameter, use the default column family
-  rocksdb::Iterator* iter = db_->NewIterator(iterator_options);
-  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (!ExpectedMetaValue(DataType::kStrings, iter->value().ToString())) {
-      continue;
-    }
-    ParsedStringsValue parsed_strings_value(iter->value());
-    if (parsed_strings_value.IsStale()) {
-      invaild_keys++;
-    } else {
-      keys++;
-      if (!parsed_strings_value.IsPermanentSurvival()) {
-        expires++;
-        ttl_sum += parsed_strings_value.Etime() - curtime;
-      }
-    }
-  }
-  delete iter;
-
-  key_info->keys = keys;
-  key_info->expires = expires;
-  key_info->avg_ttl = (expires != 0) ? ttl_sum / expires : 0;
-  key_info->invaild_keys = invaild_keys;
-  return Status::OK();
-}
-
 Status Redis::Append(const Slice& key, const Slice& value, int32_t* ret) {
   std::string old_value;
   *ret = 0;
@@ -85,7 +44,7 @@ Status Redis::Append(const Slice& key, const Slice& value, int32_t* ret) {
     if (parsed_strings_value.IsStale()) {
       *ret = static_cast<int32_t>(value.size());
       StringsValue strings_value(value);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     } else {
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
@@ -93,12 +52,12 @@ Status Redis::Append(const Slice& key, const Slice& value, int32_t* ret) {
       StringsValue strings_value(new_value);
       strings_value.SetEtime(timestamp);
       *ret = static_cast<int32_t>(new_value.size());
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     *ret = static_cast<int32_t>(value.size());
     StringsValue strings_value(value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   }
   return s;
 }
@@ -268,7 +227,7 @@ Status Redis::BitOp(BitOpType op, const std::string& dest_key, const std::vector
   StringsValue strings_value(Slice(dest_value.c_str(), max_len));
   ScopeRecordLock l(lock_mgr_, dest_key);
   BaseKey base_dest_key(dest_key);
-  return db_->Put(default_write_options_, base_dest_key.Encode(), strings_value.Encode());
+  return CountedPut(base_dest_key.Encode(), strings_value.Encode());
 }
 
 Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
@@ -294,7 +253,7 @@ Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
       *ret = -value;
       new_value = std::to_string(*ret);
       StringsValue strings_value(new_value);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     } else {
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
@@ -311,13 +270,13 @@ Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
       new_value = std::to_string(*ret);
       StringsValue strings_value(new_value);
       strings_value.SetEtime(timestamp);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     *ret = -value;
     new_value = std::to_string(*ret);
     StringsValue strings_value(new_value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
@@ -442,6 +401,81 @@ Status Redis::MGetWithTTL(const Slice& key, std::string* value, int64_t* ttl) {
   return s;
 }
 
+Status Redis::MGet(const std::vector<Slice>& keys, std::vector<ValueStatus>* vss) {
+  std::vector<std::string> encoded_keys;
+  encoded_keys.reserve(keys.size());
+  for (const auto& key : keys) {
+    BaseKey base_key(key);
+    encoded_keys.push_back(base_key.Encode().ToString());
+  }
+  std::vector<std::string> values;
+  std::vector<Status> statuses;
+  MultiGet(default_read_options_, handles_[kMetaCF], encoded_keys, &values, &statuses);
+
+  vss->clear();
+  vss->reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::string& value = values[i];
+    Status s = statuses[i];
+    if (s.ok() && !ExpectedMetaValue(DataType::kStrings, value)) {
+      s = Status::NotFound();
+    }
+    if (s.ok()) {
+      ParsedStringsValue parsed_strings_value(&value);
+      if (parsed_strings_value.IsStale()) {
+        s = Status::NotFound("Stale");
+      } else {
+        parsed_strings_value.StripSuffix();
+      }
+    }
+    if (s.ok()) {
+      vss->push_back({std::move(value), Status::OK()});
+    } else if (s.IsNotFound()) {
+      vss->push_back({std::string(), Status::NotFound()});
+    } else {
+      vss->clear();
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::MGetWithTTL(const std::vector<Slice>& keys, std::vector<ValueStatus>* vss) {
+  std::vector<std::string> encoded_keys;
+  encoded_keys.reserve(keys.size());
+  for (const auto& key : keys) {
+    BaseKey base_key(key);
+    encoded_keys.push_back(base_key.Encode().ToString());
+  }
+  std::vector<std::string> values;
+  std::vector<Status> statuses;
+  MultiGet(default_read_options_, handles_[kMetaCF], encoded_keys, &values, &statuses);
+
+  vss->clear();
+  vss->reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::string& value = values[i];
+    int64_t ttl = -2;
+    Status s = statuses[i];
+    if (s.ok() && !ExpectedMetaValue(DataType::kStrings, value)) {
+      s = Status::NotFound();
+    }
+    if (s.ok()) {
+      ParsedStringsValue parsed_strings_value(&value);
+      s = HandleParsedStringsValue(parsed_strings_value, &value, &ttl);
+    }
+    if (s.ok()) {
+      vss->push_back({std::move(value), Status::OK(), ttl});
+    } else if (s.IsNotFound()) {
+      vss->push_back({std::string(), Status::NotFound(), -2});
+    } else {
+      vss->clear();
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
 Status Redis::GetBit(const Slice& key, int64_t offset, int32_t* ret) {
   std::string meta_value;
 
@@ -615,7 +649,7 @@ Status Redis::GetSet(const Slice& key, const Slice& value, std::string* old_valu
     return s;
   }
   StringsValue strings_value(value);
-  return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+  return CountedPut(base_key.Encode(), strings_value.Encode());
 }
 
 Status Redis::Incrby(const Slice& key, int64_t value, int64_t* ret) {
@@ -642,7 +676,7 @@ Status Redis::Incrby(const Slice& key, int64_t value, int64_t* ret) {
       *ret = value;
       Int64ToStr(buf, 32, value);
       StringsValue strings_value(buf);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     } else {
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
@@ -658,13 +692,13 @@ Status Redis::Incrby(const Slice& key, int64_t value, int64_t* ret) {
       new_value = std::to_string(*ret);
       StringsValue strings_value(new_value);
       strings_value.SetEtime(timestamp);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     *ret = value;
     Int64ToStr(buf, 32, value);
     StringsValue strings_value(buf);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
@@ -697,7 +731,7 @@ Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret
       LongDoubleToStr(long_double_by, &new_value);
       *ret = new_value;
       StringsValue strings_value(new_value);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     } else {
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
@@ -713,13 +747,13 @@ Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret
       *ret = new_value;
       StringsValue strings_value(new_value);
       strings_value.SetEtime(timestamp);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      return CountedPut(base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     LongDoubleToStr(long_double_by, &new_value);
     *ret = new_value;
     StringsValue strings_value(new_value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
@@ -739,33 +773,35 @@ Status Redis::MSet(const std::vector<KeyValue>& kvs) {
     StringsValue strings_value(kv.value);
     batch.Put(base_key.Encode(), strings_value.Encode());
   }
-  return db_->Write(default_write_options_, &batch);
+  return CountedWrite(&batch);
 }
 
-Status Redis::MSetnx(const std::vector<KeyValue>& kvs, int32_t* ret) {
-  Status s;
-  bool exists = false;
-  *ret = 0;
+Status Redis::MSetnxCheck(const std::vector<KeyValue>& kvs, bool* exist) {
+  *exist = false;
   std::string value;
   for (const auto & kv : kvs) {
     BaseKey base_key(kv.key);
-    s = db_->Get(default_read_options_, base_key.Encode(), &value);
+    Status s = db_->Get(default_read_options_, base_key.Encode(), &value);
     if (!s.ok() && !s.IsNotFound()) {
       return s;
     }
     if (s.ok() && !ExpectedStale(value)) {
-      exists = true;
-      break;
+      *exist = true;
+      return Status::OK();
     }
     // when reaches here, either s is not found or s is ok but expired
   }
-  if (!exists) {
-    s = MSet(kvs);
-    if (s.ok()) {
-      *ret = 1;
-    }
+  return Status::OK();
+}
+
+Status Redis::MSetnxWrite(const std::vector<KeyValue>& kvs) {
+  rocksdb::WriteBatch batch;
+  for (const auto& kv : kvs) {
+    BaseKey base_key(kv.key);
+    StringsValue strings_value(kv.value);
+    batch.Put(base_key.Encode(), strings_value.Encode());
   }
-  return s;
+  return CountedWrite(&batch);
 }
 
 Status Redis::Set(const Slice& key, const Slice& value) {
@@ -773,7 +809,7 @@ Status Redis::Set(const Slice& key, const Slice& value) {
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseKey base_key(key);
-  return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+  return CountedPut(base_key.Encode(), strings_value.Encode());
 }
 
 Status Redis::Setxx(const Slice& key, const Slice& value, int32_t* ret, int64_t ttl) {
@@ -811,7 +847,7 @@ Status Redis::Setxx(const Slice& key, const Slice& value, int32_t* ret, int64_t
     if (ttl > 0) {
       strings_value.SetRelativeTimestamp(ttl);
     }
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return PutWithTTLIndex(key, base_key.Encode(), strings_value.Encode(), strings_value.Etime());
   }
 }
 
@@ -868,7 +904,7 @@ Status Redis::SetBit(const Slice& key, int64_t offset, int32_t on, int32_t* ret)
     }
     StringsValue strings_value(data_value);
     strings_value.SetEtime(timestamp);
-    return db_->Put(rocksdb::WriteOptions(), base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
@@ -886,7 +922,7 @@ Status Redis::Setex(const Slice& key, const Slice& value, int64_t ttl) {
 
   BaseKey base_key(key);
   ScopeRecordLock l(lock_mgr_, key);
-  return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+  return PutWithTTLIndex(key, base_key.Encode(), strings_value.Encode(), strings_value.Etime());
 }
 
 Status Redis::Setnx(const Slice& key, const Slice& value, int32_t* ret, int64_t ttl) {
@@ -909,7 +945,7 @@ Status Redis::Setnx(const Slice& key, const Slice& value, int32_t* ret, int64_t
   if (ttl > 0) {
     strings_value.SetRelativeTimestamp(ttl);
   }
-  s = db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+  s = PutWithTTLIndex(key, base_key.Encode(), strings_value.Encode(), strings_value.Etime());
   if (s.ok()) {
     *ret = 1;
   }
@@ -944,7 +980,7 @@ Status Redis::Setvx(const Slice& key, const Slice& value, const Slice& new_value
         if (ttl > 0) {
           strings_value.SetRelativeTimestamp(ttl);
         }
-        s = db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+        s = PutWithTTLIndex(key, base_key.Encode(), strings_value.Encode(), strings_value.Etime());
         if (!s.ok()) {
           return s;
         }
@@ -986,7 +1022,7 @@ Status Redis::Delvx(const Slice& key, const Slice& value, int32_t* ret) {
     } else {
       if (value.compare(parsed_strings_value.UserValue()) == 0) {
         *ret = 1;
-        return db_->Delete(default_write_options_, base_key.Encode());
+        return CountedDelete(base_key.Encode());
       } else {
         *ret = -1;
       }
@@ -1042,13 +1078,13 @@ Status Redis::Setrange(const Slice& key, int64_t start_offset, const Slice& valu
     *ret = static_cast<int32_t>(new_value.length());
     StringsValue strings_value(new_value);
     strings_value.SetEtime(timestamp);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   } else if (s.IsNotFound()) {
     std::string tmp(start_offset, '\0');
     new_value = tmp.append(value.data());
     *ret = static_cast<int32_t>(new_value.length());
     StringsValue strings_value(new_value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    return CountedPut(base_key.Encode(), strings_value.Encode());
   }
   return s;
 }
@@ -1293,7 +1329,7 @@ Status Redis::PKSetexAt(const Slice& key, const Slice& value, int64_t timestamp)
   BaseKey base_key(key);
   ScopeRecordLock l(lock_mgr_, key);
   strings_value.SetEtime(uint64_t(timestamp));
-  return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+  return PutWithTTLIndex(key, base_key.Encode(), strings_value.Encode(), strings_value.Etime());
 }
 
 Status Redis::StringsExpire(const Slice& key, int64_t ttl, std::string&& prefetch_meta) {
@@ -1324,9 +1360,9 @@ Status Redis::StringsExpire(const Slice& key, int64_t ttl, std::string&& prefetc
     }
     if (ttl > 0) {
       parsed_strings_value.SetRelativeTimestamp(ttl);
-      return db_->Put(default_write_options_, base_key.Encode(), value);
+      return PutWithTTLIndex(key, base_key.Encode(), value, parsed_strings_value.Etime());
     } else {
-      return db_->Delete(default_write_options_, base_key.Encode());
+      return CountedDelete(base_key.Encode());
     }
   }
   return s;
@@ -1358,7 +1394,7 @@ Status Redis::StringsDel(const Slice& key, std::string&& prefetch_meta) {
     if (parsed_strings_value.IsStale()) {
       return Status::NotFound("Stale");
     }
-    return db_->Delete(default_write_options_, base_key.Encode());
+    return CountedDelete(base_key.Encode());
   }
   return s;
 }
@@ -1391,9 +1427,9 @@ Status Redis::StringsExpireat(const Slice& key, int64_t timestamp, std::string&&
     } else {
       if (timestamp > 0) {
         parsed_strings_value.SetEtime(static_cast<uint64_t>(timestamp));
-        return db_->Put(default_write_options_, base_key.Encode(), value);
+        return PutWithTTLIndex(key, base_key.Encode(), value, parsed_strings_value.Etime());
       } else {
-        return db_->Delete(default_write_options_, base_key.Encode());
+        return CountedDelete(base_key.Encode());
       }
     }
   }
@@ -1431,7 +1467,7 @@ Status Redis::StringsPersist(const Slice& key, std::string&& prefetch_meta) {
         return Status::NotFound("Not have an associated timeout");
       } else {
         parsed_strings_value.SetEtime(0);
-        return db_->Put(default_write_options_, base_key.Encode(), value);
+        return CountedPut(base_key.Encode(), value);
       }
     }
   }
@@ -1567,6 +1603,97 @@ rocksdb::Status Redis::Del(const Slice& key) {
   return rocksdb::Status::NotFound();
 }
 
+Status Redis::Del(const std::vector<std::string>& keys, int64_t* count) {
+  struct DeletedKey {
+    DataType type = DataType::kNones;
+    std::string key;
+    uint64_t version = 0;
+    uint64_t count = 0;
+    bool reclaim = false;
+  };
+
+  *count = 0;
+  MultiScopeRecordLock ml(lock_mgr_, keys);
+  rocksdb::WriteBatch batch;
+  std::vector<DeletedKey> deleted_keys;
+  std::unordered_set<std::string> unique;
+  for (const auto& key : keys) {
+    if (!unique.insert(key).second) {
+      continue;
+    }
+    std::string meta_value;
+    BaseMetaKey base_meta_key(key);
+    Status s = db_->Get(default_read_options_, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
+    if (s.IsNotFound()) {
+      continue;
+    } else if (!s.ok()) {
+      return s;
+    }
+
+    DeletedKey deleted_key;
+    deleted_key.type = GetMetaValueType(meta_value);
+    deleted_key.key = key;
+    if (deleted_key.type == DataType::kStrings) {
+      ParsedStringsValue parsed_strings_value(&meta_value);
+      if (parsed_strings_value.IsStale()) {
+        continue;
+      }
+      batch.Delete(handles_[kMetaCF], base_meta_key.Encode());
+    } else if (deleted_key.type == DataType::kLists) {
+      ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
+      if (parsed_lists_meta_value.IsStale() || parsed_lists_meta_value.Count() == 0) {
+        continue;
+      }
+      deleted_key.version = parsed_lists_meta_value.Version();
+      deleted_key.count = parsed_lists_meta_value.Count();
+      deleted_key.reclaim = true;
+      parsed_lists_meta_value.InitialMetaValue();
+      batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+    } else if (deleted_key.type == DataType::kHashes || deleted_key.type == DataType::kSets ||
+               deleted_key.type == DataType::kZSets) {
+      ParsedBaseMetaValue parsed_base_meta_value(&meta_value);
+      if (parsed_base_meta_value.IsStale() || parsed_base_meta_value.Count() == 0) {
+        continue;
+      }
+      deleted_key.version = parsed_base_meta_value.Version();
+      deleted_key.count = parsed_base_meta_value.Count();
+      deleted_key.reclaim = !parsed_base_meta_value.IsInline();
+      parsed_base_meta_value.InitialMetaValue();
+      batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+    } else if (deleted_key.type == DataType::kStreams) {
+      StreamMetaValue stream_meta_value;
+      stream_meta_value.ParseFrom(meta_value);
+      if (stream_meta_value.length() == 0) {
+        continue;
+      }
+      deleted_key.count = stream_meta_value.length();
+      stream_meta_value.InitMetaValue();
+      batch.Put(handles_[kMetaCF], base_meta_key.Encode(), stream_meta_value.value());
+    } else {
+      continue;
+    }
+    deleted_keys.push_back(std::move(deleted_key));
+  }
+  if (deleted_keys.empty()) {
+    return Status::OK();
+  }
+
+  Status s = CountedWrite(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const auto& deleted_key : deleted_keys) {
+    if (deleted_key.type != DataType::kStrings) {
+      UpdateSpecificKeyStatistics(deleted_key.type, deleted_key.key, deleted_key.count);
+    }
+    if (deleted_key.reclaim) {
+      AddReclaimTaskIfNeeded(deleted_key.type, deleted_key.key, deleted_key.version, deleted_key.count);
+    }
+  }
+  *count = static_cast<int64_t>(deleted_keys.size());
+  return Status::OK();
+}
+
 rocksdb::Status Redis::Expire(const Slice& key, int64_t ttl) {
   std::string meta_value;
   BaseMetaKey base_meta_key(key);
@@ -1742,7 +1869,7 @@ rocksdb::Status Redis::PKPatternMatchDel(const std::string& pattern, int32_t* re
     }
 
     if (static_cast<size_t>(batch.Count()) >= BATCH_DELETE_LIMIT) {
-      s = db_->Write(default_write_options_, &batch);
+      s = CountedWrite(&batch);
       if (s.ok()) {
         total_delete += static_cast<int32_t>(batch.Count());
         batch.Clear();
@@ -1754,7 +1881,7 @@ rocksdb::Status Redis::PKPatternMatchDel(const std::string& pattern, int32_t* re
     iter->Next();
   }
   if (batch.Count() != 0U) {
-    s = db_->Write(default_write_options_, &batch);
+    s = CountedWrite(&batch);
     if (s.ok()) {
       total_delete += static_cast<int32_t>(batch.Count());
       batch.Clear();
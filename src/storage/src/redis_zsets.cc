@@ -20,50 +20,11 @@
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
 #include "src/zsets_filter.h"
+#include "src/zsets_rank_index.h"
 #include "src/redis.h"
 #include "storage/util.h"
 
 namespace storage {
-Status Redis::ScanZsetsKeyNum(KeyInfo* key_info) {
-  uint64_t keys = 0;
-  uint64_t expires = 0;
-  uint64_t ttl_sum = 0;
-  uint64_t invaild_keys = 0;
-
-  rocksdb::ReadOptions iterator_options;
-  const rocksdb::Snapshot* snapshot;
-  ScopeSnapshot ss(db_, &snapshot);
-  iterator_options.snapshot = snapshot;
-  iterator_options.fill_cache = false;
-
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
-
-  rocksdb::Iterator* iter = db_->NewIterator(iterator_options, handles_[kMetaCF]);
-  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
-    if (!ExpectedMetaValue(DataType::kZSets, iter->value().ToString())) {
-      continue;
-    }
-    ParsedZSetsMetaValue parsed_zsets_meta_value(iter->value());
-    if (parsed_zsets_meta_value.IsStale() || parsed_zsets_meta_value.Count() == 0) {
-      invaild_keys++;
-    } else {
-      keys++;
-      if (!parsed_zsets_meta_value.IsPermanentSurvival()) {
-        expires++;
-        ttl_sum += parsed_zsets_meta_value.Etime() - curtime;
-      }
-    }
-  }
-  delete iter;
-
-  key_info->keys = keys;
-  key_info->expires = expires;
-  key_info->avg_ttl = (expires != 0) ? ttl_sum / expires : 0;
-  key_info->invaild_keys = invaild_keys;
-  return Status::OK();
-}
-
 Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMember>* score_members) {
   uint32_t statistic = 0;
   score_members->clear();
@@ -93,6 +54,11 @@ Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMe
       int64_t num = parsed_zsets_meta_value.Count();
       num = num <= count ? num : count;
       uint64_t version = parsed_zsets_meta_value.Version();
+      ZSetsRankIndex rank_index(db_, handles_, key, version);
+      s = rank_index.Prepare(default_read_options_, false);
+      if (!s.ok()) {
+        return s;
+      }
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
@@ -106,14 +72,25 @@ Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMe
         ++del_cnt;
         batch.Delete(handles_[kZsetsDataCF], zsets_member_key.Encode());
         batch.Delete(handles_[kZsetsScoreCF], iter->key());
+        s = rank_index.DelMember(parsed_zsets_score_key.score(), parsed_zsets_score_key.member());
+        if (!s.ok()) {
+          break;
+        }
       }
       delete iter;
+      if (!s.ok()) {
+        return s;
+      }
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)){
         return Status::InvalidArgument("zset size overflow");
       }
       parsed_zsets_meta_value.ModifyCount(-del_cnt);
       batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
-      s = db_->Write(default_write_options_, &batch);
+      s = rank_index.WriteTo(&batch);
+      if (!s.ok()) {
+        return s;
+      }
+      s = CountedWrite(&batch);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
       return s;
     }
@@ -151,6 +128,11 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
       int64_t num = parsed_zsets_meta_value.Count();
       num = num <= count ? num : count;
       uint64_t version = parsed_zsets_meta_value.Version();
+      ZSetsRankIndex rank_index(db_, handles_, key, version);
+      s = rank_index.Prepare(default_read_options_, false);
+      if (!s.ok()) {
+        return s;
+      }
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
@@ -164,14 +146,25 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
         ++del_cnt;
         batch.Delete(handles_[kZsetsDataCF], zsets_member_key.Encode());
         batch.Delete(handles_[kZsetsScoreCF], iter->key());
+        s = rank_index.DelMember(parsed_zsets_score_key.score(), parsed_zsets_score_key.member());
+        if (!s.ok()) {
+          break;
+        }
       }
       delete iter;
+      if (!s.ok()) {
+        return s;
+      }
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)){
         return Status::InvalidArgument("zset size overflow");
       }
       parsed_zsets_meta_value.ModifyCount(-del_cnt);
       batch.Put(handles_[kMetaCF], base_meta_key.Encode(), meta_value);
-      s = db_->Write(default_write_options_, &batch);
+      s = rank_index.WriteTo(&batch);
+      if (!s.ok()) {
+        return s;
+      }
+      s = CountedWrite(&batch);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
       return s;
     }
@@ -196,6 +189,7 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
   uint64_t version = 0;
   std::string meta_value;
   rocksdb::WriteBatch batch;
+  std::unique_ptr<ZSetsRankIndex> rank_index;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseMetaKey base_meta_key(key);
@@ -220,6 +214,11 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
       vaild = true;
       version = parsed_zsets_meta_value.Version();
     }
+    rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+    s = rank_index->Prepare(default_read_options_, !vaild);
+    if (!s.ok()) {
+      return s;
+    }
 
     int32_t cnt = 0;
     std::string data_value;
@@ -240,6 +239,10 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
           } else {
             ZSetsScoreKey zsets_score_key(key, version, old_score, sm.member);
             batch.Delete(handles_[kZsetsScoreCF], zsets_score_key.Encode());
+            s = rank_index->DelMember(old_score, sm.member);
+            if (!s.ok()) {
+              return s;
+            }
             // delete old zsets_score_key and overwirte zsets_member_key
             // but in different column_families so we accumulative 1
             statistic++;
@@ -257,6 +260,10 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
       ZSetsScoreKey zsets_score_key(key, version, sm.score, sm.member);
       BaseDataValue zsets_score_i_val(Slice{});
       batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), zsets_score_i_val.Encode());
+      s = rank_index->AddMember(sm.score, sm.member);
+      if (!s.ok()) {
+        return s;
+      }
       if (not_found) {
         cnt++;
       }
@@ -273,6 +280,8 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
     ZSetsMetaValue zsets_meta_value(DataType::kZSets, Slice(buf, 4));
     version = zsets_meta_value.UpdateVersion();
     batch.Put(handles_[kMetaCF], base_meta_key.Encode(), zsets_meta_value.Encode());
+    rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+    rank_index->Prepare(default_read_options_, true);
     for (const auto& sm : filtered_score_members) {
       ZSetsMemberKey zsets_member_key(key, version, sm.member);
       const void* ptr_score = reinterpret_cast<const void*>(&sm.score);
@@ -283,12 +292,17 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
       ZSetsScoreKey zsets_score_key(key, version, sm.score, sm.member);
       BaseDataValue zsets_score_i_val(Slice{});
       batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), zsets_score_i_val.Encode());
+      rank_index->AddMember(sm.score, sm.member);
     }
     *ret = static_cast<int32_t>(filtered_score_members.size());
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index->WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -406,6 +420,7 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
   uint64_t version = 0;
   std::string meta_value;
   rocksdb::WriteBatch batch;
+  std::unique_ptr<ZSetsRankIndex> rank_index;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseMetaKey base_meta_key(key);
@@ -422,11 +437,17 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
   }
   if (s.ok()) {
     ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
-    if (parsed_zsets_meta_value.IsStale() || parsed_zsets_meta_value.Count() == 0) {
+    bool fresh = parsed_zsets_meta_value.IsStale() || parsed_zsets_meta_value.Count() == 0;
+    if (fresh) {
       version = parsed_zsets_meta_value.InitialMetaValue();
     } else {
       version = parsed_zsets_meta_value.Version();
     }
+    rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+    s = rank_index->Prepare(default_read_options_, fresh);
+    if (!s.ok()) {
+      return s;
+    }
     std::string data_value;
     ZSetsMemberKey zsets_member_key(key, version, member);
     s = db_->Get(default_read_options_, handles_[kZsetsDataCF], zsets_member_key.Encode(), &data_value);
@@ -439,6 +460,10 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
       score = old_score + increment;
       ZSetsScoreKey zsets_score_key(key, version, old_score, member);
       batch.Delete(handles_[kZsetsScoreCF], zsets_score_key.Encode());
+      s = rank_index->DelMember(old_score, member);
+      if (!s.ok()) {
+        return s;
+      }
       // delete old zsets_score_key and overwirte zsets_member_key
       // but in different column_families so we accumulative 1
       statistic++;
@@ -458,6 +483,8 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
     ZSetsMetaValue zsets_meta_value(DataType::kZSets, Slice(buf, 4));
     version = zsets_meta_value.UpdateVersion();
     batch.Put(handles_[kMetaCF], base_meta_key.Encode(), zsets_meta_value.Encode());
+    rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+    rank_index->Prepare(default_read_options_, true);
     score = increment;
   } else {
     return s;
@@ -471,8 +498,16 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
   ZSetsScoreKey zsets_score_key(key, version, score, member);
   BaseDataValue zsets_score_i_val(Slice{});
   batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), zsets_score_i_val.Encode());
+  s = rank_index->AddMember(score, member);
+  if (!s.ok()) {
+    return s;
+  }
   *ret = score;
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index->WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -515,13 +550,20 @@ Status Redis::ZRange(const Slice& key, int32_t start, int32_t stop, std::vector<
       if (start_index > stop_index || start_index >= count || stop_index < 0) {
         return s;
       }
-      int32_t cur_index = 0;
+      int32_t cur_index = start_index;
       ScoreMember score_member;
 
-      ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
+      ZSetsRankIndex rank_index(db_, handles_, key, version);
+      if (!rank_index.SeekToIndex(read_options, start_index, iter).ok()) {
+        // no rank index for this zset, walk from the first member
+        AddZsetsRankBuildTaskIfNeeded(key, count);
+        cur_index = 0;
+        ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+        iter->Seek(zsets_score_key.Encode());
+      }
+      for (; iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           score_member.score = parsed_zsets_score_key.score();
@@ -585,15 +627,20 @@ Status Redis::ZRangeWithTTL(const Slice& key, int32_t start, int32_t stop, std::
           || stop_index < 0) {
         return s;
       }
-      int32_t cur_index = 0;
+      int32_t cur_index = start_index;
       ScoreMember score_member;
-      ZSetsScoreKey zsets_score_key(key, version,
-                                    std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode());
-           iter->Valid() && cur_index <= stop_index;
-           iter->Next(), ++cur_index) {
+      ZSetsRankIndex rank_index(db_, handles_, key, version);
+      if (!rank_index.SeekToIndex(read_options, start_index, iter).ok()) {
+        // no rank index for this zset, walk from the first member
+        AddZsetsRankBuildTaskIfNeeded(key, count);
+        cur_index = 0;
+        ZSetsScoreKey zsets_score_key(key, version,
+                                      std::numeric_limits<double>::lowest(), Slice());
+        iter->Seek(zsets_score_key.Encode());
+      }
+      for (; iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           score_member.score = parsed_zsets_score_key.score();
@@ -644,7 +691,28 @@ Status Redis::ZRangebyscore(const Slice& key, double min, double max, bool left_
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
+      iter->Seek(zsets_score_key.Encode());
+      if (offset >= kZSetsRankBlockSize) {
+        // jump over the offset with the rank index instead of walking it
+        ZSetsRankIndex rank_index(db_, handles_, key, version);
+        double lower_score = left_close ? min : std::nextafter(min, std::numeric_limits<double>::max());
+        int32_t lower_rank = 0;
+        if (rank_index.LowerBound(read_options, lower_score, Slice(), &lower_rank).ok()) {
+          if (lower_rank + offset > stop_index) {
+            delete iter;
+            return s;
+          }
+          if (rank_index.SeekToIndex(read_options, static_cast<int32_t>(lower_rank + offset), iter).ok()) {
+            index = static_cast<int32_t>(lower_rank + offset);
+            skipped = offset;
+          } else {
+            iter->Seek(zsets_score_key.Encode());
+          }
+        } else {
+          AddZsetsRankBuildTaskIfNeeded(key, parsed_zsets_meta_value.Count());
+        }
+      }
+      for (; iter->Valid() && index <= stop_index; iter->Next(), ++index) {
         bool left_pass = false;
         bool right_pass = false;
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -715,11 +783,17 @@ Status Redis::ZRank(const Slice& key, const Slice& member, int32_t* rank) {
     } else {
       bool found = false;
       uint64_t version = parsed_zsets_meta_value.Version();
+      KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      s = ZsetsRankByIndex(read_options, key, version, member, rank);
+      if (!s.IsNotSupported()) {
+        return s;
+      }
+      AddZsetsRankBuildTaskIfNeeded(key, parsed_zsets_meta_value.Count());
+      s = Status::OK();
       int32_t index = 0;
       int32_t stop_index = parsed_zsets_meta_value.Count() - 1;
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
-      KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -754,6 +828,7 @@ Status Redis::ZRem(const Slice& key, const std::vector<std::string>& members, in
 
   std::string meta_value;
   rocksdb::WriteBatch batch;
+  std::unique_ptr<ZSetsRankIndex> rank_index;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseMetaKey base_meta_key(key);
@@ -778,6 +853,11 @@ Status Redis::ZRem(const Slice& key, const std::vector<std::string>& members, in
       int32_t del_cnt = 0;
       std::string data_value;
       uint64_t version = parsed_zsets_meta_value.Version();
+      rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+      s = rank_index->Prepare(default_read_options_, false);
+      if (!s.ok()) {
+        return s;
+      }
       for (const auto& member : filtered_members) {
         ZSetsMemberKey zsets_member_key(key, version, member);
         s = db_->Get(default_read_options_, handles_[kZsetsDataCF], zsets_member_key.Encode(), &data_value);
@@ -793,6 +873,10 @@ Status Redis::ZRem(const Slice& key, const std::vector<std::string>& members, in
 
           ZSetsScoreKey zsets_score_key(key, version, score, member);
           batch.Delete(handles_[kZsetsScoreCF], zsets_score_key.Encode());
+          s = rank_index->DelMember(score, member);
+          if (!s.ok()) {
+            return s;
+          }
         } else if (!s.IsNotFound()) {
           return s;
         }
@@ -807,7 +891,11 @@ Status Redis::ZRem(const Slice& key, const std::vector<std::string>& members, in
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index->WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -817,6 +905,7 @@ Status Redis::ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int
   uint32_t statistic = 0;
   std::string meta_value;
   rocksdb::WriteBatch batch;
+  std::unique_ptr<ZSetsRankIndex> rank_index;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseMetaKey base_meta_key(key);
@@ -850,20 +939,39 @@ Status Redis::ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int
       if (start_index > stop_index || start_index >= count) {
         return s;
       }
-      ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+      rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+      s = rank_index->Prepare(default_read_options_, false);
+      if (!s.ok()) {
+        return s;
+      }
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
+      cur_index = start_index;
+      if (!rank_index->SeekToIndex(default_read_options_, start_index, iter).ok()) {
+        // no rank index for this zset, walk from the first member
+        AddZsetsRankBuildTaskIfNeeded(key, count);
+        cur_index = 0;
+        ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+        iter->Seek(zsets_score_key.Encode());
+      }
+      for (; iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           ZSetsMemberKey zsets_member_key(key, version, parsed_zsets_score_key.member());
           batch.Delete(handles_[kZsetsDataCF], zsets_member_key.Encode());
           batch.Delete(handles_[kZsetsScoreCF], iter->key());
+          s = rank_index->DelMember(parsed_zsets_score_key.score(), parsed_zsets_score_key.member());
+          if (!s.ok()) {
+            break;
+          }
           del_cnt++;
           statistic++;
         }
       }
       delete iter;
+      if (!s.ok()) {
+        return s;
+      }
       *ret = del_cnt;
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)){
         return Status::InvalidArgument("zset size overflow");
@@ -874,7 +982,11 @@ Status Redis::ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index->WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -885,6 +997,7 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
   uint32_t statistic = 0;
   std::string meta_value;
   rocksdb::WriteBatch batch;
+  std::unique_ptr<ZSetsRankIndex> rank_index;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseMetaKey base_meta_key(key);
@@ -911,6 +1024,11 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
       int32_t cur_index = 0;
       int32_t stop_index = parsed_zsets_meta_value.Count() - 1;
       uint64_t version = parsed_zsets_meta_value.Version();
+      rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+      s = rank_index->Prepare(default_read_options_, false);
+      if (!s.ok()) {
+        return s;
+      }
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
@@ -936,6 +1054,10 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
           ZSetsMemberKey zsets_member_key(key, version, parsed_zsets_score_key.member());
           batch.Delete(handles_[kZsetsDataCF], zsets_member_key.Encode());
           batch.Delete(handles_[kZsetsScoreCF], iter->key());
+          s = rank_index->DelMember(parsed_zsets_score_key.score(), parsed_zsets_score_key.member());
+          if (!s.ok()) {
+            break;
+          }
           del_cnt++;
           statistic++;
         }
@@ -944,6 +1066,9 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
         }
       }
       delete iter;
+      if (!s.ok()) {
+        return s;
+      }
       *ret = del_cnt;
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)){
         return Status::InvalidArgument("zset size overflow");
@@ -954,7 +1079,11 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index->WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -997,13 +1126,19 @@ Status Redis::ZRevrange(const Slice& key, int32_t start, int32_t stop, std::vect
       if (start_index > stop_index || start_index >= count || stop_index < 0) {
         return s;
       }
-      int32_t cur_index = count - 1;
+      int32_t cur_index = stop_index;
       ScoreMember score_member;
-      ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && cur_index >= start_index;
-           iter->Prev(), --cur_index) {
+      ZSetsRankIndex rank_index(db_, handles_, key, version);
+      if (!rank_index.SeekToIndex(read_options, stop_index, iter).ok()) {
+        // no rank index for this zset, walk from the last member
+        AddZsetsRankBuildTaskIfNeeded(key, count);
+        cur_index = count - 1;
+        ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
+        iter->SeekForPrev(zsets_score_key.Encode());
+      }
+      for (; iter->Valid() && cur_index >= start_index; iter->Prev(), --cur_index) {
         if (cur_index <= stop_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           score_member.score = parsed_zsets_score_key.score();
@@ -1053,7 +1188,28 @@ Status Redis::ZRevrangebyscore(const Slice& key, double min, double max, bool le
       ZSetsScoreKey zsets_score_key(key, version, std::nextafter(max, std::numeric_limits<double>::max()), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && left > 0; iter->Prev(), --left) {
+      iter->SeekForPrev(zsets_score_key.Encode());
+      if (offset >= kZSetsRankBlockSize) {
+        // jump over the offset with the rank index instead of walking it
+        ZSetsRankIndex rank_index(db_, handles_, key, version);
+        double upper_score = right_close ? std::nextafter(max, std::numeric_limits<double>::max()) : max;
+        int32_t upper_rank = 0;
+        if (rank_index.LowerBound(read_options, upper_score, Slice(), &upper_rank).ok()) {
+          if (upper_rank - 1 - offset < 0) {
+            delete iter;
+            return s;
+          }
+          if (rank_index.SeekToIndex(read_options, static_cast<int32_t>(upper_rank - 1 - offset), iter).ok()) {
+            left = static_cast<int32_t>(upper_rank - offset);
+            skipped = offset;
+          } else {
+            iter->SeekForPrev(zsets_score_key.Encode());
+          }
+        } else {
+          AddZsetsRankBuildTaskIfNeeded(key, parsed_zsets_meta_value.Count());
+        }
+      }
+      for (; iter->Valid() && left > 0; iter->Prev(), --left) {
         bool left_pass = false;
         bool right_pass = false;
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -1127,8 +1283,18 @@ Status Redis::ZRevrank(const Slice& key, const Slice& member, int32_t* rank) {
       int32_t rev_index = 0;
       int32_t left = parsed_zsets_meta_value.Count();
       uint64_t version = parsed_zsets_meta_value.Version();
-      ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      int32_t forward_rank = 0;
+      s = ZsetsRankByIndex(read_options, key, version, member, &forward_rank);
+      if (s.ok()) {
+        *rank = left - 1 - forward_rank;
+        return s;
+      } else if (!s.IsNotSupported()) {
+        return s;
+      }
+      AddZsetsRankBuildTaskIfNeeded(key, parsed_zsets_meta_value.Count());
+      s = Status::OK();
+      ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
       for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && left >= 0; iter->Prev(), --left, ++rev_index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -1197,6 +1363,60 @@ Status Redis::ZScore(const Slice& key, const Slice& member, double* score) {
   return s;
 }
 
+Status Redis::ZMScore(const Slice& key, const std::vector<std::string>& members, std::vector<ScoreStatus>* sss) {
+  sss->assign(members.size(), {0, Status::NotFound()});
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot = nullptr;
+
+  std::string meta_value;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
+
+  BaseMetaKey base_meta_key(key);
+  Status s = db_->Get(read_options, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
+  if (s.ok() && !ExpectedMetaValue(DataType::kZSets, meta_value)) {
+    if (ExpectedStale(meta_value)) {
+      s = Status::NotFound();
+    } else {
+      return Status::InvalidArgument(
+        "WRONGTYPE, key: " + key.ToString() + ", expected type: " +
+        DataTypeStrings[static_cast<int>(DataType::kZSets)] + ", got type: " +
+        DataTypeStrings[static_cast<int>(GetMetaValueType(meta_value))]);
+    }
+  }
+  if (s.ok()) {
+    ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
+    uint64_t version = parsed_zsets_meta_value.Version();
+    if (parsed_zsets_meta_value.IsStale()) {
+      return Status::NotFound("Stale");
+    } else if (parsed_zsets_meta_value.Count() == 0) {
+      return Status::NotFound();
+    } else {
+      std::vector<std::string> member_keys;
+      member_keys.reserve(members.size());
+      for (const auto& member : members) {
+        ZSetsMemberKey zsets_member_key(key, version, member);
+        member_keys.push_back(zsets_member_key.Encode().ToString());
+      }
+      std::vector<std::string> data_values;
+      std::vector<Status> statuses;
+      MultiGet(read_options, handles_[kZsetsDataCF], member_keys, &data_values, &statuses);
+      for (size_t idx = 0; idx < members.size(); ++idx) {
+        if (statuses[idx].ok()) {
+          ParsedBaseDataValue parsed_value(&data_values[idx]);
+          parsed_value.StripSuffix();
+          uint64_t tmp = DecodeFixed64(data_values[idx].data());
+          const void* ptr_tmp = reinterpret_cast<const void*>(&tmp);
+          (*sss)[idx] = {*reinterpret_cast<const double*>(ptr_tmp), Status::OK()};
+        } else if (!statuses[idx].IsNotFound()) {
+          return statuses[idx];
+        }
+      }
+    }
+  }
+  return s;
+}
+
 Status Redis::ZGetAll(const Slice& key, double weight, std::map<std::string, double>* value_to_dest) {
   Status s;
   rocksdb::ReadOptions read_options;
@@ -1341,6 +1561,8 @@ Status Redis::ZUnionstore(const Slice& destination, const std::vector<std::strin
   }
 
   char score_buf[8];
+  ZSetsRankIndex rank_index(db_, handles_, destination, version);
+  rank_index.Prepare(read_options, true);
   for (const auto& sm : member_score_map) {
     ZSetsMemberKey zsets_member_key(destination, version, sm.first);
 
@@ -1352,9 +1574,14 @@ Status Redis::ZUnionstore(const Slice& destination, const std::vector<std::strin
     ZSetsScoreKey zsets_score_key(destination, version, sm.second, sm.first);
     BaseDataValue score_i_val(Slice{});
     batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), score_i_val.Encode());
+    rank_index.AddMember(sm.second, sm.first);
   }
   *ret = static_cast<int32_t>(member_score_map.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index.WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, destination.ToString(), statistic);
   value_to_dest = std::move(member_score_map);
   return s;
@@ -1496,6 +1723,8 @@ Status Redis::ZInterstore(const Slice& destination, const std::vector<std::strin
     batch.Put(handles_[kMetaCF], base_destination.Encode(), zsets_meta_value.Encode());
   }
   char score_buf[8];
+  ZSetsRankIndex rank_index(db_, handles_, destination, version);
+  rank_index.Prepare(read_options, true);
   for (const auto& sm : final_score_members) {
     ZSetsMemberKey zsets_member_key(destination, version, sm.member);
 
@@ -1507,9 +1736,14 @@ Status Redis::ZInterstore(const Slice& destination, const std::vector<std::strin
     ZSetsScoreKey zsets_score_key(destination, version, sm.score, sm.member);
     BaseDataValue zsets_score_i_val(Slice{});
     batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), zsets_score_i_val.Encode());
+    rank_index.AddMember(sm.score, sm.member);
   }
   *ret = static_cast<int32_t>(final_score_members.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index.WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, destination.ToString(), statistic);
   value_to_dest = std::move(final_score_members);
   return s;
@@ -1601,6 +1835,7 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
 
   int32_t del_cnt = 0;
   std::string meta_value;
+  std::unique_ptr<ZSetsRankIndex> rank_index;
 
   BaseMetaKey base_meta_key(key);
   Status s = db_->Get(read_options, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
@@ -1622,6 +1857,11 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
       uint64_t version = parsed_zsets_meta_value.Version();
       int32_t cur_index = 0;
       int32_t stop_index = parsed_zsets_meta_value.Count() - 1;
+      rank_index = std::make_unique<ZSetsRankIndex>(db_, handles_, key, version);
+      s = rank_index->Prepare(default_read_options_, false);
+      if (!s.ok()) {
+        return s;
+      }
       ZSetsMemberKey zsets_member_key(key, version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsDataCF]);
@@ -1645,6 +1885,10 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
           double score = *reinterpret_cast<const double*>(ptr_tmp);
           ZSetsScoreKey zsets_score_key(key, version, score, member);
           batch.Delete(handles_[kZsetsScoreCF], zsets_score_key.Encode());
+          s = rank_index->DelMember(score, member);
+          if (!s.ok()) {
+            break;
+          }
           del_cnt++;
           statistic++;
         }
@@ -1653,6 +1897,9 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
         }
       }
       delete iter;
+      if (!s.ok()) {
+        return s;
+      }
     }
     if (del_cnt > 0) {
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)){
@@ -1665,11 +1912,119 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = rank_index->WriteTo(&batch);
+  if (!s.ok()) {
+    return s;
+  }
+  s = CountedWrite(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
 
+Status Redis::ZsetsRankByIndex(const rocksdb::ReadOptions& read_options, const Slice& key, uint64_t version,
+                               const Slice& member, int32_t* rank) {
+  std::string data_value;
+  ZSetsMemberKey zsets_member_key(key, version, member);
+  Status s = db_->Get(read_options, handles_[kZsetsDataCF], zsets_member_key.Encode(), &data_value);
+  if (!s.ok()) {
+    return s;
+  }
+  ParsedBaseDataValue parsed_value(&data_value);
+  parsed_value.StripSuffix();
+  uint64_t tmp = DecodeFixed64(data_value.data());
+  const void* ptr_tmp = reinterpret_cast<const void*>(&tmp);
+  double score = *reinterpret_cast<const double*>(ptr_tmp);
+
+  int32_t index = 0;
+  ZSetsRankIndex rank_index(db_, handles_, key, version);
+  s = rank_index.Rank(read_options, score, member, &index);
+  if (s.ok()) {
+    *rank = index;
+  }
+  return s;
+}
+
+// The times a build is started over for the writes it missed
+const int kZSetsRankBuildRetries = 3;
+
+/*
+ * Build the rank index of a zset written before the index existed. The
+ * members are walked in a snapshot without the record lock, which is only
+ * held to mark the sentinel as building and to write the index at the end.
+ * A write to the zset in between flags the marker dirty and the build is
+ * started over, the reads keep scanning until one gets through.
+ */
+Status Redis::ZsetsBuildRankIndex(const Slice& key) {
+  {
+    std::lock_guard l(zsets_rank_build_mutex_);
+    zsets_rank_build_pending_.erase(key.ToString());
+  }
+  BaseMetaKey base_meta_key(key);
+  // the version of the zset, 0 if there is no zset with members
+  auto get_version = [&](uint64_t* version) {
+    *version = 0;
+    std::string meta_value;
+    Status s = db_->Get(default_read_options_, handles_[kMetaCF], base_meta_key.Encode(), &meta_value);
+    if (s.IsNotFound()) {
+      return Status::OK();
+    } else if (s.ok() && ExpectedMetaValue(DataType::kZSets, meta_value)) {
+      ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
+      if (!parsed_zsets_meta_value.IsStale() && parsed_zsets_meta_value.Count() != 0) {
+        *version = parsed_zsets_meta_value.Version();
+      }
+    }
+    return s;
+  };
+
+  ZSetsRankIndex::State state;
+  for (int attempt = 0; attempt < kZSetsRankBuildRetries; attempt++) {
+    uint64_t version = 0;
+    {
+      ScopeRecordLock l(lock_mgr_, key);
+      Status s = get_version(&version);
+      if (!s.ok() || version == 0) {
+        return s;
+      }
+      ZSetsRankIndex rank_index(db_, handles_, key, version);
+      s = rank_index.GetState(default_read_options_, &state);
+      if (!s.ok() || state == ZSetsRankIndex::State::kIndexed) {
+        return s;
+      }
+      rocksdb::WriteBatch batch;
+      rank_index.MarkBuilding(&batch);
+      s = CountedWrite(&batch);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+
+    rocksdb::ReadOptions read_options;
+    const rocksdb::Snapshot* snapshot = nullptr;
+    ScopeSnapshot ss(db_, &snapshot);
+    read_options.snapshot = snapshot;
+    ZSetsRankIndex rank_index(db_, handles_, key, version);
+    rocksdb::WriteBatch batch;
+    Status s = rank_index.Build(read_options, &batch);
+    if (!s.ok()) {
+      return s;
+    }
+
+    ScopeRecordLock l(lock_mgr_, key);
+    uint64_t current_version = 0;
+    s = get_version(&current_version);
+    if (!s.ok() || current_version != version) {
+      return s;
+    }
+    s = rank_index.GetState(default_read_options_, &state);
+    if (!s.ok()) {
+      return s;
+    } else if (state == ZSetsRankIndex::State::kBuilding) {
+      return CountedWrite(&batch);
+    }
+  }
+  return Status::OK();
+}
+
 Status Redis::ZsetsExpire(const Slice& key, int64_t ttl, std::string&& prefetch_meta) {
   std::string meta_value(std::move(prefetch_meta));
   ScopeRecordLock l(lock_mgr_, key);
@@ -1699,12 +2054,17 @@ Status Redis::ZsetsExpire(const Slice& key, int64_t ttl, std::string&& prefetch_
       return Status::NotFound();
     }
 
+    uint64_t count = parsed_zsets_meta_value.Count();
+    uint64_t version = parsed_zsets_meta_value.Version();
     if (ttl > 0) {
       parsed_zsets_meta_value.SetRelativeTimestamp(ttl);
     } else {
       parsed_zsets_meta_value.InitialMetaValue();
     }
-    s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+    s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_zsets_meta_value.Etime());
+    if (s.ok() && ttl <= 0) {
+      AddReclaimTaskIfNeeded(DataType::kZSets, key, version, count);
+    }
   }
   return s;
 }
@@ -1738,9 +2098,13 @@ Status Redis::ZsetsDel(const Slice& key, std::string&& prefetch_meta) {
       return Status::NotFound();
     } else {
       uint32_t statistic = parsed_zsets_meta_value.Count();
+      uint64_t version = parsed_zsets_meta_value.Version();
       parsed_zsets_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = CountedPut(base_meta_key.Encode(), meta_value);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
+      if (s.ok()) {
+        AddReclaimTaskIfNeeded(DataType::kZSets, key, version, statistic);
+      }
     }
   }
   return s;
@@ -1774,12 +2138,18 @@ Status Redis::ZsetsExpireat(const Slice& key, int64_t timestamp, std::string&& p
     } else if (parsed_zsets_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
+      uint64_t count = parsed_zsets_meta_value.Count();
+      uint64_t version = parsed_zsets_meta_value.Version();
       if (timestamp > 0) {
         parsed_zsets_meta_value.SetEtime(uint64_t(timestamp));
       } else {
         parsed_zsets_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+      s = PutWithTTLIndex(key, base_meta_key.Encode(), meta_value, parsed_zsets_meta_value.Etime());
+      if (s.ok() && timestamp <= 0) {
+        AddReclaimTaskIfNeeded(DataType::kZSets, key, version, count);
+      }
+      return s;
     }
   }
   return s;
@@ -1904,7 +2274,7 @@ Status Redis::ZsetsPersist(const Slice& key, std::string&& prefetch_meta) {
         return Status::NotFound("Not have an associated timeout");
       } else {
         parsed_zsets_meta_value.SetEtime(0);
-        return db_->Put(default_write_options_, handles_[kMetaCF], base_meta_key.Encode(), meta_value);
+        return CountedPut(base_meta_key.Encode(), meta_value);
       }
     }
   }
@@ -5,6 +5,7 @@
 
 #include <utility>
 #include <algorithm>
+#include <chrono>
 
 #include <glog/logging.h>
 
@@ -17,6 +18,7 @@
 #include "src/redis_hyperloglog.h"
 #include "src/type_iterator.h"
 #include "src/redis.h"
+#include "src/scope_record_lock.h"
 #include "include/pika_conf.h"
 #include "pstd/include/pika_codis_slot.h"
 
@@ -69,12 +71,19 @@ Storage::Storage(int db_instance_num, int slot_num, bool is_classic_mode) {
 Storage::~Storage() {
   bg_tasks_should_exit_ = true;
   bg_tasks_cond_var_.notify_one();
+  {
+    std::lock_guard l(reclaim_mutex_);
+    reclaim_cond_var_.notify_one();
+  }
 
   if (is_opened_) {
     int ret = 0;
     if ((ret = pthread_join(bg_tasks_thread_id_, nullptr)) != 0) {
       LOG(ERROR) << "pthread_join failed with bgtask thread error " << ret;
     }
+    if ((ret = pthread_join(reclaim_thread_id_, nullptr)) != 0) {
+      LOG(ERROR) << "pthread_join failed with reclaim thread error " << ret;
+    }
     for (auto& inst : insts_) {
       inst.reset();
     }
@@ -100,8 +109,14 @@ Status Storage::Open(const StorageOptions& storage_options, const std::string& d
       LOG(FATAL) << "open db failed" << s.ToString();
     }
   }
+  if (storage_options.reclaim_ranges_per_sec != 0) {
+    reclaim_interval_us_ = 1000000 / storage_options.reclaim_ranges_per_sec;
+  }
+  enable_ttl_index_ = storage_options.enable_ttl_index;
+  active_expire_batch_size_ = storage_options.active_expire_batch_size;
 
   is_opened_.store(true);
+  AddBGTask({DataType::kNones, kCountKeys});
   return Status::OK();
 }
 
@@ -175,11 +190,18 @@ Status Storage::GetBit(const Slice& key, int64_t offset, int32_t* ret) {
   return inst->GetBit(key, offset, ret);
 }
 
+// Every instance writes its part of kvs in one WriteBatch
 Status Storage::MSet(const std::vector<KeyValue>& kvs) {
-  Status s;
+  std::vector<std::vector<KeyValue>> inst_kvs(insts_.size());
   for (const auto& kv : kvs) {
-    auto& inst = GetDBInstance(kv.key);
-    s = inst->Set(Slice(kv.key), Slice(kv.value));
+    inst_kvs[slot_indexer_->GetInstanceID(GetSlotID(slot_num_, kv.key))].push_back(kv);
+  }
+  Status s;
+  for (size_t idx = 0; idx < insts_.size(); idx++) {
+    if (inst_kvs[idx].empty()) {
+      continue;
+    }
+    s = insts_[idx]->MSet(inst_kvs[idx]);
     if (!s.ok()) {
       return s;
     }
@@ -187,43 +209,43 @@ Status Storage::MSet(const std::vector<KeyValue>& kvs) {
   return s;
 }
 
-Status Storage::MGet(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
+// Group the keys by instance and look every group up with one MultiGet,
+// then put the results back in the order of keys
+Status Storage::MGetByInstance(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss, bool with_ttl) {
   vss->clear();
-  Status s;
-  for(const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    std::string value;
-    s = inst->MGet(key, &value);
-    if (s.ok()) {
-      vss->push_back({value, Status::OK()});
-    } else if(s.IsNotFound()) {
-      vss->push_back({std::string(), Status::NotFound()});
-    } else {
+  std::vector<std::vector<Slice>> inst_keys(insts_.size());
+  std::vector<std::vector<size_t>> inst_positions(insts_.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto inst_index = slot_indexer_->GetInstanceID(GetSlotID(slot_num_, keys[i]));
+    inst_keys[inst_index].emplace_back(keys[i]);
+    inst_positions[inst_index].push_back(i);
+  }
+
+  vss->resize(keys.size());
+  std::vector<ValueStatus> inst_vss;
+  for (size_t idx = 0; idx < insts_.size(); idx++) {
+    if (inst_keys[idx].empty()) {
+      continue;
+    }
+    Status s = with_ttl ? insts_[idx]->MGetWithTTL(inst_keys[idx], &inst_vss)
+                        : insts_[idx]->MGet(inst_keys[idx], &inst_vss);
+    if (!s.ok()) {
       vss->clear();
       return s;
     }
+    for (size_t i = 0; i < inst_vss.size(); i++) {
+      (*vss)[inst_positions[idx][i]] = std::move(inst_vss[i]);
+    }
   }
   return Status::OK();
 }
 
+Status Storage::MGet(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
+  return MGetByInstance(keys, vss, false);
+}
+
 Status Storage::MGetWithTTL(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
-  vss->clear();
-  Status s;
-  for(const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    std::string value;
-    int64_t ttl;
-    s = inst->MGetWithTTL(key, &value, &ttl);
-    if (s.ok()) {
-      vss->push_back({value, Status::OK(), ttl});
-    } else if (s.IsNotFound()) {
-      vss->push_back({std::string(), Status::NotFound(), ttl});
-    } else {
-      vss->clear();
-      return s;
-    }
-  }
-  return Status::OK();
+  return MGetByInstance(keys, vss, true);
 }
 
 Status Storage::Setnx(const Slice& key, const Slice& value, int32_t* ret, int64_t ttl) {
@@ -232,28 +254,50 @@ Status Storage::Setnx(const Slice& key, const Slice& value, int32_t* ret, int64_
 }
 
 // disallowed in codis, only runs in pika classic mode
-// TODO: Not concurrent safe now, merge wuxianrong's bugfix after floyd's PR review finishes.
 Status Storage::MSetnx(const std::vector<KeyValue>& kvs, int32_t* ret) {
   assert(is_classic_mode_);
-  Status s;
+  *ret = 0;
+  std::vector<std::vector<KeyValue>> inst_kvs(insts_.size());
   for (const auto& kv : kvs) {
-    auto& inst = GetDBInstance(kv.key);
-    s = inst->IsExist(Slice(kv.key));
-    if (!s.IsNotFound()) {
-      return s;
+    inst_kvs[slot_indexer_->GetInstanceID(GetSlotID(slot_num_, kv.key))].push_back(kv);
+  }
+
+  // lock the keys of every instance, in instance order, before any check, so
+  // no key can be set between the checks and the writes of all instances
+  std::vector<std::unique_ptr<MultiScopeRecordLock>> locks;
+  for (size_t idx = 0; idx < insts_.size(); idx++) {
+    if (inst_kvs[idx].empty()) {
+      continue;
     }
+    std::vector<std::string> keys;
+    keys.reserve(inst_kvs[idx].size());
+    for (const auto& kv : inst_kvs[idx]) {
+      keys.push_back(kv.key);
+    }
+    locks.push_back(std::make_unique<MultiScopeRecordLock>(insts_[idx]->GetLockMgr(), keys));
   }
 
-  for (const auto& kv : kvs) {
-    auto& inst = GetDBInstance(kv.key);
-    s = inst->Set(Slice(kv.key), Slice(kv.value));
-    if (!s.ok()) {
+  Status s;
+  for (size_t idx = 0; idx < insts_.size(); idx++) {
+    if (inst_kvs[idx].empty()) {
+      continue;
+    }
+    bool exist = false;
+    s = insts_[idx]->MSetnxCheck(inst_kvs[idx], &exist);
+    if (!s.ok() || exist) {
       return s;
     }
   }
-  if (s.ok()) {
-    *ret = 1;
+  for (size_t idx = 0; idx < insts_.size(); idx++) {
+    if (inst_kvs[idx].empty()) {
+      continue;
+    }
+    s = insts_[idx]->MSetnxWrite(inst_kvs[idx]);
+    if (!s.ok()) {
+      return s;
+    }
   }
+  *ret = 1;
   return s;
 }
 
@@ -621,6 +665,11 @@ Status Storage::SIsmember(const Slice& key, const Slice& member, int32_t* ret) {
   return inst->SIsmember(key, member, ret);
 }
 
+Status Storage::SMIsmember(const Slice& key, const std::vector<std::string>& members, std::vector<int32_t>* rets) {
+  auto& inst = GetDBInstance(key);
+  return inst->SMIsmember(key, members, rets);
+}
+
 Status Storage::SMembers(const Slice& key, std::vector<std::string>* members) {
   auto& inst = GetDBInstance(key);
   return inst->SMembers(key, members);
@@ -960,6 +1009,11 @@ Status Storage::ZScore(const Slice& key, const Slice& member, double* ret) {
   return inst->ZScore(key, member, ret);
 }
 
+Status Storage::ZMScore(const Slice& key, const std::vector<std::string>& members, std::vector<ScoreStatus>* sss) {
+  auto& inst = GetDBInstance(key);
+  return inst->ZMScore(key, members, sss);
+}
+
 Status Storage::ZUnionstore(const Slice& destination, const std::vector<std::string>& keys,
                             const std::vector<double>& weights, const AGGREGATE agg,
                             std::map<std::string, double>& value_to_dest, int32_t* ret) {
@@ -1184,13 +1238,19 @@ int32_t Storage::Expire(const Slice& key, int64_t ttl) {
 
 
 int64_t Storage::Del(const std::vector<std::string>& keys) {
-  Status s;
-  int64_t count = 0;
+  std::vector<std::vector<std::string>> inst_keys(insts_.size());
   for (const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    s = inst->Del(key);
+    inst_keys[slot_indexer_->GetInstanceID(GetSlotID(slot_num_, key))].push_back(key);
+  }
+  int64_t count = 0;
+  for (size_t idx = 0; idx < insts_.size(); idx++) {
+    if (inst_keys[idx].empty()) {
+      continue;
+    }
+    int64_t inst_count = 0;
+    Status s = insts_[idx]->Del(inst_keys[idx], &inst_count);
     if (s.ok()) {
-      count++;
+      count += inst_count;
     }
   }
   return count;
@@ -1658,8 +1718,17 @@ static void* StartBGThreadWrapper(void* arg) {
   return nullptr;
 }
 
+static void* StartReclaimThreadWrapper(void* arg) {
+  auto s = reinterpret_cast<Storage*>(arg);
+  s->RunReclaimTask();
+  return nullptr;
+}
+
 Status Storage::StartBGThread() {
   int result = pthread_create(&bg_tasks_thread_id_, nullptr, StartBGThreadWrapper, this);
+  if (result == 0) {
+    result = pthread_create(&reclaim_thread_id_, nullptr, StartReclaimThreadWrapper, this);
+  }
   if (result != 0) {
     char msg[128];
     snprintf(msg, sizeof(msg), "pthread create: %s", strerror(result));
@@ -1669,6 +1738,13 @@ Status Storage::StartBGThread() {
 }
 
 Status Storage::AddBGTask(const BGTask& bg_task) {
+  if (bg_task.operation == kReclaimRange || bg_task.operation == kRenumberList ||
+      bg_task.operation == kBuildRankIndex) {
+    std::lock_guard l(reclaim_mutex_);
+    reclaim_queue_.push(bg_task);
+    reclaim_cond_var_.notify_one();
+    return Status::OK();
+  }
   bg_tasks_mutex_.lock();
   if (bg_task.type == DataType::kAll) {
     // if current task it is global compact,
@@ -1707,6 +1783,38 @@ Status Storage::RunBGTask() {
       if (task.argv.size() == 2) {
         DoCompactRange(task.type, task.argv.front(), task.argv.back());
       }
+    } else if (task.operation == kActiveExpire) {
+      DoActiveExpire();
+    } else if (task.operation == kCountKeys) {
+      DoCountKeys();
+    }
+  }
+  return Status::OK();
+}
+
+Status Storage::RunReclaimTask() {
+  BGTask task;
+  auto next_reclaim = std::chrono::steady_clock::now();
+  while (!bg_tasks_should_exit_) {
+    std::unique_lock<std::mutex> lock(reclaim_mutex_);
+    reclaim_cond_var_.wait(lock, [this]() { return !reclaim_queue_.empty() || bg_tasks_should_exit_; });
+    // Spaced by reclaim_interval_us_, waiting here holds up nothing but the
+    // other reclaims, and returns at once on exit
+    reclaim_cond_var_.wait_until(lock, next_reclaim, [this]() { return bg_tasks_should_exit_.load(); });
+    if (bg_tasks_should_exit_) {
+      return Status::Incomplete("reclaim task return with bg_tasks_should_exit true");
+    }
+    task = std::move(reclaim_queue_.front());
+    reclaim_queue_.pop();
+    lock.unlock();
+
+    next_reclaim = std::chrono::steady_clock::now() + std::chrono::microseconds(reclaim_interval_us_);
+    if (task.operation == kRenumberList) {
+      DoRenumberList(task.argv.front());
+    } else if (task.operation == kBuildRankIndex) {
+      DoBuildRankIndex(task.argv.front());
+    } else {
+      DoReclaimRange(task.type, task.argv.front(), std::stoull(task.argv.back()));
     }
   }
   return Status::OK();
@@ -1766,6 +1874,54 @@ Status Storage::DoCompactSpecificKey(const DataType& type, const std::string& ke
   return s;
 }
 
+Status Storage::DoReclaimRange(const DataType& type, const std::string& key, uint64_t version) {
+  auto& inst = GetDBInstance(key);
+  Status s = inst->ReclaimVersion(type, key, version);
+  if (!s.ok()) {
+    LOG(WARNING) << "reclaim " << DataTypeToString(type) << " key " << key << " version " << version
+                 << " failed, " << s.ToString();
+  }
+  return s;
+}
+
+Status Storage::DoRenumberList(const std::string& key) {
+  auto& inst = GetDBInstance(key);
+  Status s = inst->ListsRenumber(key);
+  if (!s.ok()) {
+    LOG(WARNING) << "renumber list " << key << " failed, " << s.ToString();
+  }
+  return s;
+}
+
+Status Storage::DoBuildRankIndex(const std::string& key) {
+  auto& inst = GetDBInstance(key);
+  Status s = inst->ZsetsBuildRankIndex(key);
+  if (!s.ok()) {
+    LOG(WARNING) << "build rank index of zset " << key << " failed, " << s.ToString();
+  }
+  return s;
+}
+
+Status Storage::ActiveExpire() {
+  if (!enable_ttl_index_ || active_expire_queued_.exchange(true)) {
+    return Status::OK();
+  }
+  return AddBGTask({DataType::kNones, kActiveExpire});
+}
+
+Status Storage::DoActiveExpire() {
+  active_expire_queued_ = false;
+  Status s;
+  for (const auto& inst : insts_) {
+    uint64_t expired = 0;
+    s = inst->ActiveExpire(active_expire_batch_size_, &expired);
+    if (!s.ok()) {
+      LOG(WARNING) << "active expire of instance " << inst->GetIndex() << " failed, " << s.ToString();
+    }
+  }
+  return s;
+}
+
 Status Storage::SetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys) {
   for (const auto& inst : insts_) {
     inst->SetMaxCacheStatisticKeys(max_cache_statistic_keys);
@@ -1780,6 +1936,20 @@ Status Storage::SetSmallCompactionThreshold(uint32_t small_compaction_threshold)
   return Status::OK();
 }
 
+Status Storage::SetHashMaxInline(uint32_t hash_max_inline_entries, uint32_t hash_max_inline_value) {
+  for (const auto& inst : insts_) {
+    inst->SetHashMaxInline(hash_max_inline_entries, hash_max_inline_value);
+  }
+  return Status::OK();
+}
+
+Status Storage::SetSetMaxInline(uint32_t set_max_inline_entries, uint32_t set_max_inline_value) {
+  for (const auto& inst : insts_) {
+    inst->SetSetMaxInline(set_max_inline_entries, set_max_inline_value);
+  }
+  return Status::OK();
+}
+
 Status Storage::SetSmallCompactionDurationThreshold(uint32_t small_compaction_duration_threshold) {
   for (const auto& inst : insts_) {
     inst->SetSmallCompactionDurationThreshold(small_compaction_duration_threshold);
@@ -1837,7 +2007,10 @@ Status Storage::GetKeyNum(std::vector<KeyInfo>* key_infos) {
     if (scan_keynum_exit_) {
       break;
     }
-    auto s = db->ScanKeyNum(&db_key_infos);
+    auto s = db->ScanKeyNum(&db_key_infos, &scan_keynum_exit_);
+    if (scan_keynum_exit_) {
+      break;
+    }
     if (!s.ok()) {
       return s;
     }
@@ -1856,6 +2029,53 @@ Status Storage::StopScanKeyNum() {
   return Status::OK();
 }
 
+Status Storage::GetKeyCounts(std::vector<KeyInfo>* key_infos) {
+  key_infos->assign(DataTypeNum, KeyInfo());
+  for (const auto& db : insts_) {
+    std::vector<KeyInfo> db_key_infos;
+    db->GetKeyCounts(&db_key_infos);
+    std::transform(db_key_infos.begin(), db_key_infos.end(),
+        key_infos->begin(), key_infos->begin(), std::plus<>{});
+  }
+  return Status::OK();
+}
+
+Status Storage::DoCountKeys() {
+  Status s;
+  for (const auto& inst : insts_) {
+    std::vector<KeyInfo> key_infos;
+    s = inst->ScanKeyNum(&key_infos, &bg_tasks_should_exit_);
+    if (!s.ok()) {
+      LOG(WARNING) << "count keys of instance " << inst->GetIndex() << " failed, " << s.ToString();
+      return s;
+    }
+  }
+  return s;
+}
+
+void Storage::BeginWriteBatch() {
+  for (const auto& inst : insts_) {
+    inst->BeginWrites();
+  }
+}
+
+Status Storage::CommitWriteBatch(const std::vector<std::string>& keys) {
+  std::vector<std::vector<std::string>> inst_keys(insts_.size());
+  for (const auto& key : keys) {
+    inst_keys[slot_indexer_->GetInstanceID(GetSlotID(slot_num_, key))].push_back(key);
+  }
+  Status s;
+  for (size_t i = 0; i < insts_.size(); i++) {
+    const auto& inst = insts_[i];
+    Status inst_s = inst->CommitWrites(inst_keys[i]);
+    if (!inst_s.ok() && s.ok()) {
+      LOG(WARNING) << "commit writes of instance " << inst->GetIndex() << " failed, " << inst_s.ToString();
+      s = inst_s;
+    }
+  }
+  return s;
+}
+
 rocksdb::DB* Storage::GetDBByIndex(int index) {
   if (index < 0 || index >= db_instance_num_) {
     LOG(WARNING) << "Invalid DB Index: " << index << "total: "
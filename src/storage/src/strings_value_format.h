@@ -13,27 +13,24 @@
 
 namespace storage {
 /*
-* | type | value | reserve | cdate | timestamp |
-* |  1B  |       |   16B   |   8B  |     8B    |
+* | type | value | suffix |
+* |  1B  |       |        |
+* suffix is either | reserve 16B | cdate 8B | timestamp 8B | (legacy)
+* or the compact one, see kCompactSuffixFlag
 */
 class StringsValue : public InternalValue {
  public:
   explicit StringsValue(const rocksdb::Slice& user_value) : InternalValue(DataType::kStrings, user_value) {}
   virtual rocksdb::Slice Encode() override {
     size_t usize = user_value_.size();
-    size_t needed = usize + kSuffixReserveLength + 2 * kTimestampLength + kTypeLength;
+    size_t needed = usize + SuffixLength(ctime_, etime_, true) + kTypeLength;
     char* dst = ReAllocIfNeeded(needed);
     memcpy(dst, &type_, sizeof(type_));
     dst += sizeof(type_);
-    char* start_pos = dst;
 
     memcpy(dst, user_value_.data(), usize);
     dst += usize;
-    memcpy(dst, reserve_, kSuffixReserveLength);
-    dst += kSuffixReserveLength;
-    EncodeFixed64(dst, ctime_);
-    dst += kTimestampLength;
-    EncodeFixed64(dst, etime_);
+    EncodeSuffix(dst, reserve_, ctime_, etime_, true);
     return {start_, needed};
   }
 };
@@ -42,66 +39,35 @@ class ParsedStringsValue : public ParsedInternalValue {
  public:
   // Use this constructor after rocksdb::DB::Get();
   explicit ParsedStringsValue(std::string* internal_value_str) : ParsedInternalValue(internal_value_str) {
-    if (internal_value_str->size() >= kStringsValueMinLength) {
-      size_t offset = 0;
-      type_ = static_cast<DataType>(static_cast<uint8_t>((*internal_value_str)[0]));
-      offset += kTypeLength;
-      user_value_ = rocksdb::Slice(internal_value_str->data() + offset,
-                                   internal_value_str->size() - kStringsValueSuffixLength - offset);
-      offset += user_value_.size();
-      memcpy(reserve_, internal_value_str->data() + offset, kSuffixReserveLength);
-      offset += kSuffixReserveLength;
-      ctime_ = DecodeFixed64(internal_value_str->data() + offset);
-      offset += sizeof(ctime_);
-      etime_ = DecodeFixed64(internal_value_str->data() + offset);
-    }
+    Decode(*internal_value_str);
   }
 
   // Use this constructor in rocksdb::CompactionFilter::Filter();
   explicit ParsedStringsValue(const rocksdb::Slice& internal_value_slice) : ParsedInternalValue(internal_value_slice) {
-    if (internal_value_slice.size() >= kStringsValueMinLength) {
-      size_t offset = 0;
-      type_ = static_cast<DataType>(static_cast<uint8_t>(internal_value_slice[0]));
-      offset += kTypeLength;
-      user_value_ = rocksdb::Slice(internal_value_slice.data() + offset, internal_value_slice.size() - kStringsValueSuffixLength - offset);
-      offset += user_value_.size();
-      memcpy(reserve_, internal_value_slice.data() + offset, kSuffixReserveLength);
-      offset += kSuffixReserveLength;
-      ctime_ = DecodeFixed64(internal_value_slice.data() + offset);
-      offset += kTimestampLength;
-      etime_ = DecodeFixed64(internal_value_slice.data() + offset);
-    }
+    Decode(internal_value_slice);
   }
 
   void StripSuffix() override {
-    if (value_) {
+    if (value_ && suffix_length_ != 0) {
+      value_->erase(value_->size() - suffix_length_, suffix_length_);
       value_->erase(0, kTypeLength);
-      value_->erase(value_->size() - kStringsValueSuffixLength, kStringsValueSuffixLength);
     }
   }
 
   // Strings type do not have version field;
   void SetVersionToValue() override {}
 
-  void SetCtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() -
-                  kStringsValueSuffixLength + kSuffixReserveLength;
-      EncodeFixed64(dst, ctime_);
-    }
-  }
+  void SetCtimeToValue() override { SetSuffixToValue(true); }
+
+  void SetEtimeToValue() override { SetSuffixToValue(true); }
 
-  void SetEtimeToValue() override {
-    if (value_) {
-      char* dst = const_cast<char*>(value_->data()) + value_->size() -
-                  kStringsValueSuffixLength + kSuffixReserveLength + kTimestampLength;
-      EncodeFixed64(dst, etime_);
+ private:
+  void Decode(const rocksdb::Slice& value) {
+    if (value.size() > kTypeLength && DecodeSuffix(value.data() + kTypeLength, value.size() - kTypeLength, true)) {
+      type_ = static_cast<DataType>(static_cast<uint8_t>(value[0]));
+      user_value_ = rocksdb::Slice(value.data() + kTypeLength, value.size() - kTypeLength - suffix_length_);
     }
   }
-
-private:
- const static size_t kStringsValueSuffixLength = 2 * kTimestampLength + kSuffixReserveLength;
- const static size_t kStringsValueMinLength = kStringsValueSuffixLength + kTypeLength;
 };
 
 }  //  namespace storage
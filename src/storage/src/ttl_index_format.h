@@ -0,0 +1,62 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_TTL_INDEX_FORMAT_H_
+#define SRC_TTL_INDEX_FORMAT_H_
+
+#include <string>
+
+#include "storage/storage_define.h"
+
+namespace storage {
+
+/*
+ * Entry of kTTLIndexCF, one for every etime set on a key, the value is empty:
+ * | etime | key |
+ * |  8B   |     |
+ * etime is stored big-endian so that the entries are ordered by time.
+ * An entry only tells the key may expire at etime, the meta value is
+ * the reference, an entry whose etime no longer matches it is stale.
+ */
+class TTLIndexKey {
+ public:
+  TTLIndexKey(uint64_t etime, const Slice& key) : etime_(etime), key_(key) {}
+
+  std::string Encode() const {
+    std::string dst(sizeof(etime_), '\0');
+    for (size_t i = 0; i < sizeof(etime_); i++) {
+      dst[i] = static_cast<char>((etime_ >> (8 * (sizeof(etime_) - 1 - i))) & 0xff);
+    }
+    dst.append(key_.data(), key_.size());
+    return dst;
+  }
+
+ private:
+  uint64_t etime_ = 0;
+  Slice key_;
+};
+
+class ParsedTTLIndexKey {
+ public:
+  explicit ParsedTTLIndexKey(const Slice& key) {
+    if (key.size() < sizeof(etime_)) {
+      return;
+    }
+    for (size_t i = 0; i < sizeof(etime_); i++) {
+      etime_ = (etime_ << 8) | static_cast<uint8_t>(key[i]);
+    }
+    key_ = Slice(key.data() + sizeof(etime_), key.size() - sizeof(etime_));
+  }
+
+  uint64_t Etime() const { return etime_; }
+  Slice Key() const { return key_; }
+
+ private:
+  uint64_t etime_ = 0;
+  Slice key_;
+};
+
+}  //  namespace storage
+#endif  // SRC_TTL_INDEX_FORMAT_H_
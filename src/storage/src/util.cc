@@ -212,13 +212,14 @@ int CalculateStartAndEndKey(const std::string& key, std::string* start_key, std:
   if (key.empty()) {
     return 0;
   }
-  size_t usize = kPrefixReserveLength + key.size() + kEncodedKeyDelimSize;
+  size_t prefix_length = KeyPrefixReserveLength();
+  size_t usize = prefix_length + key.size() + kEncodedKeyDelimSize;
   size_t nzero = std::count(key.begin(), key.end(), kNeedTransformCharacter);
   usize += nzero;
   auto dst = std::make_unique<char[]>(usize);
   char* ptr = dst.get();
-  memset(ptr, kNeedTransformCharacter, kPrefixReserveLength);
-  ptr += kPrefixReserveLength;
+  memset(ptr, kNeedTransformCharacter, prefix_length);
+  ptr += prefix_length;
   ptr = storage::EncodeUserKey(Slice(key), ptr, nzero);
   if (start_key) {
     *start_key = std::string(dst.get(), ptr);
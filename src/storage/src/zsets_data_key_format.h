@@ -14,6 +14,7 @@ namespace storage {
 /* zset score to member data key format:
 * | reserve1 | key | version | score | member |  reserve2 |
 * |    8B    |     |    8B   |  8B   |        |    16B    |
+* the reserves are left out by the compact key format, see KeyFormat
  */
 class ZSetsScoreKey {
  public:
@@ -29,7 +30,9 @@ class ZSetsScoreKey {
   }
 
   Slice Encode() {
-    size_t meta_size = sizeof(reserve1_) + sizeof(version_) + sizeof(score_) + sizeof(reserve2_);
+    size_t prefix_length = KeyPrefixReserveLength();
+    size_t suffix_length = KeySuffixReserveLength();
+    size_t meta_size = prefix_length + sizeof(version_) + sizeof(score_) + suffix_length;
     size_t usize = key_.size() + member_.size() + kEncodedKeyDelimSize;
     size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
     usize += nzero;
@@ -48,8 +51,8 @@ class ZSetsScoreKey {
 
     start_ = dst;
     // reserve1: 8 byte
-    memcpy(dst, reserve1_, sizeof(reserve1_));
-    dst += sizeof(reserve1_);
+    memcpy(dst, reserve1_, prefix_length);
+    dst += prefix_length;
     // key
     dst = EncodeUserKey(key_, dst, nzero);
     // version 8 byte
@@ -63,7 +66,7 @@ class ZSetsScoreKey {
     memcpy(dst, member_.data(), member_.size());
     dst += member_.size();
     // reserve2 16 byte
-    memcpy(dst, reserve2_, sizeof(reserve2_));
+    memcpy(dst, reserve2_, suffix_length);
     return Slice(start_, needed);
   }
 
@@ -95,9 +98,9 @@ class ParsedZSetsScoreKey {
   void decode(const char* ptr, const char* end_ptr) {
     const char* start = ptr;
     // skip head reserve1_
-    ptr += sizeof(reserve1_);
+    ptr += KeyPrefixReserveLength();
     // skip tail reserve2_
-    end_ptr -= sizeof(reserve2_);
+    end_ptr -= KeySuffixReserveLength();
     // user key
     ptr = DecodeUserKey(ptr, std::distance(ptr, end_ptr), &key_str_);
     version_ = DecodeFixed64(ptr);
@@ -116,9 +119,7 @@ class ParsedZSetsScoreKey {
 
  private:
   std::string key_str_;
-  char reserve1_[8] = {0};
   uint64_t version_ = uint64_t(-1);
-  char reserve2_[16] = {0};
   double score_ = 0.0;
   Slice member_;
 };
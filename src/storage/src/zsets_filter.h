@@ -20,8 +20,11 @@ namespace storage {
 
 class ZSetsScoreFilter : public rocksdb::CompactionFilter {
  public:
-  ZSetsScoreFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type)
-      : db_(db), cf_handles_ptr_(handles_ptr), type_(type) {}
+  ZSetsScoreFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type,
+                   CompactionFilterStats* stats = nullptr)
+      : db_(db), cf_handles_ptr_(handles_ptr), stats_(stats), type_(type) {
+    default_read_options_.fill_cache = false;
+  }
 
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
@@ -37,10 +40,11 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
 
     const char* ptr = key.data();
     int key_size = key.size();
-    ptr = SeekUserkeyDelim(ptr + kPrefixReserveLength, key_size - kPrefixReserveLength);
+    ptr = SeekUserkeyDelim(ptr + KeyPrefixReserveLength(), key_size - KeyPrefixReserveLength());
     std::string meta_key_enc(key.data(), std::distance(key.data(), ptr));
-    meta_key_enc.append(kSuffixReserveLength, kNeedTransformCharacter);
+    meta_key_enc.append(KeySuffixReserveLength(), kNeedTransformCharacter);
 
+    AddCompactionFilterStat(stats_, &CompactionFilterStats::filtered_keys);
     if (meta_key_enc != cur_key_) {
       cur_key_ = meta_key_enc;
       cur_meta_etime_ = 0;
@@ -51,7 +55,8 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
       if (cf_handles_ptr_->empty()) {
         return false;
       }
-      Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[0], cur_key_, &meta_value);
+      AddCompactionFilterStat(stats_, &CompactionFilterStats::meta_lookups);
+      rocksdb::Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[0], cur_key_, &meta_value);
       if (s.ok()) {
         /*
          * The elimination policy for keys of the Data type is that if the key
@@ -80,19 +85,25 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
       return true;
     }
 
+    if (cur_meta_version_ > parsed_zsets_score_key.Version()) {
+      TRACE("Drop[score_key_version < cur_meta_version]");
+      return true;
+    }
+    // written since the meta was read, the meta read tells nothing about it
+    if (cur_meta_version_ < parsed_zsets_score_key.Version()) {
+      AddCompactionFilterStat(stats_, &CompactionFilterStats::skipped_keys);
+      TRACE("Reserve[score_key_version > cur_meta_version]");
+      return false;
+    }
+
     int64_t unix_time;
     rocksdb::Env::Default()->GetCurrentTime(&unix_time);
     if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time)) {
       TRACE("Drop[Timeout]");
       return true;
     }
-    if (cur_meta_version_ > parsed_zsets_score_key.Version()) {
-      TRACE("Drop[score_key_version < cur_meta_version]");
-      return true;
-    } else {
-      TRACE("Reserve[score_key_version == cur_meta_version]");
-      return false;
-    }
+    TRACE("Reserve[score_key_version == cur_meta_version]");
+    return false;
   }
 
   /*
@@ -117,6 +128,7 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
  private:
   rocksdb::DB* db_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  CompactionFilterStats* stats_ = nullptr;
   rocksdb::ReadOptions default_read_options_;
   mutable std::string cur_key_;
   mutable bool meta_not_found_ = false;
@@ -127,12 +139,13 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
 
 class ZSetsScoreFilterFactory : public rocksdb::CompactionFilterFactory {
  public:
-  ZSetsScoreFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type)
-      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), type_(type) {}
+  ZSetsScoreFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, enum DataType type,
+                          CompactionFilterStats* stats = nullptr)
+      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), type_(type), stats_(stats) {}
 
   std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
       const rocksdb::CompactionFilter::Context& context) override {
-    return std::make_unique<ZSetsScoreFilter>(*db_ptr_, cf_handles_ptr_, type_);
+    return std::make_unique<ZSetsScoreFilter>(*db_ptr_, cf_handles_ptr_, type_, stats_);
   }
 
   const char* Name() const override { return "ZSetsScoreFilterFactory"; }
@@ -141,6 +154,43 @@ class ZSetsScoreFilterFactory : public rocksdb::CompactionFilterFactory {
   rocksdb::DB** db_ptr_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
   enum DataType type_ = DataType::kNones;
+  CompactionFilterStats* stats_ = nullptr;
+};
+
+/*
+ * The keys of zset rank group cf are zset score keys behind a level byte,
+ * see ZSetsRankIndex, and are filtered like them
+ */
+class ZSetsRankGroupFilter : public ZSetsScoreFilter {
+ public:
+  using ZSetsScoreFilter::ZSetsScoreFilter;
+
+  bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
+              bool* value_changed) const override {
+    return ZSetsScoreFilter::Filter(level, rocksdb::Slice(key.data() + 1, key.size() - 1), value, new_value,
+                                    value_changed);
+  }
+
+  const char* Name() const override { return "ZSetsRankGroupFilter"; }
+};
+
+class ZSetsRankGroupFilterFactory : public rocksdb::CompactionFilterFactory {
+ public:
+  ZSetsRankGroupFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr,
+                              CompactionFilterStats* stats = nullptr)
+      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr), stats_(stats) {}
+
+  std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+      const rocksdb::CompactionFilter::Context& context) override {
+    return std::make_unique<ZSetsRankGroupFilter>(*db_ptr_, cf_handles_ptr_, DataType::kZSets, stats_);
+  }
+
+  const char* Name() const override { return "ZSetsRankGroupFilterFactory"; }
+
+ private:
+  rocksdb::DB** db_ptr_ = nullptr;
+  std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  CompactionFilterStats* stats_ = nullptr;
 };
 
 }  //  namespace storage
@@ -0,0 +1,764 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/zsets_rank_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <unordered_set>
+
+#include "src/base_data_value_format.h"
+#include "src/coding.h"
+
+namespace storage {
+
+// The sentinel holds one of these instead of a count while the index is built
+static const char kZSetsRankBuilding = 0;
+static const char kZSetsRankBuildingDirty = 1;
+
+// The number of members an entry of level holds after it is cut
+static int64_t LevelSize(int level) {
+  int64_t size = kZSetsRankBlockSize;
+  for (int idx = 0; idx < level; ++idx) {
+    size *= kZSetsRankGroupSize;
+  }
+  return size;
+}
+
+// The boundary an entry of level is keyed by
+static Slice BoundaryOf(int level, const Slice& key) {
+  return level == 0 ? key : Slice(key.data() + 1, key.size() - 1);
+}
+
+static int64_t DecodeBlockCount(const Slice& value) {
+  ParsedBaseDataValue parsed_value(value);
+  if (parsed_value.UserValue().size() < sizeof(uint32_t)) {
+    return 0;
+  }
+  return DecodeFixed32(parsed_value.UserValue().data());
+}
+
+static void DeleteLevels(rocksdb::WriteBatch* batch, rocksdb::ColumnFamilyHandle* rank_cf,
+                         rocksdb::ColumnFamilyHandle* group_cf, const std::string& begin, const std::string& end) {
+  batch->DeleteRange(rank_cf, begin, end);
+  for (int level = 1; level <= kZSetsRankMaxLevel; ++level) {
+    std::string level_byte(1, static_cast<char>(level));
+    batch->DeleteRange(group_cf, level_byte + begin, level_byte + end);
+  }
+}
+
+ZSetsRankIndex::ZSetsRankIndex(rocksdb::DB* db, const std::vector<rocksdb::ColumnFamilyHandle*>& handles,
+                               const Slice& key, uint64_t version)
+    : db_(db), score_cf_(handles[kZsetsScoreCF]), rank_cf_(handles[kZsetsRankCF]),
+      group_cf_(handles[kZsetsRankGroupCF]), comparator_(handles[kZsetsRankCF]->GetComparator()),
+      key_(key.ToString()), version_(version), levels_(kZSetsRankMaxLevel + 1) {
+  ZSetsScoreKey sentinel_key(key_, version_, -std::numeric_limits<double>::infinity(), Slice());
+  sentinel_ = sentinel_key.Encode().ToString();
+  ZSetsScoreKey upper_bound_key(key_, version_ + 1, -std::numeric_limits<double>::infinity(), Slice());
+  upper_bound_ = upper_bound_key.Encode().ToString();
+  for (int level = 0; level <= kZSetsRankMaxLevel; ++level) {
+    level_lower_[level] = LevelKey(level, sentinel_);
+    level_upper_[level] = LevelKey(level, upper_bound_);
+    level_lower_slices_[level] = Slice(level_lower_[level]);
+    level_upper_slices_[level] = Slice(level_upper_[level]);
+  }
+}
+
+ZSetsRankIndex::~ZSetsRankIndex() {
+  for (auto iter : iters_) {
+    delete iter;
+  }
+}
+
+void ZSetsRankIndex::DeleteVersion(rocksdb::WriteBatch* batch,
+                                   const std::vector<rocksdb::ColumnFamilyHandle*>& handles, const Slice& key,
+                                   uint64_t version) {
+  ZSetsScoreKey begin(key, version, -std::numeric_limits<double>::infinity(), Slice());
+  ZSetsScoreKey end(key, version + 1, -std::numeric_limits<double>::infinity(), Slice());
+  DeleteLevels(batch, handles[kZsetsRankCF], handles[kZsetsRankGroupCF], begin.Encode().ToString(),
+               end.Encode().ToString());
+}
+
+std::string ZSetsRankIndex::LevelKey(int level, const Slice& boundary) const {
+  if (level == 0) {
+    return boundary.ToString();
+  }
+  std::string level_key(1, static_cast<char>(level));
+  level_key.append(boundary.data(), boundary.size());
+  return level_key;
+}
+
+rocksdb::Iterator* ZSetsRankIndex::NewLevelIterator(const rocksdb::ReadOptions& read_options, int level) {
+  rocksdb::ReadOptions iter_options(read_options);
+  iter_options.iterate_lower_bound = &level_lower_slices_[level];
+  iter_options.iterate_upper_bound = &level_upper_slices_[level];
+  return db_->NewIterator(iter_options, level == 0 ? rank_cf_ : group_cf_);
+}
+
+void ZSetsRankIndex::PutEntry(rocksdb::WriteBatch* batch, int level, const std::string& boundary, int64_t count,
+                              int top_level) const {
+  char buf[5];
+  EncodeFixed32(buf, static_cast<uint32_t>(count < 0 ? 0 : count));
+  size_t size = sizeof(uint32_t);
+  if (level == 0 && IsSentinel(boundary) && top_level > 1) {
+    buf[size++] = static_cast<char>(top_level);
+  }
+  BaseDataValue entry_value(Slice(buf, size));
+  batch->Put(level == 0 ? rank_cf_ : group_cf_, LevelKey(level, boundary), entry_value.Encode());
+}
+
+Status ZSetsRankIndex::ReadSentinel(const rocksdb::ReadOptions& read_options, State* state, int* top_level) {
+  *top_level = 1;
+  std::string block_value;
+  Status s = db_->Get(read_options, rank_cf_, sentinel_, &block_value);
+  if (s.IsNotFound()) {
+    *state = State::kMissing;
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedBaseDataValue parsed_value(&block_value);
+  Slice user_value = parsed_value.UserValue();
+  if (user_value.size() >= sizeof(uint32_t)) {
+    *state = State::kIndexed;
+    if (user_value.size() > sizeof(uint32_t)) {
+      *top_level = static_cast<uint8_t>(user_value[sizeof(uint32_t)]);
+      if (*top_level < 1 || *top_level > kZSetsRankMaxLevel) {
+        return Status::Corruption("zset rank index has a bad top level");
+      }
+    }
+  } else if (user_value.size() == 1 && user_value[0] == kZSetsRankBuilding) {
+    *state = State::kBuilding;
+  } else {
+    *state = State::kBuildingDirty;
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::GetState(const rocksdb::ReadOptions& read_options, State* state) {
+  int top_level = 1;
+  return ReadSentinel(read_options, state, &top_level);
+}
+
+void ZSetsRankIndex::MarkBuilding(rocksdb::WriteBatch* batch) {
+  BaseDataValue marker(Slice(&kZSetsRankBuilding, 1));
+  batch->Put(rank_cf_, sentinel_, marker.Encode());
+}
+
+Status ZSetsRankIndex::Build(const rocksdb::ReadOptions& read_options, rocksdb::WriteBatch* batch) {
+  rocksdb::ReadOptions iter_options(read_options);
+  iter_options.fill_cache = false;
+  iter_options.iterate_lower_bound = &level_lower_slices_[0];
+  iter_options.iterate_upper_bound = &level_upper_slices_[0];
+
+  // entries left by an earlier index of the version go first, the entries
+  // put after them in the batch win
+  DeleteLevels(batch, rank_cf_, group_cf_, sentinel_, upper_bound_);
+
+  // the open entry of every level, children counts the entries of the
+  // level below in it
+  int top_level = 1;
+  int64_t top_entries = 1;
+  int64_t total = 0;
+  int64_t sentinel_count = 0;
+  std::vector<std::string> heads(kZSetsRankMaxLevel + 1, sentinel_);
+  std::vector<int64_t> counts(kZSetsRankMaxLevel + 1, 0);
+  std::vector<int64_t> children(kZSetsRankMaxLevel + 1, 1);
+  // the sentinel block is put last, it carries the top level
+  auto put = [&](int level) {
+    if (level == 0 && IsSentinel(heads[0])) {
+      sentinel_count = counts[0];
+    } else {
+      PutEntry(batch, level, heads[level], counts[level], top_level);
+    }
+  };
+  // close the open block and open one at boundary, and so on up the levels
+  // whose open entry is full
+  auto roll = [&](const std::string& boundary) {
+    for (int level = 0;; ++level) {
+      put(level);
+      heads[level] = boundary;
+      counts[level] = 0;
+      if (level == top_level) {
+        if (top_level == kZSetsRankMaxLevel || ++top_entries <= kZSetsRankGroupSize) {
+          return;
+        }
+        // the top level is full, a level above holds its entries so far
+        ++top_level;
+        counts[top_level] = total;
+        children[top_level] = kZSetsRankGroupSize;
+        top_entries = 1;
+      }
+      if (++children[level + 1] <= kZSetsRankGroupSize) {
+        return;
+      }
+      children[level + 1] = 1;
+    }
+  };
+
+  rocksdb::Iterator* score_iter = db_->NewIterator(iter_options, score_cf_);
+  for (score_iter->Seek(sentinel_); score_iter->Valid(); score_iter->Next()) {
+    if (counts[0] == kZSetsRankBlockSize) {
+      roll(score_iter->key().ToString());
+    }
+    for (int level = 0; level <= top_level; ++level) {
+      counts[level]++;
+    }
+    total++;
+  }
+  Status s = score_iter->status();
+  delete score_iter;
+  if (!s.ok()) {
+    return s;
+  }
+  for (int level = 0; level <= top_level; ++level) {
+    put(level);
+  }
+  PutEntry(batch, 0, sentinel_, sentinel_count, top_level);
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Prepare(const rocksdb::ReadOptions& read_options, bool fresh) {
+  read_options_ = read_options;
+  if (fresh) {
+    state_ = State::kIndexed;
+    top_level_ = 1;
+    sentinel_only_ = true;
+    levels_[0][sentinel_] = Entry{0, true, false, false, sentinel_};
+    levels_[1][sentinel_] = Entry{0, true};
+    return Status::OK();
+  }
+
+  Status s = ReadSentinel(read_options_, &state_, &top_level_);
+  if (!s.ok() || state_ != State::kIndexed) {
+    return s;
+  }
+  for (int level = 0; level <= top_level_; ++level) {
+    iters_.push_back(NewLevelIterator(read_options_, level));
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Locate(int level, const Slice& target, std::string* boundary) {
+  if (sentinel_only_) {
+    *boundary = sentinel_;
+    return Status::OK();
+  }
+  rocksdb::Iterator* iter = iters_[level];
+  iter->SeekForPrev(LevelKey(level, target));
+  if (!iter->Valid()) {
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+    return Status::Corruption("zset rank index lost a sentinel");
+  }
+  *boundary = BoundaryOf(level, iter->key()).ToString();
+  if (levels_[level].find(*boundary) == levels_[level].end()) {
+    // the group holding the entry is loaded with it, all the way up
+    Entry entry;
+    entry.count = DecodeBlockCount(iter->value());
+    if (level < top_level_) {
+      Status s = Locate(level + 1, *boundary, &entry.parent);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    levels_[level].emplace(*boundary, std::move(entry));
+  }
+  return Status::OK();
+}
+
+void ZSetsRankIndex::AddToAncestors(int level, const std::string& parent, int64_t delta) {
+  std::string boundary = parent;
+  for (int up = level + 1; up <= top_level_ && !boundary.empty(); ++up) {
+    Entry& entry = levels_[up][boundary];
+    entry.count += delta;
+    entry.dirty = true;
+    boundary = entry.parent;
+  }
+}
+
+Status ZSetsRankIndex::ChangeMember(double score, const Slice& member, int delta) {
+  // no index to keep up to date, a build under way is told to start over
+  if (state_ != State::kIndexed) {
+    return Status::OK();
+  }
+  ZSetsScoreKey zsets_score_key(key_, version_, score, member);
+  Slice score_key = zsets_score_key.Encode();
+  std::string boundary;
+  Status s = Locate(0, score_key, &boundary);
+  if (!s.ok()) {
+    return s;
+  }
+  Entry& block = levels_[0][boundary];
+  block.count += delta;
+  block.dirty = true;
+  block.changes.emplace_back(score_key.ToString(), delta);
+  AddToAncestors(0, block.parent, delta);
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::AddMember(double score, const Slice& member) { return ChangeMember(score, member, 1); }
+
+Status ZSetsRankIndex::DelMember(double score, const Slice& member) { return ChangeMember(score, member, -1); }
+
+bool ZSetsRankIndex::IsHead(int level, const std::string& boundary) const {
+  // the group an entry starts is loaded with it
+  if (level >= top_level_) {
+    return false;
+  }
+  auto iter = levels_[level + 1].find(boundary);
+  return iter != levels_[level + 1].end() && !iter->second.deleted;
+}
+
+Status ZSetsRankIndex::WriteTo(rocksdb::WriteBatch* batch) {
+  if (state_ == State::kBuilding || state_ == State::kBuildingDirty) {
+    BaseDataValue marker(Slice(&kZSetsRankBuildingDirty, 1));
+    batch->Put(rank_cf_, sentinel_, marker.Encode());
+    return Status::OK();
+  } else if (state_ != State::kIndexed) {
+    return Status::OK();
+  }
+
+  Status s = Rebalance();
+  if (!s.ok()) {
+    return s;
+  }
+  // the sentinels and the first entry of every group stay even when empty,
+  // so every group starts at an entry of the level below. Top down, as the
+  // first entry of a group dropped here is dropped too if empty
+  for (int level = top_level_; level >= 0; --level) {
+    for (auto& item : levels_[level]) {
+      if (item.second.dirty && item.second.count <= 0 && !IsSentinel(item.first) && !IsHead(level, item.first)) {
+        item.second.deleted = true;
+      }
+    }
+  }
+  for (int level = 0; level <= top_level_; ++level) {
+    for (const auto& item : levels_[level]) {
+      if (!item.second.dirty) {
+        continue;
+      }
+      if (item.second.deleted) {
+        batch->Delete(level == 0 ? rank_cf_ : group_cf_, LevelKey(level, item.first));
+      } else {
+        PutEntry(batch, level, item.first, item.second.count, top_level_);
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Rebalance() {
+  // level by level from the blocks up, as a split or merge changes the
+  // entries the groups above are cut from. Splits go first, an entry which
+  // was split is not merged into
+  Status s;
+  for (int level = 0; level <= top_level_; ++level) {
+    std::vector<std::string> boundaries;
+    for (const auto& item : levels_[level]) {
+      if (item.second.dirty) {
+        boundaries.push_back(item.first);
+      }
+    }
+    int64_t level_size = LevelSize(level);
+    bool top_split = false;
+    for (const auto& boundary : boundaries) {
+      if (levels_[level][boundary].count > 2 * level_size) {
+        s = level == 0 ? SplitBlock(boundary) : SplitGroup(level, boundary);
+        if (!s.ok()) {
+          return s;
+        }
+        top_split = top_split || level == top_level_;
+      }
+    }
+    for (const auto& boundary : boundaries) {
+      const Entry& entry = levels_[level][boundary];
+      if (!IsSentinel(boundary) && !IsHead(level, boundary) && !entry.split && !entry.deleted && entry.count > 0 &&
+          entry.count < level_size / 8) {
+        s = Merge(level, boundary);
+        if (!s.ok()) {
+          return s;
+        }
+      }
+    }
+    if (top_split && top_level_ < kZSetsRankMaxLevel) {
+      s = Grow();
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::NextBoundary(int level, const std::string& boundary, std::string* next) {
+  next->clear();
+  std::string level_key = LevelKey(level, boundary);
+  rocksdb::Iterator* iter = NewLevelIterator(read_options_, level);
+  iter->Seek(level_key);
+  if (iter->Valid() && iter->key() == level_key) {
+    iter->Next();
+  }
+  if (iter->Valid()) {
+    *next = BoundaryOf(level, iter->key()).ToString();
+  }
+  Status s = iter->status();
+  delete iter;
+  return s;
+}
+
+Status ZSetsRankIndex::PrevBoundary(int level, const std::string& boundary, std::string* prev, int64_t* count) {
+  prev->clear();
+  std::string level_key = LevelKey(level, boundary);
+  rocksdb::Iterator* iter = NewLevelIterator(read_options_, level);
+  iter->SeekForPrev(level_key);
+  if (iter->Valid() && iter->key() == level_key) {
+    iter->Prev();
+  }
+  if (iter->Valid()) {
+    *prev = BoundaryOf(level, iter->key()).ToString();
+    *count = DecodeBlockCount(iter->value());
+  }
+  Status s = iter->status();
+  delete iter;
+  return s;
+}
+
+Status ZSetsRankIndex::Children(int level, const std::string& start, const std::string& end,
+                                std::vector<std::pair<std::string, int64_t>>* children) {
+  auto less = [this](const std::string& a, const std::string& b) { return comparator_->Compare(a, b) < 0; };
+  std::map<std::string, int64_t, decltype(less)> entries(less);
+  rocksdb::Iterator* iter = NewLevelIterator(read_options_, level);
+  for (iter->Seek(LevelKey(level, start)); iter->Valid(); iter->Next()) {
+    Slice boundary = BoundaryOf(level, iter->key());
+    if (!end.empty() && comparator_->Compare(boundary, end) >= 0) {
+      break;
+    }
+    entries[boundary.ToString()] = DecodeBlockCount(iter->value());
+  }
+  Status s = iter->status();
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+  for (const auto& item : levels_[level]) {
+    if (comparator_->Compare(item.first, start) < 0 || (!end.empty() && comparator_->Compare(item.first, end) >= 0)) {
+      continue;
+    }
+    if (item.second.deleted || (item.second.count <= 0 && item.first != start && !IsSentinel(item.first))) {
+      entries.erase(item.first);
+    } else {
+      entries[item.first] = item.second.count;
+    }
+  }
+  children->assign(entries.begin(), entries.end());
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::SplitBlock(const std::string& boundary) {
+  // the block ends at the next boundary, walk the members in between as they
+  // are once this write is applied and recount them, so a drifted count
+  // heals itself here
+  std::string next_boundary;
+  Status s = NextBoundary(0, boundary, &next_boundary);
+  if (!s.ok()) {
+    return s;
+  }
+  // a member added and deleted again by this write nets out
+  const Entry& block = levels_[0][boundary];
+  std::unordered_map<std::string, int> net_changes;
+  for (const auto& change : block.changes) {
+    net_changes[change.first] += change.second;
+  }
+  std::vector<std::string> added;
+  std::unordered_set<std::string> deleted;
+  for (const auto& change : net_changes) {
+    if (change.second > 0) {
+      added.push_back(change.first);
+    } else if (change.second < 0) {
+      deleted.insert(change.first);
+    }
+  }
+  std::sort(added.begin(), added.end(),
+            [this](const std::string& a, const std::string& b) { return comparator_->Compare(a, b) < 0; });
+
+  int64_t walked = 0;
+  std::vector<std::string> cuts;
+  auto walk = [&](const Slice& score_key) {
+    if (walked != 0 && walked % kZSetsRankBlockSize == 0) {
+      cuts.push_back(score_key.ToString());
+    }
+    walked++;
+  };
+  rocksdb::ReadOptions read_options(read_options_);
+  read_options.fill_cache = false;
+  read_options.iterate_lower_bound = &level_lower_slices_[0];
+  read_options.iterate_upper_bound = &level_upper_slices_[0];
+  auto added_iter = added.begin();
+  rocksdb::Iterator* score_iter = db_->NewIterator(read_options, score_cf_);
+  for (score_iter->Seek(boundary); score_iter->Valid(); score_iter->Next()) {
+    if (!next_boundary.empty() && comparator_->Compare(score_iter->key(), next_boundary) >= 0) {
+      break;
+    }
+    for (; added_iter != added.end() && comparator_->Compare(*added_iter, score_iter->key()) < 0; ++added_iter) {
+      walk(*added_iter);
+    }
+    if (deleted.find(score_iter->key().ToString()) == deleted.end()) {
+      walk(score_iter->key());
+    }
+  }
+  for (; added_iter != added.end(); ++added_iter) {
+    walk(*added_iter);
+  }
+  s = score_iter->status();
+  delete score_iter;
+  if (!s.ok()) {
+    return s;
+  }
+
+  // every block holds kZSetsRankBlockSize members, the tail is folded into
+  // the last block so no undersized block is produced by a split
+  Entry& split_block = levels_[0][boundary];
+  std::string parent = split_block.parent;
+  AddToAncestors(0, parent, walked - split_block.count);
+  int64_t nblocks = std::max<int64_t>(1, walked / kZSetsRankBlockSize);
+  split_block.count = nblocks == 1 ? walked : kZSetsRankBlockSize;
+  split_block.split = true;
+  for (int64_t idx = 1; idx < nblocks; ++idx) {
+    int64_t block_count = idx == nblocks - 1 ? walked - idx * kZSetsRankBlockSize : kZSetsRankBlockSize;
+    levels_[0][cuts[idx - 1]] = Entry{block_count, true, false, true, parent};
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::SplitGroup(int level, const std::string& boundary) {
+  // the entries of the level below in the group as they are once this
+  // write is applied
+  std::string next_boundary;
+  Status s = NextBoundary(level, boundary, &next_boundary);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<std::pair<std::string, int64_t>> children;
+  s = Children(level - 1, boundary, next_boundary, &children);
+  if (!s.ok()) {
+    return s;
+  }
+
+  // cut at the first entry past the size of a group, the tail is folded
+  // into the last group if it is less than half of one
+  int64_t level_size = LevelSize(level);
+  int64_t walked = 0;
+  std::vector<std::pair<std::string, int64_t>> cuts;
+  cuts.emplace_back(boundary, 0);
+  for (const auto& child : children) {
+    if (cuts.back().second >= level_size) {
+      cuts.emplace_back(child.first, 0);
+    }
+    cuts.back().second += child.second;
+    walked += child.second;
+  }
+  if (cuts.size() > 1 && cuts.back().second < level_size / 2) {
+    cuts[cuts.size() - 2].second += cuts.back().second;
+    cuts.pop_back();
+  }
+  Entry& group = levels_[level][boundary];
+  std::string parent = group.parent;
+  AddToAncestors(level, parent, walked - group.count);
+  group.count = cuts.front().second;
+  group.split = true;
+  for (size_t idx = 1; idx < cuts.size(); ++idx) {
+    levels_[level][cuts[idx].first] = Entry{cuts[idx].second, true, false, true, parent};
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Merge(int level, const std::string& boundary) {
+  // the previous entry is in the same group, as the entry does not start one
+  std::string prev;
+  int64_t prev_count = 0;
+  Status s = PrevBoundary(level, boundary, &prev, &prev_count);
+  if (!s.ok() || prev.empty()) {
+    return s;
+  }
+  Entry& entry = levels_[level][boundary];
+  auto iter = levels_[level].find(prev);
+  if (iter == levels_[level].end()) {
+    iter = levels_[level].emplace(prev, Entry{prev_count, false, false, false, entry.parent}).first;
+  } else if (iter->second.deleted || iter->second.split) {
+    return Status::OK();
+  }
+  iter->second.count += entry.count;
+  iter->second.dirty = true;
+  entry.count = 0;
+  entry.deleted = true;
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Grow() {
+  // a level is added once the top one outgrows twice a group
+  std::vector<std::pair<std::string, int64_t>> entries;
+  Status s = Children(top_level_, sentinel_, std::string(), &entries);
+  if (!s.ok() || entries.size() <= static_cast<size_t>(2 * kZSetsRankGroupSize)) {
+    return s;
+  }
+  // the sentinel block carries the top level
+  std::string boundary;
+  s = Locate(0, sentinel_, &boundary);
+  if (!s.ok()) {
+    return s;
+  }
+  levels_[0][sentinel_].dirty = true;
+
+  int64_t total = 0;
+  for (const auto& entry : entries) {
+    total += entry.second;
+  }
+  for (auto& item : levels_[top_level_]) {
+    item.second.parent = sentinel_;
+  }
+  ++top_level_;
+  levels_[top_level_][sentinel_] = Entry{total, true};
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::SumBefore(const rocksdb::ReadOptions& read_options, int level, const std::string& start,
+                                 const Slice& target, int64_t* before, std::string* last) {
+  // add up the entries from start on which are followed by another one not
+  // greater than target, the last of them is the one holding target
+  std::string start_key = LevelKey(level, start);
+  int64_t count = 0;
+  *last = start;
+  rocksdb::Iterator* iter = NewLevelIterator(read_options, level);
+  for (iter->Seek(start_key); iter->Valid(); iter->Next()) {
+    Slice boundary = BoundaryOf(level, iter->key());
+    if (comparator_->Compare(boundary, target) > 0) {
+      break;
+    }
+    *before += count;
+    count = DecodeBlockCount(iter->value());
+    *last = boundary.ToString();
+  }
+  Status s = iter->status();
+  delete iter;
+  return s;
+}
+
+Status ZSetsRankIndex::CountBefore(const rocksdb::ReadOptions& read_options, double score, const Slice& member,
+                                   int32_t* before_count, bool* exact) {
+  State state;
+  int top_level = 1;
+  Status s = ReadSentinel(read_options, &state, &top_level);
+  if (!s.ok()) {
+    return s;
+  } else if (state != State::kIndexed) {
+    return Status::NotSupported("zset has no rank index");
+  }
+
+  ZSetsScoreKey zsets_score_key(key_, version_, score, member);
+  Slice target = zsets_score_key.Encode();
+
+  // sum up the entries of the top level before the one which holds the
+  // target, then those of every level below within the one found above
+  int64_t before = 0;
+  std::string boundary = sentinel_;
+  for (int level = top_level; level >= 0; --level) {
+    s = SumBefore(read_options, level, boundary, target, &before, &boundary);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  // then walk inside the block
+  rocksdb::ReadOptions iter_options(read_options);
+  iter_options.iterate_lower_bound = &level_lower_slices_[0];
+  iter_options.iterate_upper_bound = &level_upper_slices_[0];
+  *exact = false;
+  rocksdb::Iterator* score_iter = db_->NewIterator(iter_options, score_cf_);
+  for (score_iter->Seek(boundary); score_iter->Valid(); score_iter->Next(), ++before) {
+    int ret = comparator_->Compare(score_iter->key(), target);
+    if (ret >= 0) {
+      *exact = ret == 0;
+      break;
+    }
+  }
+  s = score_iter->status();
+  delete score_iter;
+  if (!s.ok()) {
+    return s;
+  }
+  *before_count = static_cast<int32_t>(before);
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Rank(const rocksdb::ReadOptions& read_options, double score, const Slice& member,
+                            int32_t* rank) {
+  bool exact = false;
+  Status s = CountBefore(read_options, score, member, rank, &exact);
+  if (s.ok() && !exact) {
+    return Status::NotFound();
+  }
+  return s;
+}
+
+Status ZSetsRankIndex::LowerBound(const rocksdb::ReadOptions& read_options, double score, const Slice& member,
+                                  int32_t* rank) {
+  bool exact = false;
+  return CountBefore(read_options, score, member, rank, &exact);
+}
+
+Status ZSetsRankIndex::SkipTo(const rocksdb::ReadOptions& read_options, int level, const std::string& start,
+                              int64_t index, int64_t* before, std::string* found) {
+  // find the entry from start on which holds the index-th member
+  std::string start_key = LevelKey(level, start);
+  found->clear();
+  rocksdb::Iterator* iter = NewLevelIterator(read_options, level);
+  for (iter->Seek(start_key); iter->Valid(); iter->Next()) {
+    int64_t count = DecodeBlockCount(iter->value());
+    if (*before + count > index) {
+      *found = BoundaryOf(level, iter->key()).ToString();
+      break;
+    }
+    *before += count;
+  }
+  Status s = iter->status();
+  delete iter;
+  return s;
+}
+
+Status ZSetsRankIndex::SeekToIndex(const rocksdb::ReadOptions& read_options, int32_t index,
+                                   rocksdb::Iterator* score_iter) {
+  State state;
+  int top_level = 1;
+  Status s = ReadSentinel(read_options, &state, &top_level);
+  if (!s.ok()) {
+    return s;
+  } else if (state != State::kIndexed) {
+    return Status::NotSupported("zset has no rank index");
+  }
+
+  int64_t before = 0;
+  std::string boundary = sentinel_;
+  for (int level = top_level; level >= 0 && !boundary.empty(); --level) {
+    s = SkipTo(read_options, level, boundary, index, &before, &boundary);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  bool found = false;
+  if (!boundary.empty()) {
+    score_iter->Seek(boundary);
+    for (int64_t skip = index - before; skip > 0 && score_iter->Valid(); --skip) {
+      score_iter->Next();
+    }
+    found = score_iter->Valid();
+  }
+  // counts drifted from the members, let the caller scan from the head
+  return found ? Status::OK() : Status::NotSupported("zset rank index out of range");
+}
+
+}  //  namespace storage
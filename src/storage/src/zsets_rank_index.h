@@ -0,0 +1,169 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_ZSETS_RANK_INDEX_H_
+#define SRC_ZSETS_RANK_INDEX_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
+
+#include "src/zsets_data_key_format.h"
+
+namespace storage {
+
+using Status = rocksdb::Status;
+
+// The number of members a block holds after it is cut
+const int64_t kZSetsRankBlockSize = 512;
+// The number of entries of the level below a group holds after it is cut
+const int64_t kZSetsRankGroupSize = 64;
+// The highest level of groups, a group of level 4 would hold 2^33 members,
+// more than a zset can rank
+const int kZSetsRankMaxLevel = 4;
+
+/*
+ * Rank index of a zset, a count tree.
+ *
+ * Level 0 cuts the score ordering of a zset into blocks, every block is one
+ * entry of kZsetsRankCF:
+ * | key | version | score | member |  =>  | count | suffix |
+ * |     |    8B   |  8B   |        |      |   4B  |        |
+ * the key is the lower boundary of the block, a ZSetsScoreKey, and the
+ * value is the number of members in [boundary, next boundary). The first
+ * block always starts at -inf (the sentinel), so each member belongs to
+ * exactly one block.
+ *
+ * Level l >= 1 cuts the entries of level l - 1 into groups in turn, every
+ * group is one entry of kZsetsRankGroupCF:
+ * | level | key | version | score | member |  =>  | count | suffix |
+ * |   1B  |     |    8B   |  8B   |        |      |   4B  |        |
+ * keyed by the boundary of its first entry and holding the number of
+ * members below it, see ZSetsRankGroupKeyComparatorImpl for the order.
+ * Every level starts at the sentinel too. The value of the sentinel block
+ * carries one more byte, the top level, when it is above 1. The top level
+ * is added once it outgrows twice a group and is kept for the life of the
+ * version.
+ *
+ * A rank is found by summing the entries of the top level, then of each
+ * level below within the entry holding the target, then walking one block.
+ * Counts, and the entries cut again because they grew too large or too
+ * small, are written in the same WriteBatch as the members.
+ *
+ * A zset written before the index existed has no sentinel, its reads fall
+ * back to scan and have the index built in the background, without the
+ * record lock, see Redis::ZsetsBuildRankIndex. While it is built the
+ * sentinel holds a marker instead of a count, which the writes of the zset
+ * flag as dirty so that a build which missed them is thrown away.
+ */
+class ZSetsRankIndex {
+ public:
+  enum class State { kIndexed, kMissing, kBuilding, kBuildingDirty };
+
+  ZSetsRankIndex(rocksdb::DB* db, const std::vector<rocksdb::ColumnFamilyHandle*>& handles, const Slice& key,
+                 uint64_t version);
+  ~ZSetsRankIndex();
+
+  // Write path, must be called under the record lock of the key.
+  // fresh: the version was just created, the zset has no member yet.
+  Status Prepare(const rocksdb::ReadOptions& read_options, bool fresh);
+  Status AddMember(double score, const Slice& member);
+  Status DelMember(double score, const Slice& member);
+  // the write must be given up if this fails, the counts would be wrong
+  Status WriteTo(rocksdb::WriteBatch* batch);
+
+  // Read path, return NotSupported if the zset has no rank index yet,
+  // the caller should fall back to scan.
+  Status Rank(const rocksdb::ReadOptions& read_options, double score, const Slice& member, int32_t* rank);
+  // the number of members ordered before (score, member), which need not exist
+  Status LowerBound(const rocksdb::ReadOptions& read_options, double score, const Slice& member, int32_t* rank);
+  Status SeekToIndex(const rocksdb::ReadOptions& read_options, int32_t index, rocksdb::Iterator* score_iter);
+
+  // Build, see Redis::ZsetsBuildRankIndex
+  Status GetState(const rocksdb::ReadOptions& read_options, State* state);
+  void MarkBuilding(rocksdb::WriteBatch* batch);
+  // index the members seen by read_options, replacing whatever is indexed
+  Status Build(const rocksdb::ReadOptions& read_options, rocksdb::WriteBatch* batch);
+
+  // drop the blocks and groups of every level of the version
+  static void DeleteVersion(rocksdb::WriteBatch* batch, const std::vector<rocksdb::ColumnFamilyHandle*>& handles,
+                            const Slice& key, uint64_t version);
+
+ private:
+  // a block, or a group which only uses count, the flags and parent
+  struct Entry {
+    int64_t count = 0;
+    bool dirty = false;
+    bool deleted = false;
+    bool split = false;
+    // boundary of the group holding the entry, empty on the top level
+    std::string parent;
+    // score keys added (+1) or deleted (-1) by this write, blocks only
+    std::vector<std::pair<std::string, int>> changes;
+  };
+
+  Status ReadSentinel(const rocksdb::ReadOptions& read_options, State* state, int* top_level);
+  std::string LevelKey(int level, const Slice& boundary) const;
+  rocksdb::Iterator* NewLevelIterator(const rocksdb::ReadOptions& read_options, int level);
+  void PutEntry(rocksdb::WriteBatch* batch, int level, const std::string& boundary, int64_t count,
+                int top_level) const;
+
+  Status Locate(int level, const Slice& target, std::string* boundary);
+  Status ChangeMember(double score, const Slice& member, int delta);
+  void AddToAncestors(int level, const std::string& parent, int64_t delta);
+  Status CountBefore(const rocksdb::ReadOptions& read_options, double score, const Slice& member,
+                     int32_t* before_count, bool* exact);
+  Status SumBefore(const rocksdb::ReadOptions& read_options, int level, const std::string& start,
+                   const Slice& target, int64_t* before, std::string* last);
+  Status SkipTo(const rocksdb::ReadOptions& read_options, int level, const std::string& start, int64_t index,
+                int64_t* before, std::string* found);
+
+  Status Rebalance();
+  Status SplitBlock(const std::string& boundary);
+  Status SplitGroup(int level, const std::string& boundary);
+  Status Merge(int level, const std::string& boundary);
+  Status Grow();
+  // the entries of level in [start, end) once this write is applied, an
+  // empty end is the end of the level
+  Status Children(int level, const std::string& start, const std::string& end,
+                  std::vector<std::pair<std::string, int64_t>>* children);
+  // the neighbours of boundary on level as written before this write
+  Status NextBoundary(int level, const std::string& boundary, std::string* next);
+  Status PrevBoundary(int level, const std::string& boundary, std::string* prev, int64_t* count);
+  bool IsSentinel(const Slice& boundary) const { return boundary == sentinel_; }
+  // whether the entry starts a group of the level above
+  bool IsHead(int level, const std::string& boundary) const;
+
+  rocksdb::DB* db_ = nullptr;
+  rocksdb::ColumnFamilyHandle* score_cf_ = nullptr;
+  rocksdb::ColumnFamilyHandle* rank_cf_ = nullptr;
+  rocksdb::ColumnFamilyHandle* group_cf_ = nullptr;
+  const rocksdb::Comparator* comparator_ = nullptr;
+  std::string key_;
+  uint64_t version_ = 0;
+  // encoded (key, version, -inf, "") and (key, version + 1, -inf, "")
+  std::string sentinel_;
+  std::string upper_bound_;
+  // the iterate bounds of every level
+  std::string level_lower_[kZSetsRankMaxLevel + 1];
+  std::string level_upper_[kZSetsRankMaxLevel + 1];
+  Slice level_lower_slices_[kZSetsRankMaxLevel + 1];
+  Slice level_upper_slices_[kZSetsRankMaxLevel + 1];
+
+  State state_ = State::kMissing;
+  int top_level_ = 1;
+  // the zset is new, the sentinels are its only entries
+  bool sentinel_only_ = false;
+  rocksdb::ReadOptions read_options_;
+  std::vector<rocksdb::Iterator*> iters_;
+  std::vector<std::unordered_map<std::string, Entry>> levels_;
+};
+
+}  //  namespace storage
+#endif  // SRC_ZSETS_RANK_INDEX_H_
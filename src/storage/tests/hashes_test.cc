@@ -2431,6 +2431,153 @@ TEST_F(HashesTest, PKHRScanRangeTest) {
   ASSERT_EQ(next_field, "i");
 }
 
+// Small hashes live in the meta value until they outgrow the inline limits
+TEST_F(HashesTest, HInlineTest) {  // NOLINT
+  int32_t ret = 0;
+  int64_t ival = 0;
+  std::string value;
+  std::vector<FieldValue> fvs_in;
+  std::vector<FieldValue> fvs_out;
+
+  // GP1 grows past hash_max_inline_entries
+  for (size_t idx = 0; idx < storage_options.hash_max_inline_entries; idx++) {
+    fvs_in.push_back({"GP1_FIELD" + std::to_string(100 + idx), "GP1_VALUE" + std::to_string(idx)});
+  }
+  s = db.HMSet("GP1_HINLINE_KEY", fvs_in);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(size_match(&db, "GP1_HINLINE_KEY", fvs_in.size()));
+  ASSERT_TRUE(field_value_match(&db, "GP1_HINLINE_KEY", fvs_in));
+  s = db.HGet("GP1_HINLINE_KEY", "GP1_FIELD100", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "GP1_VALUE0");
+  s = db.HGet("GP1_HINLINE_KEY", "GP1_NOT_EXIST_FIELD", &value);
+  ASSERT_TRUE(s.IsNotFound());
+
+  s = db.HIncrby("GP1_HINLINE_KEY", "GP1_COUNTER", 10, &ival);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ival, 10);
+  fvs_in.push_back({"GP1_COUNTER", "10"});
+  ASSERT_TRUE(size_match(&db, "GP1_HINLINE_KEY", fvs_in.size()));
+  ASSERT_TRUE(field_value_match(&db, "GP1_HINLINE_KEY", fvs_in));
+  s = db.HIncrby("GP1_HINLINE_KEY", "GP1_COUNTER", 5, &ival);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ival, 15);
+
+  std::vector<std::string> del_fields{"GP1_FIELD100", "GP1_COUNTER", "GP1_NOT_EXIST_FIELD"};
+  s = db.HDel("GP1_HINLINE_KEY", del_fields, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 2);
+  fvs_in.erase(fvs_in.begin());
+  fvs_in.pop_back();
+  ASSERT_TRUE(size_match(&db, "GP1_HINLINE_KEY", fvs_in.size()));
+  ASSERT_TRUE(field_value_match(&db, "GP1_HINLINE_KEY", fvs_in));
+
+  // GP2 gets a value longer than hash_max_inline_value
+  std::string long_value(storage_options.hash_max_inline_value + 1, 'x');
+  s = db.HSet("GP2_HINLINE_KEY", "GP2_FIELD1", "GP2_VALUE1", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  s = db.HSet("GP2_HINLINE_KEY", "GP2_FIELD1", "GP2_VALUE1", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 0);
+  s = db.HSetnx("GP2_HINLINE_KEY", "GP2_FIELD2", "GP2_VALUE2", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  s = db.HSet("GP2_HINLINE_KEY", "GP2_FIELD3", long_value, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(size_match(&db, "GP2_HINLINE_KEY", 3));
+  ASSERT_TRUE(field_value_match(
+      &db, "GP2_HINLINE_KEY", {{"GP2_FIELD1", "GP2_VALUE1"}, {"GP2_FIELD2", "GP2_VALUE2"}, {"GP2_FIELD3", long_value}}));
+  s = db.HSet("GP2_HINLINE_KEY", "GP2_FIELD4", "GP2_VALUE4", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(size_match(&db, "GP2_HINLINE_KEY", 4));
+
+  // GP3 scans an inline hash with a cursor
+  s = db.HMSet("GP3_HINLINE_KEY", {{"a", "v"}, {"b", "v"}, {"c", "v"}, {"d", "v"}, {"e", "v"}});
+  ASSERT_TRUE(s.ok());
+  int64_t cursor = 0;
+  int64_t next_cursor = 0;
+  s = db.HScan("GP3_HINLINE_KEY", cursor, "*", 3, &fvs_out, &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(fvs_out.size(), 3);
+  ASSERT_EQ(next_cursor, 3);
+  ASSERT_TRUE(field_value_match(fvs_out, {{"a", "v"}, {"b", "v"}, {"c", "v"}}));
+  s = db.HScan("GP3_HINLINE_KEY", next_cursor, "*", 3, &fvs_out, &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(next_cursor, 0);
+  ASSERT_TRUE(field_value_match(fvs_out, {{"d", "v"}, {"e", "v"}}));
+
+  // GP4 is deleted and starts over
+  s = db.HMSet("GP4_HINLINE_KEY", {{"GP4_FIELD1", "GP4_VALUE1"}, {"GP4_FIELD2", "GP4_VALUE2"}});
+  ASSERT_TRUE(s.ok());
+  ret = static_cast<int32_t>(db.Del({"GP4_HINLINE_KEY"}));
+  ASSERT_EQ(ret, 1);
+  s = db.HGet("GP4_HINLINE_KEY", "GP4_FIELD1", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db.HSet("GP4_HINLINE_KEY", "GP4_FIELD3", "GP4_VALUE3", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(size_match(&db, "GP4_HINLINE_KEY", 1));
+  ASSERT_TRUE(field_value_match(&db, "GP4_HINLINE_KEY", {{"GP4_FIELD3", "GP4_VALUE3"}}));
+
+  // GP5 is inline when the limits are lowered, and moves on its next write
+  s = db.HMSet("GP5_HINLINE_KEY", {{"GP5_FIELD1", "GP5_VALUE1"}, {"GP5_FIELD2", "GP5_VALUE2"}});
+  ASSERT_TRUE(s.ok());
+  db.SetHashMaxInline(1, storage_options.hash_max_inline_value);
+  ASSERT_TRUE(field_value_match(&db, "GP5_HINLINE_KEY", {{"GP5_FIELD1", "GP5_VALUE1"}, {"GP5_FIELD2", "GP5_VALUE2"}}));
+  s = db.HSet("GP5_HINLINE_KEY", "GP5_FIELD3", "GP5_VALUE3", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(size_match(&db, "GP5_HINLINE_KEY", 3));
+  ASSERT_TRUE(field_value_match(
+      &db, "GP5_HINLINE_KEY",
+      {{"GP5_FIELD1", "GP5_VALUE1"}, {"GP5_FIELD2", "GP5_VALUE2"}, {"GP5_FIELD3", "GP5_VALUE3"}}));
+  db.SetHashMaxInline(storage_options.hash_max_inline_entries, storage_options.hash_max_inline_value);
+}
+
+static uint64_t reclaimed_count(storage::Storage* const db) {
+  std::string info;
+  db->GetRocksDBInfo(info);
+  uint64_t total = 0;
+  std::string metric = "reclaim_done:";
+  for (size_t pos = info.find(metric); pos != std::string::npos; pos = info.find(metric, pos + 1)) {
+    total += std::strtoull(info.c_str() + pos + metric.size(), nullptr, 10);
+  }
+  return total;
+}
+
+// Reclaim
+TEST_F(HashesTest, HReclaimTest) {  // NOLINT
+  int32_t ret = 0;
+  std::vector<FieldValue> fvs_in;
+
+  // GP1 is large enough to be reclaimed once deleted
+  for (size_t idx = 0; idx < storage_options.reclaim_min_count; idx++) {
+    fvs_in.push_back({"GP1_FIELD" + std::to_string(idx), "GP1_VALUE" + std::to_string(idx)});
+  }
+  s = db.HMSet("GP1_HRECLAIM_KEY", fvs_in);
+  ASSERT_TRUE(s.ok());
+  ret = static_cast<int32_t>(db.Del({"GP1_HRECLAIM_KEY"}));
+  ASSERT_EQ(ret, 1);
+
+  // GP2 is too small
+  s = db.HMSet("GP2_HRECLAIM_KEY", {{"GP2_FIELD1", "GP2_VALUE1"}, {"GP2_FIELD2", "GP2_VALUE2"}});
+  ASSERT_TRUE(s.ok());
+  ret = static_cast<int32_t>(db.Del({"GP2_HRECLAIM_KEY"}));
+  ASSERT_EQ(ret, 1);
+
+  // the new version of GP1 is not touched by the reclaim of the old one
+  s = db.HSet("GP1_HRECLAIM_KEY", "GP1_FIELD0", "GP1_NEW_VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  for (int retry = 0; retry < 100 && reclaimed_count(&db) == 0; retry++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  ASSERT_EQ(reclaimed_count(&db), 1);
+  ASSERT_TRUE(size_match(&db, "GP1_HRECLAIM_KEY", 1));
+  ASSERT_TRUE(field_value_match(&db, "GP1_HRECLAIM_KEY", {{"GP1_FIELD0", "GP1_NEW_VALUE"}}));
+}
+
 int main(int argc, char** argv) {
   if (!pstd::FileExists("./log")) {
     pstd::CreatePath("./log");
@@ -5085,6 +5085,25 @@ TEST_F(KeysTest, DelTest) {
   // Strings
   s = db.Get("DEL_KEY", &value);
   ASSERT_TRUE(s.IsNotFound());
+
+  // Keys of all the types, spread over the instances, duplicated or missing
+  std::vector<storage::KeyValue> kvs;
+  for (int idx = 0; idx < 100; idx++) {
+    kvs.push_back({"DEL_MULTI_STRING_KEY" + std::to_string(idx), "VALUE"});
+  }
+  s = db.MSet(kvs);
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("DEL_MULTI_HASH_KEY", "FIELD", "VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SAdd("DEL_MULTI_SET_KEY", {"MEMBER"}, &ret);
+  ASSERT_TRUE(s.ok());
+  std::vector<std::string> multi_keys{"DEL_MULTI_HASH_KEY", "DEL_MULTI_SET_KEY", "DEL_MULTI_SET_KEY",
+                                      "DEL_MULTI_NOT_EXIST_KEY"};
+  for (const auto& kv : kvs) {
+    multi_keys.push_back(kv.key);
+  }
+  ASSERT_EQ(db.Del(multi_keys), 102);
+  ASSERT_EQ(db.Exists(multi_keys), 0);
 }
 
 // Exists
@@ -5185,6 +5204,139 @@ TEST_F(KeysTest, TTLTest) {
 }
 
 
+// GetKeyNum
+TEST_F(KeysTest, GetKeyNumTest) {
+  int32_t ret = 0;
+  uint64_t len = 0;
+  s = db.Set("GKN_STRING_KEY1", "VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.Set("GKN_STRING_KEY2", "VALUE");
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(db.Expire("GKN_STRING_KEY2", 100), 1);
+  s = db.HSet("GKN_HASH_KEY", "FIELD", "VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.LPush("GKN_LIST_KEY", {"NODE"}, &len);
+  ASSERT_TRUE(s.ok());
+  s = db.ZAdd("GKN_ZSET_KEY", {{1, "MEMBER"}}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SAdd("GKN_SET_KEY1", {"MEMBER"}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SAdd("GKN_SET_KEY2", {"MEMBER"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(db.Del({"GKN_SET_KEY2"}), 1);
+
+  // the order is strings, hashes, lists, zsets, sets, streams
+  std::vector<storage::KeyInfo> key_infos;
+  s = db.GetKeyNum(&key_infos);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(key_infos.size(), static_cast<size_t>(storage::DataTypeNum));
+  ASSERT_EQ(key_infos[0].keys, 2);
+  ASSERT_EQ(key_infos[0].expires, 1);
+  ASSERT_EQ(key_infos[1].keys, 1);
+  ASSERT_EQ(key_infos[2].keys, 1);
+  ASSERT_EQ(key_infos[3].keys, 1);
+  ASSERT_EQ(key_infos[4].keys, 1);
+  ASSERT_EQ(key_infos[4].invaild_keys, 1);
+  ASSERT_EQ(key_infos[5].keys, 0);
+}
+
+// GetKeyCounts
+TEST_F(KeysTest, GetKeyCountsTest) {
+  int32_t ret = 0;
+  s = db.Set("GKC_STRING_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.Set("GKC_STRING_KEY", "NEW_VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.Setex("GKC_TTL_KEY", "VALUE", 1);
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("GKC_HASH_KEY", "FIELD", "VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SAdd("GKC_SET_KEY", {"MEMBER"}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SRem("GKC_SET_KEY", {"MEMBER"}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZAdd("GKC_ZSET_KEY", {{1, "MEMBER"}}, &ret);
+  ASSERT_TRUE(s.ok());
+  // the zset is replaced by a string
+  s = db.Set("GKC_ZSET_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+
+  // the order is strings, hashes, lists, zsets, sets, streams
+  std::vector<storage::KeyInfo> key_infos;
+  s = db.GetKeyCounts(&key_infos);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(key_infos.size(), static_cast<size_t>(storage::DataTypeNum));
+  ASSERT_EQ(key_infos[0].keys, 3);
+  ASSERT_EQ(key_infos[0].expires, 1);
+  ASSERT_EQ(key_infos[1].keys, 1);
+  ASSERT_EQ(key_infos[3].keys, 0);
+  ASSERT_EQ(key_infos[4].keys, 0);
+
+  // expired without any write
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+  s = db.GetKeyCounts(&key_infos);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(key_infos[0].keys, 2);
+  ASSERT_EQ(key_infos[0].expires, 0);
+  ASSERT_EQ(key_infos[0].invaild_keys, 1);
+
+  // and the scan agrees
+  std::vector<storage::KeyInfo> scanned_key_infos;
+  s = db.GetKeyNum(&scanned_key_infos);
+  ASSERT_TRUE(s.ok());
+  for (int i = 0; i < storage::DataTypeNum; i++) {
+    ASSERT_EQ(scanned_key_infos[i].keys, key_infos[i].keys);
+    ASSERT_EQ(scanned_key_infos[i].expires, key_infos[i].expires);
+    ASSERT_EQ(scanned_key_infos[i].invaild_keys, key_infos[i].invaild_keys);
+  }
+}
+
+// BeginWriteBatch
+TEST_F(KeysTest, WriteBatchTest) {
+  int32_t ret = 0;
+  uint64_t llen = 0;
+  std::string value;
+  std::vector<storage::KeyInfo> before_key_infos;
+  s = db.GetKeyCounts(&before_key_infos);
+  ASSERT_TRUE(s.ok());
+
+  db.BeginWriteBatch();
+  s = db.Set("WB_STRING_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("WB_HASH_KEY", "FIELD", "VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.LPush("WB_LIST_KEY", {"NODE"}, &llen);
+  ASSERT_TRUE(s.ok());
+  // held until the commit
+  s = db.Get("WB_STRING_KEY", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  std::vector<storage::KeyInfo> key_infos;
+  s = db.GetKeyCounts(&key_infos);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(key_infos[0].keys, before_key_infos[0].keys);
+
+  s = db.CommitWriteBatch({"WB_STRING_KEY", "WB_HASH_KEY", "WB_LIST_KEY"});
+  ASSERT_TRUE(s.ok());
+  s = db.Get("WB_STRING_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "VALUE");
+  s = db.HGet("WB_HASH_KEY", "FIELD", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "VALUE");
+  s = db.GetKeyCounts(&key_infos);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(key_infos[0].keys, before_key_infos[0].keys + 1);
+  ASSERT_EQ(key_infos[1].keys, before_key_infos[1].keys + 1);
+  ASSERT_EQ(key_infos[2].keys, before_key_infos[2].keys + 1);
+
+  // the writes after the commit are not held
+  s = db.Set("WB_STRING_KEY", "NEW_VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.Get("WB_STRING_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "NEW_VALUE");
+}
+
 int main(int argc, char** argv) {
   if (!pstd::FileExists("./log")) {
     pstd::CreatePath("./log");
@@ -15,6 +15,9 @@
 #include "src/base_data_key_format.h"
 #include "src/zsets_data_key_format.h"
 #include "src/lists_data_key_format.h"
+#include "src/base_data_value_format.h"
+#include "src/base_meta_value_format.h"
+#include "src/strings_value_format.h"
 #include "storage/storage_define.h"
 
 using namespace storage;
@@ -114,6 +117,161 @@ TEST(KVFormatTest, ListDataKeyFormat) {
   ASSERT_EQ(pldk.Version(), version);
 }
 
+// The compact key format drops the 8 + 16 reserved bytes of every key
+TEST(KVFormatTest, CompactKeyFormat) {
+  rocksdb::Slice slice_key("\u0000\u0001abc\u0000", 6);
+  rocksdb::Slice slice_data("\u0000\u0001data\u0000", 7);
+  uint64_t version = 1701848429;
+  double score = -3.5;
+  uint64_t index = 10;
+
+  BaseKey legacy_bk(slice_key);
+  BaseDataKey legacy_bdk(slice_key, version, slice_data);
+  ZSetsScoreKey legacy_zsk(slice_key, version, score, slice_data);
+  ListsDataKey legacy_ldk(slice_key, version, index);
+  size_t legacy_bk_size = legacy_bk.Encode().size();
+  size_t legacy_bdk_size = legacy_bdk.Encode().size();
+  size_t legacy_zsk_size = legacy_zsk.Encode().size();
+  size_t legacy_ldk_size = legacy_ldk.Encode().size();
+
+  g_key_format = KeyFormat::kCompact;
+  BaseKey bk(slice_key);
+  rocksdb::Slice bk_enc = bk.Encode();
+  ASSERT_EQ(bk_enc, Slice("\u0000\u0001\u0001abc\u0000\u0001\u0000\u0000", 10));
+  ASSERT_EQ(bk_enc.size() + 24, legacy_bk_size);
+  ASSERT_EQ(ParsedBaseKey(bk_enc).Key(), slice_key);
+
+  BaseDataKey bdk(slice_key, version, slice_data);
+  rocksdb::Slice bdk_enc = bdk.Encode();
+  ASSERT_EQ(bdk_enc.size() + 24, legacy_bdk_size);
+  ParsedBaseDataKey pbdk(bdk_enc);
+  ASSERT_EQ(pbdk.Key(), slice_key);
+  ASSERT_EQ(pbdk.Data(), slice_data);
+  ASSERT_EQ(pbdk.Version(), version);
+  ASSERT_TRUE(bdk_enc.starts_with(bdk.EncodeSeekKey()));
+
+  ZSetsScoreKey zsk(slice_key, version, score, slice_data);
+  rocksdb::Slice zsk_enc = zsk.Encode();
+  ASSERT_EQ(zsk_enc.size() + 24, legacy_zsk_size);
+  ParsedZSetsScoreKey pzsk(zsk_enc);
+  ASSERT_EQ(pzsk.key(), slice_key);
+  ASSERT_EQ(pzsk.member(), slice_data);
+  ASSERT_EQ(pzsk.Version(), version);
+  ASSERT_EQ(pzsk.score(), score);
+
+  ListsDataKey ldk(slice_key, version, index);
+  rocksdb::Slice ldk_enc = ldk.Encode();
+  ASSERT_EQ(ldk_enc.size() + 24, legacy_ldk_size);
+  ParsedListsDataKey pldk(ldk_enc);
+  ASSERT_EQ(pldk.key(), slice_key);
+  ASSERT_EQ(pldk.index(), index);
+  ASSERT_EQ(pldk.Version(), version);
+  g_key_format = KeyFormat::kLegacy;
+}
+
+TEST(KVFormatTest, CompactValueFormat) {
+  uint64_t ctime = 1701848429;
+  uint64_t etime = 1801848429;
+  char dst[9];
+  g_key_format = KeyFormat::kCompact;
+
+  // strings value written by an older release
+  std::string legacy_value(1, static_cast<char>(DataType::kStrings));
+  legacy_value.append("string_value");
+  legacy_value.append(kSuffixReserveLength, '\0');
+  EncodeFixed64(dst, ctime);
+  legacy_value.append(dst, 8);
+  EncodeFixed64(dst, etime);
+  legacy_value.append(dst, 8);
+
+  ParsedStringsValue legacy_strings_value(&legacy_value);
+  ASSERT_EQ(legacy_strings_value.UserValue(), "string_value");
+  ASSERT_EQ(legacy_strings_value.Etime(), etime);
+  // rewriting the timestamp upgrades it to the compact suffix
+  legacy_strings_value.SetEtime(etime + 1);
+  ASSERT_EQ(legacy_strings_value.UserValue(), "string_value");
+  ASSERT_EQ(legacy_value.size(), 1 + 12 + 1 + 5 + 5 + 1);
+  ParsedStringsValue upgraded_strings_value(Slice{legacy_value});
+  ASSERT_EQ(upgraded_strings_value.UserValue(), "string_value");
+  ASSERT_EQ(upgraded_strings_value.Etime(), etime + 1);
+
+  StringsValue strings_value("string_value");
+  strings_value.SetEtime(etime);
+  std::string compact_value = strings_value.Encode().ToString();
+  ASSERT_EQ(static_cast<uint8_t>(compact_value.back()) & kCompactSuffixFlag, kCompactSuffixFlag);
+  ParsedStringsValue parsed_strings_value(&compact_value);
+  ASSERT_EQ(parsed_strings_value.UserValue(), "string_value");
+  ASSERT_EQ(parsed_strings_value.Etime(), etime);
+  parsed_strings_value.StripSuffix();
+  ASSERT_EQ(compact_value, "string_value");
+
+  // data value written by an older release
+  std::string legacy_data_value("data_value");
+  legacy_data_value.append(kSuffixReserveLength, '\0');
+  EncodeFixed64(dst, ctime);
+  legacy_data_value.append(dst, 8);
+  ParsedBaseDataValue parsed_legacy_data_value(&legacy_data_value);
+  ASSERT_EQ(parsed_legacy_data_value.UserValue(), "data_value");
+  parsed_legacy_data_value.StripSuffix();
+  ASSERT_EQ(legacy_data_value, "data_value");
+
+  BaseDataValue data_value("data_value");
+  std::string compact_data_value = data_value.Encode().ToString();
+  ASSERT_EQ(compact_data_value.size(), 10 + 1 + 5 + 1);
+  ParsedBaseDataValue parsed_data_value(Slice{compact_data_value});
+  ASSERT_EQ(parsed_data_value.UserValue(), "data_value");
+
+  // meta value keeps its version and flags across the upgrade
+  char count_buf[4];
+  EncodeFixed32(count_buf, 3);
+  std::string legacy_meta_value(1, static_cast<char>(DataType::kHashes));
+  legacy_meta_value.append(count_buf, 4);
+  EncodeFixed64(dst, 42);
+  legacy_meta_value.append(dst, 8);
+  legacy_meta_value.append(1, kMetaInlineFlag);
+  legacy_meta_value.append(kSuffixReserveLength - 1, '\0');
+  EncodeFixed64(dst, ctime);
+  legacy_meta_value.append(dst, 8);
+  legacy_meta_value.append(8, '\0');
+  ParsedBaseMetaValue parsed_meta_value(&legacy_meta_value);
+  ASSERT_EQ(parsed_meta_value.Count(), 3);
+  ASSERT_EQ(parsed_meta_value.Version(), 42);
+  ASSERT_TRUE(parsed_meta_value.IsInline());
+  parsed_meta_value.SetEtime(etime);
+  parsed_meta_value.SetVersion(43);
+  ParsedBaseMetaValue upgraded_meta_value(Slice{legacy_meta_value});
+  ASSERT_EQ(upgraded_meta_value.Count(), 3);
+  ASSERT_EQ(upgraded_meta_value.Version(), 43);
+  ASSERT_EQ(upgraded_meta_value.Etime(), etime);
+  ASSERT_TRUE(upgraded_meta_value.IsInline());
+  g_key_format = KeyFormat::kLegacy;
+}
+
+// A database of the legacy key format only writes the legacy suffix
+TEST(KVFormatTest, LegacyValueFormat) {
+  uint64_t etime = 1801848429;
+
+  StringsValue strings_value("string_value");
+  strings_value.SetEtime(etime);
+  std::string legacy_value = strings_value.Encode().ToString();
+  ASSERT_EQ(legacy_value.size(), 1 + 12 + kSuffixReserveLength + 2 * kTimestampLength);
+  ASSERT_EQ(legacy_value.back(), '\0');
+  ParsedStringsValue parsed_strings_value(&legacy_value);
+  ASSERT_EQ(parsed_strings_value.UserValue(), "string_value");
+  ASSERT_EQ(parsed_strings_value.Etime(), etime);
+  parsed_strings_value.SetEtime(etime + 1);
+  ASSERT_EQ(legacy_value.size(), 1 + 12 + kSuffixReserveLength + 2 * kTimestampLength);
+  ParsedStringsValue rewritten_strings_value(Slice{legacy_value});
+  ASSERT_EQ(rewritten_strings_value.UserValue(), "string_value");
+  ASSERT_EQ(rewritten_strings_value.Etime(), etime + 1);
+
+  BaseDataValue data_value("data_value");
+  std::string legacy_data_value = data_value.Encode().ToString();
+  ASSERT_EQ(legacy_data_value.size(), 10 + kSuffixReserveLength + kTimestampLength);
+  ParsedBaseDataValue parsed_data_value(Slice{legacy_data_value});
+  ASSERT_EQ(parsed_data_value.UserValue(), "data_value");
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
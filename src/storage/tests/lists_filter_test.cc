@@ -245,6 +245,60 @@ TEST_F(ListsFilterTest, DataFilterTest) {
   ASSERT_TRUE(s.ok());
 }
 
+// Meta lookups of the data filter
+TEST_F(ListsFilterTest, MetaLookupTest) {
+  char str[8];
+  bool filter_result;
+  bool value_changed;
+  std::string new_value;
+  CompactionFilterStats stats;
+
+  auto lists_data_filter = std::make_unique<ListsDataFilter>(meta_db, &handles, DataType::kLists, &stats);
+  ASSERT_TRUE(lists_data_filter != nullptr);
+
+  // LOOKUP_KEY_A and LOOKUP_KEY_C exist, LOOKUP_KEY_B does not
+  EncodeFixed64(str, 1);
+  ListsMetaValue lists_meta_value(Slice(str, sizeof(uint64_t)));
+  uint64_t version = lists_meta_value.UpdateVersion();
+  BaseMetaKey meta_key_a("LOOKUP_KEY_A");
+  BaseMetaKey meta_key_c("LOOKUP_KEY_C");
+  s = meta_db->Put(rocksdb::WriteOptions(), handles[0], meta_key_a.Encode(), lists_meta_value.Encode());
+  ASSERT_TRUE(s.ok());
+  s = meta_db->Put(rocksdb::WriteOptions(), handles[0], meta_key_c.Encode(), lists_meta_value.Encode());
+  ASSERT_TRUE(s.ok());
+
+  ListsDataKey lists_data_key_a("LOOKUP_KEY_A", version, 1);
+  filter_result =
+      lists_data_filter->Filter(0, lists_data_key_a.Encode(), "FILTER_TEST_VALUE", &new_value, &value_changed);
+  ASSERT_EQ(filter_result, false);
+
+  // A of a version newer than the meta read belongs to a meta written since, kept
+  ListsDataKey lists_data_key_a2("LOOKUP_KEY_A", version + 100, 1);
+  filter_result =
+      lists_data_filter->Filter(0, lists_data_key_a2.Encode(), "FILTER_TEST_VALUE", &new_value, &value_changed);
+  ASSERT_EQ(filter_result, false);
+
+  // C is read with a lookup of its own, B in between as well
+  ListsDataKey lists_data_key_b("LOOKUP_KEY_B", version, 1);
+  filter_result =
+      lists_data_filter->Filter(0, lists_data_key_b.Encode(), "FILTER_TEST_VALUE", &new_value, &value_changed);
+  ASSERT_EQ(filter_result, true);
+
+  ListsDataKey lists_data_key_c("LOOKUP_KEY_C", version, 1);
+  filter_result =
+      lists_data_filter->Filter(0, lists_data_key_c.Encode(), "FILTER_TEST_VALUE", &new_value, &value_changed);
+  ASSERT_EQ(filter_result, false);
+
+  ASSERT_EQ(stats.filtered_keys.load(), 4U);
+  ASSERT_EQ(stats.meta_lookups.load(), 3U);
+  ASSERT_EQ(stats.skipped_keys.load(), 1U);
+
+  s = meta_db->Delete(rocksdb::WriteOptions(), handles[0], meta_key_a.Encode());
+  ASSERT_TRUE(s.ok());
+  s = meta_db->Delete(rocksdb::WriteOptions(), handles[0], meta_key_c.Encode());
+  ASSERT_TRUE(s.ok());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
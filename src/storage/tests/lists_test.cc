@@ -3,6 +3,7 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <thread>
@@ -460,6 +461,149 @@ TEST_F(ListsTest, LInsertTest) {  // NOLINT
   ASSERT_TRUE(elements_match(&db, "GP10_LINSERT_KEY", {"7", "1", "8", "9", "2", "4", "3", "6", "5"}));
 }
 
+// LInsert into the middle, the list is left with uneven indexes
+TEST_F(ListsTest, LInsertMiddleTest) {  // NOLINT
+  int64_t ret;
+  uint64_t num;
+  std::string element;
+  std::vector<std::string> elements;
+
+  // ***************** Group 1 Test *****************
+  // "0" -> "1" -> ... -> "99", keep inserting right before "50" until the
+  // room between two neighbours is used up and they have to be renumbered
+  std::vector<std::string> expect;
+  for (int32_t idx = 0; idx < 100; idx++) {
+    expect.push_back(std::to_string(idx));
+  }
+  s = db.RPush("GP1_LINSERT_MIDDLE_KEY", expect, &num);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(100, num);
+
+  for (int32_t idx = 0; idx < 40; idx++) {
+    std::string value = "x" + std::to_string(idx);
+    s = db.LInsert("GP1_LINSERT_MIDDLE_KEY", storage::Before, "50", value, &ret);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(101 + idx, ret);
+    expect.insert(expect.begin() + 50 + idx, value);
+  }
+  // and right after "10", which is renumbered toward the left end
+  for (int32_t idx = 0; idx < 40; idx++) {
+    std::string value = "y" + std::to_string(idx);
+    s = db.LInsert("GP1_LINSERT_MIDDLE_KEY", storage::After, "10", value, &ret);
+    ASSERT_TRUE(s.ok());
+    expect.insert(expect.begin() + 11, value);
+  }
+  ASSERT_TRUE(len_match(&db, "GP1_LINSERT_MIDDLE_KEY", expect.size()));
+  ASSERT_TRUE(elements_match(&db, "GP1_LINSERT_MIDDLE_KEY", expect));
+
+  for (int64_t idx : {0, 11, 50, 89, 90, 179}) {
+    s = db.LIndex("GP1_LINSERT_MIDDLE_KEY", idx, &element);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(expect[idx], element);
+    s = db.LIndex("GP1_LINSERT_MIDDLE_KEY", idx - 180, &element);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(expect[idx], element);
+  }
+  s = db.LIndex("GP1_LINSERT_MIDDLE_KEY", 180, &element);
+  ASSERT_TRUE(s.IsNotFound());
+
+  s = db.LRange("GP1_LINSERT_MIDDLE_KEY", 88, 91, &elements);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(elements_match(elements, {expect[88], expect[89], expect[90], expect[91]}));
+
+  s = db.LSet("GP1_LINSERT_MIDDLE_KEY", 120, "z");
+  ASSERT_TRUE(s.ok());
+  expect[120] = "z";
+
+  // LRem leaves holes behind instead of moving the neighbours
+  uint64_t rem_num;
+  s = db.LRem("GP1_LINSERT_MIDDLE_KEY", 0, "x7", &rem_num);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(1, rem_num);
+  expect.erase(std::find(expect.begin(), expect.end(), "x7"));
+  ASSERT_TRUE(elements_match(&db, "GP1_LINSERT_MIDDLE_KEY", expect));
+
+  s = db.LTrim("GP1_LINSERT_MIDDLE_KEY", 5, -6);
+  ASSERT_TRUE(s.ok());
+  expect = std::vector<std::string>(expect.begin() + 5, expect.end() - 5);
+  ASSERT_TRUE(elements_match(&db, "GP1_LINSERT_MIDDLE_KEY", expect));
+
+  s = db.RPoplpush("GP1_LINSERT_MIDDLE_KEY", "GP1_LINSERT_MIDDLE_KEY", &element);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(expect.back(), element);
+  expect.insert(expect.begin(), expect.back());
+  expect.pop_back();
+
+  s = db.LPop("GP1_LINSERT_MIDDLE_KEY", 2, &elements);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(elements_match(elements, {expect[0], expect[1]}));
+  expect.erase(expect.begin(), expect.begin() + 2);
+
+  s = db.RPop("GP1_LINSERT_MIDDLE_KEY", 1, &elements);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(elements_match(elements, {expect.back()}));
+  expect.pop_back();
+
+  s = db.LPush("GP1_LINSERT_MIDDLE_KEY", {"head"}, &num);
+  ASSERT_TRUE(s.ok());
+  expect.insert(expect.begin(), "head");
+  s = db.RPush("GP1_LINSERT_MIDDLE_KEY", {"tail"}, &num);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(expect.size() + 1, num);
+  expect.emplace_back("tail");
+  ASSERT_TRUE(len_match(&db, "GP1_LINSERT_MIDDLE_KEY", expect.size()));
+  ASSERT_TRUE(elements_match(&db, "GP1_LINSERT_MIDDLE_KEY", expect));
+
+  // ***************** Group 2 Test *****************
+  // a gapped list larger than one renumber batch gets dense indexes again
+  expect.clear();
+  for (int32_t idx = 0; idx < 3000; idx++) {
+    expect.push_back(std::to_string(idx));
+  }
+  s = db.RPush("GP2_LINSERT_MIDDLE_KEY", expect, &num);
+  ASSERT_TRUE(s.ok());
+  s = db.LInsert("GP2_LINSERT_MIDDLE_KEY", storage::After, "1500", "x", &ret);
+  ASSERT_TRUE(s.ok());
+  expect.insert(expect.begin() + 1501, "x");
+  s = db.LRem("GP2_LINSERT_MIDDLE_KEY", 0, "10", &rem_num);
+  ASSERT_TRUE(s.ok());
+  expect.erase(expect.begin() + 10);
+
+  // looked up while gapped, whether or not the renumber queued by the
+  // writes above has run yet
+  for (int64_t idx : {0, 9, 10, 1499, 1500, 1501, 1502, 2999}) {
+    s = db.LIndex("GP2_LINSERT_MIDDLE_KEY", idx, &element);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(expect[idx], element);
+    s = db.LIndex("GP2_LINSERT_MIDDLE_KEY", idx - 3000, &element);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(expect[idx], element);
+  }
+
+  s = db.DoRenumberList("GP2_LINSERT_MIDDLE_KEY");
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(len_match(&db, "GP2_LINSERT_MIDDLE_KEY", expect.size()));
+  ASSERT_TRUE(elements_match(&db, "GP2_LINSERT_MIDDLE_KEY", expect));
+  for (int64_t idx : {0, 9, 10, 1023, 1024, 1500, 2999}) {
+    s = db.LIndex("GP2_LINSERT_MIDDLE_KEY", idx, &element);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(expect[idx], element);
+  }
+  s = db.LSet("GP2_LINSERT_MIDDLE_KEY", 2000, "z");
+  ASSERT_TRUE(s.ok());
+  expect[2000] = "z";
+  s = db.LPush("GP2_LINSERT_MIDDLE_KEY", {"head"}, &num);
+  ASSERT_TRUE(s.ok());
+  expect.insert(expect.begin(), "head");
+  s = db.RPush("GP2_LINSERT_MIDDLE_KEY", {"tail"}, &num);
+  ASSERT_TRUE(s.ok());
+  expect.emplace_back("tail");
+  ASSERT_TRUE(elements_match(&db, "GP2_LINSERT_MIDDLE_KEY", expect));
+  s = db.LRange("GP2_LINSERT_MIDDLE_KEY", 1999, 2002, &elements);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(elements_match(elements, {expect[1999], expect[2000], expect[2001], expect[2002]}));
+}
+
 // LLen
 TEST_F(ListsTest, LLenTest) {  // NOLINT
   uint64_t num;
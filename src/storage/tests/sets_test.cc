@@ -1013,6 +1013,30 @@ TEST_F(SetsTest, SIsmemberTest) {  // NOLINT
   ASSERT_EQ(ret, 0);
 }
 
+// SMIsmember
+TEST_F(SetsTest, SMIsmemberTest) {  // NOLINT
+  int32_t ret = 0;
+  std::vector<int32_t> rets;
+  s = db.SAdd("SMISMEMBER_KEY", {"MEMBER1", "MEMBER2", "MEMBER3"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 3);
+
+  // Not exist set key
+  s = db.SMIsmember("SMISMEMBER_NOT_EXIST_KEY", {"MEMBER1", "MEMBER2"}, &rets);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(rets, std::vector<int32_t>({0, 0}));
+
+  s = db.SMIsmember("SMISMEMBER_KEY", {"MEMBER1", "NOT_EXIST_MEMBER", "MEMBER3", "MEMBER1"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1, 0, 1, 1}));
+
+  // Wrong type
+  s = db.Set("SMISMEMBER_STRING_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.SMIsmember("SMISMEMBER_STRING_KEY", {"MEMBER1"}, &rets);
+  ASSERT_TRUE(s.IsInvalidArgument());
+}
+
 // SMembers
 TEST_F(SetsTest, SMembersTest) {  // NOLINT
   int32_t ret = 0;
@@ -2240,6 +2264,117 @@ TEST_F(SetsTest, SScanTest) {  // NOLINT
   ASSERT_TRUE(members_match(member_out, {}));
 }
 
+// Small sets live in the meta value until they outgrow the inline limits
+TEST_F(SetsTest, SInlineTest) {  // NOLINT
+  int32_t ret = 0;
+  std::vector<std::string> members_in;
+  std::vector<std::string> members_out;
+  std::vector<int32_t> rets;
+
+  // GP1 grows past set_max_inline_entries
+  for (size_t idx = 0; idx < storage_options.set_max_inline_entries; idx++) {
+    members_in.push_back("GP1_MEMBER" + std::to_string(100 + idx));
+  }
+  s = db.SAdd("GP1_SINLINE_KEY", members_in, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, static_cast<int32_t>(members_in.size()));
+  s = db.SAdd("GP1_SINLINE_KEY", {"GP1_MEMBER100"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 0);
+  ASSERT_TRUE(size_match(&db, "GP1_SINLINE_KEY", static_cast<int32_t>(members_in.size())));
+  ASSERT_TRUE(members_match(&db, "GP1_SINLINE_KEY", members_in));
+  s = db.SIsmember("GP1_SINLINE_KEY", "GP1_MEMBER100", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  s = db.SIsmember("GP1_SINLINE_KEY", "GP1_NOT_EXIST_MEMBER", &ret);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(ret, 0);
+  s = db.SMIsmember("GP1_SINLINE_KEY", {"GP1_MEMBER101", "GP1_NOT_EXIST_MEMBER"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1, 0}));
+
+  s = db.SAdd("GP1_SINLINE_KEY", {"GP1_MEMBER_SPILL"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  members_in.push_back("GP1_MEMBER_SPILL");
+  ASSERT_TRUE(size_match(&db, "GP1_SINLINE_KEY", static_cast<int32_t>(members_in.size())));
+  ASSERT_TRUE(members_match(&db, "GP1_SINLINE_KEY", members_in));
+  s = db.SIsmember("GP1_SINLINE_KEY", "GP1_MEMBER_SPILL", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+
+  // GP2 gets a member longer than set_max_inline_value
+  std::string long_member(storage_options.set_max_inline_value + 1, 'x');
+  s = db.SAdd("GP2_SINLINE_KEY", {"a", "b", "c"}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SRem("GP2_SINLINE_KEY", {"a", "not_exist"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(members_match(&db, "GP2_SINLINE_KEY", {"b", "c"}));
+  s = db.SAdd("GP2_SINLINE_KEY", {long_member}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(size_match(&db, "GP2_SINLINE_KEY", 3));
+  ASSERT_TRUE(members_match(&db, "GP2_SINLINE_KEY", {"b", "c", long_member}));
+
+  // GP3 mixes inline and spilled sets in SDIFF, SINTER, SUNION and SMOVE
+  s = db.SAdd("GP3_SINLINE_KEY1", {"b", "c", "d"}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SDiff({"GP3_SINLINE_KEY1", "GP2_SINLINE_KEY"}, &members_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(members_match(members_out, {"d"}));
+  members_out.clear();
+  s = db.SInter({"GP2_SINLINE_KEY", "GP3_SINLINE_KEY1"}, &members_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(members_match(members_out, {"b", "c"}));
+  members_out.clear();
+  s = db.SUnion({"GP3_SINLINE_KEY1", "GP2_SINLINE_KEY"}, &members_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(members_match(members_out, {"b", "c", "d", long_member}));
+  std::vector<std::string> value_to_dest;
+  s = db.SUnionstore("GP3_SINLINE_DEST", {"GP3_SINLINE_KEY1"}, value_to_dest, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 3);
+  ASSERT_TRUE(members_match(&db, "GP3_SINLINE_DEST", {"b", "c", "d"}));
+  s = db.SMove("GP3_SINLINE_KEY1", "GP3_SINLINE_DEST", "d", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  s = db.SMove("GP3_SINLINE_KEY1", "GP3_SINLINE_KEY2", "b", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(members_match(&db, "GP3_SINLINE_KEY1", {"c"}));
+  ASSERT_TRUE(members_match(&db, "GP3_SINLINE_KEY2", {"b"}));
+  ASSERT_TRUE(members_match(&db, "GP3_SINLINE_DEST", {"b", "c", "d"}));
+
+  // GP4 is popped empty and starts over
+  s = db.SAdd("GP4_SINLINE_KEY", {"a", "b", "c"}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.SPop("GP4_SINLINE_KEY", &members_out, 2);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(members_out.size(), 2);
+  ASSERT_TRUE(size_match(&db, "GP4_SINLINE_KEY", 1));
+  s = db.SPop("GP4_SINLINE_KEY", &members_out, 2);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(members_out.size(), 1);
+  ASSERT_TRUE(size_match(&db, "GP4_SINLINE_KEY", 0));
+  s = db.SAdd("GP4_SINLINE_KEY", {"z"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(members_match(&db, "GP4_SINLINE_KEY", {"z"}));
+
+  // GP5 is inline when the limits are lowered, and moves on its next write
+  s = db.SAdd("GP5_SINLINE_KEY", {"a", "b"}, &ret);
+  ASSERT_TRUE(s.ok());
+  db.SetSetMaxInline(1, storage_options.set_max_inline_value);
+  ASSERT_TRUE(members_match(&db, "GP5_SINLINE_KEY", {"a", "b"}));
+  s = db.SAdd("GP5_SINLINE_KEY", {"c"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(size_match(&db, "GP5_SINLINE_KEY", 3));
+  ASSERT_TRUE(members_match(&db, "GP5_SINLINE_KEY", {"a", "b", "c"}));
+  db.SetSetMaxInline(storage_options.set_max_inline_entries, storage_options.set_max_inline_value);
+}
+
 int main(int argc, char** argv) {
   if (!pstd::FileExists("./log")) {
     pstd::CreatePath("./log");
@@ -531,6 +531,42 @@ TEST_F(StringsTest, MGetTest) {
   ASSERT_EQ(vss[2].value, "");
   ASSERT_TRUE(vss[3].status.IsNotFound());
   ASSERT_EQ(vss[3].value, "");
+
+  // ***************** Group 3 Test *****************
+  // keys spread over all the instances come back in order
+  std::vector<storage::KeyValue> kvs3;
+  std::vector<std::string> keys3;
+  for (int idx = 0; idx < 200; idx++) {
+    kvs3.push_back({"GP3_MGET_KEY" + std::to_string(idx), "VALUE" + std::to_string(idx)});
+    keys3.push_back("GP3_MGET_KEY" + std::to_string(idx));
+  }
+  s = db.MSet(kvs3);
+  ASSERT_TRUE(s.ok());
+  int32_t ret = 0;
+  s = db.HSet("GP3_MGET_HASH_KEY", "FIELD", "VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  keys3.insert(keys3.begin() + 100, "GP3_MGET_HASH_KEY");
+  ASSERT_EQ(db.Expire("GP3_MGET_KEY0", 100), 1);
+
+  vss.clear();
+  s = db.MGetWithTTL(keys3, &vss);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(vss.size(), 201);
+  for (size_t idx = 0; idx < vss.size(); idx++) {
+    if (idx == 100) {
+      ASSERT_TRUE(vss[idx].status.IsNotFound());
+      ASSERT_EQ(vss[idx].ttl, -2);
+      continue;
+    }
+    size_t num = idx < 100 ? idx : idx - 1;
+    ASSERT_TRUE(vss[idx].status.ok());
+    ASSERT_EQ(vss[idx].value, "VALUE" + std::to_string(num));
+    if (num == 0) {
+      ASSERT_GT(vss[idx].ttl, 0);
+    } else {
+      ASSERT_EQ(vss[idx].ttl, -1);
+    }
+  }
 }
 
 // MSet
@@ -1007,6 +1043,57 @@ TEST_F(StringsTest, PKSetexAtTest) {
   ASSERT_EQ(ttl_ret, -2);
 }
 
+static uint64_t active_expired_count(storage::Storage* const db) {
+  std::string info;
+  db->GetRocksDBInfo(info);
+  uint64_t total = 0;
+  std::string metric = "active_expired_keys:";
+  for (size_t pos = info.find(metric); pos != std::string::npos; pos = info.find(metric, pos + 1)) {
+    total += std::strtoull(info.c_str() + pos + metric.size(), nullptr, 10);
+  }
+  return total;
+}
+
+// ActiveExpire
+TEST_F(StringsTest, ActiveExpireTest) {  // NOLINT
+  std::string path = "./db/strings_ttl_index";
+  pstd::DeleteDirIfExist(path);
+  mkdir(path.c_str(), 0755);
+  StorageOptions ttl_index_options;
+  ttl_index_options.options.create_if_missing = true;
+  ttl_index_options.enable_ttl_index = true;
+  storage::Storage ttl_index_db;
+  s = ttl_index_db.Open(ttl_index_options, path);
+  ASSERT_TRUE(s.ok());
+
+  // GP1 and GP3 expire, GP2 does not
+  s = ttl_index_db.Setex("GP1_ACTIVE_EXPIRE_KEY", "GP1_VALUE", 1);
+  ASSERT_TRUE(s.ok());
+  s = ttl_index_db.Setex("GP2_ACTIVE_EXPIRE_KEY", "GP2_VALUE", 100);
+  ASSERT_TRUE(s.ok());
+  int32_t ret = 0;
+  s = ttl_index_db.HSet("GP3_ACTIVE_EXPIRE_KEY", "GP3_FIELD", "GP3_VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ttl_index_db.Expire("GP3_ACTIVE_EXPIRE_KEY", 1), 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+
+  s = ttl_index_db.ActiveExpire();
+  ASSERT_TRUE(s.ok());
+  for (int retry = 0; retry < 100 && active_expired_count(&ttl_index_db) < 2; retry++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  ASSERT_EQ(active_expired_count(&ttl_index_db), 2);
+
+  std::string value;
+  s = ttl_index_db.Get("GP1_ACTIVE_EXPIRE_KEY", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = ttl_index_db.Get("GP2_ACTIVE_EXPIRE_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "GP2_VALUE");
+  ASSERT_EQ(ttl_index_db.Exists({"GP3_ACTIVE_EXPIRE_KEY"}), 0);
+  DeleteFiles(path.c_str());
+}
+
 int main(int argc, char** argv) {
   if (!pstd::FileExists("./log")) {
     pstd::CreatePath("./log");
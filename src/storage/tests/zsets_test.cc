@@ -3625,6 +3625,131 @@ TEST_F(ZSetsTest, ZRevrankTest) {  // NOLINT
   ASSERT_EQ(-1, rank);
 }
 
+// ZRANK / ZRANGE on a zset large enough to be cut into rank blocks
+TEST_F(ZSetsTest, ZRankIndexTest) {  // NOLINT
+  int32_t ret;
+  int32_t rank;
+  std::vector<storage::ScoreMember> score_members;
+
+  // {0, MM0000} {1, MM0001} ... {2999, MM2999}, added in shuffled batches
+  std::vector<storage::ScoreMember> expect_sm;
+  for (int32_t idx = 0; idx < 3000; idx++) {
+    char member[16];
+    snprintf(member, sizeof(member), "MM%04d", idx);
+    expect_sm.push_back({static_cast<double>(idx), member});
+  }
+  for (int32_t start = 0; start < 3; start++) {
+    std::vector<storage::ScoreMember> batch_sm;
+    for (int32_t idx = start; idx < 3000; idx += 3) {
+      batch_sm.push_back(expect_sm[idx]);
+    }
+    s = db.ZAdd("GP1_ZRANK_INDEX_KEY", batch_sm, &ret);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(1000, ret);
+  }
+  ASSERT_TRUE(size_match(&db, "GP1_ZRANK_INDEX_KEY", 3000));
+
+  for (int32_t idx : {0, 1, 511, 512, 1024, 1777, 2999}) {
+    s = db.ZRank("GP1_ZRANK_INDEX_KEY", expect_sm[idx].member, &rank);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(idx, rank);
+    s = db.ZRevrank("GP1_ZRANK_INDEX_KEY", expect_sm[idx].member, &rank);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(2999 - idx, rank);
+  }
+
+  s = db.ZRange("GP1_ZRANK_INDEX_KEY", 2047, 2049, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[2047], expect_sm[2048], expect_sm[2049]}));
+
+  s = db.ZRevrange("GP1_ZRANK_INDEX_KEY", 1500, 1501, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[1499], expect_sm[1498]}));
+
+  s = db.ZRangebyscore("GP1_ZRANK_INDEX_KEY", 100, 3000, true, true, 2, 1000, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[1100], expect_sm[1101]}));
+
+  s = db.ZRevrangebyscore("GP1_ZRANK_INDEX_KEY", 0, 2899, true, false, 2, 1000, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[1898], expect_sm[1897]}));
+
+  // Remove a range which covers several blocks, the ranks behind it shift
+  s = db.ZRemrangebyrank("GP1_ZRANK_INDEX_KEY", 100, 1899, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(1800, ret);
+  ASSERT_TRUE(size_match(&db, "GP1_ZRANK_INDEX_KEY", 1200));
+
+  s = db.ZRank("GP1_ZRANK_INDEX_KEY", "MM1900", &rank);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(100, rank);
+
+  s = db.ZRank("GP1_ZRANK_INDEX_KEY", "MM1000", &rank);
+  ASSERT_TRUE(s.IsNotFound());
+
+  s = db.ZRem("GP1_ZRANK_INDEX_KEY", {"MM0000", "MM0050", "MM2500"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(3, ret);
+
+  s = db.ZRank("GP1_ZRANK_INDEX_KEY", "MM2999", &rank);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(1196, rank);
+
+  s = db.ZRange("GP1_ZRANK_INDEX_KEY", 98, 99, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[1900], expect_sm[1901]}));
+
+  // Change the score of a member, it moves to the head
+  double score;
+  s = db.ZIncrby("GP1_ZRANK_INDEX_KEY", "MM2999", -5000, &score);
+  ASSERT_TRUE(s.ok());
+  s = db.ZRank("GP1_ZRANK_INDEX_KEY", "MM2999", &rank);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(0, rank);
+  s = db.ZRank("GP1_ZRANK_INDEX_KEY", "MM2998", &rank);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(1196, rank);
+
+  // ***************** Group 2 Test *****************
+  // large enough for the blocks to be cut into several groups
+  expect_sm.clear();
+  for (int32_t idx = 0; idx < 100000; idx++) {
+    char member[16];
+    snprintf(member, sizeof(member), "MM%06d", idx);
+    expect_sm.push_back({static_cast<double>(idx), member});
+  }
+  s = db.ZAdd("GP2_ZRANK_INDEX_KEY", expect_sm, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(100000, ret);
+  for (int32_t idx : {0, 32767, 32768, 65536, 70000, 99999}) {
+    s = db.ZRank("GP2_ZRANK_INDEX_KEY", expect_sm[idx].member, &rank);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(idx, rank);
+  }
+  s = db.ZRange("GP2_ZRANK_INDEX_KEY", 65535, 65536, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[65535], expect_sm[65536]}));
+
+  // empty the first groups but for a few members, then add to the last one
+  s = db.ZRemrangebyrank("GP2_ZRANK_INDEX_KEY", 10, 69999, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(69990, ret);
+  s = db.ZAdd("GP2_ZRANK_INDEX_KEY", {{100000.5, "MM_TAIL"}}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZRank("GP2_ZRANK_INDEX_KEY", "MM070000", &rank);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(10, rank);
+  s = db.ZRank("GP2_ZRANK_INDEX_KEY", "MM_TAIL", &rank);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(30010, rank);
+  s = db.ZRange("GP2_ZRANK_INDEX_KEY", 9, 10, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {expect_sm[9], expect_sm[70000]}));
+  s = db.ZRevrange("GP2_ZRANK_INDEX_KEY", 0, 1, &score_members);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(score_members_match(score_members, {{100000.5, "MM_TAIL"}, expect_sm[99999]}));
+}
+
 // ZSCORE
 TEST_F(ZSetsTest, ZScoreTest) {  // NOLINT
   int32_t ret;
@@ -5235,6 +5360,33 @@ TEST_F(ZSetsTest, ZScanTest) {  // NOLINT
   ASSERT_TRUE(score_members_match(score_member_out, {}));
 }
 
+// ZMScore
+TEST_F(ZSetsTest, ZMScoreTest) {  // NOLINT
+  int32_t ret = 0;
+  std::vector<storage::ScoreStatus> sss;
+  s = db.ZAdd("ZMSCORE_KEY", {{1.5, "MM1"}, {-2, "MM2"}, {100, "MM3"}}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 3);
+
+  // Not exist zset key
+  s = db.ZMScore("ZMSCORE_NOT_EXIST_KEY", {"MM1", "MM2"}, &sss);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(sss.size(), 2);
+  ASSERT_TRUE(sss[0].status.IsNotFound());
+  ASSERT_TRUE(sss[1].status.IsNotFound());
+
+  s = db.ZMScore("ZMSCORE_KEY", {"MM3", "NOT_EXIST_MEMBER", "MM1", "MM2"}, &sss);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(sss.size(), 4);
+  ASSERT_TRUE(sss[0].status.ok());
+  ASSERT_DOUBLE_EQ(sss[0].score, 100);
+  ASSERT_TRUE(sss[1].status.IsNotFound());
+  ASSERT_TRUE(sss[2].status.ok());
+  ASSERT_DOUBLE_EQ(sss[2].score, 1.5);
+  ASSERT_TRUE(sss[3].status.ok());
+  ASSERT_DOUBLE_EQ(sss[3].score, -2);
+}
+
 int main(int argc, char** argv) {
   if (!pstd::FileExists("./log")) {
     pstd::CreatePath("./log");
@@ -0,0 +1,284 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "include/pika_binlog.h"
+#include "include/pika_binlog_transverter.h"
+#include "include/pika_cmd_table_manager.h"
+#include "include/pika_conf.h"
+#include "include/pika_rm.h"
+#include "include/pika_server.h"
+#include "pstd/include/env.h"
+
+// Defined by pika.cc, which is not linked into the test
+std::unique_ptr<PikaConf> g_pika_conf;
+PikaServer* g_pika_server = nullptr;
+std::unique_ptr<PikaReplicaManager> g_pika_rm;
+std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
+
+struct Record {
+  uint64_t offset = 0;  // where the record starts in the file
+  BinlogItem item;
+};
+
+// Decode the records of a binlog file until the first hole
+static std::vector<Record> ReadRecords(const std::string& path, uint32_t filenum) {
+  std::vector<Record> records;
+  std::ifstream in(NewFileName(path + kBinlogPrefix, filenum), std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  uint64_t cursor = 0;
+  uint64_t start = 0;
+  std::string record;
+  while (cursor < data.size()) {
+    const uint64_t leftover = kBlockSize - cursor % kBlockSize;
+    if (leftover < kHeaderSize) {
+      cursor += leftover;
+      continue;
+    }
+    if (cursor + kHeaderSize > data.size()) {
+      break;
+    }
+    const auto* header = reinterpret_cast<const uint8_t*>(data.data() + cursor);
+    const uint32_t length = header[0] | (header[1] << 8) | (header[2] << 16);
+    const uint8_t type = header[7];
+    if (type == kZeroType || type > kLastType || cursor + kHeaderSize + length > data.size()) {
+      break;
+    }
+    if (type == kFullType || type == kFirstType) {
+      start = cursor;
+      record.clear();
+    }
+    record.append(data.data() + cursor + kHeaderSize, length);
+    cursor += kHeaderSize + length;
+    if (type == kFullType || type == kLastType) {
+      Record r;
+      r.offset = start;
+      EXPECT_TRUE(PikaBinlogTransverter::BinlogDecode(BinlogType::TypeFirst, record, &r.item));
+      records.push_back(r);
+    }
+  }
+  return records;
+}
+
+static std::string ReadFile(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+static void WriteFile(const std::string& filename, const std::string& data) {
+  std::fstream out(filename, std::ios::binary | std::ios::in | std::ios::out);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+class BinlogTest : public ::testing::Test {
+ public:
+  BinlogTest() = default;
+  ~BinlogTest() override = default;
+
+  void SetUp() override {
+    path_ = "./binlog_test/";
+    pstd::DeleteDirIfExist(path_);
+  }
+
+  void TearDown() override { pstd::DeleteDirIfExist(path_); }
+
+  std::string path_;
+};
+
+// Records appended after the saved manifest are recovered on open, also
+// when a record starts with the empty fragment left at the end of a block
+TEST_F(BinlogTest, RecoverTailAcrossBlockTest) {  // NOLINT
+  uint32_t filenum = 0;
+  uint64_t offset = 0;
+  uint64_t logic_id = 0;
+  std::string manifest;
+  {
+    Binlog binlog(path_);
+    binlog.StartSyncer(BinlogSyncPolicy::kInterval, 3600 * 1000, 0);
+    manifest = ReadFile(path_ + kManifest);
+
+    ASSERT_TRUE(binlog.Put("first").ok());
+    ASSERT_TRUE(binlog.GetProducerStatus(&filenum, &offset).ok());
+    const uint64_t overhead = offset - kHeaderSize - strlen("first");
+
+    // Leave exactly kHeaderSize bytes in the first block
+    const uint64_t len = kBlockSize - offset - 2 * kHeaderSize - overhead;
+    ASSERT_TRUE(binlog.Put(std::string(len, 'x')).ok());
+    ASSERT_TRUE(binlog.GetProducerStatus(&filenum, &offset).ok());
+    ASSERT_EQ(offset, kBlockSize - kHeaderSize);
+
+    // Starts with an empty kFirstType fragment
+    ASSERT_TRUE(binlog.Put("third").ok());
+    ASSERT_TRUE(binlog.Put("fourth").ok());
+    ASSERT_TRUE(binlog.GetProducerStatus(&filenum, &offset, nullptr, &logic_id).ok());
+    ASSERT_EQ(logic_id, 4);
+  }
+  // Crash before the syncer saves the manifest
+  WriteFile(path_ + kManifest, manifest);
+
+  Binlog binlog(path_);
+  uint32_t recovered_filenum = 0;
+  uint64_t recovered_offset = 0;
+  uint64_t recovered_logic_id = 0;
+  ASSERT_TRUE(binlog.GetProducerStatus(&recovered_filenum, &recovered_offset, nullptr, &recovered_logic_id).ok());
+  ASSERT_EQ(recovered_filenum, filenum);
+  ASSERT_EQ(recovered_offset, offset);
+  ASSERT_EQ(recovered_logic_id, logic_id);
+
+  // Nothing recovered is overwritten by the next append
+  ASSERT_TRUE(binlog.Put("fifth").ok());
+  std::vector<Record> records = ReadRecords(path_, 0);
+  ASSERT_EQ(records.size(), 5);
+  ASSERT_EQ(records[0].item.content(), "first");
+  ASSERT_EQ(records[2].item.content(), "third");
+  ASSERT_EQ(records[3].item.content(), "fourth");
+  ASSERT_EQ(records[4].item.content(), "fifth");
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(records[i].item.logic_id(), i + 1);
+  }
+}
+
+// Check the records of all the files: logic ids without gap, offsets and
+// filenums where the records really are, and the order of every thread
+static void CheckRecords(const std::string& path, uint32_t last_filenum, size_t threads, size_t puts) {
+  std::vector<Record> records;
+  for (uint32_t filenum = 0; filenum <= last_filenum; filenum++) {
+    for (auto& r : ReadRecords(path, filenum)) {
+      ASSERT_EQ(r.item.filenum(), filenum);
+      // A record taken at a block trailer starts in the next block
+      uint64_t offset = r.item.offset();
+      if (kBlockSize - offset % kBlockSize < kHeaderSize) {
+        offset += kBlockSize - offset % kBlockSize;
+      }
+      ASSERT_EQ(offset, r.offset);
+      records.push_back(r);
+    }
+  }
+  ASSERT_EQ(records.size(), threads * puts);
+
+  std::vector<size_t> next(threads, 0);
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(records[i].item.logic_id(), i + 1);
+    const std::string content = records[i].item.content();
+    const size_t sep = content.find(':');
+    ASSERT_NE(sep, std::string::npos);
+    const size_t thread = std::stoul(content.substr(0, sep));
+    const size_t seq = std::stoul(content.substr(sep + 1, content.find(':', sep + 1) - sep - 1));
+    ASSERT_LT(thread, threads);
+    ASSERT_EQ(seq, next[thread]++);
+  }
+}
+
+static void ConcurrentPut(Binlog* binlog, size_t threads, size_t puts, size_t value_size) {
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([binlog, t, puts, value_size] {
+      for (size_t i = 0; i < puts; i++) {
+        std::string item = std::to_string(t) + ":" + std::to_string(i) + ":";
+        item.append(value_size, 'v');
+        ASSERT_TRUE(binlog->Put(item).ok());
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+TEST_F(BinlogTest, ConcurrentPutTest) {  // NOLINT
+  const size_t threads = 8;
+  const size_t puts = 500;
+  Binlog binlog(path_);
+  ConcurrentPut(&binlog, threads, puts, 16);
+
+  uint32_t filenum = 0;
+  uint64_t offset = 0;
+  uint64_t logic_id = 0;
+  ASSERT_TRUE(binlog.GetProducerStatus(&filenum, &offset, nullptr, &logic_id).ok());
+  ASSERT_EQ(filenum, 0);
+  ASSERT_EQ(logic_id, threads * puts);
+  CheckRecords(path_, filenum, threads, puts);
+
+  // The producer offset is right behind the last record
+  ASSERT_TRUE(binlog.Put("last").ok());
+  std::vector<Record> records = ReadRecords(path_, 0);
+  ASSERT_EQ(records.back().item.offset(), offset);
+}
+
+// Groups of large records cross blocks and roll the file in the middle
+TEST_F(BinlogTest, GroupCrossFileTest) {  // NOLINT
+  const size_t threads = 4;
+  const size_t puts = 100;
+  Binlog binlog(path_, 4 * kBlockSize);
+  ConcurrentPut(&binlog, threads, puts, kBlockSize / 3);
+
+  uint32_t filenum = 0;
+  uint64_t offset = 0;
+  uint64_t logic_id = 0;
+  ASSERT_TRUE(binlog.GetProducerStatus(&filenum, &offset, nullptr, &logic_id).ok());
+  ASSERT_GT(filenum, 1);
+  ASSERT_EQ(logic_id, threads * puts);
+  CheckRecords(path_, filenum, threads, puts);
+}
+
+static void WaitPendingWriters(Binlog* binlog, size_t count) {
+  while (binlog->PendingWriters() < count) {
+    std::this_thread::yield();
+  }
+}
+
+// The callers queued behind a failed leader get its error instead of hanging
+TEST_F(BinlogTest, LeaderErrorTest) {  // NOLINT
+  Binlog binlog(path_);
+  ASSERT_TRUE(binlog.Put("before").ok());
+
+  // The leader blocks on the binlog lock after it takes its group
+  binlog.Lock();
+  std::vector<pstd::Status> status(4);
+  std::vector<std::thread> workers;
+  workers.emplace_back([&binlog, &status] { status[0] = binlog.Put("leader"); });
+  // The leader takes its group in the same critical section it queues in
+  WaitPendingWriters(&binlog, 1);
+  for (size_t i = 1; i < status.size(); i++) {
+    workers.emplace_back([&binlog, &status, i] { status[i] = binlog.Put("follower"); });
+  }
+  WaitPendingWriters(&binlog, status.size());
+  // The producer status can not be taken any more, the groups fail
+  binlog.Close();
+  binlog.Unlock();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (const auto& s : status) {
+    ASSERT_TRUE(s.IsBusy()) << s.ToString();
+  }
+
+  std::vector<Record> records = ReadRecords(path_, 0);
+  ASSERT_EQ(records.size(), 1);
+  ASSERT_EQ(records[0].item.content(), "before");
+}
+
+int main(int argc, char** argv) {
+  if (!pstd::FileExists("./log")) {
+    pstd::CreatePath("./log");
+  }
+  FLAGS_log_dir = "./log";
+  FLAGS_minloglevel = 0;
+  FLAGS_max_log_size = 1800;
+  FLAGS_logbufsecs = 0;
+  ::google::InitGoogleLogging("pika_binlog_test");
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
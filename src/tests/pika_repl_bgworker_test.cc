@@ -0,0 +1,112 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "include/pika_cmd_table_manager.h"
+#include "include/pika_conf.h"
+#include "include/pika_repl_bgworker.h"
+#include "include/pika_repl_client.h"
+#include "include/pika_rm.h"
+#include "include/pika_server.h"
+#include "pstd/include/env.h"
+
+// Defined by pika.cc, which is not linked into the test
+std::unique_ptr<PikaConf> g_pika_conf;
+PikaServer* g_pika_server = nullptr;
+std::unique_ptr<PikaReplicaManager> g_pika_rm;
+std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
+
+static std::shared_ptr<ReplWriteDBBarrier> NewBarrier(const std::vector<std::string>& keys) {
+  return std::make_shared<ReplWriteDBBarrier>(1, keys, false);
+}
+
+static void SchedulePlaceholder(PikaReplBgWorker* worker, const std::shared_ptr<ReplWriteDBBarrier>& barrier) {
+  worker->ScheduleWriteDB(new ReplClientWriteDBTaskArg(nullptr, LogOffset(), "db0", barrier));
+}
+
+class ReplBgWorkerTest : public ::testing::Test {
+ public:
+  ReplBgWorkerTest() = default;
+  ~ReplBgWorkerTest() override = default;
+
+  static void SetUpTestSuite() { g_pika_conf = std::make_unique<PikaConf>("./pika.conf"); }
+  static void TearDownTestSuite() { g_pika_conf.reset(); }
+};
+
+// A worker past a placeholder only waits before the tasks sharing its keys
+TEST_F(ReplBgWorkerTest, PlaceholderHoldsItsKeysTest) {  // NOLINT
+  PikaReplBgWorker worker(16);
+  ASSERT_EQ(worker.StartThread(), 0);
+
+  auto held = NewBarrier({"k1", "k2"});
+  auto other = NewBarrier({"k3"});
+  auto conflicting = NewBarrier({"k2"});
+  SchedulePlaceholder(&worker, held);
+  SchedulePlaceholder(&worker, other);
+  SchedulePlaceholder(&worker, conflicting);
+
+  // other goes past held, which is not applied yet
+  ASSERT_TRUE(held->WaitArrived());
+  ASSERT_TRUE(other->WaitArrived());
+  other->Applied();
+  held->Applied();
+  ASSERT_TRUE(conflicting->WaitArrived());
+  conflicting->Applied();
+
+  worker.CancelWriteDB();
+  ASSERT_EQ(worker.StopThread(), 0);
+}
+
+// Stopping the workers wakes up a worker waiting for a barrier whose other
+// part is left in the queue of a stopped worker
+TEST_F(ReplBgWorkerTest, StopWithPendingBarrierTest) {  // NOLINT
+  // The queue of running is drained once it has room for one task
+  PikaReplBgWorker running(1);
+  PikaReplBgWorker stopped(16);
+  ASSERT_EQ(running.StartThread(), 0);
+
+  auto pending = NewBarrier({"k1"});
+  auto waiting = NewBarrier({"k1"});
+  SchedulePlaceholder(&stopped, pending);
+  SchedulePlaceholder(&running, pending);
+  ASSERT_TRUE(pending->WaitArrived());
+  // Held by pending, which is never applied
+  SchedulePlaceholder(&running, waiting);
+  running.WaitWriteDBRoom();
+  ASSERT_FALSE(pending->IsDone());
+  ASSERT_FALSE(waiting->IsDone());
+
+  stopped.CancelWriteDB();
+  running.CancelWriteDB();
+  ASSERT_EQ(stopped.StopThread(), 0);
+  ASSERT_EQ(running.StopThread(), 0);
+  ASSERT_TRUE(pending->IsDone());
+  ASSERT_TRUE(waiting->IsDone());
+  ASSERT_FALSE(waiting->WaitApplied());
+
+  // Whatever is queued once cancelled never holds anyone
+  auto late = NewBarrier({"k1"});
+  SchedulePlaceholder(&running, late);
+  ASSERT_TRUE(late->IsDone());
+}
+
+int main(int argc, char** argv) {
+  if (!pstd::FileExists("./log")) {
+    pstd::CreatePath("./log");
+  }
+  FLAGS_log_dir = "./log";
+  FLAGS_minloglevel = 0;
+  FLAGS_max_log_size = 1800;
+  FLAGS_logbufsecs = 0;
+  ::google::InitGoogleLogging("pika_repl_bgworker_test");
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
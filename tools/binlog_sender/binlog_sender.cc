@@ -205,7 +205,11 @@ int main(int argc, char* argv[]) {
     pstd::Status s = binlog_consumer->Parse(&scratch);
     if (s.ok()) {
       if (PikaBinlogTransverter::BinlogDecode(TypeFirst, scratch, &binlog_item)) {
-        std::string redis_cmd = binlog_item.content();
+        std::string redis_cmd;
+        if (!PikaBinlogTransverter::ContentToResp(binlog_item.content(), &redis_cmd)) {
+          std::cout << "Binlog content decode error, exit..." << std::endl;
+          exit(-1);
+        }
         if (tv_start <= binlog_item.exec_time() && binlog_item.exec_time() <= tv_end) {
           pstd::Status net_s = cli->Send(&redis_cmd);
           if (net_s.ok()) {
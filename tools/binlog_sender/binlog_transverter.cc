@@ -5,6 +5,9 @@
 
 #include "binlog_transverter.h"
 
+#include <lz4.h>
+#include <zstd.h>
+
 uint32_t BinlogItem::exec_time() const { return exec_time_; }
 
 uint32_t BinlogItem::server_id() const { return server_id_; }
@@ -86,3 +89,61 @@ bool PikaBinlogTransverter::BinlogDecode(BinlogType type, const std::string& bin
   binlog_str.erase(0, content_length);
   return true;
 }
+
+bool PikaBinlogTransverter::ContentToResp(const std::string& content, std::string* resp) {
+  if (content.empty()) {
+    return false;
+  }
+  if (content[0] == '*') {
+    *resp = content;
+    return true;
+  }
+
+  std::string args;
+  const char* ptr = content.data() + 1;
+  const char* limit = content.data() + content.size();
+  auto format = static_cast<uint8_t>(content[0]);
+  if (format == kBinlogContentLZ4 || format == kBinlogContentZSTD) {
+    uint32_t args_len = 0;
+    ptr = pstd::GetVarint32Ptr(ptr, limit, &args_len);
+    if (!ptr) {
+      return false;
+    }
+    args.resize(args_len);
+    if (format == kBinlogContentLZ4) {
+      int n = LZ4_decompress_safe(ptr, &args[0], static_cast<int>(limit - ptr), static_cast<int>(args_len));
+      if (n < 0 || static_cast<uint32_t>(n) != args_len) {
+        return false;
+      }
+    } else {
+      size_t n = ZSTD_decompress(&args[0], args_len, ptr, limit - ptr);
+      if (ZSTD_isError(n) || n != args_len) {
+        return false;
+      }
+    }
+    ptr = args.data();
+    limit = args.data() + args.size();
+  } else if (format != kBinlogContentBinary) {
+    return false;
+  }
+
+  uint32_t argc = 0;
+  ptr = pstd::GetVarint32Ptr(ptr, limit, &argc);
+  if (!ptr) {
+    return false;
+  }
+  resp->clear();
+  resp->append("*" + std::to_string(argc) + "\r\n");
+  for (uint32_t i = 0; i < argc; i++) {
+    uint32_t len = 0;
+    ptr = pstd::GetVarint32Ptr(ptr, limit, &len);
+    if (!ptr || static_cast<size_t>(limit - ptr) < len) {
+      return false;
+    }
+    resp->append("$" + std::to_string(len) + "\r\n");
+    resp->append(ptr, len);
+    resp->append("\r\n");
+    ptr += len;
+  }
+  return true;
+}
@@ -22,6 +22,13 @@ enum BinlogType {
   TypeFirst = 1,
 };
 
+// Content formats other than RESP, see include/pika_binlog_transverter.h
+enum BinlogContentFormat : uint8_t {
+  kBinlogContentBinary = 1,
+  kBinlogContentLZ4 = 2,
+  kBinlogContentZSTD = 3,
+};
+
 class BinlogItem {
  public:
   BinlogItem() : exec_time_(0), server_id_(0), logic_id_(0), filenum_(0), offset_(0), content_("") {}
@@ -60,6 +67,9 @@ class PikaBinlogTransverter {
                                   const std::vector<std::string>& extends);
 
   static bool BinlogDecode(BinlogType type, const std::string& binlog, BinlogItem* binlog_item);
+
+  // Convert a content of any format to the RESP text of the command
+  static bool ContentToResp(const std::string& content, std::string* resp);
 };
 
 #endif